@@ -0,0 +1,177 @@
+// Headless benchmark for the batched enemy decision kernel.
+// Usage: bench_ai [enemies] [ticks]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/enemy_kernel.h"
+
+#define BENCH_WORLD_SIZE 4096
+
+// Seconds on the monotonic clock
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Fill a batch with a mixed population scattered over a large world
+static void populate(EnemyBatch *batch, int count, unsigned int seed) {
+    srand(seed);
+    batch->count = count;
+    for (int i = 0; i < count; i++) {
+        EntityType type = (EntityType)(ENTITY_ENEMY_CHASE + rand() % 4);
+        batch->x[i] = (short)(1 + rand() % (BENCH_WORLD_SIZE - 2));
+        batch->y[i] = (short)(1 + rand() % (BENCH_WORLD_SIZE - 2));
+        batch->type[i] = (unsigned char)type;
+        batch->range[i] = (short)enemy_detection_range(type, 1 + rand() % MAX_LEVEL);
+        batch->cooldown[i] = (short)(rand() % enemy_move_frequency(type));
+        batch->phase[i] = 0;
+        batch->rng[i] = (unsigned int)rand() | 1u;
+    }
+}
+
+// Apply the decided steps, keeping enemies inside the world
+static void apply_steps(EnemyBatch *batch) {
+    for (int i = 0; i < batch->count; i++) {
+        int nx = batch->x[i] + batch->step_x[i];
+        int ny = batch->y[i] + batch->step_y[i];
+        if (nx > 0 && nx < BENCH_WORLD_SIZE - 1) batch->x[i] = (short)nx;
+        if (ny > 0 && ny < BENCH_WORLD_SIZE - 1) batch->y[i] = (short)ny;
+    }
+}
+
+// Player target for a given tick: walks a slow circle around the world center
+static EnemyTarget target_for_tick(int tick) {
+    EnemyTarget target;
+    target.visible = (tick % 50) != 49;  // Occasionally lose track of the player
+    target.x = BENCH_WORLD_SIZE / 2 + (tick % 200) - 100;
+    target.y = BENCH_WORLD_SIZE / 2 + ((tick / 200) % 200) - 100;
+    target.has_velocity = tick > 0;
+    target.vx = tick % 3 == 0 ? 1 : 0;
+    target.vy = tick % 3 == 1 ? -1 : 0;
+    return target;
+}
+
+// Run a kernel for a number of ticks and print its throughput
+// (only the kernel itself is timed, not the movement step)
+static void run(const char *label, int (*kernel)(EnemyBatch *, const EnemyTarget *, bool),
+                EnemyBatch *batch, int ticks, bool use_cooldown) {
+    long decisions = 0;
+    double elapsed = 0.0;
+    for (int tick = 0; tick < ticks; tick++) {
+        EnemyTarget target = target_for_tick(tick);
+        double start = now_seconds();
+        decisions += kernel(batch, &target, use_cooldown);
+        elapsed += now_seconds() - start;
+        apply_steps(batch);
+    }
+
+    double updates = (double)batch->count * ticks;
+    printf("%-28s %8.2f ms  %12.0f enemies/s  %12.0f decisions/s\n", label, elapsed * 1000.0,
+           elapsed > 0 ? updates / elapsed : 0.0, elapsed > 0 ? decisions / elapsed : 0.0);
+}
+
+// Run the kernel the way the game does: every tick the lanes of an unsorted
+// population are gathered into a batch grouped by type, decided, and the
+// results written back (gather and scatter are timed with the kernel)
+static void run_gathered(const char *label, EnemyBatch *population, int ticks) {
+    EnemyBatch grouped;
+    int *lanes = malloc(sizeof(int) * population->count);
+    int *order = malloc(sizeof(int) * population->count);
+    if (lanes == NULL || order == NULL || !enemy_batch_alloc(&grouped, population->count)) {
+        free(lanes);
+        free(order);
+        return;
+    }
+    for (int i = 0; i < population->count; i++) {
+        lanes[i] = i;
+    }
+
+    long decisions = 0;
+    double elapsed = 0.0;
+    for (int tick = 0; tick < ticks; tick++) {
+        EnemyTarget target = target_for_tick(tick);
+        double start = now_seconds();
+        enemy_batch_gather_by_type(&grouped, population, lanes, population->count, order);
+        decisions += enemy_kernel_decide(&grouped, &target, false);
+        enemy_batch_scatter(&grouped, population, order);
+        elapsed += now_seconds() - start;
+        apply_steps(population);
+    }
+
+    double updates = (double)population->count * ticks;
+    printf("%-28s %8.2f ms  %12.0f enemies/s  %12.0f decisions/s\n", label, elapsed * 1000.0,
+           elapsed > 0 ? updates / elapsed : 0.0, elapsed > 0 ? decisions / elapsed : 0.0);
+
+    enemy_batch_free(&grouped);
+    free(lanes);
+    free(order);
+}
+
+// Check that the vector path matches the scalar reference lane for lane
+static bool verify(int count, int ticks) {
+    EnemyBatch a, b;
+    if (!enemy_batch_alloc(&a, count) || !enemy_batch_alloc(&b, count)) return false;
+    populate(&a, count, 1234);
+    enemy_batch_sort_by_type(&a);
+    populate(&b, count, 1234);
+    enemy_batch_sort_by_type(&b);
+
+    bool ok = true;
+    for (int tick = 0; tick < ticks && ok; tick++) {
+        EnemyTarget target = target_for_tick(tick);
+        bool use_cooldown = (tick % 2) == 0;
+        enemy_kernel_decide(&a, &target, use_cooldown);
+        enemy_kernel_decide_scalar(&b, &target, use_cooldown);
+        ok = memcmp(a.step_x, b.step_x, count) == 0 && memcmp(a.step_y, b.step_y, count) == 0 &&
+             memcmp(a.rng, b.rng, sizeof(unsigned int) * count) == 0 &&
+             memcmp(a.phase, b.phase, sizeof(unsigned short) * count) == 0 &&
+             memcmp(a.cooldown, b.cooldown, sizeof(short) * count) == 0;
+        apply_steps(&a);
+        apply_steps(&b);
+    }
+
+    enemy_batch_free(&a);
+    enemy_batch_free(&b);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 16384;
+    int ticks = argc > 2 ? atoi(argv[2]) : 500;
+    if (count <= 0 || ticks <= 0) {
+        fprintf(stderr, "Usage: %s [enemies] [ticks]\n", argv[0]);
+        return 1;
+    }
+
+    printf("bench_ai: %d enemies, %d ticks, %d-lane kernel\n", count, ticks, ENEMY_KERNEL_LANES);
+
+    if (!verify(count < 4096 ? count : 4096, 64)) {
+        printf("FAIL: vector kernel does not match the scalar reference\n");
+        return 1;
+    }
+    printf("vector kernel matches scalar reference\n");
+
+    EnemyBatch batch;
+    if (!enemy_batch_alloc(&batch, count)) return 1;
+
+    populate(&batch, count, 42);
+    run("scalar, unsorted:", enemy_kernel_decide_scalar, &batch, ticks, false);
+
+    // The kernel is only ever run on batches grouped by type: on a mixed
+    // batch its same-type runs are too short to fill the vector lanes
+    populate(&batch, count, 42);
+    run_gathered("batched, gathered by type:", &batch, ticks);
+
+    populate(&batch, count, 42);
+    enemy_batch_sort_by_type(&batch);
+    run("batched, grouped by type:", enemy_kernel_decide, &batch, ticks, false);
+
+    populate(&batch, count, 42);
+    enemy_batch_sort_by_type(&batch);
+    run("batched, with cooldowns:", enemy_kernel_decide, &batch, ticks, true);
+
+    enemy_batch_free(&batch);
+    return 0;
+}
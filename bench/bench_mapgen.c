@@ -0,0 +1,144 @@
+// Headless benchmark for the level generator.
+// Usage: bench_mapgen [width] [height] [levels] [seed] [candidates] [budget_ms]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/mapgen.h"
+
+// Threads of the multi-threaded leg of verify; set explicitly so that a
+// single-CPU host still splits bands and runs best-of-N in parallel
+#define VERIFY_THREADS 4
+
+// Seconds on the monotonic clock
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// FNV-1a hash of a generated map, printed so runs can be compared across builds
+static unsigned int hash_map(const GameMap *map) {
+    unsigned int hash = 2166136261u;
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            hash = (hash ^ (unsigned int)MAP_TILE(map, x, y)) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+// Allocate a stride-padded tile buffer the way the shared segment lays it out
+static bool alloc_map(GameMap *map, int width, int height) {
+    map->width = width;
+    map->height = height;
+    map->stride = MAP_STRIDE_FOR(width);
+    map->tiles = calloc(MAP_CELLS(map), sizeof(MapTile));
+    return map->tiles != NULL;
+}
+
+// Check that the same (seed, level) produces the same map twice, and that
+// the single-threaded and multi-threaded paths agree (best-of-N included,
+// without a time budget)
+static bool verify(int width, int height, unsigned int seed, int candidates) {
+    GameMap a, b;
+    bool allocated_a = alloc_map(&a, width, height);
+    bool allocated_b = alloc_map(&b, width, height);
+    if (!allocated_a || !allocated_b) {
+        free(allocated_a ? a.tiles : NULL);
+        free(allocated_b ? b.tiles : NULL);
+        return false;
+    }
+
+    bool ok = true;
+    for (int level = 1; level <= MAX_LEVEL && ok; level++) {
+        MapGenParams params;
+        mapgen_default_params(level, &params);
+        params.candidates = candidates;
+        params.threads = VERIFY_THREADS;
+        MapGenParams single = params;
+        single.threads = 1;
+        ok = mapgen_generate(seed, level, width, height, &params, &a, NULL) &&
+             mapgen_generate(seed, level, width, height, &single, &b, NULL) &&
+             memcmp(a.tiles, b.tiles, MAP_CELLS(&a)) == 0;
+        if (ok) {
+            printf("level %d seed %u: map hash %08x\n", level, seed, hash_map(&a));
+        }
+    }
+
+    free(a.tiles);
+    free(b.tiles);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    int width = argc > 1 ? atoi(argv[1]) : DEFAULT_MAP_WIDTH;
+    int height = argc > 2 ? atoi(argv[2]) : DEFAULT_MAP_HEIGHT;
+    int levels = argc > 3 ? atoi(argv[3]) : 200;
+    unsigned int seed = argc > 4 ? (unsigned int)strtoul(argv[4], NULL, 10) : 12345u;
+    int candidates = argc > 5 ? atoi(argv[5]) : 1;
+    int budget_ms = argc > 6 ? atoi(argv[6]) : 0;
+    if (width < MAPGEN_MIN_SIZE || height < MAPGEN_MIN_SIZE ||
+        width > MAX_MAP_SIZE || height > MAX_MAP_SIZE || levels <= 0 ||
+        candidates < 1 || candidates > MAPGEN_MAX_CANDIDATES || budget_ms < 0) {
+        fprintf(stderr, "Usage: %s [width %d..%d] [height %d..%d] [levels] [seed] [candidates 1..%d] [budget_ms]\n",
+                argv[0], MAPGEN_MIN_SIZE, MAX_MAP_SIZE, MAPGEN_MIN_SIZE, MAX_MAP_SIZE, MAPGEN_MAX_CANDIDATES);
+        return 1;
+    }
+
+    printf("bench_mapgen: %dx%d, %d levels, best of %d", width, height, levels, candidates);
+    if (budget_ms > 0) printf(" within %d ms", budget_ms);
+    printf("\n");
+
+    // Also compare at a height that splits into VERIFY_THREADS bands, with
+    // as many candidates as threads, since small maps run single-threaded
+    int band_height = VERIFY_THREADS * MAPGEN_MIN_BAND_ROWS;
+    if (!verify(width, height, seed, candidates) ||
+        (height < band_height && !verify(width, band_height, seed, VERIFY_THREADS))) {
+        printf("FAIL: generation is not deterministic across runs or thread counts\n");
+        return 1;
+    }
+
+    GameMap map;
+    if (!alloc_map(&map, width, height)) {
+        perror("tile buffer allocation failed");
+        return 1;
+    }
+
+    MapGenStats total = {0};
+    double start = now_seconds();
+    for (int i = 0; i < levels; i++) {
+        int level = 1 + i % MAX_LEVEL;
+        MapGenParams params;
+        MapGenStats stats;
+        mapgen_default_params(level, &params);
+        params.candidates = candidates;
+        params.budget_ms = budget_ms;
+        if (!mapgen_generate(seed + (unsigned int)i, level, width, height, &params, &map, &stats)) {
+            free(map.tiles);
+            return 1;
+        }
+        total.noise_ms += stats.noise_ms;
+        total.smoothing_ms += stats.smoothing_ms;
+        total.carving_ms += stats.carving_ms;
+        total.placement_ms += stats.placement_ms;
+        total.components += stats.components;
+        total.tiles_carved += stats.tiles_carved;
+        total.candidates += stats.candidates;
+        total.quality += stats.quality;
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("%-12s %10.1f levels/s  (%.3f ms/level)\n", "total:", levels / elapsed, elapsed * 1000.0 / levels);
+    printf("%-12s %10.3f ms/level\n", "noise:", total.noise_ms / levels);
+    printf("%-12s %10.3f ms/level\n", "smoothing:", total.smoothing_ms / levels);
+    printf("%-12s %10.3f ms/level\n", "carving:", total.carving_ms / levels);
+    printf("%-12s %10.3f ms/level\n", "placement:", total.placement_ms / levels);
+    printf("%-12s %10.1f components, %.1f walls carved per level\n", "repair:",
+           (double)total.components / levels, (double)total.tiles_carved / levels);
+    printf("%-12s %10.3f score, %.1f candidates per level\n", "quality:",
+           total.quality / levels, (double)total.candidates / levels);
+
+    free(map.tiles);
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Headless benchmark for the particle system.
+// Usage: bench_particles [particles] [ticks]
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../include/particles.h"
+
+#define BENCH_TICK_SECONDS (1.0f / 60.0f)
+
+// Seconds on the monotonic clock
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Spawn particles of every kind until the system holds count of them
+static void top_up(ParticleSystem *ps, int count) {
+    SDL_Color color = {255, 200, 100, 255};
+    while (ps->count < count) {
+        float x = (float)(rand() % 4096);
+        float y = (float)(rand() % 4096);
+        particles_spawn(ps, x, y, color, (ParticleKind)(rand() % 3));
+    }
+}
+
+// Run an update for a number of ticks, refilling the deaths between ticks,
+// and print its throughput (only the update itself is timed)
+static void run(const char *label, void (*update)(ParticleSystem *, float),
+                ParticleSystem *ps, int count, int ticks) {
+    srand(42);
+    ps->count = 0;
+    top_up(ps, count);
+
+    double elapsed = 0.0;
+    for (int tick = 0; tick < ticks; tick++) {
+        double start = now_seconds();
+        update(ps, BENCH_TICK_SECONDS);
+        elapsed += now_seconds() - start;
+        top_up(ps, count);
+    }
+
+    double updates = (double)count * ticks;
+    printf("%-20s %8.2f ms  %8.3f ms/tick  %12.0f particles/s\n", label, elapsed * 1000.0,
+           elapsed * 1000.0 / ticks, elapsed > 0 ? updates / elapsed : 0.0);
+}
+
+// Time spawning into an empty system
+static void run_spawn(ParticleSystem *ps, int count) {
+    srand(42);
+    ps->count = 0;
+    double start = now_seconds();
+    top_up(ps, count);
+    double elapsed = now_seconds() - start;
+    printf("%-20s %8.2f ms  %12.0f spawns/s\n", "spawn:", elapsed * 1000.0,
+           elapsed > 0 ? count / elapsed : 0.0);
+}
+
+// Check that the vector update matches the scalar reference particle for particle
+static bool verify(int count, int ticks) {
+    ParticleSystem a, b;
+    if (!particles_init(&a, count) || !particles_init(&b, count)) return false;
+    srand(1234);
+    top_up(&a, count);
+    srand(1234);
+    top_up(&b, count);
+
+    bool ok = true;
+    for (int tick = 0; tick < ticks && ok; tick++) {
+        particles_update(&a, BENCH_TICK_SECONDS);
+        particles_update_scalar(&b, BENCH_TICK_SECONDS);
+        ok = a.count == b.count;
+        for (int i = 0; i < a.count && ok; i++) {
+            ok = fabsf(a.x[i] - b.x[i]) < 1e-4f && fabsf(a.y[i] - b.y[i]) < 1e-4f &&
+                 fabsf(a.vy[i] - b.vy[i]) < 1e-4f && fabsf(a.life[i] - b.life[i]) < 1e-4f;
+        }
+    }
+
+    particles_free(&a);
+    particles_free(&b);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 50000;
+    int ticks = argc > 2 ? atoi(argv[2]) : 600;
+    if (count <= 0 || ticks <= 0) {
+        fprintf(stderr, "Usage: %s [particles] [ticks]\n", argv[0]);
+        return 1;
+    }
+
+    printf("bench_particles: %d particles, %d ticks, %d-lane update\n", count, ticks, PARTICLE_LANES);
+
+    if (!verify(count < 4099 ? count : 4099, 90)) {
+        printf("FAIL: vector update does not match the scalar reference\n");
+        return 1;
+    }
+    printf("vector update matches scalar reference\n");
+
+    ParticleSystem ps;
+    if (!particles_init(&ps, count)) return 1;
+
+    run_spawn(&ps, count);
+    run("scalar update:", particles_update_scalar, &ps, count, ticks);
+    run("vector update:", particles_update, &ps, count, ticks);
+
+    particles_free(&ps);
+    return 0;
+}
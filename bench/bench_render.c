@@ -0,0 +1,306 @@
+// Headless benchmark for the render path (render_game and render_game_ui).
+// Frames are drawn by SDL's software renderer into an offscreen surface, so
+// no display is needed.
+// Usage: bench_render [frames] [seed] [--hashes]
+//   --hashes prints an FNV-1a hash of every frame and of each fixture, to
+//   check that a rendering change leaves the output unchanged
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <SDL2/SDL.h>
+#include "../include/game.h"
+#include "../include/mapgen.h"
+#include "../include/occupancy.h"
+#include "../include/frame_clock.h"
+#include "../include/sine_lut.h"
+#include "../include/tile_layer.h"
+#include "../include/ui_cache.h"
+#include "../include/render_batch.h"
+#include "../include/sprite_atlas.h"
+#include "../include/text.h"
+
+#define BENCH_MAP_SIZE DEFAULT_MAP_WIDTH
+
+// A canned game state to render
+typedef struct {
+    const char *name;
+    void (*setup)(GameState *state);
+} Fixture;
+
+// Seconds on the monotonic clock
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned int bench_seed = 1;
+
+// Next floor tile at or after (x, y) in row order, wrapping inside the map
+static void find_floor(const GameMap *map, int *x, int *y) {
+    for (int i = 0; i < map->width * map->height; i++) {
+        int cx = (*x + i) % map->width;
+        int cy = (*y + (*x + i) / map->width) % map->height;
+        if (MAP_TILE(map, cx, cy) == TILE_EMPTY) {
+            *x = cx;
+            *y = cy;
+            return;
+        }
+    }
+}
+
+// Put a player on the nearest floor tile
+static void place_player(GameState *state, int id, int x, int y) {
+    find_floor(&state->map, &x, &y);
+    Player *p = &state->players[id];
+    p->id = id;
+    p->x = x;
+    p->y = y;
+    p->health = 100;
+    p->is_active = true;
+    p->type = ENTITY_PLAYER;
+    occupancy_move(state, ENTITY_ID_PLAYER(id), x, y);
+    if (id >= state->num_players) state->num_players = id + 1;
+}
+
+// Put an enemy of a type on the nearest floor tile
+static void place_enemy(GameState *state, int id, EntityType type, int x, int y) {
+    find_floor(&state->map, &x, &y);
+    state->enemies.x[id] = (short)x;
+    state->enemies.y[id] = (short)y;
+    state->enemies.type[id] = (unsigned char)type;
+    state->enemies.active[id] = true;
+    occupancy_move(state, ENTITY_ID_ENEMY(id), x, y);
+    if (id >= state->num_enemies) state->num_enemies = id + 1;
+}
+
+// Level 1 as the game generates it: player at the start, a few enemies in
+// view, nothing collected yet
+static void setup_fresh(GameState *state) {
+    place_player(state, 0, 4, 4);
+    place_enemy(state, 0, ENTITY_ENEMY_CHASE, 14, 6);
+    place_enemy(state, 1, ENTITY_ENEMY_RANDOM, 22, 10);
+    place_enemy(state, 2, ENTITY_ENEMY_GUARD, 30, 14);
+    state->keys_required = 5;
+    state->current_time = state->start_time + 12;
+}
+
+// Every player and enemy on screen, keys and treasures all over the view,
+// the exit open and the HUD full (low health warning included)
+static void setup_crowded(GameState *state) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        place_player(state, i, 4 + i * 8, 4 + i * 3);
+    }
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        place_enemy(state, i, (EntityType)(ENTITY_ENEMY_CHASE + i % 4), 6 + i * 4, 2 + (i * 5) % 18);
+    }
+    int standing[MAX_ENTITIES];
+    for (int y = 1; y < SNAPSHOT_MAX_ROWS; y++) {
+        for (int x = 1; x < SNAPSHOT_MAX_COLUMNS; x++) {
+            if (MAP_TILE(&state->map, x, y) != TILE_EMPTY ||
+                occupancy_entities_at(state, x, y, OCCUPANCY_ALL, standing, MAX_ENTITIES) > 0) {
+                continue;
+            }
+            if ((x * 7 + y * 3) % 11 == 0) MAP_TILE(&state->map, x, y) = TILE_TREASURE;
+            else if ((x * 5 + y * 11) % 17 == 0) MAP_TILE(&state->map, x, y) = TILE_KEY;
+        }
+    }
+    MAP_TILE(&state->map, SNAPSHOT_MAX_COLUMNS / 2, SNAPSHOT_MAX_ROWS / 2) = TILE_EXIT;
+    state->players[0].health = 20;
+    state->players[0].score = 900;
+    state->players[0].keys = 6;
+    state->keys_required = 7;
+    state->exit_enabled = true;
+    state->current_time = state->start_time + 754;
+}
+
+// The fresh level after the player was caught
+static void setup_game_over(GameState *state) {
+    setup_fresh(state);
+    state->players[0].health = 0;
+    state->game_over = true;
+    state->winner_id = -1;
+}
+
+static const Fixture fixtures[] = {
+    {"fresh level", setup_fresh},
+    {"crowded screen", setup_crowded},
+    {"game over", setup_game_over},
+};
+#define NUM_FIXTURES ((int)(sizeof(fixtures) / sizeof(fixtures[0])))
+
+// Generate the level and reset everything else in the state
+static bool reset_state(GameState *state) {
+    MapGenParams params;
+    mapgen_default_params(1, &params);
+    params.keys = 5;
+    params.threads = 1;
+    if (!mapgen_generate(bench_seed, 1, state->map.width, state->map.height, &params, &state->map, NULL)) {
+        return false;
+    }
+
+    memset(state->players, 0, sizeof(state->players));
+    memset(&state->enemies, 0, sizeof(state->enemies));
+    occupancy_clear(state);
+    state->num_players = 0;
+    state->num_enemies = 0;
+    state->game_over = false;
+    state->winner_id = 0;
+    state->exit_enabled = false;
+    state->start_time = 1000000;
+    state->current_time = state->start_time;
+    return true;
+}
+
+// FNV-1a hash of the surface pixels
+static unsigned int hash_surface(SDL_Surface *surface) {
+    unsigned int hash = 2166136261u;
+    if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+    for (int y = 0; y < surface->h; y++) {
+        const unsigned char *row = (const unsigned char *)surface->pixels + (size_t)y * surface->pitch;
+        for (int i = 0; i < surface->w * 4; i++) {
+            hash = (hash ^ row[i]) * 16777619u;
+        }
+    }
+    if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+    return hash;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Value below which the given fraction of the sorted samples fall
+static double percentile(const double *sorted, int count, double fraction) {
+    int index = (int)(fraction * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+// Render a fixture for a number of frames and print its frame times
+static bool run(SDL_Renderer *renderer, SDL_Surface *surface, GameState *state,
+                const Fixture *fixture, int frames, bool hashes) {
+    if (!reset_state(state)) {
+        printf("%s: level generation failed\n", fixture->name);
+        return false;
+    }
+    fixture->setup(state);
+    srand(bench_seed);
+
+    double *times = malloc((size_t)frames * sizeof(double));
+    if (times == NULL) {
+        perror("Failed to allocate frame times");
+        return false;
+    }
+
+    RenderSnapshot snapshot;
+    double capture_total = 0.0;
+    unsigned int fixture_hash = 2166136261u;
+    for (int frame = 0; frame < frames; frame++) {
+        double start = now_seconds();
+        capture_render_snapshot(state, 0, &snapshot);
+        double captured = now_seconds();
+        advance_animation(&snapshot, SIM_TICK_SECONDS);
+        double advanced = now_seconds();
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        render_game(renderer, &snapshot, 0.5f);
+        SDL_RenderFlush(renderer);
+        double end = now_seconds();
+
+        capture_total += captured - start;
+        times[frame] = (end - advanced) * 1000.0;
+
+        if (hashes) {
+            unsigned int hash = hash_surface(surface);
+            printf("  %s frame %d: %08x\n", fixture->name, frame, hash);
+            fixture_hash = (fixture_hash ^ hash) * 16777619u;
+        }
+    }
+
+    double first = times[0];
+    qsort(times, (size_t)frames, sizeof(double), compare_doubles);
+    printf("%-16s first %7.3f ms  p50 %7.3f ms  p90 %7.3f ms  p99 %7.3f ms  max %7.3f ms  capture %6.2f us\n",
+           fixture->name, first, percentile(times, frames, 0.50), percentile(times, frames, 0.90),
+           percentile(times, frames, 0.99), times[frames - 1], capture_total / frames * 1e6);
+    if (hashes) {
+        printf("%-16s hash %08x\n", fixture->name, fixture_hash);
+    }
+
+    free(times);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    int frames = 300;
+    bool hashes = false;
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--hashes") == 0) {
+            hashes = true;
+        } else if (positional == 0) {
+            frames = atoi(argv[i]);
+            positional++;
+        } else if (positional == 1) {
+            bench_seed = (unsigned int)strtoul(argv[i], NULL, 10);
+            positional++;
+        } else {
+            frames = 0;
+        }
+    }
+    if (frames <= 0 || bench_seed == 0) {
+        fprintf(stderr, "Usage: %s [frames] [seed] [--hashes]\n", argv[0]);
+        return 1;
+    }
+
+    // Nothing is shown: the dummy video driver needs no display
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        printf("SDL could not initialize: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, WINDOW_WIDTH, WINDOW_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *renderer = surface != NULL ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    if (renderer == NULL) {
+        printf("Error creating software renderer: %s\n", SDL_GetError());
+        SDL_FreeSurface(surface);
+        SDL_Quit();
+        return 1;
+    }
+    sine_lut_init();
+
+    GameState *state = calloc(1, sizeof(GameState));
+    if (state != NULL) {
+        state->map.width = BENCH_MAP_SIZE;
+        state->map.height = BENCH_MAP_SIZE;
+        state->map.stride = MAP_STRIDE_FOR(BENCH_MAP_SIZE);
+        state->map.tiles = calloc(MAP_CELLS(&state->map), sizeof(MapTile));
+    }
+    if (state == NULL || state->map.tiles == NULL) {
+        perror("Failed to allocate game state");
+        return 1;
+    }
+
+    printf("bench_render: %dx%d software renderer, %d frames per fixture, seed %u\n",
+           WINDOW_WIDTH, WINDOW_HEIGHT, frames, bench_seed);
+
+    bool ok = true;
+    for (int i = 0; i < NUM_FIXTURES && ok; i++) {
+        ok = run(renderer, surface, state, &fixtures[i], frames, hashes);
+    }
+
+    tile_layer_destroy();
+    ui_cache_destroy();
+    sprite_atlas_destroy();
+    text_cache_destroy();
+    render_batch_free();
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    free(state->map.tiles);
+    free(state);
+    SDL_Quit();
+    return ok ? 0 : 1;
+}
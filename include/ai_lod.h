@@ -0,0 +1,35 @@
+#ifndef AI_LOD_H
+#define AI_LOD_H
+
+#include <stdbool.h>
+#include "game.h"
+
+// Default AI CPU budget per window, shared by all enemies
+#define AI_LOD_DEFAULT_BUDGET_US 2000
+
+// The budget is refilled once per enemy decision cycle (enemy processes
+// decide every 50 ms), not every 60 Hz tick, so it can actually run out
+#define AI_LOD_WINDOW_TICKS 3
+
+// Path distances (in tiles) at which enemies drop to the next tier
+#define AI_LOD_NEAR_DISTANCE 12
+#define AI_LOD_FAR_DISTANCE 30
+#define AI_LOD_DORMANT_DISTANCE 60
+
+// Extra distance an enemy must move past a boundary before it is demoted
+#define AI_LOD_HYSTERESIS 4
+
+#if AI_LOD_DORMANT_DISTANCE + AI_LOD_HYSTERESIS > AI_LOD_FIELD_RADIUS
+#error "The AI LOD distance field must reach the dormant boundary and its hysteresis band"
+#endif
+
+// Function declarations
+void ai_lod_init(GameState *state, int budget_us);
+void ai_lod_update(GameState *state);
+int ai_lod_player_distance(const GameState *state, int x, int y);
+AiLodTier ai_lod_tier(const GameState *state, int enemy_id);
+int ai_lod_frequency_scale(AiLodTier tier);
+bool ai_lod_try_acquire(GameState *state, int enemy_id, unsigned int *window);
+void ai_lod_charge(GameState *state, unsigned int window, long elapsed_us);
+
+#endif /* AI_LOD_H */
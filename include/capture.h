@@ -0,0 +1,42 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+// Gameplay recording. Every Nth frame is read back from the renderer into
+// one of CAPTURE_POOL_SIZE preallocated buffers and queued for a background
+// thread, which encodes it. When every buffer is still waiting to be
+// encoded the frame is dropped and counted instead of stalling the game.
+//
+// raw, qoi and png write one numbered file per frame into a directory; y4m
+// writes one YUV 4:2:0 stream to a file, or to a command's standard input
+// when the target starts with '|' (e.g. "|ffmpeg -i - out.mp4").
+#define CAPTURE_POOL_SIZE 8
+#define CAPTURE_DEFAULT_FPS 60     // Frame rate written in y4m headers
+
+typedef enum {
+    CAPTURE_RAW = 0,         // RGBA bytes, top row first
+    CAPTURE_QOI,             // "Quite OK Image" lossless format
+    CAPTURE_PNG,             // RGBA PNG with uncompressed (stored) deflate blocks
+    CAPTURE_Y4M              // YUV4MPEG2 stream, 4:2:0 full range
+} CaptureFormat;
+
+typedef struct {
+    unsigned long captured;   // Frames read back and queued
+    unsigned long written;    // Frames encoded
+    unsigned long dropped;    // Frames skipped because no buffer was free
+    unsigned long failed;     // Frames the encoder could not write
+    double readback_ms;       // Render thread time spent reading frames back
+    double readback_max_ms;   // Longest single readback
+} CaptureStats;
+
+// Function declarations
+bool capture_parse_format(const char *name, CaptureFormat *format);
+bool capture_start(SDL_Renderer *renderer, const char *target, CaptureFormat format, int every);
+uint64_t capture_frame(SDL_Renderer *renderer);
+void capture_get_stats(CaptureStats *stats);
+void capture_stop(void);
+
+#endif /* CAPTURE_H */
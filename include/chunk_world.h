@@ -0,0 +1,124 @@
+#ifndef CHUNK_WORLD_H
+#define CHUNK_WORLD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "game.h"
+#include "mapgen.h"
+#include "freecells.h"
+
+// Chunk geometry (chunks are MAPGEN_CHUNK_SIZE tiles square)
+#define CHUNK_SIZE MAPGEN_CHUNK_SIZE
+#define CHUNK_SHIFT 6
+#define CHUNK_TILES (CHUNK_SIZE * CHUNK_SIZE)
+
+// Resident chunk budget: the tiles of a streamed level never take more than
+// CHUNK_POOL_SLOTS * CHUNK_TILES bytes, however large the level is
+#define CHUNK_POOL_SLOTS 256
+
+// Chunks generated ahead of the player (Chebyshev radius in chunks), and
+// chunks kept around every enemy; neither is evicted while in range
+#define CHUNK_STREAM_RADIUS 2
+#define CHUNK_PIN_RADIUS 1
+
+// Background generation in the main process
+#define CHUNK_WORKERS 2
+#define CHUNK_QUEUE_SIZE 64
+
+// Modified chunks that get evicted are written to a private directory made
+// from this template (mkdtemp, mode 0700) and read back on demand
+#define CHUNK_SPILL_TEMPLATE "/tmp/dungeon_conquerors_chunks.XXXXXX"
+
+// Per-chunk flags
+#define CHUNK_QUEUED  0x1   // Waiting for a worker thread
+#define CHUNK_SPILLED 0x2   // A modified copy is saved in the spill directory
+
+// One resident chunk
+typedef struct {
+    int chunk_x;             // Chunk coordinates (-1 when the slot is free)
+    int chunk_y;
+    unsigned int serial;     // Changes every time the slot is refilled
+    unsigned int last_used;  // Clock value of the last access (LRU eviction)
+    bool dirty;              // Modified since it was generated or loaded
+} ChunkSlot;
+
+// Chunk store of a streamed level. It lives in the shared segment, followed
+// by the chunk index, the chunk flags and the tile pool (see chunk_world_place).
+// Everything here is read and written with the game state lock held.
+typedef struct ChunkWorld {
+    unsigned int seed;
+    int level;
+    unsigned int epoch;      // Bumped on every reset; stale worker results are dropped
+    int width;               // Level size in tiles
+    int height;
+    int chunks_x;            // Level size in chunks
+    int chunks_y;
+    MapGenParams params;
+    int num_keys;
+    int key_x[MAPGEN_MAX_KEYS];
+    int key_y[MAPGEN_MAX_KEYS];
+
+    unsigned int clock;
+    unsigned int next_serial;
+    int resident;
+    ChunkSlot slots[CHUNK_POOL_SLOTS];
+
+    // Chunks that must stay resident: around the player and every enemy
+    int num_pins;
+    int pin_x[MAX_ENTITIES];
+    int pin_y[MAX_ENTITIES];
+    int pin_radius[MAX_ENTITIES];
+
+    // Counters for diagnostics
+    unsigned int generated;
+    unsigned int loaded;
+    unsigned int spilled;
+    unsigned int evicted;
+
+    char spill_dir[64];      // Spill directory of this game ("" until the first spill)
+
+    short *index;            // Slot + 1 of every chunk (0 = not resident)
+    unsigned char *flags;    // CHUNK_QUEUED / CHUNK_SPILLED of every chunk
+    MapTile *pool;           // CHUNK_POOL_SLOTS chunks of CHUNK_TILES tiles
+} ChunkWorld;
+
+// Function declarations
+size_t chunk_world_size(int width, int height);
+ChunkWorld *chunk_world_place(void *memory, int width, int height);
+void chunk_world_reset(ChunkWorld *world, unsigned int seed, int level, const MapGenParams *params);
+MapTile chunk_world_get(ChunkWorld *world, int x, int y);
+MapTile chunk_world_peek(ChunkWorld *world, int x, int y);
+void chunk_world_set(ChunkWorld *world, int x, int y, MapTile tile);
+void chunk_world_update(GameState *state);
+bool chunk_world_start_workers(ChunkWorld *world);
+void chunk_world_stop_workers(ChunkWorld *world);
+
+// Tile at (x, y) of any map; streamed maps bring the chunk in if needed.
+// (x, y) must be inside the map. Streamed maps need the game state lock.
+// Bringing a chunk in generates it (or reads its spill file) right there,
+// with the lock held, which stalls the frame and every enemy process; keep
+// it to gameplay next to the player or an enemy, whose chunks are pinned.
+static inline MapTile map_get_tile(const GameMap *map, int x, int y) {
+    if (map->chunks == NULL) return MAP_TILE(map, x, y);
+    return chunk_world_get(map->chunks, x, y);
+}
+
+// Like map_get_tile, but never generates or loads: tiles of chunks that are
+// not resident read as walls. Used by rendering and by searches that must
+// not sweep the level.
+static inline MapTile map_peek_tile(const GameMap *map, int x, int y) {
+    if (map->chunks == NULL) return MAP_TILE(map, x, y);
+    return chunk_world_peek(map->chunks, x, y);
+}
+
+// Change the tile at (x, y) of any map (keeping its free-cell index current)
+static inline void map_set_tile(GameMap *map, int x, int y, MapTile tile) {
+    if (map->chunks == NULL) {
+        MAP_TILE(map, x, y) = tile;
+        if (map->free_cells != NULL) freecells_update(map->free_cells, map, x, y);
+    } else {
+        chunk_world_set(map->chunks, x, y, tile);
+    }
+}
+
+#endif /* CHUNK_WORLD_H */
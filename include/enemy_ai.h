@@ -0,0 +1,16 @@
+#ifndef ENEMY_AI_H
+#define ENEMY_AI_H
+
+#include "game.h"
+
+// Enemy processes don't run the decision kernel themselves. When one is
+// allowed to move it posts a request in the shared EnemyStore; once per tick
+// the main process gathers every pending request, grouped by type, decides
+// them all in one batched kernel pass and writes each step back to its
+// enemy's lane, where the enemy's process picks it up on its next cycle.
+
+// Function declarations
+void enemy_ai_init(GameState *state);
+int enemy_ai_update(GameState *state);
+
+#endif /* ENEMY_AI_H */
@@ -0,0 +1,49 @@
+#ifndef ENEMY_KERNEL_H
+#define ENEMY_KERNEL_H
+
+#include <stdbool.h>
+#include "game.h"
+
+// Number of enemies processed together by the vector path of the kernel
+#define ENEMY_KERNEL_LANES 4
+
+// View over structure-of-arrays enemy data. It either points into the shared
+// EnemyStore or owns heap arrays (enemy_batch_alloc) for large headless runs.
+typedef struct {
+    int count;
+    int capacity;
+    bool owns_memory;
+    short *x;
+    short *y;
+    unsigned char *type;
+    short *range;
+    short *cooldown;
+    unsigned short *phase;
+    unsigned int *rng;
+    signed char *step_x;
+    signed char *step_y;
+} EnemyBatch;
+
+// What the enemies know about the player for one round of decisions
+typedef struct {
+    bool visible;          // Player position is known (otherwise enemies wander)
+    int x;                 // Player position
+    int y;
+    bool has_velocity;     // A previous position was known, so vx/vy are valid
+    int vx;                // Player's last observed step, used for prediction
+    int vy;
+} EnemyTarget;
+
+// Function declarations
+int enemy_move_frequency(EntityType type);
+int enemy_detection_range(EntityType type, int level);
+void enemy_batch_bind(EnemyBatch *batch, EnemyStore *store, int first, int count);
+bool enemy_batch_alloc(EnemyBatch *batch, int capacity);
+void enemy_batch_free(EnemyBatch *batch);
+void enemy_batch_gather_by_type(EnemyBatch *dst, const EnemyBatch *src, const int *lanes, int count, int *order);
+void enemy_batch_scatter(const EnemyBatch *src, EnemyBatch *dst, const int *order);
+void enemy_batch_sort_by_type(EnemyBatch *batch);
+int enemy_kernel_decide(EnemyBatch *batch, const EnemyTarget *target, bool use_cooldown);
+int enemy_kernel_decide_scalar(EnemyBatch *batch, const EnemyTarget *target, bool use_cooldown);
+
+#endif /* ENEMY_KERNEL_H */
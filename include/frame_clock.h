@@ -0,0 +1,34 @@
+#ifndef FRAME_CLOCK_H
+#define FRAME_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Frame scheduling on the monotonic clock. The simulation advances in fixed
+// ticks: each frame adds the real time since the last one to an accumulator
+// and runs as many whole ticks as it holds; the remainder (alpha) says how
+// far rendering is between the last tick and the next. Without vsync the
+// loop sleeps until an absolute per-frame deadline, so render time does not
+// add to the frame interval.
+
+#define SIM_TICKS_PER_SECOND 60
+#define SIM_TICK_SECONDS (1.0f / SIM_TICKS_PER_SECOND)
+#define FRAME_CLOCK_DEFAULT_FPS 60
+#define FRAME_CLOCK_MAX_TICKS 5      // Ticks run per frame at most; time beyond is dropped
+
+typedef struct {
+    uint64_t tick_ns;        // Simulation step
+    uint64_t frame_ns;       // Frame interval to sleep to (0 = paced by a vsync present)
+    uint64_t previous_ns;    // Clock reading at the start of the last frame
+    uint64_t accumulator_ns; // Real time not yet simulated
+    uint64_t deadline_ns;    // When the next frame should start
+} FrameClock;
+
+// Function declarations
+uint64_t frame_clock_now_ns(void);
+void frame_clock_init(FrameClock *clock, int frames_per_second, bool vsync);
+int frame_clock_begin(FrameClock *clock);
+float frame_clock_alpha(const FrameClock *clock);
+void frame_clock_wait(FrameClock *clock);
+
+#endif /* FRAME_CLOCK_H */
@@ -0,0 +1,55 @@
+#ifndef FREECELLS_H
+#define FREECELLS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "game.h"
+
+// The index groups tiles in square blocks; each block keeps its own dense
+// list of free tiles (local offsets), and a Fenwick tree over the block
+// counts finds the block holding the n-th free tile
+#define FREECELL_BLOCK_SHIFT 4
+#define FREECELL_BLOCK_SIZE (1 << FREECELL_BLOCK_SHIFT)
+#define FREECELL_BLOCK_CELLS (FREECELL_BLOCK_SIZE * FREECELL_BLOCK_SIZE)
+
+// Samples drawn before a filtered query gives up
+#define FREECELL_MAX_ATTEMPTS 64
+
+// Index of the free tiles of a map: empty floor reachable from the start
+// (TILE_EMPTY in MAP_COMPONENT_MAIN). Lives in freecells_size() bytes of
+// memory laid out by freecells_place (a region of the shared segment, or
+// the heap).
+typedef struct FreeCellIndex {
+    int blocks_x;
+    int blocks_y;
+    int stride;                 // Row stride of the map it indexes
+    int total;                  // Free tiles in the whole map
+    unsigned short *count;      // Free tiles of each block
+    unsigned char *cells;       // FREECELL_BLOCK_CELLS local offsets per block, first count[b] are free
+    unsigned char *slot;        // Position of each tile in its block's list (map layout)
+    int *tree;                  // Fenwick tree over count (1-based, blocks + 1 entries)
+} FreeCellIndex;
+
+// Restrictions on a sample. The rectangle is inclusive; tiles closer than
+// min_distance (Euclidean) to (avoid_x, avoid_y) are rejected.
+typedef struct {
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+    int avoid_x;
+    int avoid_y;
+    int min_distance;           // 0 = no distance rule
+} FreeCellFilter;
+
+// Function declarations
+size_t freecells_size(int width, int height);
+FreeCellIndex *freecells_place(void *memory, int width, int height);
+FreeCellIndex *freecells_alloc(int width, int height);
+void freecells_rebuild(FreeCellIndex *index, const GameMap *map);
+void freecells_update(FreeCellIndex *index, const GameMap *map, int x, int y);
+void freecells_filter_all(const GameMap *map, FreeCellFilter *filter);
+bool freecells_sample(const FreeCellIndex *index, const GameMap *map, const FreeCellFilter *filter,
+                      unsigned int *rng, int *x, int *y);
+
+#endif /* FREECELLS_H */
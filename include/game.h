@@ -11,10 +11,20 @@
 #define TILE_SIZE 32
 #define MAX_PLAYERS 4
 #define MAX_ENEMIES 8
-#define MAP_WIDTH 80
-#define MAP_HEIGHT 80
+#define DEFAULT_MAP_WIDTH 80
+#define DEFAULT_MAP_HEIGHT 80
+#define MIN_MAP_SIZE 80      // Map dimensions are chosen at startup within these bounds
+#define MAX_MAP_SIZE 4096
+#define MAX_STREAMED_MAP_SIZE 32767  // Streamed levels keep a bounded set of chunks; tile coordinates are shorts
+#define MAP_ROW_ALIGN 16     // Map rows are padded to a multiple of this many tiles
 #define MIN_PLAY_TIME_SEC 300
 #define MAX_LEVEL 2  // Maximum level in the game
+#define DEFAULT_GEN_BUDGET_MS 250  // Time budget of best-of-N level generation (--best-of)
+
+// Entity ids shared by the occupancy grid: players first, then enemies
+#define MAX_ENTITIES (MAX_PLAYERS + MAX_ENEMIES)
+#define ENTITY_ID_PLAYER(i) (i)
+#define ENTITY_ID_ENEMY(i) (MAX_PLAYERS + (i))
 
 // Game tile types
 typedef enum {
@@ -47,18 +57,144 @@ typedef struct {
     int keys;              // Number of keys collected
 } Player;
 
-// Game map structure
+// Enemy data, stored as a structure of arrays so decisions can be batched
+// across enemies (see enemy_kernel.h). Enemy i is lane i of every array.
+typedef struct {
+    short x[MAX_ENEMIES];
+    short y[MAX_ENEMIES];
+    unsigned char type[MAX_ENEMIES];   // EntityType of each enemy
+    bool active[MAX_ENEMIES];
+    short speed[MAX_ENEMIES];          // Movement speed * 100 (set per level)
+    short aggression[MAX_ENEMIES];     // Aggression * 100 (set per level)
+    short range[MAX_ENEMIES];          // Detection range in tiles
+    short cooldown[MAX_ENEMIES];       // Ticks until the next decision (batched ticks only)
+    unsigned short phase[MAX_ENEMIES]; // Decisions taken so far, drives patrol patterns
+    unsigned int rng[MAX_ENEMIES];     // Per-enemy random state
+    signed char step_x[MAX_ENEMIES];   // Last decided step
+    signed char step_y[MAX_ENEMIES];
+    bool wants_decision[MAX_ENEMIES];  // Set by the enemy's process, decided by the main process next tick
+    bool tracking[MAX_ENEMIES];        // Whether the requesting enemy knows where the player is
+    bool decided[MAX_ENEMIES];         // step_x/step_y hold a decision the enemy has not taken yet
+} EnemyStore;
+
+// A map tile as stored in memory (one TileType value per byte)
+typedef unsigned char MapTile;
+
+// Chunk store of a streamed level (see chunk_world.h)
+struct ChunkWorld;
+
+// Index of the free tiles of a map (see freecells.h)
+struct FreeCellIndex;
+
+// Game map structure. The tiles live in the variable-length part of the shared
+// segment (or any caller-provided buffer); rows are stride tiles apart.
+// Streamed levels keep their tiles in chunks instead: tiles is NULL and every
+// access goes through map_get_tile / map_set_tile.
 typedef struct {
-    TileType tiles[MAP_HEIGHT][MAP_WIDTH];
+    MapTile *tiles;
+    struct ChunkWorld *chunks; // Chunk store of a streamed level, NULL otherwise
+    unsigned short *components; // Connected component of each tile (MAP_COMPONENT_*), NULL if not tracked
+    struct FreeCellIndex *free_cells; // Free tiles for random placement, NULL if not tracked
     int width;
     int height;
+    int stride;            // Tiles per row in memory (width rounded up to MAP_ROW_ALIGN)
 } GameMap;
 
-// Game state structure (to be stored in shared memory)
+// Component labels: walls, everything reachable from the start, and sealed
+// pockets beyond the label range (other pockets have their own labels)
+#define MAP_COMPONENT_NONE 0
+#define MAP_COMPONENT_MAIN 1
+#define MAP_COMPONENT_POCKET 0xFFFF
+
+// Tile (x, y) of a map, usable on either side of an assignment
+#define MAP_TILE(map, x, y) ((map)->tiles[(size_t)(y) * (map)->stride + (x)])
+
+// Number of per-tile entries in arrays laid out like the map (tiles, fields)
+#define MAP_CELLS(map) ((size_t)(map)->stride * (map)->height)
+
+// Row stride used for a map of the given width
+#define MAP_STRIDE_FOR(width) (((width) + MAP_ROW_ALIGN - 1) / MAP_ROW_ALIGN * MAP_ROW_ALIGN)
+
+// Buckets of the occupancy index (a power of two, well above MAX_ENTITIES)
+#define OCCUPANCY_BUCKETS 256
+
+// Occupancy index, kept in sync with every entity move. Tiles are hashed
+// into a fixed number of buckets, so its size does not depend on the map;
+// each bucket heads an intrusive list of the entities standing on its tiles.
+// All links are stored as entity id + 1 so a zeroed grid is a valid empty grid.
+typedef struct {
+    short head[OCCUPANCY_BUCKETS];      // First entity of each bucket (+1, 0 = empty)
+    short next[MAX_ENTITIES];           // Next entity in the same bucket (+1, 0 = end)
+    short cell_x[MAX_ENTITIES];         // Tile the entity is currently linked into
+    short cell_y[MAX_ENTITIES];
+    bool linked[MAX_ENTITIES];          // Whether the entity is in the grid at all
+} OccupancyGrid;
+
+// AI level-of-detail tiers, from full-rate thinking down to dormant
+typedef enum {
+    AI_LOD_ACTIVE = 0,     // On screen or close to the player: full cadence
+    AI_LOD_NEAR,           // A short walk away: half cadence
+    AI_LOD_FAR,            // Reachable but far: quarter cadence
+    AI_LOD_DORMANT,        // Unreachable or very far: cheap wandering only
+    AI_LOD_TIER_COUNT
+} AiLodTier;
+
+// Reach of the AI LOD player distance field: the dormant distance plus its
+// hysteresis band (see ai_lod.h). The field covers only the square window of
+// this radius around the player, whatever the size of the map.
+#define AI_LOD_FIELD_RADIUS 64
+#define AI_LOD_FIELD_SIDE (2 * AI_LOD_FIELD_RADIUS + 1)
+
+// Shared state of the AI level-of-detail scheduler (maintained by the main process)
+typedef struct {
+    unsigned short player_distance[AI_LOD_FIELD_SIDE * AI_LOD_FIELD_SIDE]; // Path distance from player 0, window around field_x/y
+    int field_x;                  // Player tile the distance field was built from
+    int field_y;
+    int field_level;              // Level the distance field was built for
+    AiLodTier tier[MAX_ENEMIES];  // Current tier of each enemy
+    unsigned int tick;            // Scheduler tick counter (one per simulation tick)
+    unsigned int window;          // Budget window counter (one per enemy decision cycle)
+    unsigned int window_start_tick; // Tick the current window started at
+    int budget_us;                // AI CPU time allowed per window (all enemies together)
+    int budget_remaining_us;      // AI CPU time left in the current window (negative = overrun)
+    int previous_remaining_us;    // What the previous window had left when it closed
+    int decisions_this_window;    // Enemy decisions granted in the current window
+    int deferred_this_window;     // Enemy decisions pushed back for lack of budget
+} AiScheduler;
+
+// Longest stretch of the player's predicted route the interception planner considers
+#define INTERCEPT_MAX_ROUTE 64
+
+// Interception plan for smart enemies, rebuilt by the main process once per tick
+typedef struct {
+    int goal_level;               // Level, key count and exit state the route was predicted for
+    int goal_keys_collected;
+    bool goal_exit_enabled;
+    bool goal_valid;
+    short route_x[INTERCEPT_MAX_ROUTE];  // Player's predicted route, route[k] reached after k steps
+    short route_y[INTERCEPT_MAX_ROUTE];
+    int route_length;
+    int player_x;                 // Player tile the route was planned from
+    int player_y;
+    bool has_plan[MAX_ENEMIES];   // Whether each enemy has an assigned interception cell
+    short origin_x[MAX_ENEMIES];  // Enemy tile the plan was made from
+    short origin_y[MAX_ENEMIES];
+    short target_x[MAX_ENEMIES];  // Assigned interception cell
+    short target_y[MAX_ENEMIES];
+    signed char step_x[MAX_ENEMIES]; // First step from origin toward the target
+    signed char step_y[MAX_ENEMIES];
+    unsigned int plans_built;     // Number of times the assignment was recomputed
+} InterceptPlanner;
+
+// Game state structure (to be stored in shared memory). It is the header of
+// the shared segment; the per-tile arrays it points to follow it in the same
+// segment, sized for the map chosen at startup (see init_shared_memory).
 typedef struct {
     GameMap map;
+    GameMap staged_map;           // Buffers the next level is pre-generated into (see level_stage.h)
+    OccupancyGrid occupancy;      // Tile -> entity index for collisions and spatial queries
     Player players[MAX_PLAYERS];  // Player[0] is the human player
-    Player enemies[MAX_ENEMIES];  // AI-controlled enemies
+    EnemyStore enemies;           // AI-controlled enemies
     int num_players;
     int num_enemies;
     bool game_over;
@@ -69,10 +205,54 @@ typedef struct {
     bool exit_enabled;     // Whether exit is enabled yet
     int keys_required;     // Number of keys needed to enable exit
     int keys_collected;    // Number of keys collected so far
+    unsigned int seed;     // World seed; each level is generated from (seed, level)
     int current_level;     // Current level (1 or 2)
     bool level_complete;   // Flag to indicate level is complete and should advance
+    int num_spawns;        // Enemy start positions given by a level file (0 = random)
+    short spawn_x[MAX_ENEMIES];
+    short spawn_y[MAX_ENEMIES];
+    unsigned char spawn_type[MAX_ENEMIES]; // EntityType of each, or ENTITY_PLAYER to keep the default
+    AiScheduler ai_lod;    // Per-enemy AI tiers and tick budget
+    InterceptPlanner intercept; // Interception cells assigned to smart enemies
 } GameState;
 
+// Largest tile window a frame shows (the viewport computed by get_viewport)
+#define SNAPSHOT_MAX_COLUMNS (WINDOW_WIDTH / TILE_SIZE)
+#define SNAPSHOT_MAX_ROWS ((WINDOW_HEIGHT - 40) / TILE_SIZE)
+
+// Snapshot tile value for positions outside the map
+#define SNAPSHOT_TILE_OUTSIDE 0xFF
+
+// A player or enemy in view, as a frame draws it
+typedef struct {
+    unsigned char index;   // Player or enemy index (picks colours and animation phase)
+    unsigned char type;    // EntityType
+    short x;               // Map position
+    short y;
+} RenderEntity;
+
+// Everything one frame draws, copied out of the shared state under the lock
+// (capture_render_snapshot) so drawing runs without holding it
+typedef struct {
+    int start_x;           // Viewport position and size, in tiles
+    int start_y;
+    int columns;
+    int rows;
+    MapTile tiles[SNAPSHOT_MAX_ROWS * SNAPSHOT_MAX_COLUMNS]; // Viewport tiles, row-major, columns wide
+    RenderEntity players[MAX_PLAYERS];   // Active players in view
+    RenderEntity enemies[MAX_ENEMIES];   // Active enemies in view
+    int num_players;
+    int num_enemies;
+    int score;             // HUD values of player 0
+    int keys;
+    int health;
+    int keys_required;
+    time_t elapsed;        // Seconds since the game started
+    bool exit_enabled;
+    bool game_over;
+    int winner_id;
+} RenderSnapshot;
+
 // Message structure for IPC
 typedef struct {
     int from_id;           // Sender ID
@@ -94,7 +274,10 @@ typedef struct {
 // Function declarations
 bool game_init(void);
 void game_cleanup(void);
-void render_game(SDL_Renderer *renderer, GameState *state, int player_id);
+void capture_render_snapshot(GameState *state, int player_id, RenderSnapshot *snapshot);
+void render_game(SDL_Renderer *renderer, const RenderSnapshot *snapshot, float alpha);
+void advance_animation(const RenderSnapshot *snapshot, float dt);
+void get_viewport(GameState *state, int player_id, int *start_x, int *start_y, int *width, int *height);
 void update_player(GameState *state, int player_id, int dx, int dy);
 bool is_valid_move(GameState *state, int player_id, int dx, int dy);
 void process_player_input(SDL_Event *event, GameState *state, int player_id);
@@ -102,8 +285,11 @@ void enemy_ai_process(int enemy_id);
 void check_player_enemy_collision(GameState *state);
 void update_game_time(GameState *state);
 bool check_exit_criteria(GameState *state);
-void render_game_ui(SDL_Renderer *renderer, GameState *state);
+void render_game_ui(SDL_Renderer *renderer, const RenderSnapshot *snapshot);
 void render_digit(SDL_Renderer *renderer, int x, int y, int digit);
 void generate_level(GameState *state, int level);
+void set_level_candidates(int candidates, int budget_ms);
+bool load_level(GameState *state, const char *path);
+bool save_level(const GameState *state, const char *path);
 
 #endif /* GAME_H */ 
\ No newline at end of file
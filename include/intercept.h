@@ -0,0 +1,15 @@
+#ifndef INTERCEPT_H
+#define INTERCEPT_H
+
+#include <stdbool.h>
+#include "game.h"
+
+// Minimum number of route steps between the cells assigned to two smart enemies
+#define INTERCEPT_SPACING 3
+
+// Function declarations
+void intercept_init(GameState *state);
+void intercept_update(GameState *state);
+bool intercept_lookup(const GameState *state, int enemy_id, int enemy_x, int enemy_y, int *dx, int *dy);
+
+#endif /* INTERCEPT_H */
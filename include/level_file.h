@@ -0,0 +1,74 @@
+#ifndef LEVEL_FILE_H
+#define LEVEL_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "game.h"
+#include "mapgen.h"
+
+// Binary level files: a fixed header, then the tiles and component labels in
+// the in-memory map layout (stride tiles per row), then the enemy spawn
+// points. Sections are aligned so a read-only mmap of the file is used as is;
+// loading a level is a page-in and a copy, with no parsing or generation.
+#define LEVEL_FILE_MAGIC "DCLEVEL"
+#define LEVEL_FILE_VERSION 1
+#define LEVEL_FILE_SECTION_ALIGN 4096
+
+// Generated levels are cached as level files in LEVEL_CACHE_DIR-<uid>, a
+// private (0700) directory per user, keyed by (seed, level, size, params);
+// the oldest are deleted beyond LEVEL_CACHE_MAX_BYTES
+#define LEVEL_CACHE_DIR "/tmp/dungeon_conquerors_levels"
+#define LEVEL_CACHE_MAX_BYTES (512u * 1024 * 1024)
+
+// An enemy start position
+typedef struct {
+    int16_t x;
+    int16_t y;
+    uint8_t type;            // EntityType of the enemy
+    uint8_t reserved[3];
+} LevelSpawn;
+
+// Header at offset 0 of a level file. Offsets are from the start of the
+// file; the checksum covers every byte after the header.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int32_t width;
+    int32_t height;
+    int32_t stride;
+    uint32_t seed;
+    int32_t level;
+    int32_t keys_required;
+    MapGenParams params;     // Parameters the level was generated with
+    uint32_t num_spawns;
+    uint32_t reserved;
+    uint64_t tiles_offset;       // stride * height MapTile
+    uint64_t components_offset;  // stride * height unsigned short
+    uint64_t spawns_offset;      // num_spawns LevelSpawn
+    uint64_t file_size;
+    uint64_t checksum;
+} LevelFileHeader;
+
+// A level file mapped into memory (read only)
+typedef struct {
+    const LevelFileHeader *header;
+    const MapTile *tiles;
+    const unsigned short *components;
+    const LevelSpawn *spawns;
+    int num_keys;            // TILE_KEY cells in the map
+    void *base;
+    size_t size;
+} LevelFile;
+
+// Function declarations
+bool level_file_open(const char *path, LevelFile *file);
+void level_file_close(LevelFile *file);
+bool level_file_copy_map(const LevelFile *file, GameMap *map);
+bool level_file_write(const char *path, const GameMap *map, unsigned int seed, int level,
+                      int keys_required, const MapGenParams *params,
+                      const LevelSpawn *spawns, int num_spawns);
+bool level_cache_generate(unsigned int seed, int level, const MapGenParams *params, GameMap *map);
+
+#endif /* LEVEL_FILE_H */
@@ -0,0 +1,20 @@
+#ifndef LEVEL_STAGE_H
+#define LEVEL_STAGE_H
+
+#include <stdbool.h>
+#include "game.h"
+#include "mapgen.h"
+
+// The next level is generated in the background into the staging buffers of
+// GameState.staged_map (a second set of tiles, component labels and free-cell
+// index in the shared segment). The level transition then just swaps the
+// buffer pointers of the live map and the staging map under the game state
+// lock. Streamed levels are laid out lazily anyway and are never staged.
+
+// Function declarations
+bool level_stage_start(GameState *state);
+void level_stage_stop(void);
+void level_stage_request(GameState *state, int level, const MapGenParams *params);
+bool level_stage_take(GameState *state, int level, const MapGenParams *params);
+
+#endif /* LEVEL_STAGE_H */
@@ -0,0 +1,76 @@
+#ifndef MAPGEN_H
+#define MAPGEN_H
+
+#include <stdbool.h>
+#include "game.h"
+
+// Smallest map the generator can lay out (start area, key region and exit corridor)
+#define MAPGEN_MIN_SIZE 32
+#define MAPGEN_MAX_KEYS 32
+
+// Large maps are smoothed in row bands, one per thread, each at least this tall
+#define MAPGEN_MAX_THREADS 16
+#define MAPGEN_MIN_BAND_ROWS 128
+
+// Walkable components smaller than this are left sealed instead of being
+// tunneled into (nothing is placed in them)
+#define MAPGEN_MIN_CAVE_TILES 8
+
+// Best-of-N generation: most candidates per level, and the scratch memory
+// the candidate buffers may take (fewer run at once on large maps)
+#define MAPGEN_MAX_CANDIDATES 64
+#define MAPGEN_CANDIDATE_MAX_BYTES (256u * 1024 * 1024)
+
+// Streamed levels are generated one square chunk of this many tiles at a time
+#define MAPGEN_CHUNK_SIZE 64
+
+// Tunable inputs of the generator; mapgen_default_params gives the game's values
+typedef struct {
+    int wall_chance;        // Percent of interior tiles seeded as walls
+    int smoothing_passes;   // Cellular automaton iterations
+    int section_doors;      // Doors scattered to split the map into sections
+    int treasure_divisor;   // One treasure attempt per this many tiles
+    int extra_treasures;    // Additional treasure attempts
+    int keys;               // Keys to place (each gets a corridor)
+    int path_door_chance;   // Percent chance of a door on each key corridor tile
+    int threads;            // Worker threads for noise and smoothing (0 = one per CPU)
+    int candidates;         // Levels built to keep the best scoring one (<= 1 = just one)
+    int budget_ms;          // No new candidates are started after this long (0 = no limit)
+} MapGenParams;
+
+// Wall-clock time spent in each generation stage, in milliseconds, and what
+// the connectivity repair had to do
+typedef struct {
+    double noise_ms;
+    double smoothing_ms;
+    double carving_ms;
+    double placement_ms;
+    int components;         // Walkable components before the connectivity repair
+    int tiles_carved;       // Walls carved to connect them
+    int candidates;         // Candidate levels built (best-of-N generation)
+    double quality;         // Score of the level kept (see mapgen_score)
+} MapGenStats;
+
+// Fast quality metrics of a generated level, each scaled to 0..1 (higher is
+// better), and their weighted sum
+typedef struct {
+    double path;            // Walk from the start to the keys and the exit, against the map size
+    double open_area;       // How close the floor ratio is to half the map
+    double dead_ends;       // Few floor tiles with a single way out
+    double key_spread;      // Keys far from each other rather than clustered
+    double spawn_spread;    // Enemy spawn regions that have reachable floor
+    double score;
+} MapGenQuality;
+
+// Function declarations
+void mapgen_default_params(int level, MapGenParams *params);
+bool mapgen_generate(unsigned int seed, int level, int width, int height,
+                     const MapGenParams *params, GameMap *map, MapGenStats *stats);
+double mapgen_score(const GameMap *map, MapGenQuality *quality);
+int mapgen_chunk_key_sites(unsigned int seed, int level, int width, int height,
+                           int keys, int *site_x, int *site_y);
+bool mapgen_generate_chunk(unsigned int seed, int level, int width, int height,
+                           const MapGenParams *params, const int *key_x, const int *key_y,
+                           int num_keys, int chunk_x, int chunk_y, MapTile *tiles);
+
+#endif /* MAPGEN_H */
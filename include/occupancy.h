@@ -0,0 +1,20 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include <stdbool.h>
+#include "game.h"
+
+// Entity kind filters for occupancy queries
+#define OCCUPANCY_PLAYERS 0x1
+#define OCCUPANCY_ENEMIES 0x2
+#define OCCUPANCY_ALL     (OCCUPANCY_PLAYERS | OCCUPANCY_ENEMIES)
+
+// Function declarations
+void occupancy_clear(GameState *state);
+void occupancy_move(GameState *state, int entity_id, int x, int y);
+void occupancy_remove(GameState *state, int entity_id);
+bool occupancy_has_enemy(const GameState *state, int x, int y);
+int occupancy_entities_at(const GameState *state, int x, int y, int kinds, int *out, int max_out);
+int occupancy_query_rect(const GameState *state, int x, int y, int w, int h, int kinds, int *out, int max_out);
+
+#endif /* OCCUPANCY_H */
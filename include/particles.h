@@ -0,0 +1,44 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+// Particles are kept as a structure of arrays with the live ones packed at
+// the front ([0, count)): spawning appends, a dying particle is replaced by
+// the last live one, so there are no free slots to search or skip. The
+// update integrates PARTICLE_LANES particles at a time with GCC vector types.
+#define PARTICLE_LANES 4
+#define PARTICLE_CAPACITY 65536
+#define PARTICLE_GRAVITY 0.02f   // Added to vy every tick
+
+// Spawn behaviours
+typedef enum {
+    PARTICLE_EXPLOSION = 0,  // Fast, larger, long lived
+    PARTICLE_TRAIL,          // Slow drift with an upward bias
+    PARTICLE_SPARKLE         // Still and short lived
+} ParticleKind;
+
+typedef struct {
+    int count;               // Live particles
+    int capacity;            // Multiple of PARTICLE_LANES
+    float *x;                // Position, in tiles
+    float *y;
+    float *prev_x;           // Position at the previous tick (for interpolation)
+    float *prev_y;
+    float *vx;               // Velocity, in tiles per tick
+    float *vy;
+    float *life;             // Remaining life, in seconds
+    float *max_life;
+    SDL_Color *color;
+    unsigned char *size;     // Side in pixels
+} ParticleSystem;
+
+// Function declarations
+bool particles_init(ParticleSystem *ps, int capacity);
+void particles_free(ParticleSystem *ps);
+bool particles_spawn(ParticleSystem *ps, float x, float y, SDL_Color color, ParticleKind kind);
+void particles_update(ParticleSystem *ps, float dt);
+void particles_update_scalar(ParticleSystem *ps, float dt);
+
+#endif /* PARTICLES_H */
@@ -0,0 +1,27 @@
+#ifndef PATHFIELD_H
+#define PATHFIELD_H
+
+#include <stdbool.h>
+#include "game.h"
+
+// Distance value for tiles the search never reached
+#define PATHFIELD_UNREACHED 0xFFFF
+
+// Side and size of a window field: the square of tiles within radius of its
+// centre, which is all a search bounded to radius steps can reach
+#define PATHFIELD_WINDOW_SIDE(radius) (2 * (radius) + 1)
+#define PATHFIELD_WINDOW_CELLS(radius) (PATHFIELD_WINDOW_SIDE(radius) * PATHFIELD_WINDOW_SIDE(radius))
+
+// Function declarations
+bool pathfield_is_walkable(const GameMap *map, int x, int y);
+void pathfield_clear(const GameMap *map, unsigned short *distance);
+int pathfield_build(const GameMap *map, int start_x, int start_y, int max_distance, unsigned short *distance);
+int pathfield_build_multi(const GameMap *map, const int *sources, int num_sources, int max_distance, unsigned short *distance);
+int pathfield_search(const GameMap *map, const int *sources, int num_sources, int max_distance, unsigned short *distance);
+int pathfield_search_window(const GameMap *map, int cx, int cy, int radius, unsigned short *distance);
+unsigned short pathfield_window_distance(const unsigned short *distance, int cx, int cy, int radius, int x, int y);
+unsigned short pathfield_component(const GameMap *map, int x, int y);
+bool pathfield_connected(const GameMap *map, int from_x, int from_y, int to_x, int to_y);
+void pathfield_open_tile(GameMap *map, int x, int y);
+
+#endif /* PATHFIELD_H */
@@ -9,6 +9,9 @@
 #define MAX_PROCESSES 4
 #define MAX_ENEMY_PROCESSES 5
 
+// Enemies never spawn closer than this many tiles to the player
+#define ENEMY_SPAWN_MIN_DISTANCE 10
+
 // Array to store process IDs
 extern pid_t player_pids[MAX_PROCESSES];
 extern pid_t enemy_pids[MAX_ENEMY_PROCESSES];
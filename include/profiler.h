@@ -0,0 +1,53 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include "frame_clock.h"
+
+// Per-phase frame timing. Each phase of a frame is bracketed by
+// profile_begin / profile_end; the times of the last PROFILER_WINDOW frames
+// feed the avg/p95/p99/max figures of the overlay (toggled with F3), and
+// every frame can be appended to a CSV file (--profile FILE). While neither
+// is on, profile_begin and profile_end only test a flag.
+#define PROFILER_WINDOW 240          // Frames the rolling statistics cover
+#define PROFILER_REFRESH_FRAMES 30   // Frames between overlay figure updates
+
+typedef enum {
+    PROFILE_INPUT = 0,       // Event polling and player input
+    PROFILE_IPC,             // Draining messages from the enemy processes
+    PROFILE_SIMULATION,      // Fixed simulation ticks
+    PROFILE_SNAPSHOT,        // Locked copy of the render snapshot
+    PROFILE_TILES,           // Background, tile layer and animated tiles
+    PROFILE_PARTICLES,       // Particle ticks and drawing
+    PROFILE_ENTITIES,        // Players and enemies
+    PROFILE_UI,              // HUD and game over overlay
+    PROFILE_CAPTURE,         // Frame readback for --capture
+    PROFILE_PRESENT,         // SDL_RenderPresent
+    PROFILE_FRAME,           // The whole frame, sleep excluded
+    PROFILE_PHASE_COUNT
+} ProfilePhase;
+
+extern bool profiler_enabled;
+
+// Function declarations
+void profiler_record(ProfilePhase phase, uint64_t ns);
+void profiler_end_frame(void);
+void profiler_toggle_overlay(void);
+bool profiler_open_csv(const char *path);
+void profiler_draw_overlay(SDL_Renderer *renderer);
+void profiler_shutdown(void);
+
+// Start timing a phase (0 while profiling is off)
+static inline uint64_t profile_begin(void) {
+    return profiler_enabled ? frame_clock_now_ns() : 0;
+}
+
+// Add the time since a profile_begin to a phase of the current frame
+// (skipped if profiling was switched on in between)
+static inline void profile_end(ProfilePhase phase, uint64_t start) {
+    if (profiler_enabled && start != 0) profiler_record(phase, frame_clock_now_ns() - start);
+}
+
+#endif /* PROFILER_H */
@@ -0,0 +1,54 @@
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Adaptive render quality. The governor is fed the work time of every frame
+// (sleep excluded) and keeps a smoothed average of it. When the average
+// stays above QUALITY_DEGRADE_SHARE of the frame budget for
+// QUALITY_DEGRADE_FRAMES frames it drops one level, shedding visual effects;
+// it climbs back one level only after QUALITY_RECOVER_FRAMES frames below
+// QUALITY_RECOVER_SHARE, so it does not flip back and forth at the edge.
+#define QUALITY_SMOOTHING 0.1f           // Weight of the newest frame in the average
+#define QUALITY_DEGRADE_SHARE 0.9f       // Of the budget
+#define QUALITY_RECOVER_SHARE 0.6f
+#define QUALITY_DEGRADE_FRAMES 20        // A third of a second at 60 fps
+#define QUALITY_RECOVER_FRAMES 180       // Three seconds at 60 fps
+
+typedef enum {
+    QUALITY_HIGH = 0,        // Every effect
+    QUALITY_MEDIUM,          // Half the particles, no gradient backgrounds
+    QUALITY_LOW,             // A quarter of the particles, still tiles and enemies
+    QUALITY_MINIMAL,         // No particles, no enemy eyes
+    QUALITY_LEVEL_COUNT
+} QualityLevel;
+
+// What a level draws
+typedef struct {
+    int particle_divisor;        // Spawn chances are divided by this (0 = no particles)
+    bool gradient_background;    // Game and welcome background gradients
+    bool tile_glow;              // Pulsing keys, treasures and exit
+    bool tile_sparkles;          // Sparkles over keys, treasures and the exit
+    bool enemy_animation;        // Enemy pulse and hover
+    bool enemy_eyes;
+} QualitySettings;
+
+typedef struct {
+    QualityLevel level;
+    float average_ms;                            // Smoothed frame work time
+    float budget_ms;
+    unsigned int changes;                        // Level changes so far
+    double seconds_at[QUALITY_LEVEL_COUNT];      // Time spent at each level
+} QualityStats;
+
+// Function declarations
+void quality_init(uint64_t budget_ns);
+void quality_record_frame(uint64_t work_ns);
+QualityLevel quality_level(void);
+const QualitySettings *quality_settings(void);
+const char *quality_level_name(QualityLevel level);
+void quality_get_stats(QualityStats *stats);
+void quality_print_stats(void);
+
+#endif /* QUALITY_H */
@@ -0,0 +1,22 @@
+#ifndef RENDER_BATCH_H
+#define RENDER_BATCH_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+// Coloured rectangles, triangles, lines and filled circles are collected
+// into one vertex array and submitted with a single SDL_RenderGeometry call
+// per layer (render_batch_flush). Primitives are drawn in the order they
+// were added, with the renderer's draw blend mode. Where SDL_RenderGeometry
+// is missing (SDL older than 2.0.18) or fails, runs of rectangles of one
+// colour are drawn with SDL_RenderFillRects and other shapes directly.
+
+// Function declarations
+void render_batch_rect(int x, int y, int w, int h, SDL_Color color);
+void render_batch_line(int x1, int y1, int x2, int y2, SDL_Color color);
+void render_batch_triangle(float x0, float y0, float x1, float y1, float x2, float y2, SDL_Color color);
+void render_batch_circle(float cx, float cy, float radius, int segments, SDL_Color color);
+void render_batch_flush(SDL_Renderer *renderer);
+void render_batch_free(void);
+
+#endif /* RENDER_BATCH_H */
@@ -10,6 +10,9 @@
 #define SHM_PATH "/etc/passwd"  // Use a file that's guaranteed to exist
 #define SHM_ID 'D'
 
+// Alignment of each region in the shared segment
+#define SHM_REGION_ALIGN 64
+
 // Semaphore name
 #define SEM_NAME "/dungeon_conquerors_sem"
 
@@ -19,7 +22,8 @@ extern sem_t* sem_id;
 extern GameState* game_state;
 
 // Function declarations
-bool init_shared_memory(void);
+size_t shared_segment_size(int map_width, int map_height, bool streamed);
+bool init_shared_memory(int map_width, int map_height, bool streamed, unsigned int seed, const char *level_path);
 void cleanup_shared_memory(void);
 void lock_game_state(void);
 void unlock_game_state(void);
@@ -0,0 +1,23 @@
+#ifndef SINE_LUT_H
+#define SINE_LUT_H
+
+#include <stdint.h>
+
+// Sine by table lookup for the pulse and hover animations, which are
+// evaluated many times per frame and need no more than three decimals.
+// sine_lut_init must run once before lut_sinf is used.
+#define SINE_LUT_BITS 12
+#define SINE_LUT_SIZE (1 << SINE_LUT_BITS)
+
+extern float sine_lut[SINE_LUT_SIZE];
+
+// Function declarations
+void sine_lut_init(void);
+
+// sin(radians) to within about 0.002
+static inline float lut_sinf(float radians) {
+    int64_t index = (int64_t)(radians * (SINE_LUT_SIZE / 6.28318530717958647692f));
+    return sine_lut[index & (SINE_LUT_SIZE - 1)];
+}
+
+#endif /* SINE_LUT_H */
@@ -0,0 +1,31 @@
+#ifndef SPRITE_ATLAS_H
+#define SPRITE_ATLAS_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+// Entity and item shapes are rasterized once, antialiased, into a texture
+// atlas of TILE_SIZE cells. Each frame a sprite is a quad of that texture
+// tinted by a vertex colour (which also carries the pulse brightness and
+// alpha); all queued sprites go out in one SDL_RenderGeometry call. Sprites
+// meant to be tinted are white; the others are drawn with a white tint or
+// a grey one to scale their colours. The atlas is built on first use.
+typedef enum {
+    SPRITE_PLAYER_BODY = 0,  // Player disc
+    SPRITE_PLAYER_CORE,      // Smaller disc highlighting the player's centre
+    SPRITE_KEY,              // Key head and stem
+    SPRITE_TREASURE,         // Chest in full colour
+    SPRITE_ENEMY_BODY,       // Enemy triangle
+    SPRITE_EYES_CHASE,       // Eyes per enemy type, in full colour
+    SPRITE_EYES_RANDOM,
+    SPRITE_EYES_GUARD,
+    SPRITE_EYES_SMART,
+    SPRITE_COUNT
+} SpriteId;
+
+// Function declarations
+void sprite_atlas_draw(SpriteId id, int x, int y, SDL_Color tint);
+void sprite_atlas_flush(SDL_Renderer *renderer);
+void sprite_atlas_destroy(void);
+
+#endif /* SPRITE_ATLAS_H */
@@ -0,0 +1,19 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <SDL2/SDL.h>
+
+// Text is drawn from the line glyphs of glyph_lines, rasterized once per
+// size into a glyph atlas texture. The quads of recently drawn strings are
+// kept in a small cache keyed by (string, size, colour), so an unchanged
+// label costs one SDL_RenderGeometry call and no layout work.
+#define TEXT_MAX_ATLASES 8           // Glyph sizes kept at once
+#define TEXT_CACHE_ENTRIES 64
+#define TEXT_CACHE_MAX_LENGTH 63     // Longer strings are laid out every time
+
+// Function declarations
+void draw_text(SDL_Renderer* renderer, int x, int y, const char* text, int size, SDL_Color color);
+void draw_simple_text(SDL_Renderer* renderer, int x, int y, const char* text, int size);
+void text_cache_destroy(void);
+
+#endif /* TEXT_H */
@@ -0,0 +1,35 @@
+#ifndef TILE_LAYER_H
+#define TILE_LAYER_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "game.h"
+
+// The static look of the map (floors, walls, doors and the base colour of
+// every other tile) is kept in a render-target texture one viewport in size.
+// Map tile (x, y) lives in texture cell (x mod columns, y mod rows), so
+// scrolling only draws the newly exposed rows and columns; the texture is
+// shown with at most four SDL_RenderCopy calls (one per wrapped quadrant).
+// A shadow copy of what each cell holds finds changed tiles each frame.
+
+// Most animated tiles (keys, treasures, the exit) reported per frame
+#define TILE_LAYER_MAX_ANIMATED 1024
+
+// A visible tile drawn on top of the layer every frame
+typedef struct {
+    int map_x;
+    int map_y;
+    int screen_x;
+    int screen_y;
+    TileType tile;
+} AnimatedTile;
+
+// Function declarations
+void tile_layer_draw_tile(TileType tile, int map_y, int x, int y);
+bool tile_layer_is_animated(TileType tile);
+int tile_layer_render(SDL_Renderer *renderer, const RenderSnapshot *snapshot,
+                      AnimatedTile *animated, int max_animated);
+void tile_layer_invalidate(void);
+void tile_layer_destroy(void);
+
+#endif /* TILE_LAYER_H */
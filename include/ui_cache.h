@@ -0,0 +1,27 @@
+#ifndef UI_CACHE_H
+#define UI_CACHE_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "game.h"
+
+// The screen gradients (game and welcome backgrounds, HUD bar, timer box,
+// score and health bars) used to be drawn one line per pixel row or column
+// every frame. Each is now a one pixel thick texture built from the same
+// colours and stretched across its area with a single SDL_RenderCopy. A
+// gradient is rebuilt only when its input changes (the health bar follows
+// the player's health); without textures the lines are drawn as before.
+
+// Longest gradient, in pixels
+#define UI_GRADIENT_MAX_LENGTH (WINDOW_WIDTH > WINDOW_HEIGHT ? WINDOW_WIDTH : WINDOW_HEIGHT)
+
+// Function declarations
+void ui_draw_background(SDL_Renderer *renderer);
+void ui_draw_welcome_background(SDL_Renderer *renderer);
+void ui_draw_hud_background(SDL_Renderer *renderer);
+void ui_draw_timer_background(SDL_Renderer *renderer);
+void ui_draw_score_bar(SDL_Renderer *renderer, int x, int y, int width);
+void ui_draw_health_bar(SDL_Renderer *renderer, int x, int y, int health);
+void ui_cache_destroy(void);
+
+#endif /* UI_CACHE_H */
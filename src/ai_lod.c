@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include "../include/ai_lod.h"
+#include "../include/pathfield.h"
+
+// Largest distance in each tier before the enemy is moved down a tier
+static const int tier_max_distance[AI_LOD_TIER_COUNT] = {
+    AI_LOD_NEAR_DISTANCE,
+    AI_LOD_FAR_DISTANCE,
+    AI_LOD_DORMANT_DISTANCE,
+    PATHFIELD_UNREACHED
+};
+
+// Reset the scheduler; every enemy starts at full cadence
+void ai_lod_init(GameState *state, int budget_us) {
+    if (state == NULL) return;
+
+    AiScheduler *lod = &state->ai_lod;
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        lod->tier[i] = AI_LOD_ACTIVE;
+    }
+    for (int i = 0; i < AI_LOD_FIELD_SIDE * AI_LOD_FIELD_SIDE; i++) {
+        lod->player_distance[i] = PATHFIELD_UNREACHED;
+    }
+    lod->field_x = -1;
+    lod->field_y = -1;
+    lod->field_level = 0;
+    lod->tick = 0;
+    lod->window = 0;
+    lod->window_start_tick = 0;
+    lod->budget_us = budget_us > 0 ? budget_us : AI_LOD_DEFAULT_BUDGET_US;
+    lod->budget_remaining_us = lod->budget_us;
+    lod->previous_remaining_us = lod->budget_us;
+    lod->decisions_this_window = 0;
+    lod->deferred_this_window = 0;
+}
+
+// Pick the tier an enemy belongs in from its path distance to the player
+static AiLodTier tier_for_distance(int distance) {
+    for (int tier = AI_LOD_ACTIVE; tier < AI_LOD_DORMANT; tier++) {
+        if (distance <= tier_max_distance[tier]) {
+            return (AiLodTier)tier;
+        }
+    }
+    return AI_LOD_DORMANT;
+}
+
+// Start a new scheduler tick: refill the budget when a new window begins,
+// refresh the player distance field if the player moved, and move each enemy
+// at most one tier toward the tier its distance calls for. An overrun is
+// carried into the next window rather than forgotten. Must be called with
+// the game state locked.
+void ai_lod_update(GameState *state) {
+    if (state == NULL) return;
+
+    AiScheduler *lod = &state->ai_lod;
+    lod->tick++;
+    if (lod->tick - lod->window_start_tick >= AI_LOD_WINDOW_TICKS) {
+        lod->window++;
+        lod->window_start_tick = lod->tick;
+        lod->previous_remaining_us = lod->budget_remaining_us;
+        int debt_us = lod->budget_remaining_us < 0 ? -lod->budget_remaining_us : 0;
+        lod->budget_remaining_us = lod->budget_us - debt_us;
+        lod->decisions_this_window = 0;
+        lod->deferred_this_window = 0;
+    }
+
+    Player *player = &state->players[0];
+    if (!player->is_active) return;
+
+    // The field only needs to cover the dormant boundary plus its hysteresis
+    // band, so it is a fixed window around the player, whatever the map size
+    if (player->x != lod->field_x || player->y != lod->field_y || state->current_level != lod->field_level) {
+        pathfield_search_window(&state->map, player->x, player->y, AI_LOD_FIELD_RADIUS, lod->player_distance);
+        lod->field_x = player->x;
+        lod->field_y = player->y;
+        lod->field_level = state->current_level;
+    }
+
+    int view_x, view_y, view_w, view_h;
+    get_viewport(state, 0, &view_x, &view_y, &view_w, &view_h);
+
+    for (int i = 0; i < state->num_enemies; i++) {
+        if (!state->enemies.active[i]) continue;
+
+        int enemy_x = state->enemies.x[i];
+        int enemy_y = state->enemies.y[i];
+        int distance = ai_lod_player_distance(state, enemy_x, enemy_y);
+        bool on_screen = enemy_x >= view_x && enemy_x < view_x + view_w &&
+                         enemy_y >= view_y && enemy_y < view_y + view_h;
+
+        // Enemies sealed off from the player can never reach them: dormant
+        // right away, without waiting for the distance field
+        if (!on_screen && !pathfield_connected(&state->map, enemy_x, enemy_y, player->x, player->y)) {
+            distance = PATHFIELD_UNREACHED;
+        }
+
+        AiLodTier current = lod->tier[i];
+        AiLodTier target = on_screen ? AI_LOD_ACTIVE : tier_for_distance(distance);
+
+        if (target < current) {
+            // Promote one tier per tick so enemies ramp up as the player approaches
+            lod->tier[i] = (AiLodTier)(current - 1);
+        } else if (target > current &&
+                   (distance == PATHFIELD_UNREACHED ||
+                    distance > tier_max_distance[current] + AI_LOD_HYSTERESIS)) {
+            // Only demote once the enemy is clearly past the boundary
+            lod->tier[i] = (AiLodTier)(current + 1);
+        }
+    }
+}
+
+// Path distance from the player to (x, y) as of the last field rebuild, or
+// PATHFIELD_UNREACHED beyond AI_LOD_FIELD_RADIUS
+int ai_lod_player_distance(const GameState *state, int x, int y) {
+    const AiScheduler *lod = &state->ai_lod;
+    if (lod->field_x < 0) return PATHFIELD_UNREACHED;
+    return pathfield_window_distance(lod->player_distance, lod->field_x, lod->field_y, AI_LOD_FIELD_RADIUS, x, y);
+}
+
+// Get the current tier of an enemy
+AiLodTier ai_lod_tier(const GameState *state, int enemy_id) {
+    if (state == NULL || enemy_id < 0 || enemy_id >= MAX_ENEMIES) {
+        return AI_LOD_ACTIVE;
+    }
+    return state->ai_lod.tier[enemy_id];
+}
+
+// Multiplier applied to an enemy's move_frequency for its tier
+int ai_lod_frequency_scale(AiLodTier tier) {
+    switch (tier) {
+        case AI_LOD_ACTIVE:
+            return 1;
+        case AI_LOD_NEAR:
+            return 2;
+        case AI_LOD_FAR:
+            return 4;
+        case AI_LOD_DORMANT:
+        default:
+            return 8;
+    }
+}
+
+// Ask for permission to run one AI decision in the current window. Lower
+// tiers may only dip into the part of the budget the higher tiers leave
+// untouched, so on-screen enemies keep thinking when the budget runs short.
+// The granted window is stored in *window for ai_lod_charge.
+// Must be called with the game state locked.
+bool ai_lod_try_acquire(GameState *state, int enemy_id, unsigned int *window) {
+    if (state == NULL || enemy_id < 0 || enemy_id >= MAX_ENEMIES) {
+        return false;
+    }
+
+    AiScheduler *lod = &state->ai_lod;
+    int reserve_us = lod->budget_us * lod->tier[enemy_id] / AI_LOD_TIER_COUNT;
+
+    if (lod->budget_remaining_us > reserve_us) {
+        lod->decisions_this_window++;
+        *window = lod->window;
+        return true;
+    }
+
+    lod->deferred_this_window++;
+    return false;
+}
+
+// Charge the CPU time of a granted decision against the window it was
+// granted in. If that window has closed since, whatever the charge takes it
+// past its budget comes out of the current window.
+// Must be called with the game state locked.
+void ai_lod_charge(GameState *state, unsigned int window, long elapsed_us) {
+    if (state == NULL) return;
+
+    // Every decision costs something, even when it is below clock resolution
+    AiScheduler *lod = &state->ai_lod;
+    int cost_us = elapsed_us < 1 ? 1 : (int)elapsed_us;
+    if (window == lod->window) {
+        lod->budget_remaining_us -= cost_us;
+        return;
+    }
+
+    int overrun_us = cost_us;
+    if (window == lod->window - 1) {
+        int before = lod->previous_remaining_us;
+        lod->previous_remaining_us -= cost_us;
+        overrun_us = before <= 0 ? cost_us : (lod->previous_remaining_us < 0 ? -lod->previous_remaining_us : 0);
+    }
+    lod->budget_remaining_us -= overrun_us;
+}
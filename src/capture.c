@@ -0,0 +1,485 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "../include/capture.h"
+#include "../include/frame_clock.h"
+
+// A frame waiting for the encoder
+typedef struct {
+    unsigned char *pixels;   // RGBA, width * 4 bytes per row
+    unsigned long frame;     // Presented frame number
+} CaptureBuffer;
+
+// Capture state (main process only). The queue and the counters are shared
+// with the encoder thread under queue_mutex.
+static bool capturing = false;
+static CaptureFormat capture_format;
+static char capture_target[256];
+static int capture_every = 1;
+static int width = 0;
+static int height = 0;
+static unsigned long frames_seen = 0;
+static FILE *stream = NULL;              // y4m output
+static bool stream_is_pipe = false;
+static pthread_t encoder_thread;
+static bool encoder_stopping = false;
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static CaptureBuffer buffers[CAPTURE_POOL_SIZE];
+static CaptureBuffer *free_buffers[CAPTURE_POOL_SIZE];
+static int free_count = 0;
+static CaptureBuffer *queue[CAPTURE_POOL_SIZE];
+static int queue_head = 0;
+static int queue_count = 0;
+static CaptureStats stats;
+
+// Encoder scratch space (encoder thread only)
+static unsigned char *scratch = NULL;
+static size_t scratch_size = 0;
+
+static const char *format_names[] = {"raw", "qoi", "png", "y4m"};
+
+// Look up a format by name
+bool capture_parse_format(const char *name, CaptureFormat *format) {
+    for (int i = 0; i < (int)(sizeof(format_names) / sizeof(format_names[0])); i++) {
+        if (strcmp(name, format_names[i]) == 0) {
+            *format = (CaptureFormat)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void put_be32(unsigned char *p, unsigned int v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+// Encode a frame as QOI into scratch; returns the encoded size
+static size_t encode_qoi(const unsigned char *pixels) {
+    unsigned char *out = scratch;
+    size_t n = 0;
+    memcpy(out, "qoif", 4);
+    put_be32(out + 4, (unsigned int)width);
+    put_be32(out + 8, (unsigned int)height);
+    out[12] = 4;   // RGBA
+    out[13] = 0;   // sRGB with linear alpha
+    n = 14;
+
+    unsigned char index[64][4];
+    memset(index, 0, sizeof(index));
+    unsigned char prev[4] = {0, 0, 0, 255};
+    int run = 0;
+    size_t total = (size_t)width * height;
+
+    for (size_t i = 0; i < total; i++) {
+        const unsigned char *px = pixels + i * 4;
+        if (memcmp(px, prev, 4) == 0) {
+            run++;
+            if (run == 62 || i == total - 1) {
+                out[n++] = (unsigned char)(0xc0 | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            out[n++] = (unsigned char)(0xc0 | (run - 1));
+            run = 0;
+        }
+
+        int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+        if (memcmp(index[hash], px, 4) == 0) {
+            out[n++] = (unsigned char)hash;
+        } else {
+            memcpy(index[hash], px, 4);
+            if (px[3] == prev[3]) {
+                signed char vr = (signed char)(px[0] - prev[0]);
+                signed char vg = (signed char)(px[1] - prev[1]);
+                signed char vb = (signed char)(px[2] - prev[2]);
+                signed char vg_r = (signed char)(vr - vg);
+                signed char vg_b = (signed char)(vb - vg);
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                    out[n++] = (unsigned char)(0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                    out[n++] = (unsigned char)(0x80 | (vg + 32));
+                    out[n++] = (unsigned char)((vg_r + 8) << 4 | (vg_b + 8));
+                } else {
+                    out[n++] = 0xfe;
+                    memcpy(out + n, px, 3);
+                    n += 3;
+                }
+            } else {
+                out[n++] = 0xff;
+                memcpy(out + n, px, 4);
+                n += 4;
+            }
+        }
+        memcpy(prev, px, 4);
+    }
+
+    static const unsigned char end_marker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    memcpy(out + n, end_marker, sizeof(end_marker));
+    return n + sizeof(end_marker);
+}
+
+// CRC-32 of PNG chunks, table built on first use (encoder thread only)
+static unsigned int crc_table[256];
+static bool crc_table_ready = false;
+
+static unsigned int crc_update(unsigned int crc, const unsigned char *data, size_t len) {
+    if (!crc_table_ready) {
+        for (unsigned int i = 0; i < 256; i++) {
+            unsigned int c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            crc_table[i] = c;
+        }
+        crc_table_ready = true;
+    }
+    for (size_t i = 0; i < len; i++) {
+        crc = crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+// Append a PNG chunk to scratch at offset n; returns the new offset
+static size_t put_png_chunk(size_t n, const char *type, const unsigned char *data, size_t len) {
+    put_be32(scratch + n, (unsigned int)len);
+    memcpy(scratch + n + 4, type, 4);
+    if (len > 0 && data != scratch + n + 8) memcpy(scratch + n + 8, data, len);
+    unsigned int crc = crc_update(0xffffffffu, scratch + n + 4, len + 4) ^ 0xffffffffu;
+    put_be32(scratch + n + 8 + len, crc);
+    return n + 12 + len;
+}
+
+// Encode a frame as PNG into scratch; returns the encoded size. The image
+// data uses stored deflate blocks, so no compression library is needed and
+// the encoder keeps up with the game; files are about the size of raw frames.
+static size_t encode_png(const unsigned char *pixels) {
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    memcpy(scratch, signature, sizeof(signature));
+
+    unsigned char header[13];
+    put_be32(header, (unsigned int)width);
+    put_be32(header + 4, (unsigned int)height);
+    header[8] = 8;     // Bits per channel
+    header[9] = 6;     // RGBA
+    header[10] = 0;    // Deflate
+    header[11] = 0;    // Adaptive filtering
+    header[12] = 0;    // Not interlaced
+    size_t n = put_png_chunk(sizeof(signature), "IHDR", header, sizeof(header));
+
+    // Build the zlib stream in place after the IDAT length and type
+    unsigned char *z = scratch + n + 8;
+    size_t zn = 0;
+    z[zn++] = 0x78;
+    z[zn++] = 0x01;
+
+    size_t row_bytes = (size_t)width * 4;
+    size_t raw_left = (size_t)height * (row_bytes + 1);
+    size_t block_left = 0;
+    unsigned int adler_a = 1, adler_b = 0;
+    for (int y = 0; y < height; y++) {
+        static const unsigned char filter_none = 0;
+        const unsigned char *parts[2] = {&filter_none, pixels + (size_t)y * row_bytes};
+        size_t lengths[2] = {1, row_bytes};
+        for (int part = 0; part < 2; part++) {
+            const unsigned char *data = parts[part];
+            size_t len = lengths[part];
+            while (len > 0) {
+                if (block_left == 0) {
+                    block_left = raw_left < 65535 ? raw_left : 65535;
+                    z[zn++] = block_left == raw_left ? 1 : 0;   // Last block?
+                    z[zn++] = (unsigned char)block_left;
+                    z[zn++] = (unsigned char)(block_left >> 8);
+                    z[zn++] = (unsigned char)~block_left;
+                    z[zn++] = (unsigned char)(~block_left >> 8);
+                }
+                size_t count = len < block_left ? len : block_left;
+                memcpy(z + zn, data, count);
+                for (size_t i = 0; i < count; i++) {
+                    adler_a += data[i];
+                    if (adler_a >= 65521) adler_a -= 65521;
+                    adler_b += adler_a;
+                    if (adler_b >= 65521) adler_b -= 65521;
+                }
+                zn += count;
+                data += count;
+                len -= count;
+                block_left -= count;
+                raw_left -= count;
+            }
+        }
+    }
+    put_be32(z + zn, adler_b << 16 | adler_a);
+    zn += 4;
+
+    n = put_png_chunk(n, "IDAT", z, zn);
+    return put_png_chunk(n, "IEND", NULL, 0);
+}
+
+// Convert a frame to YUV 4:2:0 (full range BT.601) into scratch; returns
+// the size of the three planes
+static size_t encode_y4m(const unsigned char *pixels) {
+    int chroma_w = (width + 1) / 2;
+    int chroma_h = (height + 1) / 2;
+    unsigned char *plane_y = scratch;
+    unsigned char *plane_u = plane_y + (size_t)width * height;
+    unsigned char *plane_v = plane_u + (size_t)chroma_w * chroma_h;
+
+    for (int y = 0; y < height; y++) {
+        const unsigned char *row = pixels + (size_t)y * width * 4;
+        for (int x = 0; x < width; x++) {
+            const unsigned char *px = row + x * 4;
+            plane_y[(size_t)y * width + x] = (unsigned char)((77 * px[0] + 150 * px[1] + 29 * px[2] + 128) >> 8);
+        }
+    }
+    for (int cy = 0; cy < chroma_h; cy++) {
+        for (int cx = 0; cx < chroma_w; cx++) {
+            int r = 0, g = 0, b = 0, samples = 0;
+            for (int dy = 0; dy < 2 && cy * 2 + dy < height; dy++) {
+                for (int dx = 0; dx < 2 && cx * 2 + dx < width; dx++) {
+                    const unsigned char *px = pixels + ((size_t)(cy * 2 + dy) * width + cx * 2 + dx) * 4;
+                    r += px[0];
+                    g += px[1];
+                    b += px[2];
+                    samples++;
+                }
+            }
+            r /= samples;
+            g /= samples;
+            b /= samples;
+            plane_u[(size_t)cy * chroma_w + cx] = (unsigned char)(((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128);
+            plane_v[(size_t)cy * chroma_w + cx] = (unsigned char)(((128 * r - 107 * g - 21 * b + 128) >> 8) + 128);
+        }
+    }
+    return (size_t)width * height + 2 * (size_t)chroma_w * chroma_h;
+}
+
+// Write one numbered file of the frame
+static bool write_frame_file(const unsigned char *data, size_t size, unsigned long frame) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/frame_%06lu.%s", capture_target, frame, format_names[capture_format]);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        perror("Failed to open capture file");
+        return false;
+    }
+    bool ok = fwrite(data, 1, size, file) == size;
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+// Encode and write one frame
+static bool encode_frame(const CaptureBuffer *buffer) {
+    switch (capture_format) {
+        case CAPTURE_RAW:
+            return write_frame_file(buffer->pixels, (size_t)width * height * 4, buffer->frame);
+        case CAPTURE_QOI:
+            return write_frame_file(scratch, encode_qoi(buffer->pixels), buffer->frame);
+        case CAPTURE_PNG:
+            return write_frame_file(scratch, encode_png(buffer->pixels), buffer->frame);
+        case CAPTURE_Y4M: {
+            size_t size = encode_y4m(buffer->pixels);
+            return fputs("FRAME\n", stream) != EOF && fwrite(scratch, 1, size, stream) == size;
+        }
+    }
+    return false;
+}
+
+// Encoder thread: encode queued frames in order and hand their buffers
+// back; on stop, finish the frames already queued
+static void *encoder_main(void *arg) {
+    (void)arg;
+    bool reported = false;
+
+    for (;;) {
+        pthread_mutex_lock(&queue_mutex);
+        while (queue_count == 0 && !encoder_stopping) {
+            pthread_cond_wait(&queue_cond, &queue_mutex);
+        }
+        if (queue_count == 0) {
+            pthread_mutex_unlock(&queue_mutex);
+            break;
+        }
+        CaptureBuffer *buffer = queue[queue_head];
+        queue_head = (queue_head + 1) % CAPTURE_POOL_SIZE;
+        queue_count--;
+        pthread_mutex_unlock(&queue_mutex);
+
+        bool ok = encode_frame(buffer);
+        if (!ok && !reported) {
+            printf("Warning: failed to write captured frame %lu; later failures are only counted\n", buffer->frame);
+            reported = true;
+        }
+
+        pthread_mutex_lock(&queue_mutex);
+        if (ok) stats.written++; else stats.failed++;
+        free_buffers[free_count++] = buffer;
+        pthread_mutex_unlock(&queue_mutex);
+    }
+    return NULL;
+}
+
+// Free the buffers and close the output
+static void release_capture(void) {
+    for (int i = 0; i < CAPTURE_POOL_SIZE; i++) {
+        free(buffers[i].pixels);
+        buffers[i].pixels = NULL;
+    }
+    free(scratch);
+    scratch = NULL;
+    if (stream != NULL) {
+        if (stream_is_pipe) pclose(stream); else fclose(stream);
+        stream = NULL;
+    }
+}
+
+// Start recording every Nth frame of the renderer's output to target (a
+// directory, a y4m file or "|command")
+bool capture_start(SDL_Renderer *renderer, const char *target, CaptureFormat format, int every) {
+    if (capturing) return false;
+    if (SDL_GetRendererOutputSize(renderer, &width, &height) != 0 || width <= 0 || height <= 0) {
+        printf("Failed to get renderer size for capture: %s\n", SDL_GetError());
+        return false;
+    }
+
+    capture_format = format;
+    capture_every = every > 0 ? every : 1;
+    snprintf(capture_target, sizeof(capture_target), "%s", target);
+    frames_seen = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    // The encoder needs room for the largest output of the format: QOI's
+    // worst case, a whole PNG file or the YUV planes
+    size_t frame_bytes = (size_t)width * height * 4;
+    switch (format) {
+        case CAPTURE_RAW:
+            scratch_size = 0;
+            break;
+        case CAPTURE_QOI:
+            scratch_size = (size_t)width * height * 5 + 14 + 8;
+            break;
+        case CAPTURE_PNG:
+            scratch_size = frame_bytes + height + (frame_bytes + height) / 65535 * 5 + 128;
+            break;
+        case CAPTURE_Y4M:
+            scratch_size = frame_bytes;
+            break;
+    }
+
+    if (format == CAPTURE_Y4M) {
+        if (target[0] == '|') {
+            // Keep running if the command exits; writes then fail with EPIPE
+            signal(SIGPIPE, SIG_IGN);
+            stream = popen(target + 1, "w");
+            stream_is_pipe = true;
+        } else {
+            stream = fopen(target, "wb");
+            stream_is_pipe = false;
+        }
+        if (stream == NULL) {
+            perror("Failed to open capture stream");
+            return false;
+        }
+        fprintf(stream, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg\n",
+                width, height, CAPTURE_DEFAULT_FPS, capture_every);
+    } else if (mkdir(target, 0777) == -1 && errno != EEXIST) {
+        perror("Failed to create capture directory");
+        return false;
+    }
+
+    free_count = 0;
+    for (int i = 0; i < CAPTURE_POOL_SIZE; i++) {
+        buffers[i].pixels = malloc(frame_bytes);
+        if (buffers[i].pixels == NULL) break;
+        free_buffers[free_count++] = &buffers[i];
+    }
+    if (scratch_size > 0) {
+        scratch = malloc(scratch_size);
+    }
+    if (free_count < CAPTURE_POOL_SIZE || (scratch_size > 0 && scratch == NULL)) {
+        perror("Failed to allocate capture buffers");
+        release_capture();
+        return false;
+    }
+
+    queue_head = 0;
+    queue_count = 0;
+    encoder_stopping = false;
+    if (pthread_create(&encoder_thread, NULL, encoder_main, NULL) != 0) {
+        perror("Failed to create capture encoder thread");
+        release_capture();
+        return false;
+    }
+
+    capturing = true;
+    printf("Capturing every %d frame(s) as %s to %s\n", capture_every, format_names[format], target);
+    return true;
+}
+
+// Read back the frame just drawn and queue it for encoding. Call before
+// SDL_RenderPresent: the back buffer is undefined after the present.
+// Returns the nanoseconds the readback took (0 if none was made), so the
+// caller can keep it out of its own frame timing.
+uint64_t capture_frame(SDL_Renderer *renderer) {
+    if (!capturing) return 0;
+    unsigned long frame = frames_seen++;
+    if (frame % (unsigned long)capture_every != 0) return 0;
+
+    pthread_mutex_lock(&queue_mutex);
+    CaptureBuffer *buffer = free_count > 0 ? free_buffers[--free_count] : NULL;
+    if (buffer == NULL) stats.dropped++;
+    pthread_mutex_unlock(&queue_mutex);
+    if (buffer == NULL) return 0;
+
+    // RGBA32 is R, G, B, A in memory whatever the byte order
+    uint64_t start = frame_clock_now_ns();
+    bool ok = SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_RGBA32, buffer->pixels, width * 4) == 0;
+    uint64_t elapsed = frame_clock_now_ns() - start;
+    buffer->frame = frame;
+
+    pthread_mutex_lock(&queue_mutex);
+    stats.readback_ms += elapsed / 1e6;
+    if (elapsed / 1e6 > stats.readback_max_ms) stats.readback_max_ms = elapsed / 1e6;
+    if (ok) {
+        queue[(queue_head + queue_count) % CAPTURE_POOL_SIZE] = buffer;
+        queue_count++;
+        stats.captured++;
+        pthread_cond_signal(&queue_cond);
+    } else {
+        free_buffers[free_count++] = buffer;
+        stats.failed++;
+    }
+    pthread_mutex_unlock(&queue_mutex);
+    return elapsed;
+}
+
+// Copy the frame counters
+void capture_get_stats(CaptureStats *out) {
+    pthread_mutex_lock(&queue_mutex);
+    *out = stats;
+    pthread_mutex_unlock(&queue_mutex);
+}
+
+// Finish encoding the queued frames, stop the encoder and print the counts
+void capture_stop(void) {
+    if (!capturing) return;
+
+    pthread_mutex_lock(&queue_mutex);
+    encoder_stopping = true;
+    pthread_cond_broadcast(&queue_cond);
+    pthread_mutex_unlock(&queue_mutex);
+    pthread_join(encoder_thread, NULL);
+
+    release_capture();
+    capturing = false;
+    printf("Capture: %lu frames written, %lu dropped, %lu failed; readback %.2f ms average, %.2f ms max\n",
+           stats.written, stats.dropped, stats.failed,
+           stats.captured > 0 ? stats.readback_ms / stats.captured : 0.0, stats.readback_max_ms);
+}
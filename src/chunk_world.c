@@ -0,0 +1,488 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "../include/chunk_world.h"
+#include "../include/shared_memory.h"
+
+// A chunk waiting for a worker thread
+typedef struct {
+    int chunk_x;
+    int chunk_y;
+    unsigned int epoch;
+} ChunkRequest;
+
+// Worker threads and their request queue (main process only)
+static pthread_t workers[CHUNK_WORKERS];
+static int num_workers = 0;
+static bool workers_stopping = false;
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static ChunkRequest queue[CHUNK_QUEUE_SIZE];
+static int queue_head = 0;
+static int queue_count = 0;
+
+// Last chunk looked up by this thread. Tile reads mostly stay within one
+// chunk, so this skips the index for nearly all of them; the slot serial
+// tells when the chunk has been evicted since.
+static __thread struct {
+    const ChunkWorld *world;
+    int chunk_x;
+    int chunk_y;
+    int slot;
+    unsigned int serial;
+} last_chunk = {NULL, -1, -1, -1, 0};
+
+// Round a size up to a multiple of SHM_REGION_ALIGN
+static size_t align_region(size_t size) {
+    return (size + SHM_REGION_ALIGN - 1) & ~(size_t)(SHM_REGION_ALIGN - 1);
+}
+
+// Bytes needed for the chunk store of a level (header, index, flags, pool)
+size_t chunk_world_size(int width, int height) {
+    size_t chunks = (size_t)((width + CHUNK_SIZE - 1) >> CHUNK_SHIFT) * ((height + CHUNK_SIZE - 1) >> CHUNK_SHIFT);
+    return align_region(sizeof(ChunkWorld)) +
+           align_region(sizeof(short) * chunks) +
+           align_region(chunks) +
+           sizeof(MapTile) * CHUNK_POOL_SLOTS * CHUNK_TILES;
+}
+
+// Lay out an empty chunk store in chunk_world_size(width, height) bytes of
+// memory (normally a region of the shared segment)
+ChunkWorld *chunk_world_place(void *memory, int width, int height) {
+    if (memory == NULL) return NULL;
+
+    memset(memory, 0, chunk_world_size(width, height));
+    ChunkWorld *world = (ChunkWorld *)memory;
+    world->width = width;
+    world->height = height;
+    world->chunks_x = (width + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    world->chunks_y = (height + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+
+    size_t chunks = (size_t)world->chunks_x * world->chunks_y;
+    char *region = (char *)memory + align_region(sizeof(ChunkWorld));
+    world->index = (short *)region;
+    region += align_region(sizeof(short) * chunks);
+    world->flags = (unsigned char *)region;
+    region += align_region(chunks);
+    world->pool = (MapTile *)region;
+
+    for (int i = 0; i < CHUNK_POOL_SLOTS; i++) {
+        world->slots[i].chunk_x = -1;
+        world->slots[i].chunk_y = -1;
+    }
+    return world;
+}
+
+// Path of the spill file of a chunk
+static void spill_path(const ChunkWorld *world, int chunk_x, int chunk_y, char *path, size_t size) {
+    snprintf(path, size, "%s/%u-%d-%d-%d.chunk", world->spill_dir, world->seed, world->level, chunk_x, chunk_y);
+}
+
+// Make this game's spill directory on first use. It is private to the user
+// and unique to the game, so concurrent games never share spill files.
+static bool ensure_spill_dir(ChunkWorld *world) {
+    if (world->spill_dir[0] != '\0') return true;
+
+    char dir[sizeof(world->spill_dir)];
+    snprintf(dir, sizeof(dir), "%s", CHUNK_SPILL_TEMPLATE);
+    if (mkdtemp(dir) == NULL) {
+        perror("Failed to create chunk spill directory");
+        return false;
+    }
+    memcpy(world->spill_dir, dir, sizeof(dir));
+    return true;
+}
+
+// Save a modified chunk so it survives eviction. An older copy of the chunk
+// is replaced by a new file; existing files and symlinks are never written through.
+static bool write_spill(ChunkWorld *world, int chunk_x, int chunk_y, const MapTile *tiles) {
+    if (!ensure_spill_dir(world)) return false;
+
+    char path[256];
+    spill_path(world, chunk_x, chunk_y, path, sizeof(path));
+    unlink(path);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+    FILE *file = fd == -1 ? NULL : fdopen(fd, "wb");
+    if (file == NULL) {
+        perror("Failed to open chunk spill file");
+        if (fd != -1) close(fd);
+        return false;
+    }
+    bool ok = fwrite(tiles, sizeof(MapTile), CHUNK_TILES, file) == CHUNK_TILES;
+    if (fclose(file) != 0) ok = false;
+    if (!ok) {
+        printf("Warning: failed to save chunk (%d,%d); its changes are lost\n", chunk_x, chunk_y);
+    }
+    return ok;
+}
+
+// Read a spilled chunk back
+static bool read_spill(const ChunkWorld *world, int chunk_x, int chunk_y, MapTile *tiles) {
+    char path[256];
+    spill_path(world, chunk_x, chunk_y, path, sizeof(path));
+
+    int fd = open(path, O_RDONLY | O_NOFOLLOW);
+    FILE *file = fd == -1 ? NULL : fdopen(fd, "rb");
+    if (file == NULL) {
+        perror("Failed to open chunk spill file");
+        if (fd != -1) close(fd);
+        return false;
+    }
+    bool ok = fread(tiles, sizeof(MapTile), CHUNK_TILES, file) == CHUNK_TILES;
+    fclose(file);
+    return ok;
+}
+
+// Delete the spill files of the current level
+static void discard_spills(ChunkWorld *world) {
+    size_t chunks = (size_t)world->chunks_x * world->chunks_y;
+    for (size_t i = 0; i < chunks; i++) {
+        if (world->flags[i] & CHUNK_SPILLED) {
+            char path[256];
+            spill_path(world, (int)(i % world->chunks_x), (int)(i / world->chunks_x), path, sizeof(path));
+            unlink(path);
+        }
+    }
+}
+
+// Start a level: drop every chunk of the previous one and pick the key sites.
+// Chunks are then generated as they are first needed.
+void chunk_world_reset(ChunkWorld *world, unsigned int seed, int level, const MapGenParams *params) {
+    if (world == NULL || params == NULL) return;
+
+    discard_spills(world);
+    size_t chunks = (size_t)world->chunks_x * world->chunks_y;
+    memset(world->index, 0, sizeof(short) * chunks);
+    memset(world->flags, 0, chunks);
+    for (int i = 0; i < CHUNK_POOL_SLOTS; i++) {
+        world->slots[i].chunk_x = -1;
+        world->slots[i].chunk_y = -1;
+        world->slots[i].serial = 0;
+        world->slots[i].dirty = false;
+    }
+    world->resident = 0;
+    world->num_pins = 0;
+
+    world->epoch++;
+    world->seed = seed;
+    world->level = level;
+    world->params = *params;
+    world->num_keys = mapgen_chunk_key_sites(seed, level, world->width, world->height,
+                                             params->keys, world->key_x, world->key_y);
+}
+
+// Whether a chunk is close to the player or an enemy
+static bool chunk_pinned(const ChunkWorld *world, int chunk_x, int chunk_y) {
+    for (int i = 0; i < world->num_pins; i++) {
+        if (abs(chunk_x - world->pin_x[i]) <= world->pin_radius[i] &&
+            abs(chunk_y - world->pin_y[i]) <= world->pin_radius[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Drop a chunk from its slot, saving it first if it was modified
+static void evict_slot(ChunkWorld *world, int slot) {
+    ChunkSlot *entry = &world->slots[slot];
+    size_t chunk = (size_t)entry->chunk_y * world->chunks_x + entry->chunk_x;
+
+    if (entry->dirty &&
+        write_spill(world, entry->chunk_x, entry->chunk_y, &world->pool[(size_t)slot * CHUNK_TILES])) {
+        world->flags[chunk] |= CHUNK_SPILLED;
+        world->spilled++;
+    }
+    world->index[chunk] = 0;
+    entry->chunk_x = -1;
+    entry->chunk_y = -1;
+    entry->serial = 0;
+    entry->dirty = false;
+    world->resident--;
+    world->evicted++;
+}
+
+// Find a slot for a new chunk: a free one, else the least recently used
+// chunk away from the player and enemies (or simply the least recently used
+// one if every chunk is pinned)
+static int claim_slot(ChunkWorld *world) {
+    int victim = -1;
+    int pinned_victim = -1;
+    for (int i = 0; i < CHUNK_POOL_SLOTS; i++) {
+        const ChunkSlot *entry = &world->slots[i];
+        if (entry->chunk_x < 0) return i;
+
+        if (chunk_pinned(world, entry->chunk_x, entry->chunk_y)) {
+            if (pinned_victim < 0 || entry->last_used < world->slots[pinned_victim].last_used) {
+                pinned_victim = i;
+            }
+        } else if (victim < 0 || entry->last_used < world->slots[victim].last_used) {
+            victim = i;
+        }
+    }
+
+    if (victim < 0) victim = pinned_victim;
+    evict_slot(world, victim);
+    return victim;
+}
+
+// Record that a slot now holds a chunk
+static void register_slot(ChunkWorld *world, int slot, int chunk_x, int chunk_y) {
+    ChunkSlot *entry = &world->slots[slot];
+    entry->chunk_x = chunk_x;
+    entry->chunk_y = chunk_y;
+    entry->serial = ++world->next_serial;
+    if (entry->serial == 0) entry->serial = ++world->next_serial;
+    entry->last_used = world->clock;
+    entry->dirty = false;
+    world->index[(size_t)chunk_y * world->chunks_x + chunk_x] = (short)(slot + 1);
+    world->resident++;
+}
+
+// Make a chunk resident right away: read its spill file if it has one,
+// otherwise generate it. Returns its slot. Runs in the caller with the game
+// state lock held, so everyone waiting for the lock waits for this too.
+static int bring_in(ChunkWorld *world, int chunk_x, int chunk_y) {
+    int slot = claim_slot(world);
+    MapTile *tiles = &world->pool[(size_t)slot * CHUNK_TILES];
+    size_t chunk = (size_t)chunk_y * world->chunks_x + chunk_x;
+
+    if ((world->flags[chunk] & CHUNK_SPILLED) && read_spill(world, chunk_x, chunk_y, tiles)) {
+        world->loaded++;
+    } else if (mapgen_generate_chunk(world->seed, world->level, world->width, world->height, &world->params,
+                                     world->key_x, world->key_y, world->num_keys, chunk_x, chunk_y, tiles)) {
+        world->generated++;
+    } else {
+        memset(tiles, TILE_WALL, sizeof(MapTile) * CHUNK_TILES);
+    }
+
+    register_slot(world, slot, chunk_x, chunk_y);
+    return slot;
+}
+
+// Slot of a chunk, or -1 if it is not resident
+static inline int find_slot(ChunkWorld *world, int chunk_x, int chunk_y) {
+    if (last_chunk.world == world && last_chunk.chunk_x == chunk_x && last_chunk.chunk_y == chunk_y &&
+        world->slots[last_chunk.slot].serial == last_chunk.serial) {
+        return last_chunk.slot;
+    }
+
+    int entry = world->index[(size_t)chunk_y * world->chunks_x + chunk_x];
+    if (entry == 0) return -1;
+
+    int slot = entry - 1;
+    world->slots[slot].last_used = world->clock;
+    last_chunk.world = world;
+    last_chunk.chunk_x = chunk_x;
+    last_chunk.chunk_y = chunk_y;
+    last_chunk.slot = slot;
+    last_chunk.serial = world->slots[slot].serial;
+    return slot;
+}
+
+// Slot of a chunk, bringing it in if needed
+static int require_slot(ChunkWorld *world, int chunk_x, int chunk_y) {
+    int slot = find_slot(world, chunk_x, chunk_y);
+    if (slot >= 0) return slot;
+
+    bring_in(world, chunk_x, chunk_y);
+    return find_slot(world, chunk_x, chunk_y);
+}
+
+// Tile at (x, y), generating or loading its chunk if it is not resident.
+// Tiles outside the level are walls.
+MapTile chunk_world_get(ChunkWorld *world, int x, int y) {
+    if (x < 0 || y < 0 || x >= world->width || y >= world->height) return TILE_WALL;
+
+    int slot = require_slot(world, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT);
+    return world->pool[(size_t)slot * CHUNK_TILES + (y & (CHUNK_SIZE - 1)) * CHUNK_SIZE + (x & (CHUNK_SIZE - 1))];
+}
+
+// Tile at (x, y) if its chunk is resident; anything else reads as a wall
+MapTile chunk_world_peek(ChunkWorld *world, int x, int y) {
+    if (x < 0 || y < 0 || x >= world->width || y >= world->height) return TILE_WALL;
+
+    int slot = find_slot(world, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT);
+    if (slot < 0) return TILE_WALL;
+    return world->pool[(size_t)slot * CHUNK_TILES + (y & (CHUNK_SIZE - 1)) * CHUNK_SIZE + (x & (CHUNK_SIZE - 1))];
+}
+
+// Change the tile at (x, y); the chunk is saved to disk if it is evicted later
+void chunk_world_set(ChunkWorld *world, int x, int y, MapTile tile) {
+    if (x < 0 || y < 0 || x >= world->width || y >= world->height) return;
+
+    int slot = require_slot(world, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT);
+    MapTile *cell = &world->pool[(size_t)slot * CHUNK_TILES + (y & (CHUNK_SIZE - 1)) * CHUNK_SIZE + (x & (CHUNK_SIZE - 1))];
+    if (*cell != tile) {
+        *cell = tile;
+        world->slots[slot].dirty = true;
+    }
+}
+
+// Hand a chunk to the worker threads (no-op if none are running)
+static void request_chunk(ChunkWorld *world, int chunk_x, int chunk_y) {
+    size_t chunk = (size_t)chunk_y * world->chunks_x + chunk_x;
+    if (num_workers == 0 || (world->flags[chunk] & CHUNK_QUEUED)) return;
+
+    pthread_mutex_lock(&queue_mutex);
+    if (queue_count < CHUNK_QUEUE_SIZE) {
+        ChunkRequest *request = &queue[(queue_head + queue_count) % CHUNK_QUEUE_SIZE];
+        request->chunk_x = chunk_x;
+        request->chunk_y = chunk_y;
+        request->epoch = world->epoch;
+        queue_count++;
+        world->flags[chunk] |= CHUNK_QUEUED;
+        pthread_cond_signal(&queue_cond);
+    }
+    pthread_mutex_unlock(&queue_mutex);
+}
+
+// Add a pin and touch (or request) the chunks it covers
+static void pin_area(ChunkWorld *world, int x, int y, int radius) {
+    if (world->num_pins >= MAX_ENTITIES) return;
+
+    int chunk_x = x >> CHUNK_SHIFT;
+    int chunk_y = y >> CHUNK_SHIFT;
+    world->pin_x[world->num_pins] = chunk_x;
+    world->pin_y[world->num_pins] = chunk_y;
+    world->pin_radius[world->num_pins] = radius;
+    world->num_pins++;
+
+    for (int cy = chunk_y - radius; cy <= chunk_y + radius; cy++) {
+        if (cy < 0 || cy >= world->chunks_y) continue;
+        for (int cx = chunk_x - radius; cx <= chunk_x + radius; cx++) {
+            if (cx < 0 || cx >= world->chunks_x) continue;
+
+            int entry = world->index[(size_t)cy * world->chunks_x + cx];
+            if (entry != 0) {
+                world->slots[entry - 1].last_used = world->clock;
+            } else {
+                request_chunk(world, cx, cy);
+            }
+        }
+    }
+}
+
+// Once per frame (main process, lock held): advance the LRU clock, pin the
+// chunks around the player and the enemies, and queue the missing ones
+void chunk_world_update(GameState *state) {
+    if (state == NULL || state->map.chunks == NULL) return;
+
+    ChunkWorld *world = state->map.chunks;
+    world->clock++;
+    world->num_pins = 0;
+
+    for (int i = 0; i < state->num_players; i++) {
+        if (state->players[i].is_active) {
+            pin_area(world, state->players[i].x, state->players[i].y, CHUNK_STREAM_RADIUS);
+        }
+    }
+    for (int i = 0; i < state->num_enemies; i++) {
+        if (state->enemies.active[i]) {
+            pin_area(world, state->enemies.x[i], state->enemies.y[i], CHUNK_PIN_RADIUS);
+        }
+    }
+}
+
+// Worker thread: generate requested chunks without holding the game state
+// lock, then install them under it
+static void *chunk_worker(void *arg) {
+    ChunkWorld *world = (ChunkWorld *)arg;
+    static __thread MapTile tiles[CHUNK_TILES];
+
+    for (;;) {
+        pthread_mutex_lock(&queue_mutex);
+        while (queue_count == 0 && !workers_stopping) {
+            pthread_cond_wait(&queue_cond, &queue_mutex);
+        }
+        if (workers_stopping) {
+            pthread_mutex_unlock(&queue_mutex);
+            break;
+        }
+        ChunkRequest request = queue[queue_head];
+        queue_head = (queue_head + 1) % CHUNK_QUEUE_SIZE;
+        queue_count--;
+        pthread_mutex_unlock(&queue_mutex);
+
+        // Copy the generation inputs; spilled chunks are just read back
+        size_t chunk = (size_t)request.chunk_y * world->chunks_x + request.chunk_x;
+        lock_game_state();
+        bool current = request.epoch == world->epoch;
+        bool wanted = current && world->index[chunk] == 0 && !(world->flags[chunk] & CHUNK_SPILLED);
+        if (current && !wanted) {
+            if (world->index[chunk] == 0) {
+                bring_in(world, request.chunk_x, request.chunk_y);
+            }
+            world->flags[chunk] &= ~CHUNK_QUEUED;
+        }
+        unsigned int seed = world->seed;
+        int level = world->level;
+        MapGenParams params = world->params;
+        int num_keys = world->num_keys;
+        int key_x[MAPGEN_MAX_KEYS], key_y[MAPGEN_MAX_KEYS];
+        memcpy(key_x, world->key_x, sizeof(key_x));
+        memcpy(key_y, world->key_y, sizeof(key_y));
+        unlock_game_state();
+        if (!wanted) continue;
+
+        bool ok = mapgen_generate_chunk(seed, level, world->width, world->height, &params,
+                                        key_x, key_y, num_keys, request.chunk_x, request.chunk_y, tiles);
+
+        lock_game_state();
+        if (request.epoch == world->epoch) {
+            if (ok && world->index[chunk] == 0) {
+                int slot = claim_slot(world);
+                memcpy(&world->pool[(size_t)slot * CHUNK_TILES], tiles, sizeof(tiles));
+                register_slot(world, slot, request.chunk_x, request.chunk_y);
+                world->generated++;
+            }
+            world->flags[chunk] &= ~CHUNK_QUEUED;
+        }
+        unlock_game_state();
+    }
+    return NULL;
+}
+
+// Start the background generators of a streamed level. Call after the enemy
+// processes are forked; without workers chunks are generated on first access.
+bool chunk_world_start_workers(ChunkWorld *world) {
+    if (world == NULL) return false;
+
+    workers_stopping = false;
+    for (int i = 0; i < CHUNK_WORKERS; i++) {
+        if (pthread_create(&workers[num_workers], NULL, chunk_worker, world) != 0) {
+            perror("Failed to create chunk worker thread");
+            break;
+        }
+        num_workers++;
+    }
+    return num_workers > 0;
+}
+
+// Stop the background generators and delete the level's spill files
+void chunk_world_stop_workers(ChunkWorld *world) {
+    pthread_mutex_lock(&queue_mutex);
+    workers_stopping = true;
+    pthread_cond_broadcast(&queue_cond);
+    pthread_mutex_unlock(&queue_mutex);
+
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    num_workers = 0;
+    queue_head = 0;
+    queue_count = 0;
+
+    if (world != NULL) {
+        discard_spills(world);
+        if (world->spill_dir[0] != '\0') {
+            rmdir(world->spill_dir);
+            world->spill_dir[0] = '\0';
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../include/enemy_ai.h"
+#include "../include/enemy_kernel.h"
+#include "../include/ai_lod.h"
+
+// Gather buffers for the batched pass, one per target (enemies that know
+// where the player is, and those that wander); only the main process runs it
+static EnemyBatch tracking_batch;
+static EnemyBatch wandering_batch;
+static bool batches_ready = false;
+
+// Player position at the previous pass that had tracking enemies, so the
+// kernel sees the player's step since then (as each process used to)
+static int last_player_x = -1;
+static int last_player_y = -1;
+
+// Clear pending requests and forget the player's last position
+void enemy_ai_init(GameState *state) {
+    if (state == NULL) return;
+
+    memset(state->enemies.wants_decision, 0, sizeof(state->enemies.wants_decision));
+    memset(state->enemies.decided, 0, sizeof(state->enemies.decided));
+    last_player_x = -1;
+    last_player_y = -1;
+}
+
+// Gather the given store lanes grouped by type, run the kernel over them and
+// write the results back
+static void decide_lanes(EnemyBatch *store, EnemyBatch *batch, const int *lanes, int count,
+                         const EnemyTarget *target) {
+    if (count == 0) return;
+
+    int order[MAX_ENEMIES];
+    enemy_batch_gather_by_type(batch, store, lanes, count, order);
+    enemy_kernel_decide(batch, target, false);
+    enemy_batch_scatter(batch, store, order);
+}
+
+// Decide every pending enemy request in one batched pass and charge its CPU
+// time to the current AI budget window. Returns the number of decisions.
+// Must be called with the game state locked (after ai_lod_update).
+int enemy_ai_update(GameState *state) {
+    if (state == NULL) return 0;
+
+    int tracking_lanes[MAX_ENEMIES];
+    int wandering_lanes[MAX_ENEMIES];
+    int num_tracking = 0;
+    int num_wandering = 0;
+    EnemyStore *enemies = &state->enemies;
+    for (int i = 0; i < state->num_enemies; i++) {
+        if (!enemies->wants_decision[i]) continue;
+        enemies->wants_decision[i] = false;
+        if (!enemies->active[i]) continue;
+
+        if (enemies->tracking[i]) {
+            tracking_lanes[num_tracking++] = i;
+        } else {
+            wandering_lanes[num_wandering++] = i;
+        }
+    }
+    if (num_tracking + num_wandering == 0) return 0;
+
+    if (!batches_ready) {
+        if (!enemy_batch_alloc(&tracking_batch, MAX_ENEMIES)) return 0;
+        if (!enemy_batch_alloc(&wandering_batch, MAX_ENEMIES)) {
+            enemy_batch_free(&tracking_batch);
+            return 0;
+        }
+        batches_ready = true;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    EnemyBatch store;
+    enemy_batch_bind(&store, enemies, 0, state->num_enemies);
+
+    const Player *player = &state->players[0];
+    EnemyTarget target;
+    target.visible = player->is_active && num_tracking > 0;
+    target.x = player->x;
+    target.y = player->y;
+    target.has_velocity = target.visible && last_player_x >= 0;
+    target.vx = player->x - last_player_x;
+    target.vy = player->y - last_player_y;
+    if (target.visible) {
+        last_player_x = player->x;
+        last_player_y = player->y;
+        decide_lanes(&store, &tracking_batch, tracking_lanes, num_tracking, &target);
+    } else {
+        // Nobody to track: everything wanders
+        memcpy(&wandering_lanes[num_wandering], tracking_lanes, sizeof(int) * num_tracking);
+        num_wandering += num_tracking;
+        num_tracking = 0;
+    }
+
+    EnemyTarget wander;
+    memset(&wander, 0, sizeof(wander));
+    wander.visible = false;
+    decide_lanes(&store, &wandering_batch, wandering_lanes, num_wandering, &wander);
+
+    for (int k = 0; k < num_tracking; k++) {
+        enemies->decided[tracking_lanes[k]] = true;
+    }
+    for (int k = 0; k < num_wandering; k++) {
+        enemies->decided[wandering_lanes[k]] = true;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long elapsed_us = (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_nsec - start.tv_nsec) / 1000L;
+    ai_lod_charge(state, state->ai_lod.window, elapsed_us);
+    return num_tracking + num_wandering;
+}
@@ -0,0 +1,464 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/enemy_kernel.h"
+
+// Vector types for the batched path: four 32-bit lanes, which GCC maps onto
+// SSE2 on x86-64 and NEON on ARM, so the kernel needs no per-ISA intrinsics
+typedef int v4si __attribute__((vector_size(16)));
+typedef unsigned int v4su __attribute__((vector_size(16)));
+typedef short v4hi __attribute__((vector_size(8)));
+typedef unsigned short v4hu __attribute__((vector_size(8)));
+typedef signed char v4qi __attribute__((vector_size(4)));
+
+#define SPLAT(v) ((v4si){(v), (v), (v), (v)})
+
+// Cycles between decisions for each enemy type (the original move_frequency values)
+int enemy_move_frequency(EntityType type) {
+    switch (type) {
+        case ENTITY_ENEMY_CHASE:
+            return 8;
+        case ENTITY_ENEMY_RANDOM:
+            return 10;
+        case ENTITY_ENEMY_GUARD:
+            return 12;
+        case ENTITY_ENEMY_SMART:
+            return 7;
+        default:
+            return 10;
+    }
+}
+
+// Distance (in tiles) at which an enemy notices the player; grows with the level
+int enemy_detection_range(EntityType type, int level) {
+    int base;
+    switch (type) {
+        case ENTITY_ENEMY_RANDOM:
+            base = 10;
+            break;
+        case ENTITY_ENEMY_GUARD:
+            base = 8;
+            break;
+        default:
+            base = 12;  // Chasers always track the player; only used for stats
+            break;
+    }
+    return base + (level - 1) * 2;
+}
+
+// Point a batch at a range of enemies in the shared store
+void enemy_batch_bind(EnemyBatch *batch, EnemyStore *store, int first, int count) {
+    batch->count = count;
+    batch->capacity = count;
+    batch->owns_memory = false;
+    batch->x = &store->x[first];
+    batch->y = &store->y[first];
+    batch->type = &store->type[first];
+    batch->range = &store->range[first];
+    batch->cooldown = &store->cooldown[first];
+    batch->phase = &store->phase[first];
+    batch->rng = &store->rng[first];
+    batch->step_x = &store->step_x[first];
+    batch->step_y = &store->step_y[first];
+}
+
+// Allocate a standalone batch (used by headless benchmarks)
+bool enemy_batch_alloc(EnemyBatch *batch, int capacity) {
+    memset(batch, 0, sizeof(*batch));
+    batch->capacity = capacity;
+    batch->owns_memory = true;
+    batch->x = calloc(capacity, sizeof(short));
+    batch->y = calloc(capacity, sizeof(short));
+    batch->type = calloc(capacity, sizeof(unsigned char));
+    batch->range = calloc(capacity, sizeof(short));
+    batch->cooldown = calloc(capacity, sizeof(short));
+    batch->phase = calloc(capacity, sizeof(unsigned short));
+    batch->rng = calloc(capacity, sizeof(unsigned int));
+    batch->step_x = calloc(capacity, sizeof(signed char));
+    batch->step_y = calloc(capacity, sizeof(signed char));
+
+    if (!batch->x || !batch->y || !batch->type || !batch->range || !batch->cooldown ||
+        !batch->phase || !batch->rng || !batch->step_x || !batch->step_y) {
+        perror("enemy batch allocation failed");
+        enemy_batch_free(batch);
+        return false;
+    }
+    return true;
+}
+
+// Release a standalone batch
+void enemy_batch_free(EnemyBatch *batch) {
+    if (batch == NULL || !batch->owns_memory) return;
+
+    free(batch->x);
+    free(batch->y);
+    free(batch->type);
+    free(batch->range);
+    free(batch->cooldown);
+    free(batch->phase);
+    free(batch->rng);
+    free(batch->step_x);
+    free(batch->step_y);
+    memset(batch, 0, sizeof(*batch));
+}
+
+// Copy the given lanes of src into dst grouped by type (a counting sort, so
+// lanes of one type keep their order), which lets the kernel run long
+// same-type vector runs. order[k] receives the src lane copied to dst lane k.
+// dst must be a standalone batch with room for count lanes.
+void enemy_batch_gather_by_type(EnemyBatch *dst, const EnemyBatch *src, const int *lanes, int count, int *order) {
+    int counts[256] = {0};
+    for (int k = 0; k < count; k++) {
+        counts[src->type[lanes[k]]]++;
+    }
+
+    int start[256];
+    int sum = 0;
+    for (int t = 0; t < 256; t++) {
+        start[t] = sum;
+        sum += counts[t];
+    }
+
+    for (int k = 0; k < count; k++) {
+        int lane = lanes[k];
+        int i = start[src->type[lane]]++;
+        order[i] = lane;
+        dst->x[i] = src->x[lane];
+        dst->y[i] = src->y[lane];
+        dst->type[i] = src->type[lane];
+        dst->range[i] = src->range[lane];
+        dst->cooldown[i] = src->cooldown[lane];
+        dst->phase[i] = src->phase[lane];
+        dst->rng[i] = src->rng[lane];
+        dst->step_x[i] = src->step_x[lane];
+        dst->step_y[i] = src->step_y[lane];
+    }
+    dst->count = count;
+}
+
+// Write back what the kernel changes (random state, phase, cooldown and the
+// decided step) from a gathered batch to the lanes it was gathered from
+void enemy_batch_scatter(const EnemyBatch *src, EnemyBatch *dst, const int *order) {
+    for (int i = 0; i < src->count; i++) {
+        int lane = order[i];
+        dst->cooldown[lane] = src->cooldown[i];
+        dst->phase[lane] = src->phase[i];
+        dst->rng[lane] = src->rng[i];
+        dst->step_x[lane] = src->step_x[i];
+        dst->step_y[lane] = src->step_y[i];
+    }
+}
+
+// Reorder a standalone batch so that enemies of the same type are contiguous.
+// Lanes of the shared store are tied to enemy ids and processes, so bound
+// batches are left alone; those are gathered into a standalone batch instead.
+void enemy_batch_sort_by_type(EnemyBatch *batch) {
+    if (batch == NULL || !batch->owns_memory || batch->count <= 1) return;
+
+    int n = batch->count;
+    int *lanes = malloc(sizeof(int) * n);
+    int *order = malloc(sizeof(int) * n);
+    EnemyBatch sorted;
+    if (lanes == NULL || order == NULL || !enemy_batch_alloc(&sorted, n)) {
+        free(lanes);
+        free(order);
+        return;
+    }
+
+    for (int i = 0; i < n; i++) {
+        lanes[i] = i;
+    }
+    enemy_batch_gather_by_type(&sorted, batch, lanes, n, order);
+
+    enemy_batch_free(batch);
+    *batch = sorted;
+    free(lanes);
+    free(order);
+}
+
+// xorshift32 step used for every per-enemy random choice
+static inline unsigned int xorshift32(unsigned int state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Unit step toward a signed distance (zero distance steps backwards, like the
+// original per-process AI did)
+static inline int step_toward(int d) {
+    return d > 0 ? 1 : -1;
+}
+
+// Random cardinal direction from two random bits
+static inline void random_direction(unsigned int bits, int *sx, int *sy) {
+    switch (bits & 3) {
+        case 0: *sx = 1; break;
+        case 1: *sx = -1; break;
+        case 2: *sy = 1; break;
+        default: *sy = -1; break;
+    }
+}
+
+// Decide one enemy (scalar path, also used for run tails). Returns 1 when the
+// enemy made a decision, 0 when it was still cooling down.
+static int decide_lane(EnemyBatch *batch, int i, const EnemyTarget *target, bool use_cooldown) {
+    unsigned int r = xorshift32(batch->rng[i]);
+    batch->rng[i] = r;
+
+    int type = batch->type[i];
+    if (use_cooldown && batch->cooldown[i] > 0) {
+        batch->cooldown[i]--;
+        batch->step_x[i] = 0;
+        batch->step_y[i] = 0;
+        return 0;
+    }
+
+    int sx = 0, sy = 0;
+    int phase = batch->phase[i];
+
+    if (!target->visible) {
+        random_direction(r >> 1, &sx, &sy);
+    } else {
+        int dx = target->x - batch->x[i];
+        int dy = target->y - batch->y[i];
+        int dist_squared = dx * dx + dy * dy;
+        int range_squared = batch->range[i] * batch->range[i];
+        bool chase_x = abs(dx) > abs(dy);
+
+        switch (type) {
+            case ENTITY_ENEMY_RANDOM:
+                // Chase along a random axis when close, otherwise wander
+                if (dist_squared < range_squared) {
+                    if ((r & 1) == 0) sx = step_toward(dx);
+                    else sy = step_toward(dy);
+                } else {
+                    random_direction(r >> 1, &sx, &sy);
+                }
+                break;
+
+            case ENTITY_ENEMY_GUARD:
+                // Chase when the player enters the guarded area, otherwise patrol
+                if (dist_squared < range_squared) {
+                    if ((phase & 1) == 0) sx = step_toward(dx);
+                    else sy = step_toward(dy);
+                } else {
+                    int patrol = ((phase >> 1) & 1) == 0 ? 1 : -1;
+                    if ((phase & 1) == 0) sx = patrol;
+                    else sy = patrol;
+                }
+                break;
+
+            case ENTITY_ENEMY_SMART:
+                // Intercept a few tiles ahead of the player's direction of travel
+                if (target->has_velocity && abs(target->vx) > abs(target->vy)) {
+                    int dx_intercept = target->x + target->vx * 3 - batch->x[i];
+                    if (dx_intercept != 0) sx = step_toward(dx_intercept);
+                    else sy = step_toward(dy);
+                } else if (target->has_velocity && target->vy != 0) {
+                    int dy_intercept = target->y + target->vy * 3 - batch->y[i];
+                    if (dy_intercept != 0) sy = step_toward(dy_intercept);
+                    else sx = step_toward(dx);
+                } else if (target->has_velocity && r % 3 == 0) {
+                    // Player standing still: sometimes cut diagonally
+                    sx = step_toward(dx);
+                    sy = step_toward(dy);
+                } else if (chase_x) {
+                    sx = step_toward(dx);
+                } else {
+                    sy = step_toward(dy);
+                }
+                break;
+
+            case ENTITY_ENEMY_CHASE:
+            default:
+                // Close the larger distance first
+                if (chase_x) sx = step_toward(dx);
+                else sy = step_toward(dy);
+                break;
+        }
+    }
+
+    batch->step_x[i] = (signed char)sx;
+    batch->step_y[i] = (signed char)sy;
+    batch->phase[i] = (unsigned short)(phase + 1);
+    if (use_cooldown) {
+        batch->cooldown[i] = (short)(enemy_move_frequency((EntityType)type) - 1);
+    }
+    return 1;
+}
+
+static inline v4si select4(v4si mask, v4si a, v4si b) {
+    return (a & mask) | (b & ~mask);
+}
+
+static inline v4si step_toward4(v4si d) {
+    return ((d > SPLAT(0)) & SPLAT(2)) - SPLAT(1);
+}
+
+static inline v4si abs4(v4si d) {
+    return select4(d < SPLAT(0), -d, d);
+}
+
+static inline v4si load_short4(const short *p) {
+    v4hi h;
+    memcpy(&h, p, sizeof(h));
+    return __builtin_convertvector(h, v4si);
+}
+
+static inline v4si load_ushort4(const unsigned short *p) {
+    v4hu h;
+    memcpy(&h, p, sizeof(h));
+    return __builtin_convertvector(h, v4si);
+}
+
+static inline void store_step4(signed char *p, v4si v) {
+    v4qi q = __builtin_convertvector(v, v4qi);
+    memcpy(p, &q, sizeof(q));
+}
+
+// Random cardinal direction from two random bits per lane
+static inline void random_direction4(v4si bits, v4si *sx, v4si *sy) {
+    v4si dir = bits & SPLAT(3);
+    *sx = (SPLAT(1) & (dir == SPLAT(0))) | (SPLAT(-1) & (dir == SPLAT(1)));
+    *sy = (SPLAT(1) & (dir == SPLAT(2))) | (SPLAT(-1) & (dir == SPLAT(3)));
+}
+
+// Decide ENEMY_KERNEL_LANES enemies of the same type starting at lane i.
+// Every lane runs the same instructions; per-lane choices are mask selects.
+// Must produce exactly what decide_lane() produces for each lane.
+static int decide_chunk(EnemyBatch *batch, int i, int type, const EnemyTarget *target, bool use_cooldown) {
+    v4su r;
+    memcpy(&r, &batch->rng[i], sizeof(r));
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    memcpy(&batch->rng[i], &r, sizeof(r));
+    v4si bits = (v4si)r;
+    v4si bits_shifted = (v4si)(r >> 1);
+
+    v4si cooldown = load_short4(&batch->cooldown[i]);
+    v4si ready = use_cooldown ? (cooldown == SPLAT(0)) : SPLAT(-1);
+    v4si phase = load_ushort4(&batch->phase[i]);
+
+    v4si sx = SPLAT(0);
+    v4si sy = SPLAT(0);
+
+    if (!target->visible) {
+        random_direction4(bits_shifted, &sx, &sy);
+    } else {
+        v4si x = load_short4(&batch->x[i]);
+        v4si y = load_short4(&batch->y[i]);
+        v4si range = load_short4(&batch->range[i]);
+        v4si dx = SPLAT(target->x) - x;
+        v4si dy = SPLAT(target->y) - y;
+        v4si detected = (dx * dx + dy * dy) < (range * range);
+        v4si chase_x = abs4(dx) > abs4(dy);
+        v4si toward_x = step_toward4(dx);
+        v4si toward_y = step_toward4(dy);
+
+        switch (type) {
+            case ENTITY_ENEMY_RANDOM: {
+                v4si wander_x, wander_y;
+                random_direction4(bits_shifted, &wander_x, &wander_y);
+                v4si axis_x = (bits & SPLAT(1)) == SPLAT(0);
+                sx = select4(detected, toward_x & axis_x, wander_x);
+                sy = select4(detected, toward_y & ~axis_x, wander_y);
+                break;
+            }
+
+            case ENTITY_ENEMY_GUARD: {
+                v4si even = (phase & SPLAT(1)) == SPLAT(0);
+                v4si patrol = select4(((phase >> 1) & SPLAT(1)) == SPLAT(0), SPLAT(1), SPLAT(-1));
+                sx = even & select4(detected, toward_x, patrol);
+                sy = ~even & select4(detected, toward_y, patrol);
+                break;
+            }
+
+            case ENTITY_ENEMY_SMART:
+                // The player's velocity is shared by all lanes, so the
+                // prediction mode is a uniform branch, not a per-lane one
+                if (target->has_velocity && abs(target->vx) > abs(target->vy)) {
+                    v4si dx_intercept = SPLAT(target->x + target->vx * 3) - x;
+                    v4si at_x = dx_intercept == SPLAT(0);
+                    sx = ~at_x & step_toward4(dx_intercept);
+                    sy = at_x & toward_y;
+                } else if (target->has_velocity && target->vy != 0) {
+                    v4si dy_intercept = SPLAT(target->y + target->vy * 3) - y;
+                    v4si at_y = dy_intercept == SPLAT(0);
+                    sy = ~at_y & step_toward4(dy_intercept);
+                    sx = at_y & toward_x;
+                } else {
+                    v4si diagonal = target->has_velocity ? (v4si)(r % 3u == 0u) : SPLAT(0);
+                    sx = select4(diagonal, toward_x, chase_x & toward_x);
+                    sy = select4(diagonal, toward_y, ~chase_x & toward_y);
+                }
+                break;
+
+            case ENTITY_ENEMY_CHASE:
+            default:
+                sx = chase_x & toward_x;
+                sy = ~chase_x & toward_y;
+                break;
+        }
+    }
+
+    store_step4(&batch->step_x[i], sx & ready);
+    store_step4(&batch->step_y[i], sy & ready);
+
+    v4hu next_phase = __builtin_convertvector(phase - ready, v4hu);
+    memcpy(&batch->phase[i], &next_phase, sizeof(next_phase));
+
+    if (use_cooldown) {
+        v4si reload = SPLAT(enemy_move_frequency((EntityType)type) - 1);
+        v4hi next_cooldown = __builtin_convertvector(select4(ready, reload, cooldown - SPLAT(1)), v4hi);
+        memcpy(&batch->cooldown[i], &next_cooldown, sizeof(next_cooldown));
+    }
+
+    // Each ready lane is -1 in the mask
+    int decided = 0;
+    for (int lane = 0; lane < ENEMY_KERNEL_LANES; lane++) {
+        decided -= ready[lane];
+    }
+    return decided;
+}
+
+// Decide a step for every enemy in the batch. Enemies are processed in runs of
+// the same type: full vector chunks first, then a scalar tail per run, so the
+// batch should be grouped by type (enemy_batch_gather_by_type); on a mixed
+// batch the runs are short and most lanes fall through to the scalar tail. With
+// use_cooldown set, enemies only decide when their cooldown has run out and
+// then reload it from their type's move frequency; otherwise all decide.
+// Returns the number of decisions made.
+int enemy_kernel_decide(EnemyBatch *batch, const EnemyTarget *target, bool use_cooldown) {
+    if (batch == NULL || target == NULL) return 0;
+
+    int decided = 0;
+    int i = 0;
+    while (i < batch->count) {
+        int type = batch->type[i];
+        int run_end = i + 1;
+        while (run_end < batch->count && batch->type[run_end] == type) {
+            run_end++;
+        }
+
+        for (; i + ENEMY_KERNEL_LANES <= run_end; i += ENEMY_KERNEL_LANES) {
+            decided += decide_chunk(batch, i, type, target, use_cooldown);
+        }
+        for (; i < run_end; i++) {
+            decided += decide_lane(batch, i, target, use_cooldown);
+        }
+    }
+    return decided;
+}
+
+// Reference implementation: one enemy at a time, no vector path
+int enemy_kernel_decide_scalar(EnemyBatch *batch, const EnemyTarget *target, bool use_cooldown) {
+    if (batch == NULL || target == NULL) return 0;
+
+    int decided = 0;
+    for (int i = 0; i < batch->count; i++) {
+        decided += decide_lane(batch, i, target, use_cooldown);
+    }
+    return decided;
+}
@@ -0,0 +1,68 @@
+#include <time.h>
+#include "../include/frame_clock.h"
+
+#define NS_PER_SECOND 1000000000ULL
+
+// Nanoseconds on the monotonic clock
+uint64_t frame_clock_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SECOND + (uint64_t)ts.tv_nsec;
+}
+
+// Start the clock. With vsync the present call paces frames and
+// frame_clock_wait does not sleep.
+void frame_clock_init(FrameClock *clock, int frames_per_second, bool vsync) {
+    if (frames_per_second <= 0) frames_per_second = FRAME_CLOCK_DEFAULT_FPS;
+
+    clock->tick_ns = NS_PER_SECOND / SIM_TICKS_PER_SECOND;
+    clock->frame_ns = vsync ? 0 : NS_PER_SECOND / (uint64_t)frames_per_second;
+    clock->previous_ns = frame_clock_now_ns();
+    clock->accumulator_ns = 0;
+    clock->deadline_ns = clock->previous_ns + clock->frame_ns;
+}
+
+// Account for the time since the last frame and return the number of
+// simulation ticks to run now. After a long stall (a breakpoint, a dragged
+// window) at most FRAME_CLOCK_MAX_TICKS run and the rest is dropped, so the
+// simulation does not spiral trying to catch up.
+int frame_clock_begin(FrameClock *clock) {
+    uint64_t now = frame_clock_now_ns();
+    clock->accumulator_ns += now - clock->previous_ns;
+    clock->previous_ns = now;
+
+    int ticks = (int)(clock->accumulator_ns / clock->tick_ns);
+    if (ticks > FRAME_CLOCK_MAX_TICKS) {
+        ticks = FRAME_CLOCK_MAX_TICKS;
+        clock->accumulator_ns = 0;
+    } else {
+        clock->accumulator_ns -= (uint64_t)ticks * clock->tick_ns;
+    }
+    return ticks;
+}
+
+// Fraction of a tick the frame is past the last simulated tick (0..1)
+float frame_clock_alpha(const FrameClock *clock) {
+    return (float)clock->accumulator_ns / (float)clock->tick_ns;
+}
+
+// Sleep until the next frame deadline. A frame that overran its deadline by
+// a whole interval starts a new schedule instead of rushing to catch up.
+void frame_clock_wait(FrameClock *clock) {
+    if (clock->frame_ns == 0) return;
+
+    uint64_t now = frame_clock_now_ns();
+    if (now < clock->deadline_ns) {
+        struct timespec until = {
+            (time_t)(clock->deadline_ns / NS_PER_SECOND),
+            (long)(clock->deadline_ns % NS_PER_SECOND)
+        };
+        // A signal (EINTR) ends the sleep early so the caller can react to it
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+    }
+
+    clock->deadline_ns += clock->frame_ns;
+    if (now > clock->deadline_ns) {
+        clock->deadline_ns = now + clock->frame_ns;
+    }
+}
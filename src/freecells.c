@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/freecells.h"
+#include "../include/shared_memory.h"
+
+// Round a size up to a multiple of SHM_REGION_ALIGN
+static size_t align_region(size_t size) {
+    return (size + SHM_REGION_ALIGN - 1) & ~(size_t)(SHM_REGION_ALIGN - 1);
+}
+
+// Next value of a caller-owned xorshift32 stream (state must be non-zero)
+static inline unsigned int next_random(unsigned int *rng) {
+    unsigned int v = *rng ? *rng : 0x9E3779B9u;
+    v ^= v << 13;
+    v ^= v >> 17;
+    v ^= v << 5;
+    *rng = v;
+    return v;
+}
+
+// Bytes needed for the index of a map
+size_t freecells_size(int width, int height) {
+    int stride = MAP_STRIDE_FOR(width);
+    size_t blocks = (size_t)(stride >> FREECELL_BLOCK_SHIFT) *
+                    ((height + FREECELL_BLOCK_SIZE - 1) >> FREECELL_BLOCK_SHIFT);
+    return align_region(sizeof(FreeCellIndex)) +
+           align_region(sizeof(unsigned short) * blocks) +
+           align_region(blocks * FREECELL_BLOCK_CELLS) +
+           align_region((size_t)stride * height) +
+           sizeof(int) * (blocks + 1);
+}
+
+// Lay out an empty index in freecells_size(width, height) bytes of memory
+FreeCellIndex *freecells_place(void *memory, int width, int height) {
+    if (memory == NULL) return NULL;
+
+    memset(memory, 0, freecells_size(width, height));
+    FreeCellIndex *index = (FreeCellIndex *)memory;
+    index->stride = MAP_STRIDE_FOR(width);
+    index->blocks_x = index->stride >> FREECELL_BLOCK_SHIFT;
+    index->blocks_y = (height + FREECELL_BLOCK_SIZE - 1) >> FREECELL_BLOCK_SHIFT;
+
+    size_t blocks = (size_t)index->blocks_x * index->blocks_y;
+    char *region = (char *)memory + align_region(sizeof(FreeCellIndex));
+    index->count = (unsigned short *)region;
+    region += align_region(sizeof(unsigned short) * blocks);
+    index->cells = (unsigned char *)region;
+    region += align_region(blocks * FREECELL_BLOCK_CELLS);
+    index->slot = (unsigned char *)region;
+    region += align_region((size_t)index->stride * height);
+    index->tree = (int *)region;
+    return index;
+}
+
+// Heap-allocated index (release with free())
+FreeCellIndex *freecells_alloc(int width, int height) {
+    void *memory = malloc(freecells_size(width, height));
+    if (memory == NULL) {
+        perror("free cell index allocation failed");
+        return NULL;
+    }
+    return freecells_place(memory, width, height);
+}
+
+// Whether a tile belongs in the index
+static inline bool tile_is_free(const GameMap *map, int x, int y) {
+    size_t i = (size_t)y * map->stride + x;
+    return map->tiles[i] == TILE_EMPTY &&
+           (map->components == NULL || map->components[i] == MAP_COMPONENT_MAIN);
+}
+
+// Block of a tile and its offset inside the block
+static inline int block_of(const FreeCellIndex *index, int x, int y, int *local) {
+    *local = ((y & (FREECELL_BLOCK_SIZE - 1)) << FREECELL_BLOCK_SHIFT) | (x & (FREECELL_BLOCK_SIZE - 1));
+    return (y >> FREECELL_BLOCK_SHIFT) * index->blocks_x + (x >> FREECELL_BLOCK_SHIFT);
+}
+
+// Whether a tile is currently in the index (sparse set membership test)
+static inline bool indexed(const FreeCellIndex *index, int x, int y) {
+    int local;
+    int block = block_of(index, x, y, &local);
+    int slot = index->slot[(size_t)y * index->stride + x];
+    return slot < index->count[block] && index->cells[(size_t)block * FREECELL_BLOCK_CELLS + slot] == local;
+}
+
+// Add delta to a block count in the Fenwick tree
+static void tree_add(FreeCellIndex *index, int block, int delta) {
+    int blocks = index->blocks_x * index->blocks_y;
+    for (int i = block + 1; i <= blocks; i += i & -i) {
+        index->tree[i] += delta;
+    }
+}
+
+// Block holding the n-th free tile (0-based) and n's rank inside it
+static int tree_find(const FreeCellIndex *index, int n, int *rank) {
+    int blocks = index->blocks_x * index->blocks_y;
+    int step = 1;
+    while (step * 2 <= blocks) step *= 2;
+
+    int position = 0;
+    for (; step > 0; step /= 2) {
+        if (position + step <= blocks && index->tree[position + step] <= n) {
+            position += step;
+            n -= index->tree[position];
+        }
+    }
+    *rank = n;
+    return position;
+}
+
+// Rebuild the index from scratch after the map was generated
+void freecells_rebuild(FreeCellIndex *index, const GameMap *map) {
+    if (index == NULL || map == NULL || map->tiles == NULL) return;
+
+    int blocks = index->blocks_x * index->blocks_y;
+    memset(index->count, 0, sizeof(unsigned short) * blocks);
+    memset(index->tree, 0, sizeof(int) * (blocks + 1));
+    index->total = 0;
+
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            if (!tile_is_free(map, x, y)) continue;
+
+            int local;
+            int block = block_of(index, x, y, &local);
+            int slot = index->count[block]++;
+            index->cells[(size_t)block * FREECELL_BLOCK_CELLS + slot] = (unsigned char)local;
+            index->slot[(size_t)y * index->stride + x] = (unsigned char)slot;
+            index->total++;
+        }
+    }
+
+    // Linear-time Fenwick construction from the block counts
+    for (int i = 1; i <= blocks; i++) {
+        index->tree[i] += index->count[i - 1];
+        int parent = i + (i & -i);
+        if (parent <= blocks) index->tree[parent] += index->tree[i];
+    }
+}
+
+// Bring one tile's membership up to date after its tile or label changed
+void freecells_update(FreeCellIndex *index, const GameMap *map, int x, int y) {
+    if (index == NULL || map == NULL || map->tiles == NULL) return;
+    if (x < 0 || y < 0 || x >= map->width || y >= map->height) return;
+
+    bool free_now = tile_is_free(map, x, y);
+    if (free_now == indexed(index, x, y)) return;
+
+    int local;
+    int block = block_of(index, x, y, &local);
+    unsigned char *list = &index->cells[(size_t)block * FREECELL_BLOCK_CELLS];
+    if (free_now) {
+        int slot = index->count[block]++;
+        list[slot] = (unsigned char)local;
+        index->slot[(size_t)y * index->stride + x] = (unsigned char)slot;
+        index->total++;
+        tree_add(index, block, 1);
+    } else {
+        // Swap-remove: the block's last entry takes this tile's slot
+        int slot = index->slot[(size_t)y * index->stride + x];
+        int last = --index->count[block];
+        int moved = list[last];
+        list[slot] = (unsigned char)moved;
+        int moved_x = ((block % index->blocks_x) << FREECELL_BLOCK_SHIFT) | (moved & (FREECELL_BLOCK_SIZE - 1));
+        int moved_y = ((block / index->blocks_x) << FREECELL_BLOCK_SHIFT) | (moved >> FREECELL_BLOCK_SHIFT);
+        index->slot[(size_t)moved_y * index->stride + moved_x] = (unsigned char)slot;
+        index->total--;
+        tree_add(index, block, -1);
+    }
+}
+
+// A filter that accepts every tile of the map
+void freecells_filter_all(const GameMap *map, FreeCellFilter *filter) {
+    filter->min_x = 0;
+    filter->min_y = 0;
+    filter->max_x = map->width - 1;
+    filter->max_y = map->height - 1;
+    filter->avoid_x = 0;
+    filter->avoid_y = 0;
+    filter->min_distance = 0;
+}
+
+// Whether a tile passes a filter
+static bool accepted(const FreeCellFilter *filter, int x, int y) {
+    if (x < filter->min_x || x > filter->max_x || y < filter->min_y || y > filter->max_y) {
+        return false;
+    }
+    if (filter->min_distance > 0) {
+        int dx = x - filter->avoid_x;
+        int dy = y - filter->avoid_y;
+        return dx * dx + dy * dy >= filter->min_distance * filter->min_distance;
+    }
+    return true;
+}
+
+// Pick a uniformly random free tile that passes the filter (NULL = any).
+// Unrestricted queries cost one Fenwick descent; a rectangle costs one walk
+// over the blocks it overlaps per attempt. Gives up after
+// FREECELL_MAX_ATTEMPTS rejected samples. rng is the caller's random state.
+bool freecells_sample(const FreeCellIndex *index, const GameMap *map, const FreeCellFilter *filter,
+                      unsigned int *rng, int *x, int *y) {
+    if (index == NULL || map == NULL || rng == NULL || x == NULL || y == NULL || index->total == 0) {
+        return false;
+    }
+
+    FreeCellFilter all;
+    if (filter == NULL) {
+        freecells_filter_all(map, &all);
+        filter = &all;
+    }
+
+    // Blocks overlapping the rectangle
+    int bx0 = filter->min_x < 0 ? 0 : filter->min_x >> FREECELL_BLOCK_SHIFT;
+    int by0 = filter->min_y < 0 ? 0 : filter->min_y >> FREECELL_BLOCK_SHIFT;
+    int bx1 = filter->max_x >= map->width ? (map->width - 1) >> FREECELL_BLOCK_SHIFT : filter->max_x >> FREECELL_BLOCK_SHIFT;
+    int by1 = filter->max_y >= map->height ? (map->height - 1) >> FREECELL_BLOCK_SHIFT : filter->max_y >> FREECELL_BLOCK_SHIFT;
+    if (bx1 < bx0 || by1 < by0) return false;
+
+    bool whole_map = bx0 == 0 && by0 == 0 && bx1 == index->blocks_x - 1 && by1 == index->blocks_y - 1;
+    int in_blocks = index->total;
+    if (!whole_map) {
+        in_blocks = 0;
+        for (int by = by0; by <= by1; by++) {
+            for (int bx = bx0; bx <= bx1; bx++) {
+                in_blocks += index->count[by * index->blocks_x + bx];
+            }
+        }
+        if (in_blocks == 0) return false;
+    }
+
+    for (int attempt = 0; attempt < FREECELL_MAX_ATTEMPTS; attempt++) {
+        int n = (int)(next_random(rng) % (unsigned int)in_blocks);
+        int block = -1;
+        int rank = 0;
+        if (whole_map) {
+            block = tree_find(index, n, &rank);
+        } else {
+            for (int by = by0; by <= by1 && block < 0; by++) {
+                for (int bx = bx0; bx <= bx1; bx++) {
+                    int count = index->count[by * index->blocks_x + bx];
+                    if (n < count) {
+                        block = by * index->blocks_x + bx;
+                        rank = n;
+                        break;
+                    }
+                    n -= count;
+                }
+            }
+        }
+
+        int local = index->cells[(size_t)block * FREECELL_BLOCK_CELLS + rank];
+        int cx = ((block % index->blocks_x) << FREECELL_BLOCK_SHIFT) | (local & (FREECELL_BLOCK_SIZE - 1));
+        int cy = ((block / index->blocks_x) << FREECELL_BLOCK_SHIFT) | (local >> FREECELL_BLOCK_SHIFT);
+        if (accepted(filter, cx, cy)) {
+            *x = cx;
+            *y = cy;
+            return true;
+        }
+    }
+    return false;
+}
@@ -10,14 +10,27 @@
 #include <math.h>
 #include "../include/game.h"
 #include "../include/shared_memory.h"
+#include "../include/occupancy.h"
+#include "../include/enemy_kernel.h"
+#include "../include/mapgen.h"
+#include "../include/chunk_world.h"
+#include "../include/level_stage.h"
+#include "../include/level_file.h"
+#include "../include/tile_layer.h"
+#include "../include/ui_cache.h"
+#include "../include/render_batch.h"
+#include "../include/sprite_atlas.h"
+#include "../include/sine_lut.h"
+#include "../include/text.h"
+#include "../include/frame_clock.h"
+#include "../include/profiler.h"
+#include "../include/particles.h"
+#include "../include/quality.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-// Function declaration from main.c
-void draw_simple_text(SDL_Renderer* renderer, int x, int y, const char* text, int size);
-
 // Global variables
 SDL_Texture* tile_textures[5] = {NULL};  // Textures for different tile types
 SDL_Texture* player_textures[MAX_PLAYERS] = {NULL};  // Textures for players
@@ -57,119 +70,138 @@ SDL_Color enemy_colors[4] = {
     {241, 196, 15, 255}   // Smart (Sunflower yellow)
 };
 
-// Animation variables
+// Animation variables. animation_clock advances by whole simulation ticks;
+// animation_time is the clock interpolated to the frame being drawn.
 float animation_time = 0.0f;
-int particle_count = 0;
-#define MAX_PARTICLES 100
+static float animation_clock = 0.0f;
 
-// Particle structure for visual effects
-typedef struct {
-    float x, y;         // Position
-    float vx, vy;       // Velocity
-    float lifetime;     // Remaining life
-    float max_lifetime; // Maximum lifetime
-    SDL_Color color;    // Particle color
-    int size;           // Particle size
-    bool active;        // Is particle active
-} Particle;
+// Particle effects (each process that draws keeps its own)
+static ParticleSystem particles;
+static bool particles_allocated = false;
+#define GAME_OVER_BURST_LIMIT 50   // The game over burst stops adding particles above this many
+
+// Add a particle effect (dropped if the system is full or unavailable)
+static void spawn_particle(float x, float y, SDL_Color color, ParticleKind kind) {
+    particles_spawn(&particles, x, y, color, kind);
+}
 
-Particle particles[MAX_PARTICLES];
+// Base colour of an enemy type
+static SDL_Color enemy_color(EntityType type) {
+    if (type >= ENTITY_ENEMY_CHASE && type <= ENTITY_ENEMY_SMART) {
+        return enemy_colors[type - ENTITY_ENEMY_CHASE];
+    }
+    return enemy_colors[0];
+}
 
-// Initialize a particle effect
-void spawn_particle(float x, float y, SDL_Color color, int type) {
-    if (particle_count >= MAX_PARTICLES) return;
-    
-    int idx = -1;
-    // Find an inactive particle
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        if (!particles[i].active) {
-            idx = i;
-            break;
+// Spawn one tick's worth of effect particles for what is on screen:
+// sparkles over keys, treasures and the open exit, trails behind players
+// and enemies, and the burst of the game over screen. Lower render quality
+// levels make every spawn chance rarer.
+static void spawn_effect_particles(const RenderSnapshot* snapshot) {
+    const QualitySettings* quality = quality_settings();
+    int rarity = quality->particle_divisor;
+    if (rarity == 0) {
+        return;
+    }
+    
+    for (int y = 0; y < snapshot->rows && quality->tile_sparkles; y++) {
+        for (int x = 0; x < snapshot->columns; x++) {
+            int tile = snapshot->tiles[y * snapshot->columns + x];
+            float map_x = snapshot->start_x + x;
+            float map_y = snapshot->start_y + y;
+            if (tile == TILE_EXIT && snapshot->exit_enabled && rand() % (10 * rarity) == 0) {
+                float px = map_x + (rand() % 100) / 100.0f;
+                float py = map_y + (rand() % 100) / 100.0f;
+                SDL_Color spark_color = {200, 255, 200, 255};
+                spawn_particle(px, py, spark_color, PARTICLE_SPARKLE);
+            } else if (tile == TILE_KEY && rand() % (20 * rarity) == 0) {
+                SDL_Color spark_color = {255, 255, 150, 255};
+                spawn_particle(map_x + 0.5f, map_y + 0.5f, spark_color, PARTICLE_SPARKLE);
+            } else if (tile == TILE_TREASURE && rand() % (30 * rarity) == 0) {
+                SDL_Color spark_color = {255, 215, 0, 255};
+                spawn_particle(map_x + 0.5f, map_y + 0.3f, spark_color, PARTICLE_SPARKLE);
+            }
+        }
+    }
+    
+    // Player movement trails
+    for (int v = 0; v < snapshot->num_players; v++) {
+        const RenderEntity* p = &snapshot->players[v];
+        if (rand() % (5 * rarity) == 0) {
+            float px = p->x + (rand() % 80 - 40) / 100.0f;
+            float py = p->y + (rand() % 80 - 40) / 100.0f;
+            SDL_Color trail_color = player_colors[p->index];
+            trail_color.a = 150;  // Semi-transparent
+            spawn_particle(px, py, trail_color, PARTICLE_TRAIL);
         }
     }
     
-    if (idx == -1) return; // No free particles
-    
-    particles[idx].x = x;
-    particles[idx].y = y;
-    particles[idx].color = color;
-    particles[idx].active = true;
-    
-    // Different particle behaviors based on type
-    switch (type) {
-        case 0: // Explosion
-            particles[idx].vx = (rand() % 100 - 50) / 25.0f;
-            particles[idx].vy = (rand() % 100 - 50) / 25.0f;
-            particles[idx].size = 3 + (rand() % 3);
-            particles[idx].max_lifetime = 0.5f + (rand() % 100) / 200.0f;
-            break;
-        case 1: // Trail
-            particles[idx].vx = (rand() % 60 - 30) / 100.0f;
-            particles[idx].vy = (rand() % 60 - 30) / 100.0f - 0.2f; // Upward bias
-            particles[idx].size = 2 + (rand() % 2);
-            particles[idx].max_lifetime = 0.3f + (rand() % 100) / 500.0f;
-            break;
-        case 2: // Sparkle
-            particles[idx].vx = 0;
-            particles[idx].vy = 0;
-            particles[idx].size = 1 + (rand() % 2);
-            particles[idx].max_lifetime = 0.2f + (rand() % 100) / 500.0f;
-            break;
+    // Enemy trails
+    for (int v = 0; v < snapshot->num_enemies; v++) {
+        const RenderEntity* e = &snapshot->enemies[v];
+        if (rand() % (15 * rarity) == 0) {
+            spawn_particle(e->x, e->y, enemy_color((EntityType)e->type), PARTICLE_TRAIL);
+        }
     }
     
-    particles[idx].lifetime = particles[idx].max_lifetime;
-    particle_count++;
+    // Generate lots of particles for game over
+    if (snapshot->game_over && particles.count < GAME_OVER_BURST_LIMIT) {
+        for (int i = 0; i < 5 / rarity; i++) {
+            float px = rand() % WINDOW_WIDTH / TILE_SIZE + snapshot->start_x;
+            float py = rand() % WINDOW_HEIGHT / TILE_SIZE + snapshot->start_y;
+            
+            SDL_Color particle_color;
+            if (snapshot->winner_id >= 0) {
+                // Victory particles
+                particle_color.r = 100 + (rand() % 155);
+                particle_color.g = 200 + (rand() % 55);
+                particle_color.b = 100 + (rand() % 155);
+            } else {
+                // Defeat particles
+                particle_color.r = 200 + (rand() % 55);
+                particle_color.g = 50 + (rand() % 100);
+                particle_color.b = 50 + (rand() % 100);
+            }
+            particle_color.a = 255;
+            
+            spawn_particle(px, py, particle_color, PARTICLE_EXPLOSION);
+        }
+    }
 }
 
-// Update all particles
-void update_particles(float dt) {
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        if (!particles[i].active) continue;
-        
-        particles[i].lifetime -= dt;
-        if (particles[i].lifetime <= 0) {
-            particles[i].active = false;
-            particle_count--;
-            continue;
-        }
-        
-        particles[i].x += particles[i].vx;
-        particles[i].y += particles[i].vy;
-        
-        // Add slight gravity effect
-        particles[i].vy += 0.02f;
+// Advance animations and particles by one simulation tick of dt seconds,
+// spawning the effects for the snapshot about to be drawn
+void advance_animation(const RenderSnapshot* snapshot, float dt) {
+    if (!particles_allocated) {
+        particles_allocated = true;
+        particles_init(&particles, PARTICLE_CAPACITY);  // On failure no particles are shown
     }
+    
+    animation_clock += dt;
+    particles_update(&particles, dt);
+    spawn_effect_particles(snapshot);
 }
 
-// Render all active particles
-void render_particles(SDL_Renderer* renderer, int start_x, int start_y) {
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        if (!particles[i].active) continue;
+// Queue the particles on screen on the render batch, alpha of the way from
+// their previous tick's position to the current one
+static void render_particles(int start_x, int start_y, float alpha) {
+    for (int i = 0; i < particles.count; i++) {
+        // Convert the interpolated world position to screen position
+        float x = particles.prev_x[i] + (particles.x[i] - particles.prev_x[i]) * alpha;
+        float y = particles.prev_y[i] + (particles.y[i] - particles.prev_y[i]) * alpha;
+        int screen_x = (x - start_x) * TILE_SIZE;
+        int screen_y = (y - start_y) * TILE_SIZE;
+        int size = particles.size[i];
+        if (screen_x + size <= 0 || screen_x >= WINDOW_WIDTH || screen_y + size <= 0 || screen_y >= WINDOW_HEIGHT) {
+            continue;
+        }
         
         // Alpha fades out as particle ages
-        float alpha_factor = particles[i].lifetime / particles[i].max_lifetime;
-        
-        SDL_SetRenderDrawColor(
-            renderer,
-            particles[i].color.r,
-            particles[i].color.g,
-            particles[i].color.b,
-            (Uint8)(255 * alpha_factor)
-        );
-        
-        // Convert particle world position to screen position
-        int screen_x = (particles[i].x - start_x) * TILE_SIZE;
-        int screen_y = (particles[i].y - start_y) * TILE_SIZE;
-        
-        // Draw the particle as a small rectangle
-        SDL_Rect particle_rect = {
-            (int)screen_x,
-            (int)screen_y,
-            particles[i].size,
-            particles[i].size
-        };
+        SDL_Color color = particles.color[i];
+        color.a = (Uint8)(255 * (particles.life[i] / particles.max_life[i]));
         
-        SDL_RenderFillRect(renderer, &particle_rect);
+        // Queue the particle as a small rectangle
+        render_batch_rect(screen_x, screen_y, size, size, color);
     }
 }
 
@@ -197,11 +229,24 @@ void* background_event_thread(void* data) {
             
             // 3% chance to add a new treasure
             if (rand() % 100 < 3) {
-                int x = rand() % (game_state->map.width - 2) + 1;
-                int y = rand() % (game_state->map.height - 2) + 1;
-                
-                if (game_state->map.tiles[y][x] == TILE_EMPTY) {
-                    game_state->map.tiles[y][x] = TILE_TREASURE;
+                GameMap *map = &game_state->map;
+                unsigned int pick = (unsigned int)rand() | 1;
+                int x, y;
+
+                if (map->free_cells != NULL) {
+                    // Any reachable empty tile, drawn straight from the index
+                    if (freecells_sample(map->free_cells, map, NULL, &pick, &x, &y)) {
+                        map_set_tile(map, x, y, TILE_TREASURE);
+                    }
+                } else {
+                    // Streamed levels: one try among the resident chunks.
+                    // Their generator walls in sealed pockets, so any empty
+                    // tile is reachable.
+                    x = rand() % (map->width - 2) + 1;
+                    y = rand() % (map->height - 2) + 1;
+                    if (map_peek_tile(map, x, y) == TILE_EMPTY) {
+                        map_set_tile(map, x, y, TILE_TREASURE);
+                    }
                 }
             }
             
@@ -280,495 +325,343 @@ void game_cleanup(void) {
     }
     
     // Free any other game resources if needed
+    particles_free(&particles);
     printf("Game cleanup completed\n");
 }
 
-// Render the game state
-void render_game(SDL_Renderer* renderer, GameState* state, int player_id) {
-    if (!state || !renderer) {
-        return;
-    }
-    
+// Compute the map area shown on screen, centered on a player
+void get_viewport(GameState* state, int player_id, int* start_x, int* start_y, int* width, int* height) {
     Player* player = &state->players[player_id];
     
-    // Center view on player
-    int center_x = player->x;
-    int center_y = player->y;
-    
     // Visible area
     int visible_width = WINDOW_WIDTH / TILE_SIZE;
     int visible_height = (WINDOW_HEIGHT - 40) / TILE_SIZE; // Account for UI space
     
-    int start_x = center_x - visible_width / 2;
-    int start_y = center_y - visible_height / 2;
+    int x = player->x - visible_width / 2;
+    int y = player->y - visible_height / 2;
     
     // Ensure start coordinates are within bounds
-    if (start_x < 0) start_x = 0;
-    if (start_y < 0) start_y = 0;
-    if (start_x + visible_width >= state->map.width) start_x = state->map.width - visible_width;
-    if (start_y + visible_height >= state->map.height) start_y = state->map.height - visible_height;
-    
-    // Update animation time based on current game time
-    float current_time = (float)(state->current_time - state->start_time);
-    animation_time = current_time;
-    
-    // Update particles
-    update_particles(1.0f / 60.0f); // Assuming 60 FPS
-    
-    // Draw a dark background gradient
-    for (int y = 0; y < WINDOW_HEIGHT; y++) {
-        // Subtle gradient effect
-        int gradient = 20 + (y * 10 / WINDOW_HEIGHT);
-        SDL_SetRenderDrawColor(renderer, gradient/2, gradient/2, gradient, 255);
-        SDL_RenderDrawLine(renderer, 0, y, WINDOW_WIDTH, y);
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x + visible_width >= state->map.width) x = state->map.width - visible_width;
+    if (y + visible_height >= state->map.height) y = state->map.height - visible_height;
+    
+    *start_x = x;
+    *start_y = y;
+    *width = visible_width;
+    *height = visible_height;
+}
+
+// Copy what a frame centered on a player shows out of the shared state.
+// Called with the game state lock held; it only copies, so the lock is
+// released before any drawing.
+void capture_render_snapshot(GameState* state, int player_id, RenderSnapshot* snapshot) {
+    int start_x, start_y, columns, rows;
+    get_viewport(state, player_id, &start_x, &start_y, &columns, &rows);
+    snapshot->start_x = start_x;
+    snapshot->start_y = start_y;
+    snapshot->columns = columns;
+    snapshot->rows = rows;
+    
+    // Visible tile window; rows of an in-memory map are copied whole
+    for (int y = 0; y < rows; y++) {
+        MapTile* row = &snapshot->tiles[y * columns];
+        int map_y = start_y + y;
+        if (map_y < 0 || map_y >= state->map.height) {
+            memset(row, SNAPSHOT_TILE_OUTSIDE, (size_t)columns);
+            continue;
+        }
+        int first = start_x < 0 ? -start_x : 0;
+        int last = state->map.width - start_x < columns ? state->map.width - start_x : columns;
+        if (last < first) last = first;
+        memset(row, SNAPSHOT_TILE_OUTSIDE, (size_t)first);
+        memset(row + last, SNAPSHOT_TILE_OUTSIDE, (size_t)(columns - last));
+        if (state->map.chunks == NULL) {
+            memcpy(row + first, &MAP_TILE(&state->map, start_x + first, map_y), (size_t)(last - first));
+        } else {
+            // Peek only: the view lies within CHUNK_STREAM_RADIUS of the
+            // player, so its chunks are already queued, and bringing one in
+            // here would stall the frame with the lock held. A chunk still
+            // in flight shows as wall for a frame or two.
+            for (int x = first; x < last; x++) {
+                row[x] = map_peek_tile(&state->map, start_x + x, map_y);
+            }
+        }
     }
     
-    // Render map tiles with modern effects
-    for (int y = 0; y < visible_height; y++) {
-        for (int x = 0; x < visible_width; x++) {
-            int map_x = start_x + x;
-            int map_y = start_y + y;
-            
-            if (map_x >= 0 && map_x < state->map.width && map_y >= 0 && map_y < state->map.height) {
-                TileType tile = state->map.tiles[map_y][map_x];
-                
-                // Create a tile position for special effects
-                int tile_x = x * TILE_SIZE;
-                int tile_y = y * TILE_SIZE;
-                
-                // If it's an exit and not enabled, render it differently
-                if (tile == TILE_EXIT && !state->exit_enabled) {
-                    // Render as inactive exit (darker green with pulsing effect)
-                    float pulse = (sinf(animation_time * 2.0f) * 0.3f + 0.7f);
-                    SDL_SetRenderDrawColor(renderer, 
-                                          (Uint8)(30 * pulse), 
-                                          (Uint8)(100 * pulse), 
-                                          (Uint8)(50 * pulse), 
-                                          255);
-                } else if (tile == TILE_EXIT && state->exit_enabled) {
-                    // Active exit gets a pulsing effect
-                    float pulse = (sinf(animation_time * 4.0f) * 0.3f + 0.7f);
-                    SDL_SetRenderDrawColor(renderer, 
-                                          (Uint8)(46 * pulse), 
-                                          (Uint8)(204 * pulse), 
-                                          (Uint8)(113 * pulse), 
-                                          255);
-                    
-                    // Add sparkle particles occasionally to the exit
-                    if (rand() % 10 == 0) {
-                        float px = map_x + (rand() % 100) / 100.0f;
-                        float py = map_y + (rand() % 100) / 100.0f;
-                        SDL_Color spark_color = {200, 255, 200, 255};
-                        spawn_particle(px, py, spark_color, 2);
-                    }
-                } else {
-                    // Set color based on tile type
-                    SDL_SetRenderDrawColor(
-                        renderer,
-                        tile_colors[tile].r,
-                        tile_colors[tile].g,
-                        tile_colors[tile].b,
-                        tile_colors[tile].a
-                    );
-                }
-                
-                // Draw tile with modern appearance
-                SDL_Rect tile_rect = {
-                    tile_x,
-                    tile_y,
-                    TILE_SIZE,
-                    TILE_SIZE
-                };
-                
-                SDL_RenderFillRect(renderer, &tile_rect);
-                
-                // Add detail to the tile based on type
-                if (tile == TILE_WALL) {
-                    // Draw subtle grid lines for walls to create a brick effect
-                    SDL_SetRenderDrawColor(renderer, 40, 42, 54, 255);
-                    
-                    // Horizontal lines
-                    if (map_y % 2 == 0) {
-                        SDL_RenderDrawLine(renderer, 
-                                          tile_x, tile_y + TILE_SIZE/2, 
-                                          tile_x + TILE_SIZE, tile_y + TILE_SIZE/2);
-                    } else {
-                        SDL_RenderDrawLine(renderer, 
-                                          tile_x + TILE_SIZE/2, tile_y, 
-                                          tile_x + TILE_SIZE/2, tile_y + TILE_SIZE);
-                    }
-                } 
-                else if (tile == TILE_KEY) {
-                    // Draw key with glowing effect
-                    float glow = (sinf(animation_time * 3.0f) * 0.3f + 0.7f);
-                    SDL_SetRenderDrawColor(renderer, 
-                                          (Uint8)(255 * glow), 
-                                          (Uint8)(255 * glow), 
-                                          (Uint8)(100 + 155 * glow), 
-                                          255);
-                    
-                    int cx = tile_x + TILE_SIZE / 2;
-                    int cy = tile_y + TILE_SIZE / 2;
-                    int radius = TILE_SIZE / 3;
-                    
-                    // Draw key head (circle with more points for smoothness)
-                    for (int i = 0; i < 16; i++) {
-                        float angle = i * M_PI / 8;
-                        SDL_RenderDrawLine(renderer, 
-                            cx, cy,
-                            cx + radius * cosf(angle),
-                            cy + radius * sinf(angle));
-                    }
-                    
-                    // Draw key stem
-                    SDL_RenderDrawLine(renderer, cx, cy + radius/2, cx, cy + radius * 1.5);
-                    SDL_RenderDrawLine(renderer, cx-2, cy + radius * 1.5, cx+2, cy + radius * 1.5);
-                    
-                    // Occasionally add sparkle particles
-                    if (rand() % 20 == 0) {
-                        float px = map_x + 0.5f;
-                        float py = map_y + 0.5f;
-                        SDL_Color spark_color = {255, 255, 150, 255};
-                        spawn_particle(px, py, spark_color, 2);
-                    }
-                }
-                else if (tile == TILE_DOOR) {
-                    // Draw door frame with a more detailed appearance
-                    float glow = (sinf(animation_time * 2.0f + map_x * 0.1f + map_y * 0.1f) * 0.2f + 0.8f);
-                    SDL_SetRenderDrawColor(renderer, 
-                                          (Uint8)(150 * glow), 
-                                          (Uint8)(80 * glow), 
-                                          (Uint8)(40 * glow), 
-                                          255);
-                    
-                    // Draw door outline
-                    SDL_Rect door_frame = {
-                        tile_x + 2,
-                        tile_y + 2,
-                        TILE_SIZE - 4,
-                        TILE_SIZE - 4
-                    };
-                    SDL_RenderDrawRect(renderer, &door_frame);
-                    
-                    // Draw door handle
-                    SDL_Rect door_handle = {
-                        tile_x + TILE_SIZE * 3/4 - 2,
-                        tile_y + TILE_SIZE/2 - 2,
-                        4,
-                        4
-                    };
-                    SDL_RenderFillRect(renderer, &door_handle);
-                    
-                    // Draw door panels
-                    SDL_RenderDrawLine(renderer, 
-                                      tile_x + TILE_SIZE/2, tile_y + 4,
-                                      tile_x + TILE_SIZE/2, tile_y + TILE_SIZE - 4);
+    // Entities in view (they may overlap the UI bar, so the query covers
+    // every row that is at least partially on screen). The occupancy grid
+    // returns them sorted by id, players first.
+    int visible_entities[MAX_ENTITIES];
+    int num_visible = occupancy_query_rect(state, start_x, start_y,
+                                           WINDOW_WIDTH / TILE_SIZE,
+                                           (WINDOW_HEIGHT + TILE_SIZE - 1) / TILE_SIZE,
+                                           OCCUPANCY_ALL, visible_entities, MAX_ENTITIES);
+    snapshot->num_players = 0;
+    snapshot->num_enemies = 0;
+    for (int v = 0; v < num_visible; v++) {
+        int id = visible_entities[v];
+        RenderEntity* e;
+        if (id < MAX_PLAYERS) {
+            Player* p = &state->players[id];
+            if (!p->is_active) continue;
+            e = &snapshot->players[snapshot->num_players++];
+            e->index = (unsigned char)id;
+            e->type = (unsigned char)p->type;
+            e->x = (short)p->x;
+            e->y = (short)p->y;
+        } else {
+            int i = id - MAX_PLAYERS;
+            if (!state->enemies.active[i]) continue;
+            e = &snapshot->enemies[snapshot->num_enemies++];
+            e->index = (unsigned char)i;
+            e->type = state->enemies.type[i];
+            e->x = state->enemies.x[i];
+            e->y = state->enemies.y[i];
+        }
+    }
+    
+    // HUD values
+    snapshot->score = state->players[0].score;
+    snapshot->keys = state->players[0].keys;
+    snapshot->health = state->players[0].health;
+    snapshot->keys_required = state->keys_required;
+    snapshot->elapsed = state->current_time - state->start_time;
+    snapshot->exit_enabled = state->exit_enabled;
+    snapshot->game_over = state->game_over;
+    snapshot->winner_id = state->winner_id;
+}
+
+// Glow of an animated tile pulsing at speed; held at its mean when the
+// render quality turns tile glow off
+static float tile_glow(float speed) {
+    if (!quality_settings()->tile_glow) {
+        return 0.7f;
+    }
+    return lut_sinf(animation_time * speed) * 0.3f + 0.7f;
+}
+
+// Queue the animated part of a key, treasure or exit tile over the tile layer
+static void render_animated_tile(const RenderSnapshot* snapshot, const AnimatedTile* a) {
+    int tile_x = a->screen_x;
+    int tile_y = a->screen_y;
+    
+    if (a->tile == TILE_EXIT) {
+        SDL_Color color;
+        if (!snapshot->exit_enabled) {
+            // Render as inactive exit (darker green with pulsing effect)
+            float pulse = tile_glow(2.0f);
+            color = (SDL_Color){(Uint8)(30 * pulse), (Uint8)(100 * pulse), (Uint8)(50 * pulse), 255};
+        } else {
+            // Active exit gets a pulsing effect
+            float pulse = tile_glow(4.0f);
+            color = (SDL_Color){(Uint8)(46 * pulse), (Uint8)(204 * pulse), (Uint8)(113 * pulse), 255};
+        }
+        render_batch_rect(tile_x, tile_y, TILE_SIZE, TILE_SIZE, color);
+    }
+    else if (a->tile == TILE_KEY) {
+        // Draw key with glowing effect
+        float glow = tile_glow(3.0f);
+        SDL_Color color = {(Uint8)(255 * glow), (Uint8)(255 * glow), (Uint8)(100 + 155 * glow), 255};
+        sprite_atlas_draw(SPRITE_KEY, tile_x, tile_y, color);
+    }
+    else if (a->tile == TILE_TREASURE) {
+        // Draw treasure chest with a pulsing golden glow
+        float glow = tile_glow(2.5f);
+        Uint8 level = (Uint8)(255 * glow);
+        SDL_Color shade = {level, level, level, 255};
+        sprite_atlas_draw(SPRITE_TREASURE, tile_x, tile_y, shade);
+    }
+}
+
+// Render a frame from a snapshot of the game state (no lock needed), alpha
+// of a tick past the last simulation tick
+void render_game(SDL_Renderer* renderer, const RenderSnapshot* snapshot, float alpha) {
+    if (!snapshot || !renderer) {
+        return;
+    }
+    
+    // Visible area centered on the player
+    int start_x = snapshot->start_x;
+    int start_y = snapshot->start_y;
+    int visible_width = snapshot->columns;
+    int visible_height = snapshot->rows;
+    
+    // Animations run on the tick clock, interpolated to this frame
+    animation_time = animation_clock + alpha * SIM_TICK_SECONDS;
+    
+    // Draw a dark background gradient (left cleared at lower quality levels)
+    const QualitySettings* quality = quality_settings();
+    uint64_t phase_start = profile_begin();
+    if (quality->gradient_background) {
+        ui_draw_background(renderer);
+    }
+    
+    // Static tiles come from the cached tile layer; keys, treasures and the
+    // exit are drawn over it every frame
+    AnimatedTile animated[TILE_LAYER_MAX_ANIMATED];
+    int num_animated = tile_layer_render(renderer, snapshot, animated, TILE_LAYER_MAX_ANIMATED);
+    if (num_animated < 0) {
+        // No render targets: draw the visible tiles directly
+        num_animated = 0;
+        for (int y = 0; y < visible_height; y++) {
+            for (int x = 0; x < visible_width; x++) {
+                int tile = snapshot->tiles[y * visible_width + x];
+                if (tile == SNAPSHOT_TILE_OUTSIDE) {
+                    continue;
                 }
-                else if (tile == TILE_TREASURE) {
-                    // Draw treasure chest with a pulsing golden glow
-                    float glow = (sinf(animation_time * 2.5f) * 0.3f + 0.7f);
-                    
-                    // Chest base
-                    SDL_SetRenderDrawColor(renderer, 
-                                          (Uint8)(150 * glow), 
-                                          (Uint8)(100 * glow), 
-                                          (Uint8)(50 * glow), 
-                                          255);
-                    
-                    SDL_Rect chest_base = {
-                        tile_x + 2,
-                        tile_y + TILE_SIZE/2,
-                        TILE_SIZE - 4,
-                        TILE_SIZE/2 - 2
-                    };
-                    SDL_RenderFillRect(renderer, &chest_base);
-                    
-                    // Chest top
-                    SDL_SetRenderDrawColor(renderer, 
-                                          (Uint8)(200 * glow), 
-                                          (Uint8)(150 * glow), 
-                                          (Uint8)(50 * glow), 
-                                          255);
-                    
-                    SDL_Rect chest_top = {
-                        tile_x + 2,
-                        tile_y + 2,
-                        TILE_SIZE - 4,
-                        TILE_SIZE/2 - 2
-                    };
-                    SDL_RenderFillRect(renderer, &chest_top);
-                    
-                    // Lock
-                    SDL_SetRenderDrawColor(renderer, 
-                                          (Uint8)(220 * glow), 
-                                          (Uint8)(180 * glow), 
-                                          (Uint8)(40 * glow), 
-                                          255);
-                    
-                    SDL_Rect lock = {
-                        tile_x + TILE_SIZE/2 - 2,
-                        tile_y + TILE_SIZE/2 - 2,
-                        4,
-                        4
-                    };
-                    SDL_RenderFillRect(renderer, &lock);
-                    
-                    // Add occasional sparkle
-                    if (rand() % 30 == 0) {
-                        float px = map_x + 0.5f;
-                        float py = map_y + 0.3f;
-                        SDL_Color spark_color = {255, 215, 0, 255};
-                        spawn_particle(px, py, spark_color, 2);
-                    }
+                int map_y = start_y + y;
+                tile_layer_draw_tile((TileType)tile, map_y, x * TILE_SIZE, y * TILE_SIZE);
+                if (tile_layer_is_animated((TileType)tile) && num_animated < TILE_LAYER_MAX_ANIMATED) {
+                    AnimatedTile* a = &animated[num_animated++];
+                    a->map_x = start_x + x;
+                    a->map_y = map_y;
+                    a->screen_x = x * TILE_SIZE;
+                    a->screen_y = y * TILE_SIZE;
+                    a->tile = (TileType)tile;
                 }
             }
         }
     }
+    for (int i = 0; i < num_animated; i++) {
+        render_animated_tile(snapshot, &animated[i]);
+    }
+    render_batch_flush(renderer);
+    sprite_atlas_flush(renderer);
+    profile_end(PROFILE_TILES, phase_start);
     
     // Render particles behind players and enemies
-    render_particles(renderer, start_x, start_y);
+    phase_start = profile_begin();
+    render_particles(start_x, start_y, alpha);
+    render_batch_flush(renderer);
+    profile_end(PROFILE_PARTICLES, phase_start);
     
     // Render players with modern effects
-    for (int i = 0; i < state->num_players; i++) {
-        Player* p = &state->players[i];
+    phase_start = profile_begin();
+    for (int v = 0; v < snapshot->num_players; v++) {
+        const RenderEntity* p = &snapshot->players[v];
+        int i = p->index;
+        int screen_x = (p->x - start_x) * TILE_SIZE;
+        int screen_y = (p->y - start_y) * TILE_SIZE;
         
-        if (p->is_active) {
-            int screen_x = (p->x - start_x) * TILE_SIZE;
-            int screen_y = (p->y - start_y) * TILE_SIZE;
-            
-            // Check if player is in visible area
-            if (screen_x >= 0 && screen_x < WINDOW_WIDTH && screen_y >= 0 && screen_y < WINDOW_HEIGHT) {
-                // Pulsing effect for player
-                float pulse = (sinf(animation_time * 3.0f) * 0.15f + 0.85f);
-                
-                // Set color based on player ID with pulsing
-                SDL_SetRenderDrawColor(
-                    renderer,
-                    (Uint8)(player_colors[i].r * pulse),
-                    (Uint8)(player_colors[i].g * pulse),
-                    (Uint8)(player_colors[i].b * pulse),
-                    player_colors[i].a
-                );
-                
-                // Draw player base (circle)
-                int cx = screen_x + TILE_SIZE / 2;
-                int cy = screen_y + TILE_SIZE / 2;
-                int radius = TILE_SIZE / 3;
-                
-                // Draw filled circle by rendering lines from center
-                for (int angle = 0; angle < 360; angle += 10) {
-                    float rad_angle = angle * M_PI / 180.0f;
-                    SDL_RenderDrawLine(renderer, 
-                        cx, cy,
-                        cx + radius * cosf(rad_angle),
-                        cy + radius * sinf(rad_angle));
-                }
-                
-                // Draw player inner circle (highlight)
-                SDL_SetRenderDrawColor(
-                    renderer,
-                    (Uint8)fmin(255, player_colors[i].r * 1.3f),
-                    (Uint8)fmin(255, player_colors[i].g * 1.3f),
-                    (Uint8)fmin(255, player_colors[i].b * 1.3f),
-                    player_colors[i].a
-                );
-                
-                radius = TILE_SIZE / 6;
-                for (int angle = 0; angle < 360; angle += 15) {
-                    float rad_angle = angle * M_PI / 180.0f;
-                    SDL_RenderDrawLine(renderer, 
-                        cx, cy,
-                        cx + radius * cosf(rad_angle),
-                        cy + radius * sinf(rad_angle));
-                }
-                
-                // Draw player movement trail (particles)
-                if (rand() % 5 == 0) {
-                    float px = p->x + (rand() % 80 - 40) / 100.0f;
-                    float py = p->y + (rand() % 80 - 40) / 100.0f;
-                    SDL_Color trail_color = player_colors[i];
-                    trail_color.a = 150;  // Semi-transparent
-                    spawn_particle(px, py, trail_color, 1);
-                }
-            }
-        }
+        // Pulsing effect for player
+        float pulse = (lut_sinf(animation_time * 3.0f) * 0.15f + 0.85f);
+        
+        // Set color based on player ID with pulsing
+        SDL_Color base = {
+            (Uint8)(player_colors[i].r * pulse),
+            (Uint8)(player_colors[i].g * pulse),
+            (Uint8)(player_colors[i].b * pulse),
+            player_colors[i].a
+        };
+        
+        // Draw player base (circle)
+        sprite_atlas_draw(SPRITE_PLAYER_BODY, screen_x, screen_y, base);
+        
+        // Draw player inner circle (highlight)
+        SDL_Color highlight = {
+            (Uint8)fmin(255, player_colors[i].r * 1.3f),
+            (Uint8)fmin(255, player_colors[i].g * 1.3f),
+            (Uint8)fmin(255, player_colors[i].b * 1.3f),
+            player_colors[i].a
+        };
+        sprite_atlas_draw(SPRITE_PLAYER_CORE, screen_x, screen_y, highlight);
     }
     
     // Render enemies with modern effects
-    for (int i = 0; i < state->num_enemies; i++) {
-        Player* enemy = &state->enemies[i];
+    for (int v = 0; v < snapshot->num_enemies; v++) {
+        const RenderEntity* e = &snapshot->enemies[v];
+        int i = e->index;
+        EntityType enemy_type = (EntityType)e->type;
+        int screen_x = (e->x - start_x) * TILE_SIZE;
+        int screen_y = (e->y - start_y) * TILE_SIZE;
         
-        if (enemy->is_active) {
-            int screen_x = (enemy->x - start_x) * TILE_SIZE;
-            int screen_y = (enemy->y - start_y) * TILE_SIZE;
-            
-            // Check if enemy is in visible area
-            if (screen_x >= 0 && screen_x < WINDOW_WIDTH && screen_y >= 0 && screen_y < WINDOW_HEIGHT) {
-                // Set color based on enemy type with a pulsing effect
-                SDL_Color color = enemy_colors[0]; // Default color
-                float pulse_speed = 2.0f;
-                
-                switch(enemy->type) {
-                    case ENTITY_ENEMY_CHASE:
-                        color = enemy_colors[0]; // Purple for chaser
-                        pulse_speed = 4.0f;      // Faster pulse for chasers
-                        break;
-                    case ENTITY_ENEMY_RANDOM:
-                        color = enemy_colors[1]; // Orange for random
-                        pulse_speed = 1.5f;
-                        break;
-                    case ENTITY_ENEMY_GUARD:
-                        color = enemy_colors[2]; // Cyan for guard
-                        pulse_speed = 1.0f;
-                        break;
-                    case ENTITY_ENEMY_SMART:
-                        color = enemy_colors[3]; // Yellow for smart
-                        pulse_speed = 3.0f;
-                        break;
-                    default:
-                        break;
-                }
-                
-                // Calculate pulsing effect
-                float pulse = (sinf(animation_time * pulse_speed) * 0.2f + 0.8f);
-                
-                SDL_SetRenderDrawColor(
-                    renderer,
-                    (Uint8)(color.r * pulse),
-                    (Uint8)(color.g * pulse),
-                    (Uint8)(color.b * pulse),
-                    color.a
-                );
-                
-                // Draw enemy base triangle with floating animation
-                float hover_offset = sinf(animation_time * 2.0f + i * 0.5f) * 2.0f;
-                
-                SDL_Point triangle[3] = {
-                    {screen_x + TILE_SIZE / 2, (int)(screen_y + TILE_SIZE / 4 + hover_offset)},           // Top
-                    {screen_x + TILE_SIZE / 4, (int)(screen_y + TILE_SIZE * 3 / 4 + hover_offset)},       // Bottom left
-                    {screen_x + TILE_SIZE * 3 / 4, (int)(screen_y + TILE_SIZE * 3 / 4 + hover_offset)}    // Bottom right
-                };
-                
-                // Fill the triangle
-                for (int y = triangle[0].y; y <= triangle[1].y; y++) {
-                    // Calculate x range for each scan line
-                    float progress = (float)(y - triangle[0].y) / (triangle[1].y - triangle[0].y);
-                    int x_start = triangle[0].x - progress * (triangle[0].x - triangle[1].x);
-                    int x_end = triangle[0].x + progress * (triangle[2].x - triangle[0].x);
-                    SDL_RenderDrawLine(renderer, x_start, y, x_end, y);
-                }
-                
-                // Draw triangle outline
-                SDL_RenderDrawLine(renderer, triangle[0].x, triangle[0].y, triangle[1].x, triangle[1].y);
-                SDL_RenderDrawLine(renderer, triangle[1].x, triangle[1].y, triangle[2].x, triangle[2].y);
-                SDL_RenderDrawLine(renderer, triangle[2].x, triangle[2].y, triangle[0].x, triangle[0].y);
-                
-                // Draw eye (based on enemy type)
-                SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // White eyes
-                
-                // Different eye patterns for different enemy types
-                switch(enemy->type) {
-                    case ENTITY_ENEMY_CHASE:
-                        // One big central eye
-                        {
-                            SDL_Rect enemy_eye = {
-                    screen_x + TILE_SIZE * 3 / 8,
-                                (int)(screen_y + TILE_SIZE * 3 / 8 + hover_offset),
-                    TILE_SIZE / 4,
-                    TILE_SIZE / 4
-                };
-                            SDL_RenderFillRect(renderer, &enemy_eye);
-                        }
-                        break;
-                    case ENTITY_ENEMY_RANDOM:
-                        // Two small eyes
-                        {
-                            SDL_Rect eye_left = {
-                                screen_x + TILE_SIZE * 5 / 16,
-                                (int)(screen_y + TILE_SIZE * 3 / 8 + hover_offset),
-                                TILE_SIZE / 8,
-                                TILE_SIZE / 8
-                            };
-                            SDL_Rect eye_right = {
-                                screen_x + TILE_SIZE * 9 / 16,
-                                (int)(screen_y + TILE_SIZE * 3 / 8 + hover_offset),
-                                TILE_SIZE / 8,
-                                TILE_SIZE / 8
-                            };
-                            SDL_RenderFillRect(renderer, &eye_left);
-                            SDL_RenderFillRect(renderer, &eye_right);
-                        }
-                        break;
-                    case ENTITY_ENEMY_GUARD:
-                        // Horizontal bar eyes
-                        {
-                            SDL_Rect enemy_bar_eye = {
-                                screen_x + TILE_SIZE * 3 / 8,
-                                (int)(screen_y + TILE_SIZE * 3 / 8 + hover_offset),
-                                TILE_SIZE / 4,
-                                TILE_SIZE / 8
-                            };
-                            SDL_RenderFillRect(renderer, &enemy_bar_eye);
-                        }
-                        break;
-                    case ENTITY_ENEMY_SMART:
-                        // Smart enemy has a red pupil in the eye
-                        {
-                            SDL_Rect smart_eye = {
-                                screen_x + TILE_SIZE * 3 / 8,
-                                (int)(screen_y + TILE_SIZE * 3 / 8 + hover_offset),
-                                TILE_SIZE / 4,
-                                TILE_SIZE / 4
-                            };
-                            SDL_RenderFillRect(renderer, &smart_eye);
-                            
-                            SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255); // Red pupil
-                            SDL_Rect pupil = {
-                                screen_x + TILE_SIZE / 2 - TILE_SIZE / 16,
-                                (int)(screen_y + TILE_SIZE / 2 - TILE_SIZE / 16 + hover_offset),
-                                TILE_SIZE / 8,
-                                TILE_SIZE / 8
-                            };
-                            SDL_RenderFillRect(renderer, &pupil);
-                        }
-                        break;
-                    default:
-                        // Default eye
-                        {
-                            SDL_Rect default_eye = {
-                                screen_x + TILE_SIZE * 3 / 8,
-                                (int)(screen_y + TILE_SIZE * 3 / 8 + hover_offset),
-                                TILE_SIZE / 4,
-                                TILE_SIZE / 4
-                            };
-                            SDL_RenderFillRect(renderer, &default_eye);
-                        }
-                        break;
-                }
-                
-                // Add occasional enemy trail particles
-                if (rand() % 15 == 0) {
-                    float px = enemy->x;
-                    float py = enemy->y;
-                    spawn_particle(px, py, color, 1);
-                }
-            }
+        // Set color based on enemy type with a pulsing effect
+        SDL_Color color = enemy_colors[0]; // Default color
+        float pulse_speed = 2.0f;
+        
+        switch(enemy_type) {
+            case ENTITY_ENEMY_CHASE:
+                color = enemy_colors[0]; // Purple for chaser
+                pulse_speed = 4.0f;      // Faster pulse for chasers
+                break;
+            case ENTITY_ENEMY_RANDOM:
+                color = enemy_colors[1]; // Orange for random
+                pulse_speed = 1.5f;
+                break;
+            case ENTITY_ENEMY_GUARD:
+                color = enemy_colors[2]; // Cyan for guard
+                pulse_speed = 1.0f;
+                break;
+            case ENTITY_ENEMY_SMART:
+                color = enemy_colors[3]; // Yellow for smart
+                pulse_speed = 3.0f;
+                break;
+            default:
+                break;
+        }
+        
+        // Calculate pulsing effect (steady at lower quality levels)
+        float pulse = 0.8f;
+        if (quality->enemy_animation) {
+            pulse = lut_sinf(animation_time * pulse_speed) * 0.2f + 0.8f;
+        }
+        
+        SDL_Color body = {
+            (Uint8)(color.r * pulse),
+            (Uint8)(color.g * pulse),
+            (Uint8)(color.b * pulse),
+            color.a
+        };
+        
+        // Draw enemy base triangle with floating animation
+        int sprite_y = screen_y;
+        if (quality->enemy_animation) {
+            float hover_offset = lut_sinf(animation_time * 2.0f + i * 0.5f) * 2.0f;
+            sprite_y += (int)hover_offset;
+        }
+        sprite_atlas_draw(SPRITE_ENEMY_BODY, screen_x, sprite_y, body);
+        if (!quality->enemy_eyes) {
+            continue;
+        }
+        
+        // Draw eye (different eye patterns for different enemy types)
+        SDL_Color white = {255, 255, 255, 255};
+        SpriteId eyes = SPRITE_EYES_CHASE;
+        switch(enemy_type) {
+            case ENTITY_ENEMY_RANDOM:
+                eyes = SPRITE_EYES_RANDOM;   // Two small eyes
+                break;
+            case ENTITY_ENEMY_GUARD:
+                eyes = SPRITE_EYES_GUARD;    // Horizontal bar eyes
+                break;
+            case ENTITY_ENEMY_SMART:
+                eyes = SPRITE_EYES_SMART;    // Eye with a red pupil
+                break;
+            default:
+                break;                       // One big central eye
         }
+        sprite_atlas_draw(eyes, screen_x, sprite_y, white);
     }
     
+    // Draw the players and enemies queued above
+    sprite_atlas_flush(renderer);
+    profile_end(PROFILE_ENTITIES, phase_start);
+    
     // Render game UI (timer, score, health, keys)
-    render_game_ui(renderer, state);
+    phase_start = profile_begin();
+    render_game_ui(renderer, snapshot);
     
     // Render game over message if applicable
-    if (state->game_over) {
+    if (snapshot->game_over) {
         char game_over_msg[64];
-        sprintf(game_over_msg, "Game Over! Winner: Player %d", state->winner_id + 1);
+        sprintf(game_over_msg, "Game Over! Winner: Player %d", snapshot->winner_id + 1);
         
         // Create a pulsing overlay
-        float pulse = (sinf(animation_time * 2.0f) * 0.1f + 0.9f);
+        float pulse = (lut_sinf(animation_time * 2.0f) * 0.1f + 0.9f);
         
         // Draw game over background with pulse effect
-        if (state->winner_id >= 0) {
+        if (snapshot->winner_id >= 0) {
             // Victory
             SDL_SetRenderDrawColor(renderer, (Uint8)(0 * pulse), (Uint8)(100 * pulse), (Uint8)(0 * pulse), 200);
         } else {
@@ -788,31 +681,8 @@ void render_game(SDL_Renderer* renderer, GameState* state, int player_id) {
         SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
         SDL_Rect border = {msg_rect.x - 2, msg_rect.y - 2, msg_rect.w + 4, msg_rect.h + 4};
         SDL_RenderDrawRect(renderer, &border);
-        
-        // Generate lots of particles for game over
-        if (particle_count < MAX_PARTICLES / 2) {
-            for (int i = 0; i < 5; i++) {
-                float px = rand() % WINDOW_WIDTH / TILE_SIZE + start_x;
-                float py = rand() % WINDOW_HEIGHT / TILE_SIZE + start_y;
-                
-                SDL_Color particle_color;
-                if (state->winner_id >= 0) {
-                    // Victory particles
-                    particle_color.r = 100 + (rand() % 155);
-                    particle_color.g = 200 + (rand() % 55);
-                    particle_color.b = 100 + (rand() % 155);
-                } else {
-                    // Defeat particles
-                    particle_color.r = 200 + (rand() % 55);
-                    particle_color.g = 50 + (rand() % 100);
-                    particle_color.b = 50 + (rand() % 100);
-                }
-                particle_color.a = 255;
-                
-                spawn_particle(px, py, particle_color, 0);
-            }
-        }
     }
+    profile_end(PROFILE_UI, phase_start);
 }
 
 // Check if a move is valid
@@ -827,17 +697,13 @@ bool is_valid_move(GameState* state, int player_id, int dx, int dy) {
     }
     
     // Check for walls
-    if (state->map.tiles[new_y][new_x] == TILE_WALL) {
+    if (map_get_tile(&state->map, new_x, new_y) == TILE_WALL) {
         return false;
     }
     
     // Check for enemy collision
-    for (int i = 0; i < state->num_enemies; i++) {
-        if (state->enemies[i].is_active && 
-            state->enemies[i].x == new_x && 
-            state->enemies[i].y == new_y) {
-            return false;
-        }
+    if (occupancy_has_enemy(state, new_x, new_y)) {
+        return false;
     }
     
     return true;
@@ -854,13 +720,13 @@ void update_player(GameState* state, int player_id, int dx, int dy) {
         int new_y = player->y + dy;
         
         // Handle tile interactions
-        TileType tile = state->map.tiles[new_y][new_x];
+        TileType tile = map_get_tile(&state->map, new_x, new_y);
         
         switch (tile) {
             case TILE_TREASURE:
                 // Collect treasure
                 player->score += 10;
-                state->map.tiles[new_y][new_x] = TILE_EMPTY;
+                map_set_tile(&state->map, new_x, new_y, TILE_EMPTY);
                 break;
                 
             case TILE_KEY:
@@ -868,7 +734,7 @@ void update_player(GameState* state, int player_id, int dx, int dy) {
                 player->keys++;
                 state->keys_collected++;
                 printf("Key collected! (%d/%d)\n", state->keys_collected, state->keys_required);
-                state->map.tiles[new_y][new_x] = TILE_EMPTY;
+                map_set_tile(&state->map, new_x, new_y, TILE_EMPTY);
                 
                 // Check if all keys collected
                 if (state->keys_collected >= state->keys_required) {
@@ -895,7 +761,7 @@ void update_player(GameState* state, int player_id, int dx, int dy) {
                         break;
                 }
                 
-                state->map.tiles[new_y][new_x] = TILE_EMPTY;
+                map_set_tile(&state->map, new_x, new_y, TILE_EMPTY);
                 break;
                 
             case TILE_EXIT:
@@ -921,6 +787,7 @@ void update_player(GameState* state, int player_id, int dx, int dy) {
                         // Reset player position to starting point
                         player->x = 2;
                         player->y = 2;
+                        occupancy_move(state, ENTITY_ID_PLAYER(player_id), player->x, player->y);
                         
                         // Don't allow immediate move
                         unlock_game_state();
@@ -949,6 +816,7 @@ void update_player(GameState* state, int player_id, int dx, int dy) {
         // Update position
         player->x = new_x;
         player->y = new_y;
+        occupancy_move(state, ENTITY_ID_PLAYER(player_id), new_x, new_y);
     }
     
     unlock_game_state();
@@ -979,6 +847,7 @@ void process_player_input(SDL_Event* event, GameState* state, int player_id) {
                 // Mark player as inactive and set game exit status
                 lock_game_state();
                 state->players[player_id].is_active = false;
+                occupancy_remove(state, ENTITY_ID_PLAYER(player_id));
                 state->game_over = true;
                 state->winner_id = -2;  // Special code to indicate game exited (not victory or defeat)
                 unlock_game_state();
@@ -1005,17 +874,9 @@ void update_game_time(GameState* state) {
 }
 
 // Render the UI elements
-void render_game_ui(SDL_Renderer* renderer, GameState* state) {
+void render_game_ui(SDL_Renderer* renderer, const RenderSnapshot* snapshot) {
     // Draw modern UI background with gradient
-    for (int y = WINDOW_HEIGHT - 40; y < WINDOW_HEIGHT; y++) {
-        float fade = (float)(y - (WINDOW_HEIGHT - 40)) / 40.0f;
-        SDL_SetRenderDrawColor(renderer, 
-                              (Uint8)(20 + fade * 20), 
-                              (Uint8)(20 + fade * 20), 
-                              (Uint8)(30 + fade * 20), 
-                              (Uint8)(200 + fade * 55));
-        SDL_RenderDrawLine(renderer, 0, y, WINDOW_WIDTH, y);
-    }
+    ui_draw_hud_background(renderer);
     
     // Draw UI frame
     SDL_SetRenderDrawColor(renderer, 60, 60, 80, 255);
@@ -1033,7 +894,7 @@ void render_game_ui(SDL_Renderer* renderer, GameState* state) {
     SDL_RenderDrawLine(renderer, WINDOW_WIDTH*2/3, WINDOW_HEIGHT - 36, WINDOW_WIDTH*2/3, WINDOW_HEIGHT - 4);
     
     // Render score with gradient
-    int score_width = state->players[0].score;
+    int score_width = snapshot->score;
     if (score_width > 0) {
         // Cap score display width
         if (score_width > WINDOW_WIDTH/3 - 20) {
@@ -1055,19 +916,7 @@ void render_game_ui(SDL_Renderer* renderer, GameState* state) {
         SDL_RenderFillRect(renderer, &score_bg);
         
         // Draw score gradient bar
-        for (int x = 0; x < score_width; x++) {
-            float progress = (float)x / (WINDOW_WIDTH/3 - 25);
-            SDL_SetRenderDrawColor(renderer, 
-                                  (Uint8)(255 * (1.0f - progress)), 
-                                  (Uint8)(215 * progress + 180 * (1.0f - progress)), 
-                                  (Uint8)(0 * progress + 40 * (1.0f - progress)), 
-                                  255);
-            SDL_RenderDrawLine(renderer, 
-                              15 + x, 
-                              WINDOW_HEIGHT - 20, 
-                              15 + x, 
-                              WINDOW_HEIGHT - 7);
-        }
+        ui_draw_score_bar(renderer, 15, WINDOW_HEIGHT - 20, score_width);
     }
     
     // Render keys collected with animations
@@ -1076,7 +925,7 @@ void render_game_ui(SDL_Renderer* renderer, GameState* state) {
     draw_simple_text(renderer, WINDOW_WIDTH/3 + 15, WINDOW_HEIGHT - 34, "KEYS", 8);
     
     // Determine number of key slots based on level
-    int num_slots = state->keys_required; 
+    int num_slots = snapshot->keys_required; 
     
     // Adjust spacing if we have more than 5 slots
     int key_spacing = 25; // Default spacing
@@ -1101,11 +950,11 @@ void render_game_ui(SDL_Renderer* renderer, GameState* state) {
     }
     
     // Draw collected keys with animations
-    for (int i = 0; i < state->players[0].keys; i++) {
+    for (int i = 0; i < snapshot->keys; i++) {
         // Don't draw more keys than slots available
         if (i >= num_slots) break;
         
-        float pulse = (sinf(animation_time * 3.0f + i * 0.5f) * 0.2f + 0.8f);
+        float pulse = (lut_sinf(animation_time * 3.0f + i * 0.5f) * 0.2f + 0.8f);
         SDL_SetRenderDrawColor(renderer, 
                               (Uint8)(52 * pulse), 
                               (Uint8)(152 * pulse), 
@@ -1146,24 +995,8 @@ void render_game_ui(SDL_Renderer* renderer, GameState* state) {
     };
     SDL_RenderFillRect(renderer, &health_bg);
     
-    // Calculate width based on health
-    int health_width = (WINDOW_WIDTH/3 - 30) * state->players[0].health / 100;
-    
     // Draw health gradient from red to green based on amount
-    float health_percent = state->players[0].health / 100.0f;
-    for (int x = 0; x < health_width; x++) {
-        float progress = (float)x / (WINDOW_WIDTH/3 - 30);
-        SDL_SetRenderDrawColor(renderer, 
-                              (Uint8)(255 * (1.0f - progress * health_percent)), 
-                              (Uint8)(80 * (1.0f - health_percent) + 220 * health_percent * progress), 
-                              (Uint8)(80 * (1.0f - health_percent)), 
-                              255);
-        SDL_RenderDrawLine(renderer, 
-                          WINDOW_WIDTH*2/3 + 15 + x, 
-                          WINDOW_HEIGHT - 20, 
-                          WINDOW_WIDTH*2/3 + 15 + x, 
-                          WINDOW_HEIGHT - 7);
-    }
+    ui_draw_health_bar(renderer, WINDOW_WIDTH*2/3 + 15, WINDOW_HEIGHT - 20, snapshot->health);
     
     // Add health bar segments for more modern look
     for (int i = 1; i < 10; i++) {
@@ -1173,8 +1006,8 @@ void render_game_ui(SDL_Renderer* renderer, GameState* state) {
     }
     
     // Low health warning (pulsing) when below 30%
-    if (state->players[0].health < 30) {
-        float warning_pulse = (sinf(animation_time * 5.0f) * 0.5f + 0.5f);
+    if (snapshot->health < 30) {
+        float warning_pulse = (lut_sinf(animation_time * 5.0f) * 0.5f + 0.5f);
         SDL_SetRenderDrawColor(renderer, 
                               255, 
                               (Uint8)(50 * warning_pulse), 
@@ -1190,20 +1023,12 @@ void render_game_ui(SDL_Renderer* renderer, GameState* state) {
     }
     
     // Render time elapsed as a stylish digital clock at top of screen
-    time_t elapsed = state->current_time - state->start_time;
+    time_t elapsed = snapshot->elapsed;
     int minutes = elapsed / 60;
     int seconds = elapsed % 60;
     
     // Draw timer background with gradient
-    for (int y = 0; y < 25; y++) {
-        float fade = (float)y / 25.0f;
-        SDL_SetRenderDrawColor(renderer, 
-                              (Uint8)(20 + fade * 20), 
-                              (Uint8)(20 + fade * 20), 
-                              (Uint8)(30 + fade * 20), 
-                              (Uint8)(200 - fade * 100));
-        SDL_RenderDrawLine(renderer, WINDOW_WIDTH/2 - 60, y, WINDOW_WIDTH/2 + 60, y);
-    }
+    ui_draw_timer_background(renderer);
     
     // Draw timer border
     SDL_SetRenderDrawColor(renderer, 100, 100, 120, 150);
@@ -1216,7 +1041,7 @@ void render_game_ui(SDL_Renderer* renderer, GameState* state) {
     SDL_RenderDrawRect(renderer, &timer_border);
     
     // Draw digital clock style time using 7-segment display style digits
-    float glow = (sinf(animation_time * 1.0f) * 0.2f + 0.8f);
+    float glow = (lut_sinf(animation_time * 1.0f) * 0.2f + 0.8f);
     SDL_SetRenderDrawColor(renderer, 
                           (Uint8)(180 * glow), 
                           (Uint8)(220 * glow), 
@@ -1288,14 +1113,63 @@ void render_digit(SDL_Renderer* renderer, int x, int y, int digit) {
     }
 }
 
-// Generate a level with difficulty based on level number
+// Keys needed to open the exit of a level
+static int level_keys_required(int level) {
+    return level == 1 ? 5 : 7;  // Level 1: 5 keys, level 2: 7 keys
+}
+
+// Best-of-N level generation (see set_level_candidates)
+static int level_candidates = 1;
+static int level_budget_ms = 0;
+
+// Generate each level as the best of several candidates, built in parallel
+// and scored by mapgen_score; no new candidate is started after budget_ms
+// (0 = no limit). Takes effect from the next level generated.
+void set_level_candidates(int candidates, int budget_ms) {
+    level_candidates = candidates < 1 ? 1 : candidates > MAPGEN_MAX_CANDIDATES ? MAPGEN_MAX_CANDIDATES : candidates;
+    level_budget_ms = budget_ms < 0 ? 0 : budget_ms;
+}
+
+// Generation parameters of a level
+static void level_params(int level, MapGenParams *params) {
+    mapgen_default_params(level, params);
+    params->keys = level_keys_required(level);
+    params->candidates = level_candidates;
+    params->budget_ms = level_candidates > 1 ? level_budget_ms : 0;
+}
+
+// Everything about starting a level besides its map: queue the level after
+// it for pre-generation and scale the enemies to it
+static void begin_level(GameState *state, int level) {
+    state->keys_collected = 0;
+    state->exit_enabled = false;
+    state->level_complete = false;
+    
+    // Start laying out the level after this one while this one is played
+    if (level < MAX_LEVEL) {
+        MapGenParams next;
+        level_params(level + 1, &next);
+        level_stage_request(state, level + 1, &next);
+    }
+    
+    // Increase enemy speed, aggression and detection range based on level
+    for (int i = 0; i < state->num_enemies; i++) {
+        state->enemies.speed[i] = (short)((1.5f + (level * 0.2f)) * 100);
+        state->enemies.aggression[i] = (short)((0.8f + (level * 0.1f)) * 100);
+        state->enemies.range[i] = (short)enemy_detection_range((EntityType)state->enemies.type[i], level);
+    }
+}
+
+// Generate a level with difficulty based on level number. The map comes from
+// the background stage when it has been pre-generated (see level_stage.h), or
+// from the level cache when this level was generated before (see level_file.h).
 void generate_level(GameState *state, int level) {
     if (state == NULL) {
         printf("Error: NULL state passed to generate_level\n");
         return;
     }
     
-    printf("Generating level %d...\n", level);
+    printf("Generating level %d (seed %u)...\n", level, state->seed);
     
     // Validate level number
     if (level < 1 || level > MAX_LEVEL) {
@@ -1303,214 +1177,97 @@ void generate_level(GameState *state, int level) {
         return;
     }
     
-    // Reset the map
-    memset(state->map.tiles, 0, sizeof(state->map.tiles));
-    state->map.width = MAP_WIDTH;
-    state->map.height = MAP_HEIGHT;
-    
-    // Initialize map with walls around the edges
-    for (int y = 0; y < MAP_HEIGHT; y++) {
-        for (int x = 0; x < MAP_WIDTH; x++) {
-            if (x == 0 || y == 0 || x == MAP_WIDTH-1 || y == MAP_HEIGHT-1) {
-                state->map.tiles[y][x] = TILE_WALL;
-            } else {
-                state->map.tiles[y][x] = TILE_EMPTY;
-            }
-        }
-    }
-    
-    // Create a more complex maze using a cellular automaton approach
-    // First, randomly place walls - denser for higher levels
-    int wall_chance = 30 + (level - 1) * 5; // 30% for level 1, 35% for level 2, etc.
-    wall_chance = wall_chance > 50 ? 50 : wall_chance; // Cap at 50%
-    
-    for (int y = 1; y < MAP_HEIGHT-1; y++) {
-        for (int x = 1; x < MAP_WIDTH-1; x++) {
-            // Keep starting area clear (top-left corner)
-            if (x < 5 && y < 5) continue;
-            
-            // Place walls based on level difficulty
-            if (rand() % 100 < wall_chance) {
-                state->map.tiles[y][x] = TILE_WALL;
-            }
-        }
-    }
-    
-    // Smooth the maze using a cellular automaton approach
-    for (int iteration = 0; iteration < 3; iteration++) {
-        // Create a temporary copy of the map
-        TileType temp_map[MAP_HEIGHT][MAP_WIDTH];
-        memcpy(temp_map, state->map.tiles, sizeof(temp_map));
-        
-        for (int y = 1; y < MAP_HEIGHT-1; y++) {
-            for (int x = 1; x < MAP_WIDTH-1; x++) {
-                // Count walls in 3x3 neighborhood
-                int wall_count = 0;
-                for (int dy = -1; dy <= 1; dy++) {
-                    for (int dx = -1; dx <= 1; dx++) {
-                        if (state->map.tiles[y+dy][x+dx] == TILE_WALL) {
-                            wall_count++;
-                        }
-                    }
-                }
-                
-                // Apply cellular automaton rules
-                if (wall_count >= 5) {
-                    temp_map[y][x] = TILE_WALL;
-                } else if (wall_count <= 2) {
-                    temp_map[y][x] = TILE_EMPTY;
-                }
-                // Otherwise, keep the current state
-            }
-        }
-        
-        // Update the map with the smoothed version
-        memcpy(state->map.tiles, temp_map, sizeof(temp_map));
+    // Set keys required based on level
+    state->keys_required = level_keys_required(level);
+    
+    // Lay out the map; the same seed and level always give the same map
+    MapGenParams params;
+    level_params(level, &params);
+    
+    if (state->map.chunks != NULL) {
+        // Streamed levels are generated chunk by chunk as the player explores
+        chunk_world_reset(state->map.chunks, state->seed, level, &params);
+    } else if (level_stage_take(state, level, &params)) {
+        // Pre-generated in the background; swapped in without generating
+    } else if (!level_cache_generate(state->seed, level, &params, &state->map)) {
+        printf("Error: Failed to generate level %d\n", level);
+        return;
     }
     
-    // Ensure the player's starting position is clear
-    for (int y = 1; y < 8; y++) {
-        for (int x = 1; x < 8; x++) {
-            state->map.tiles[y][x] = TILE_EMPTY;
-        }
-    }
+    // Generated levels place their enemies at random
+    state->num_spawns = 0;
+    begin_level(state, level);
     
-    // Also create clear paths outward from the starting area in four directions
-    // Path to the right
-    for (int x = 8; x < 15; x++) {
-        state->map.tiles[4][x] = TILE_EMPTY;
-        state->map.tiles[5][x] = TILE_EMPTY;
+    printf("Level %d generated: %d keys required\n", level, state->keys_required);
+}
+
+// Start the game from a level file instead of generating the first level.
+// The file's size must match the map; its seed becomes the world seed, so
+// the levels after it are generated as usual. Returns false if the file
+// cannot be used.
+bool load_level(GameState *state, const char *path) {
+    if (state == NULL || path == NULL) {
+        printf("Error: NULL argument passed to load_level\n");
+        return false;
     }
-    
-    // Path downward
-    for (int y = 8; y < 15; y++) {
-        state->map.tiles[y][4] = TILE_EMPTY;
-        state->map.tiles[y][5] = TILE_EMPTY;
+    if (state->map.chunks != NULL) {
+        printf("Error: level files cannot be used with streamed levels\n");
+        return false;
     }
     
-    // Place a door at the end of each starting path
-    state->map.tiles[4][14] = TILE_DOOR;
-    state->map.tiles[14][4] = TILE_DOOR;
-    
-    // Add doors to create sections - reduced to just 2 doors
-    for (int i = 0; i < 2; i++) {
-        int x = 15 + rand() % (MAP_WIDTH - 25);
-        int y = 15 + rand() % (MAP_HEIGHT - 25);
-        state->map.tiles[y][x] = TILE_DOOR;
+    LevelFile file;
+    if (!level_file_open(path, &file)) {
+        return false;
     }
-    
-    // Add treasures - minimal quantity
-    int num_treasures = MAP_WIDTH * MAP_HEIGHT / 400 + (level - 1); // Reduced from /200 to /400, and from *2 to *1
-    for (int i = 0; i < num_treasures; i++) {
-        int x = rand() % (MAP_WIDTH - 2) + 1;
-        int y = rand() % (MAP_HEIGHT - 2) + 1;
-        if (state->map.tiles[y][x] == TILE_EMPTY) {
-            state->map.tiles[y][x] = TILE_TREASURE;
-        }
+    if (!level_file_copy_map(&file, &state->map)) {
+        level_file_close(&file);
+        return false;
     }
     
-    // Add exit in the far corner
-    state->map.tiles[MAP_HEIGHT-2][MAP_WIDTH-2] = TILE_EMPTY; // Clear any walls near exit
-    state->map.tiles[MAP_HEIGHT-3][MAP_WIDTH-2] = TILE_EMPTY;
-    state->map.tiles[MAP_HEIGHT-2][MAP_WIDTH-3] = TILE_EMPTY;
-    state->map.tiles[MAP_HEIGHT-3][MAP_WIDTH-3] = TILE_EMPTY;
-    state->map.tiles[MAP_HEIGHT-2][MAP_WIDTH-2] = TILE_EXIT;
-    
-    // Create a path from exit toward the center of the map
-    int path_x = MAP_WIDTH - 2;
-    int path_y = MAP_HEIGHT - 2;
-    int target_x = MAP_WIDTH / 2;
-    int target_y = MAP_HEIGHT / 2;
-    
-    // Clear a path from exit toward center (using simple pathfinding)
-    while (path_x > target_x || path_y > target_y) {
-        // Move toward center, one step at a time
-        if (path_x > target_x) {
-            path_x--;
-            state->map.tiles[path_y][path_x] = TILE_EMPTY;
-        }
-        if (path_y > target_y) {
-            path_y--;
-            state->map.tiles[path_y][path_x] = TILE_EMPTY;
-        }
-        
-        // Also clear adjacent tiles to make the path wider and more visible
-        if (path_x + 1 < MAP_WIDTH) 
-            state->map.tiles[path_y][path_x + 1] = TILE_EMPTY;
-        if (path_y + 1 < MAP_HEIGHT) 
-            state->map.tiles[path_y + 1][path_x] = TILE_EMPTY;
+    const LevelFileHeader *header = file.header;
+    state->seed = header->seed;
+    state->current_level = header->level;
+    // A level cannot ask for more keys than it holds
+    state->keys_required = header->keys_required;
+    if (state->keys_required < 0) state->keys_required = 0;
+    if (state->keys_required > file.num_keys) state->keys_required = file.num_keys;
+    state->num_spawns = (int)header->num_spawns;
+    for (int i = 0; i < state->num_spawns; i++) {
+        state->spawn_x[i] = file.spawns[i].x;
+        state->spawn_y[i] = file.spawns[i].y;
+        state->spawn_type[i] = file.spawns[i].type;
     }
+    level_file_close(&file);
     
-    // Reset level complete flag
-    state->level_complete = false;
+    begin_level(state, state->current_level);
     
-    // Increase enemy speed and aggression based on level
-    for (int i = 0; i < state->num_enemies; i++) {
-        Player* enemy = &state->enemies[i];
-        // Store speed and aggression in the score field temporarily
-        enemy->score = (int)((1.5f + (level * 0.2f)) * 100); // Store speed * 100
-        enemy->health = (int)((0.8f + (level * 0.1f)) * 100); // Store aggression * 100
-        enemy->keys = 10 + (level * 2); // Store detection range
+    printf("Level %d loaded from %s: %d keys required\n", state->current_level, path, state->keys_required);
+    return true;
+}
+
+// Save the current level as a level file, with the enemies' current
+// positions as its spawn points (see level_file.h)
+bool save_level(const GameState *state, const char *path) {
+    if (state == NULL || path == NULL) {
+        printf("Error: NULL argument passed to save_level\n");
+        return false;
     }
     
-    // Set keys required based on level
-    if (level == 1) {
-        state->keys_required = 5;  // Level 1: 5 keys
-    } else if (level == 2) {
-        state->keys_required = 7;  // Level 2: 7 keys
+    LevelSpawn spawns[MAX_ENEMIES];
+    memset(spawns, 0, sizeof(spawns));
+    int num_spawns = state->num_enemies < MAX_ENEMIES ? state->num_enemies : MAX_ENEMIES;
+    for (int i = 0; i < num_spawns; i++) {
+        spawns[i].x = state->enemies.x[i];
+        spawns[i].y = state->enemies.y[i];
+        spawns[i].type = state->enemies.type[i];
     }
-    state->keys_collected = 0;
-    state->exit_enabled = false;
     
-    // Add exactly the required number of keys
-    for (int i = 0; i < state->keys_required; i++) {
-        int x, y;
-        do {
-            // Place keys farther from the starting point
-            x = 20 + rand() % (MAP_WIDTH - 25);
-            y = 20 + rand() % (MAP_HEIGHT - 25);
-        } while (state->map.tiles[y][x] != TILE_EMPTY);
-        
-        state->map.tiles[y][x] = TILE_KEY;
-        
-        // Create a path from this key to either the starting area or the map center
-        int path_x = x;
-        int path_y = y;
-        int target_x, target_y;
-        
-        // Alternate between creating paths to start and center to create connections
-        if (i % 2 == 0) {
-            // Path to starting area
-            target_x = 3;
-            target_y = 3;
-        } else {
-            // Path to center of map
-            target_x = MAP_WIDTH / 2;
-            target_y = MAP_HEIGHT / 2;
-        }
-        
-        // Create path from key to target
-        while ((abs(path_x - target_x) > 3) || (abs(path_y - target_y) > 3)) {
-            // Choose direction based on which axis has greater distance
-            if (abs(path_x - target_x) > abs(path_y - target_y)) {
-                // Move horizontally
-                path_x += (path_x < target_x) ? 1 : -1;
-            } else {
-                // Move vertically
-                path_y += (path_y < target_y) ? 1 : -1;
-            }
-            
-            // Clear current tile if it's a wall
-            if (state->map.tiles[path_y][path_x] == TILE_WALL) {
-                state->map.tiles[path_y][path_x] = TILE_EMPTY;
-            }
-            
-            // Occasionally place a door (5% chance)
-            if (rand() % 100 < 5 && state->map.tiles[path_y][path_x] == TILE_EMPTY) {
-                state->map.tiles[path_y][path_x] = TILE_DOOR;
-            }
-        }
+    MapGenParams params;
+    level_params(state->current_level, &params);
+    if (!level_file_write(path, &state->map, state->seed, state->current_level,
+                          state->keys_required, &params, spawns, num_spawns)) {
+        return false;
     }
-    
-    printf("Level %d generated: %d keys required\n", level, state->keys_required);
-} 
\ No newline at end of file
+    printf("Level %d saved to %s\n", state->current_level, path);
+    return true;
+}
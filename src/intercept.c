@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/intercept.h"
+#include "../include/pathfield.h"
+#include "../include/chunk_world.h"
+#include "../include/ai_lod.h"
+
+// Scratch window field for enemy searches (INTERCEPT_MAX_ROUTE around the
+// enemy being planned); only the main process runs the planner
+static unsigned short enemy_distance[PATHFIELD_WINDOW_CELLS(INTERCEPT_MAX_ROUTE)];
+
+static const int step_x[4] = {1, -1, 0, 0};
+static const int step_y[4] = {0, 0, 1, -1};
+
+// Reset the planner; nothing is planned until the first update
+void intercept_init(GameState *state) {
+    if (state == NULL) return;
+
+    InterceptPlanner *plan = &state->intercept;
+    memset(plan, 0, sizeof(*plan));
+    plan->goal_valid = false;
+    plan->player_x = -1;
+    plan->player_y = -1;
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        plan->origin_x[i] = -1;
+        plan->origin_y[i] = -1;
+    }
+}
+
+// Find the player's nearest next objective (a key still on the map, or the
+// exit once it has been enabled) inside the area the AI LOD field covers.
+// Returns false if none is within reach of the field.
+static bool find_nearest_goal(const GameState *state, int *goal_x, int *goal_y) {
+    const GameMap *map = &state->map;
+    TileType goal = state->exit_enabled ? TILE_EXIT : TILE_KEY;
+    int radius = AI_LOD_FIELD_RADIUS;
+    int field_x = state->ai_lod.field_x;
+    int field_y = state->ai_lod.field_y;
+    if (field_x < 0) return false;
+
+    int x0 = field_x - radius < 0 ? 0 : field_x - radius;
+    int y0 = field_y - radius < 0 ? 0 : field_y - radius;
+    int x1 = field_x + radius >= map->width ? map->width - 1 : field_x + radius;
+    int y1 = field_y + radius >= map->height ? map->height - 1 : field_y + radius;
+
+    int best = PATHFIELD_UNREACHED;
+    for (int y = y0; y <= y1; y++) {
+        const unsigned short *row = &state->ai_lod.player_distance[(y - field_y + radius) * AI_LOD_FIELD_SIDE];
+        for (int x = x0; x <= x1; x++) {
+            int d = row[x - field_x + radius];
+            if (d >= best || map_peek_tile(map, x, y) != goal) continue;
+            best = d;
+            *goal_x = x;
+            *goal_y = y;
+        }
+    }
+    return best != PATHFIELD_UNREACHED;
+}
+
+// Predict the route the player will take to their nearest objective by
+// walking back from it along the AI LOD field (path distance from the
+// player), so route[k] is the cell the player reaches after k steps. Straight
+// moves are preferred when several routes are equally short. With no
+// objective in reach the route is just the player's tile, which the enemies
+// then chase.
+static void build_player_route(InterceptPlanner *plan, const GameState *state, int player_x, int player_y) {
+    const GameMap *map = &state->map;
+
+    plan->route_x[0] = (short)player_x;
+    plan->route_y[0] = (short)player_y;
+    plan->route_length = 1;
+
+    int x, y;
+    if (!find_nearest_goal(state, &x, &y)) return;
+
+    int d = ai_lod_player_distance(state, x, y);
+    int length = d + 1 < INTERCEPT_MAX_ROUTE ? d + 1 : INTERCEPT_MAX_ROUTE;
+    int last_dir = -1;
+    while (d > 0) {
+        if (d < INTERCEPT_MAX_ROUTE) {
+            plan->route_x[d] = (short)x;
+            plan->route_y[d] = (short)y;
+        }
+
+        int dirs[4];
+        int num_dirs = 0;
+        if (last_dir >= 0) dirs[num_dirs++] = last_dir;
+        for (int dir = 0; dir < 4; dir++) {
+            if (dir != last_dir) dirs[num_dirs++] = dir;
+        }
+
+        int next_dir = -1;
+        for (int i = 0; i < num_dirs && next_dir < 0; i++) {
+            int dir = dirs[i];
+            int nx = x + step_x[dir];
+            int ny = y + step_y[dir];
+            if (nx < 0 || nx >= map->width || ny < 0 || ny >= map->height) continue;
+            if (ai_lod_player_distance(state, nx, ny) == d - 1) {
+                next_dir = dir;
+            }
+        }
+        if (next_dir < 0) return;
+
+        x += step_x[next_dir];
+        y += step_y[next_dir];
+        last_dir = next_dir;
+        d--;
+    }
+    plan->route_length = length;
+}
+
+// Walk back from a target tile along the window field built from the enemy
+// to find the enemy's first step. Returns false if the target was not reached.
+static bool first_step_toward(const unsigned short *distance, int enemy_x, int enemy_y,
+                              int target_x, int target_y, int *dx, int *dy) {
+    int x = target_x;
+    int y = target_y;
+    int d = pathfield_window_distance(distance, enemy_x, enemy_y, INTERCEPT_MAX_ROUTE, x, y);
+    if (d == PATHFIELD_UNREACHED) return false;
+
+    while (d > 1) {
+        bool stepped = false;
+        for (int dir = 0; dir < 4 && !stepped; dir++) {
+            int nx = x + step_x[dir];
+            int ny = y + step_y[dir];
+            if (pathfield_window_distance(distance, enemy_x, enemy_y, INTERCEPT_MAX_ROUTE, nx, ny) == d - 1) {
+                x = nx;
+                y = ny;
+                stepped = true;
+            }
+        }
+        if (!stepped) return false;
+        d--;
+    }
+
+    // d == 0 means the enemy already stands on its cell and holds position
+    *dx = d == 0 ? 0 : x - enemy_x;
+    *dy = d == 0 ? 0 : y - enemy_y;
+    return true;
+}
+
+// Check whether a route index is too close to one already given to another enemy
+static bool route_index_claimed(const bool *claimed, int route_length, int index) {
+    for (int k = index - INTERCEPT_SPACING + 1; k < index + INTERCEPT_SPACING; k++) {
+        if (k >= 0 && k < route_length && claimed[k]) return true;
+    }
+    return false;
+}
+
+// Check whether the current plan is stale (player, objectives or a smart enemy moved)
+static bool plan_is_stale(const GameState *state, const Player *player) {
+    const InterceptPlanner *plan = &state->intercept;
+    if (player->x != plan->player_x || player->y != plan->player_y) return true;
+
+    for (int i = 0; i < state->num_enemies; i++) {
+        if (!state->enemies.active[i] || state->enemies.type[i] != ENTITY_ENEMY_SMART) continue;
+        if (state->enemies.x[i] != plan->origin_x[i] || state->enemies.y[i] != plan->origin_y[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Run one planner tick: predict the player's route to their next objective
+// and give each smart enemy the earliest cell on that route it can reach
+// before the player does. Cells are handed out nearest enemy first and kept INTERCEPT_SPACING steps apart so enemies don't
+// pile onto the same spot; an enemy that cannot get ahead of the player
+// chases the player's current tile instead.
+// Must be called with the game state locked (after ai_lod_update).
+void intercept_update(GameState *state) {
+    if (state == NULL) return;
+
+    InterceptPlanner *plan = &state->intercept;
+    Player *player = &state->players[0];
+    if (!player->is_active) {
+        memset(plan->has_plan, 0, sizeof(plan->has_plan));
+        return;
+    }
+
+    bool goals_changed = !plan->goal_valid ||
+                         plan->goal_level != state->current_level ||
+                         plan->goal_keys_collected != state->keys_collected ||
+                         plan->goal_exit_enabled != state->exit_enabled;
+    if (!goals_changed && !plan_is_stale(state, player)) return;
+
+    build_player_route(plan, state, player->x, player->y);
+    plan->goal_level = state->current_level;
+    plan->goal_keys_collected = state->keys_collected;
+    plan->goal_exit_enabled = state->exit_enabled;
+    plan->goal_valid = true;
+    plan->player_x = player->x;
+    plan->player_y = player->y;
+    plan->plans_built++;
+
+    // Smart enemies ordered by path distance to the player (the LOD field)
+    int order[MAX_ENEMIES];
+    int count = 0;
+    for (int i = 0; i < state->num_enemies; i++) {
+        plan->has_plan[i] = false;
+        if (!state->enemies.active[i] || state->enemies.type[i] != ENTITY_ENEMY_SMART) continue;
+
+        plan->origin_x[i] = state->enemies.x[i];
+        plan->origin_y[i] = state->enemies.y[i];
+        if (state->ai_lod.tier[i] == AI_LOD_DORMANT) continue;
+
+        int distance = ai_lod_player_distance(state, state->enemies.x[i], state->enemies.y[i]);
+        int j = count++;
+        while (j > 0 && ai_lod_player_distance(state, state->enemies.x[order[j - 1]],
+                                               state->enemies.y[order[j - 1]]) > distance) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    bool claimed[INTERCEPT_MAX_ROUTE] = {false};
+    for (int n = 0; n < count; n++) {
+        int i = order[n];
+        int enemy_x = state->enemies.x[i];
+        int enemy_y = state->enemies.y[i];
+
+        if (pathfield_search_window(&state->map, enemy_x, enemy_y, INTERCEPT_MAX_ROUTE, enemy_distance) < 0) continue;
+
+        // Earliest free route cell the enemy reaches no later than the player
+        int best = -1;
+        for (int k = 1; k < plan->route_length && best < 0; k++) {
+            int d = pathfield_window_distance(enemy_distance, enemy_x, enemy_y, INTERCEPT_MAX_ROUTE,
+                                              plan->route_x[k], plan->route_y[k]);
+            if (d != PATHFIELD_UNREACHED && d <= k && !route_index_claimed(claimed, plan->route_length, k)) {
+                best = k;
+            }
+        }
+
+        int target = best >= 0 ? best : 0;
+        int dx = 0, dy = 0;
+        bool reached = first_step_toward(enemy_distance, enemy_x, enemy_y,
+                                         plan->route_x[target], plan->route_y[target], &dx, &dy);
+        if (!reached) continue;
+
+        if (best >= 0) claimed[best] = true;
+        plan->has_plan[i] = true;
+        plan->target_x[i] = plan->route_x[target];
+        plan->target_y[i] = plan->route_y[target];
+        plan->step_x[i] = (signed char)dx;
+        plan->step_y[i] = (signed char)dy;
+    }
+}
+
+// Look up the planned step for an enemy standing at (enemy_x, enemy_y).
+// Returns false if there is no plan or it was made for a different tile.
+// Must be called with the game state locked.
+bool intercept_lookup(const GameState *state, int enemy_id, int enemy_x, int enemy_y, int *dx, int *dy) {
+    if (state == NULL || enemy_id < 0 || enemy_id >= MAX_ENEMIES) return false;
+
+    const InterceptPlanner *plan = &state->intercept;
+    if (!plan->has_plan[enemy_id] ||
+        plan->origin_x[enemy_id] != enemy_x || plan->origin_y[enemy_id] != enemy_y) {
+        return false;
+    }
+
+    *dx = plan->step_x[enemy_id];
+    *dy = plan->step_y[enemy_id];
+    return true;
+}
@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/level_file.h"
+#include "../include/freecells.h"
+
+// Round a file offset up to the next section boundary
+static uint64_t align_section(uint64_t offset) {
+    return (offset + LEVEL_FILE_SECTION_ALIGN - 1) & ~(uint64_t)(LEVEL_FILE_SECTION_ALIGN - 1);
+}
+
+// Fold a section into a checksum, eight bytes at a time (size is a multiple of 8)
+static uint64_t checksum_update(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3ULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+// Checksum of the tile, label and spawn sections
+static uint64_t level_checksum(const MapTile *tiles, const unsigned short *components,
+                               const LevelSpawn *spawns, size_t cells, int num_spawns) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = checksum_update(hash, tiles, sizeof(MapTile) * cells);
+    hash = checksum_update(hash, components, sizeof(unsigned short) * cells);
+    return checksum_update(hash, spawns, sizeof(LevelSpawn) * (size_t)num_spawns);
+}
+
+// True if a section of length bytes at offset lies inside a file of size
+// bytes. Written so untrusted offsets cannot wrap the sum.
+static bool section_fits(uint64_t offset, uint64_t length, size_t size) {
+    return offset <= size && size - offset >= length;
+}
+
+// Check the contents of a level file's sections: every tile is a TileType,
+// the border is wall, walls and only walls carry MAP_COMPONENT_NONE, and the
+// spawn points lie on floor inside the map. Counts the key tiles.
+static bool check_sections(LevelFile *file) {
+    const LevelFileHeader *header = file->header;
+    int width = header->width;
+    int height = header->height;
+    int keys = 0;
+    for (int y = 0; y < height; y++) {
+        const MapTile *tiles = file->tiles + (size_t)y * header->stride;
+        const unsigned short *labels = file->components + (size_t)y * header->stride;
+        for (int x = 0; x < header->stride; x++) {
+            if (tiles[x] > TILE_KEY) return false;
+        }
+        for (int x = 0; x < width; x++) {
+            bool wall = tiles[x] == TILE_WALL;
+            if (wall != (labels[x] == MAP_COMPONENT_NONE)) return false;
+            if (!wall && (x == 0 || y == 0 || x == width - 1 || y == height - 1)) return false;
+            keys += tiles[x] == TILE_KEY;
+        }
+    }
+    for (uint32_t i = 0; i < header->num_spawns; i++) {
+        int x = file->spawns[i].x;
+        int y = file->spawns[i].y;
+        if (x <= 0 || y <= 0 || x >= width - 1 || y >= height - 1 ||
+            file->tiles[(size_t)y * header->stride + x] == TILE_WALL) {
+            return false;
+        }
+    }
+    file->num_keys = keys;
+    return true;
+}
+
+// Map a level file read-only and check it: magic, version, sizes, section
+// bounds, checksum and section contents. Prints the reason and returns false
+// on any mismatch.
+bool level_file_open(const char *path, LevelFile *file) {
+    memset(file, 0, sizeof(*file));
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("Failed to open level file");
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1 || (size_t)info.st_size < sizeof(LevelFileHeader)) {
+        printf("Error: %s is not a level file\n", path);
+        close(fd);
+        return false;
+    }
+    void *base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map level file");
+        return false;
+    }
+    madvise(base, (size_t)info.st_size, MADV_WILLNEED);
+
+    file->base = base;
+    file->size = (size_t)info.st_size;
+    const LevelFileHeader *header = (const LevelFileHeader *)base;
+    file->header = header;
+
+    if (memcmp(header->magic, LEVEL_FILE_MAGIC, sizeof(LEVEL_FILE_MAGIC)) != 0 ||
+        header->version != LEVEL_FILE_VERSION || header->header_size != sizeof(LevelFileHeader)) {
+        printf("Error: %s is not a version %d level file\n", path, LEVEL_FILE_VERSION);
+        level_file_close(file);
+        return false;
+    }
+    if (header->width < MIN_MAP_SIZE || header->width > MAX_MAP_SIZE ||
+        header->height < MIN_MAP_SIZE || header->height > MAX_MAP_SIZE ||
+        header->stride != MAP_STRIDE_FOR(header->width) ||
+        header->level < 1 || header->level > MAX_LEVEL || header->num_spawns > MAX_ENEMIES) {
+        printf("Error: level file %s has an invalid header\n", path);
+        level_file_close(file);
+        return false;
+    }
+
+    size_t cells = (size_t)header->stride * header->height;
+    if (header->file_size != file->size ||
+        header->tiles_offset % LEVEL_FILE_SECTION_ALIGN != 0 ||
+        header->components_offset % LEVEL_FILE_SECTION_ALIGN != 0 ||
+        header->spawns_offset % LEVEL_FILE_SECTION_ALIGN != 0 ||
+        !section_fits(header->tiles_offset, sizeof(MapTile) * cells, file->size) ||
+        !section_fits(header->components_offset, sizeof(unsigned short) * cells, file->size) ||
+        !section_fits(header->spawns_offset, sizeof(LevelSpawn) * header->num_spawns, file->size)) {
+        printf("Error: level file %s is truncated or damaged\n", path);
+        level_file_close(file);
+        return false;
+    }
+
+    const char *bytes = (const char *)base;
+    file->tiles = (const MapTile *)(bytes + header->tiles_offset);
+    file->components = (const unsigned short *)(bytes + header->components_offset);
+    file->spawns = (const LevelSpawn *)(bytes + header->spawns_offset);
+    if (level_checksum(file->tiles, file->components, file->spawns, cells, (int)header->num_spawns) != header->checksum) {
+        printf("Error: level file %s fails its checksum\n", path);
+        level_file_close(file);
+        return false;
+    }
+    if (!check_sections(file)) {
+        printf("Error: level file %s has invalid tiles, labels or spawn points\n", path);
+        level_file_close(file);
+        return false;
+    }
+    return true;
+}
+
+// Unmap a level file
+void level_file_close(LevelFile *file) {
+    if (file->base != NULL) {
+        munmap(file->base, file->size);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+// Copy the tiles and labels of a level file into a map of the same size and
+// rebuild its free-cell index
+bool level_file_copy_map(const LevelFile *file, GameMap *map) {
+    const LevelFileHeader *header = file->header;
+    if (map->tiles == NULL || map->components == NULL) {
+        printf("Error: level files can only be loaded into a flat map\n");
+        return false;
+    }
+    if (header->width != map->width || header->height != map->height) {
+        printf("Error: level is %dx%d but the map is %dx%d\n",
+               header->width, header->height, map->width, map->height);
+        return false;
+    }
+
+    if (header->stride == map->stride) {
+        size_t cells = MAP_CELLS(map);
+        memcpy(map->tiles, file->tiles, sizeof(MapTile) * cells);
+        memcpy(map->components, file->components, sizeof(unsigned short) * cells);
+    } else {
+        for (int y = 0; y < map->height; y++) {
+            memcpy(&MAP_TILE(map, 0, y), file->tiles + (size_t)y * header->stride, sizeof(MapTile) * map->width);
+            memcpy(map->components + (size_t)y * map->stride, file->components + (size_t)y * header->stride,
+                   sizeof(unsigned short) * map->width);
+        }
+    }
+    freecells_rebuild(map->free_cells, map);
+    return true;
+}
+
+// Write zero bytes up to a file offset
+static bool pad_to(FILE *out, uint64_t offset) {
+    static const char zeros[LEVEL_FILE_SECTION_ALIGN];
+    long position = ftell(out);
+    if (position < 0) return false;
+    uint64_t missing = offset - (uint64_t)position;
+    return missing == 0 || fwrite(zeros, 1, (size_t)missing, out) == missing;
+}
+
+// Save a flat map as a level file. The file is written under a temporary
+// name and renamed into place, so readers never see a partial file.
+bool level_file_write(const char *path, const GameMap *map, unsigned int seed, int level,
+                      int keys_required, const MapGenParams *params,
+                      const LevelSpawn *spawns, int num_spawns) {
+    if (map->tiles == NULL || map->components == NULL || params == NULL) {
+        printf("Error: only flat maps can be saved as level files\n");
+        return false;
+    }
+    if (num_spawns < 0 || num_spawns > MAX_ENEMIES) num_spawns = 0;
+
+    size_t cells = MAP_CELLS(map);
+    LevelFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEVEL_FILE_MAGIC, sizeof(LEVEL_FILE_MAGIC));
+    header.version = LEVEL_FILE_VERSION;
+    header.header_size = sizeof(LevelFileHeader);
+    header.width = map->width;
+    header.height = map->height;
+    header.stride = map->stride;
+    header.seed = seed;
+    header.level = level;
+    header.keys_required = keys_required;
+    header.params = *params;
+    header.num_spawns = (uint32_t)num_spawns;
+    header.tiles_offset = align_section(sizeof(LevelFileHeader));
+    header.components_offset = align_section(header.tiles_offset + sizeof(MapTile) * cells);
+    header.spawns_offset = align_section(header.components_offset + sizeof(unsigned short) * cells);
+    header.file_size = header.spawns_offset + sizeof(LevelSpawn) * (size_t)num_spawns;
+    header.checksum = level_checksum(map->tiles, map->components, spawns, cells, num_spawns);
+
+    // The temporary file is always a new file of our own; existing files and
+    // symlinks under its name are never written through
+    char temp_path[512];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d.tmp", path, (int)getpid());
+    unlink(temp_path);
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+    FILE *out = fd == -1 ? NULL : fdopen(fd, "wb");
+    if (out == NULL) {
+        perror("Failed to create level file");
+        if (fd != -1) close(fd);
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              pad_to(out, header.tiles_offset) &&
+              fwrite(map->tiles, sizeof(MapTile), cells, out) == cells &&
+              pad_to(out, header.components_offset) &&
+              fwrite(map->components, sizeof(unsigned short), cells, out) == cells &&
+              pad_to(out, header.spawns_offset) &&
+              (num_spawns == 0 || fwrite(spawns, sizeof(LevelSpawn), (size_t)num_spawns, out) == (size_t)num_spawns);
+    if (fclose(out) != 0) ok = false;
+    if (ok && rename(temp_path, path) == -1) {
+        perror("Failed to move level file into place");
+        ok = false;
+    }
+    if (!ok) {
+        printf("Warning: failed to save level file %s\n", path);
+        unlink(temp_path);
+    }
+    return ok;
+}
+
+// Find or create this user's cache directory. Cached levels are trusted on
+// read, so the directory must be ours and closed to everyone else; returns
+// false (and the cache is skipped) if it is not.
+static bool cache_dir(char *dir, size_t size) {
+    snprintf(dir, size, "%s-%u", LEVEL_CACHE_DIR, (unsigned int)getuid());
+    if (mkdir(dir, 0700) == -1 && errno != EEXIST) {
+        perror("Failed to create level cache directory");
+        return false;
+    }
+    struct stat info;
+    if (lstat(dir, &info) == -1 || !S_ISDIR(info.st_mode) ||
+        info.st_uid != getuid() || (info.st_mode & 077) != 0) {
+        printf("Warning: level cache %s is not a private directory; not using it\n", dir);
+        return false;
+    }
+    return true;
+}
+
+// Cache key of a level: the parameters that shape it (the thread count
+// does not change the output)
+static void cache_path(const char *dir, unsigned int seed, int level, int width, int height,
+                       const MapGenParams *params, char *path, size_t size) {
+    MapGenParams key = *params;
+    key.threads = 0;
+    uint64_t hash = checksum_update(0xCBF29CE484222325ULL, &key, sizeof(key));
+    snprintf(path, size, "%s/%u-%d-%dx%d-%016llx.level", dir, seed, level, width, height,
+             (unsigned long long)hash);
+}
+
+// A cache file and when it was last used
+typedef struct {
+    char name[256];
+    time_t used;
+    off_t size;
+} CacheEntry;
+
+// Order cache entries oldest first
+static int compare_entries(const void *a, const void *b) {
+    time_t ta = ((const CacheEntry *)a)->used;
+    time_t tb = ((const CacheEntry *)b)->used;
+    return (ta > tb) - (ta < tb);
+}
+
+// Delete the least recently used cache files until the cache fits its budget
+static void trim_cache(const char *cache) {
+    DIR *dir = opendir(cache);
+    if (dir == NULL) return;
+
+    size_t count = 0, capacity = 0;
+    CacheEntry *entries = NULL;
+    unsigned long long total = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length < 6 || length >= sizeof(entries->name) ||
+            strcmp(entry->d_name + length - 6, ".level") != 0) {
+            continue;
+        }
+
+        char path[512];
+        struct stat info;
+        snprintf(path, sizeof(path), "%s/%s", cache, entry->d_name);
+        if (lstat(path, &info) == -1 || !S_ISREG(info.st_mode)) continue;
+        if (count == capacity) {
+            size_t grown_capacity = capacity ? capacity * 2 : 16;
+            CacheEntry *grown = realloc(entries, sizeof(CacheEntry) * grown_capacity);
+            if (grown == NULL) break;
+            entries = grown;
+            capacity = grown_capacity;
+        }
+        memcpy(entries[count].name, entry->d_name, length + 1);
+        entries[count].used = info.st_mtime;
+        entries[count].size = info.st_size;
+        total += (unsigned long long)info.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    qsort(entries, count, sizeof(CacheEntry), compare_entries);
+    for (size_t i = 0; i < count && total > LEVEL_CACHE_MAX_BYTES; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", cache, entries[i].name);
+        if (unlink(path) == 0) {
+            total -= (unsigned long long)entries[i].size;
+        }
+    }
+    free(entries);
+}
+
+// Lay out a level into a flat map: from the level cache if this (seed, level,
+// size, params) was generated before, else by generating it and adding it to
+// the cache. Returns false only if generation fails.
+bool level_cache_generate(unsigned int seed, int level, const MapGenParams *params, GameMap *map) {
+    char dir[256];
+    if (!cache_dir(dir, sizeof(dir))) {
+        return mapgen_generate(seed, level, map->width, map->height, params, map, NULL);
+    }
+    char path[512];
+    cache_path(dir, seed, level, map->width, map->height, params, path, sizeof(path));
+
+    if (access(path, R_OK) == 0) {
+        LevelFile file;
+        bool loaded = false;
+        if (level_file_open(path, &file)) {
+            loaded = file.header->seed == seed && file.header->level == level &&
+                     level_file_copy_map(&file, map);
+            level_file_close(&file);
+        }
+        if (loaded) {
+            utime(path, NULL);   // Mark it recently used
+            return true;
+        }
+        unlink(path);            // Stale or damaged; replace it
+    }
+
+    if (!mapgen_generate(seed, level, map->width, map->height, params, map, NULL)) {
+        return false;
+    }
+    if (level_file_write(path, map, seed, level, params->keys, params, NULL, 0)) {
+        trim_cache(dir);
+    }
+    return true;
+}
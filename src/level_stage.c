@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/level_stage.h"
+#include "../include/level_file.h"
+
+// A level to lay out: everything its map is a function of
+typedef struct {
+    unsigned int seed;
+    int level;
+    MapGenParams params;
+} StageJob;
+
+// Worker thread and its state (main process only)
+static pthread_t stage_thread;
+static bool stage_running = false;
+static bool stage_stopping = false;
+static pthread_mutex_t stage_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stage_cond = PTHREAD_COND_INITIALIZER;
+static StageJob pending;             // Next level to generate
+static bool has_pending = false;
+static bool busy = false;            // The worker is writing the staging buffers
+static StageJob staged;              // Level held by the staging buffers
+static bool has_staged = false;
+
+// Whether two jobs produce the same map
+static bool same_job(const StageJob *a, const StageJob *b) {
+    return a->seed == b->seed && a->level == b->level &&
+           memcmp(&a->params, &b->params, sizeof(MapGenParams)) == 0;
+}
+
+// Worker: generate each requested level into the staging buffers. The
+// buffers belong to nobody else until level_stage_take swaps them in, so no
+// game state lock is needed while generating.
+static void *stage_worker(void *arg) {
+    GameState *state = (GameState *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&stage_mutex);
+        while (!has_pending && !stage_stopping) {
+            pthread_cond_wait(&stage_cond, &stage_mutex);
+        }
+        if (stage_stopping) {
+            pthread_mutex_unlock(&stage_mutex);
+            break;
+        }
+        StageJob job = pending;
+        has_pending = false;
+        has_staged = false;
+        busy = true;
+        GameMap map = state->staged_map;
+        pthread_mutex_unlock(&stage_mutex);
+
+        bool ok = level_cache_generate(job.seed, job.level, &job.params, &map);
+        if (!ok) {
+            printf("Error: Failed to pre-generate level %d\n", job.level);
+        }
+
+        pthread_mutex_lock(&stage_mutex);
+        busy = false;
+        if (ok) {
+            staged = job;
+            has_staged = true;
+        }
+        pthread_cond_broadcast(&stage_cond);
+        pthread_mutex_unlock(&stage_mutex);
+    }
+    return NULL;
+}
+
+// Start pre-generating levels. Call after the enemy processes are forked;
+// without the worker every level is generated when it is entered.
+bool level_stage_start(GameState *state) {
+    if (state == NULL || state->map.chunks != NULL || state->staged_map.tiles == NULL) {
+        return false;
+    }
+
+    stage_stopping = false;
+    if (pthread_create(&stage_thread, NULL, stage_worker, state) != 0) {
+        perror("Failed to create level staging thread");
+        return false;
+    }
+    stage_running = true;
+    return true;
+}
+
+// Stop the worker (waiting for a level in progress to finish)
+void level_stage_stop(void) {
+    if (!stage_running) return;
+
+    pthread_mutex_lock(&stage_mutex);
+    stage_stopping = true;
+    pthread_cond_broadcast(&stage_cond);
+    pthread_mutex_unlock(&stage_mutex);
+
+    pthread_join(stage_thread, NULL);
+    stage_running = false;
+    has_pending = false;
+    has_staged = false;
+}
+
+// Queue a level for pre-generation; it replaces any earlier request that
+// has not started yet. Requests made before level_stage_start wait for it.
+void level_stage_request(GameState *state, int level, const MapGenParams *params) {
+    if (state == NULL || params == NULL || state->map.chunks != NULL || state->staged_map.tiles == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&stage_mutex);
+    pending.seed = state->seed;
+    pending.level = level;
+    pending.params = *params;
+    has_pending = true;
+    pthread_cond_signal(&stage_cond);
+    pthread_mutex_unlock(&stage_mutex);
+}
+
+// Make the staged level live if it is the one asked for, by swapping the
+// buffers of the live and staging maps. If the worker is still on it, waits
+// for it to finish. Call with the game state lock held. Returns false if the
+// level was not staged; the caller then generates it itself.
+bool level_stage_take(GameState *state, int level, const MapGenParams *params) {
+    if (state == NULL || params == NULL || state->map.chunks != NULL || state->staged_map.tiles == NULL) {
+        return false;
+    }
+
+    StageJob wanted = {state->seed, level, *params};
+    pthread_mutex_lock(&stage_mutex);
+    while (stage_running && (busy || (has_pending && same_job(&pending, &wanted)))) {
+        pthread_cond_wait(&stage_cond, &stage_mutex);
+    }
+    bool ready = has_staged && same_job(&staged, &wanted);
+    if (ready) {
+        GameMap *live = &state->map;
+        GameMap *stage = &state->staged_map;
+        MapTile *tiles = live->tiles;
+        unsigned short *components = live->components;
+        struct FreeCellIndex *free_cells = live->free_cells;
+        live->tiles = stage->tiles;
+        live->components = stage->components;
+        live->free_cells = stage->free_cells;
+        stage->tiles = tiles;
+        stage->components = components;
+        stage->free_cells = free_cells;
+        has_staged = false;
+    }
+    pthread_mutex_unlock(&stage_mutex);
+    return ready;
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -8,6 +9,22 @@
 #include "../include/game.h"
 #include "../include/shared_memory.h"
 #include "../include/process.h"
+#include "../include/ai_lod.h"
+#include "../include/intercept.h"
+#include "../include/enemy_ai.h"
+#include "../include/chunk_world.h"
+#include "../include/level_stage.h"
+#include "../include/level_file.h"
+#include "../include/tile_layer.h"
+#include "../include/ui_cache.h"
+#include "../include/render_batch.h"
+#include "../include/sprite_atlas.h"
+#include "../include/sine_lut.h"
+#include "../include/text.h"
+#include "../include/frame_clock.h"
+#include "../include/profiler.h"
+#include "../include/quality.h"
+#include "../include/capture.h"
 
 // Define M_PI if not defined (for pulse calculations)
 #ifndef M_PI
@@ -26,284 +43,117 @@ void handle_signal(int sig) {
     terminate_flag = 1;
 }
 
-// Draw a simple character using lines
-void draw_simple_char(SDL_Renderer* renderer, int x, int y, char c, int size) {
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    
-    switch(c) {
-        case 'A':
-            SDL_RenderDrawLine(renderer, x, y + size, x + size/2, y);
-            SDL_RenderDrawLine(renderer, x + size/2, y, x + size, y + size);
-            SDL_RenderDrawLine(renderer, x + size/4, y + size/2, x + 3*size/4, y + size/2);
-            break;
-        case 'B':
-            SDL_RenderDrawLine(renderer, x, y, x, y + size);
-            SDL_RenderDrawLine(renderer, x, y, x + 2*size/3, y);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + size, y + size/4);
-            SDL_RenderDrawLine(renderer, x + size, y + size/4, x + 2*size/3, y + size/2);
-            SDL_RenderDrawLine(renderer, x, y + size/2, x + 2*size/3, y + size/2);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size/2, x + size, y + 3*size/4);
-            SDL_RenderDrawLine(renderer, x + size, y + 3*size/4, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x, y + size, x + 2*size/3, y + size);
-            break;
-        case 'C':
-            SDL_RenderDrawLine(renderer, x + size, y, x + size/3, y);
-            SDL_RenderDrawLine(renderer, x + size/3, y, x, y + size/3);
-            SDL_RenderDrawLine(renderer, x, y + size/3, x, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x, y + 2*size/3, x + size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size, x + size, y + size);
-            break;
-        case 'D':
-            SDL_RenderDrawLine(renderer, x, y, x, y + size);
-            SDL_RenderDrawLine(renderer, x, y, x + 2*size/3, y);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + size, y + size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + size/3, x + size, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + 2*size/3, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x, y + size);
-            break;
-        case 'E':
-            SDL_RenderDrawLine(renderer, x, y, x, y + size);
-            SDL_RenderDrawLine(renderer, x, y, x + size, y);
-            SDL_RenderDrawLine(renderer, x, y + size/2, x + 2*size/3, y + size/2);
-            SDL_RenderDrawLine(renderer, x, y + size, x + size, y + size);
-            break;
-        case 'F':
-            SDL_RenderDrawLine(renderer, x, y, x, y + size);
-            SDL_RenderDrawLine(renderer, x, y, x + size, y);
-            SDL_RenderDrawLine(renderer, x, y + size/2, x + 2*size/3, y + size/2);
-            break;
-        case 'G':
-            SDL_RenderDrawLine(renderer, x + size, y, x + size/3, y);
-            SDL_RenderDrawLine(renderer, x + size/3, y, x, y + size/3);
-            SDL_RenderDrawLine(renderer, x, y + size/3, x, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x, y + 2*size/3, x + size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x + size, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + 2*size/3, x + size, y + size/2);
-            SDL_RenderDrawLine(renderer, x + size, y + size/2, x + 2*size/3, y + size/2);
-            break;
-        case 'H':
-            SDL_RenderDrawLine(renderer, x, y, x, y + size);
-            SDL_RenderDrawLine(renderer, x + size, y, x + size, y + size);
-            SDL_RenderDrawLine(renderer, x, y + size/2, x + size, y + size/2);
-            break;
-        case 'I':
-            SDL_RenderDrawLine(renderer, x, y, x + size, y);
-            SDL_RenderDrawLine(renderer, x + size/2, y, x + size/2, y + size);
-            SDL_RenderDrawLine(renderer, x, y + size, x + size, y + size);
-            break;
-        case 'K':
-            SDL_RenderDrawLine(renderer, x, y, x, y + size);
-            SDL_RenderDrawLine(renderer, x, y + size/2, x + size, y);
-            SDL_RenderDrawLine(renderer, x, y + size/2, x + size, y + size);
-            break;
-        case 'L':
-            SDL_RenderDrawLine(renderer, x, y, x, y + size);
-            SDL_RenderDrawLine(renderer, x, y + size, x + size, y + size);
-            break;
-        case 'M':
-            SDL_RenderDrawLine(renderer, x, y, x, y + size);
-            SDL_RenderDrawLine(renderer, x, y, x + size/2, y + size/2);
-            SDL_RenderDrawLine(renderer, x + size/2, y + size/2, x + size, y);
-            SDL_RenderDrawLine(renderer, x + size, y, x + size, y + size);
-            break;
-        case 'N':
-            SDL_RenderDrawLine(renderer, x, y, x, y + size);
-            SDL_RenderDrawLine(renderer, x, y, x + size, y + size);
-            SDL_RenderDrawLine(renderer, x + size, y, x + size, y + size);
-            break;
-        case 'O':
-            SDL_RenderDrawLine(renderer, x + size/3, y, x + 2*size/3, y);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + size, y + size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + size/3, x + size, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + 2*size/3, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x + size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size, x, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x, y + 2*size/3, x, y + size/3);
-            SDL_RenderDrawLine(renderer, x, y + size/3, x + size/3, y);
-            break;
-        case 'P':
-            SDL_RenderDrawLine(renderer, x, y, x, y + size);
-            SDL_RenderDrawLine(renderer, x, y, x + 2*size/3, y);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + size, y + size/4);
-            SDL_RenderDrawLine(renderer, x + size, y + size/4, x + 2*size/3, y + size/2);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size/2, x, y + size/2);
-            break;
-        case 'Q':
-            SDL_RenderDrawLine(renderer, x + size/3, y, x + 2*size/3, y);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + size, y + size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + size/3, x + size, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + 2*size/3, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x + size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size, x, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x, y + 2*size/3, x, y + size/3);
-            SDL_RenderDrawLine(renderer, x, y + size/3, x + size/3, y);
-            SDL_RenderDrawLine(renderer, x + size/2, y + 2*size/3, x + size, y + size);
-            break;
-        case 'R':
-            SDL_RenderDrawLine(renderer, x, y, x, y + size);
-            SDL_RenderDrawLine(renderer, x, y, x + 2*size/3, y);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + size, y + size/4);
-            SDL_RenderDrawLine(renderer, x + size, y + size/4, x + 2*size/3, y + size/2);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size/2, x, y + size/2);
-            SDL_RenderDrawLine(renderer, x + size/2, y + size/2, x + size, y + size);
-            break;
-        case 'S':
-            SDL_RenderDrawLine(renderer, x + size, y, x + size/3, y);
-            SDL_RenderDrawLine(renderer, x + size/3, y, x, y + size/3);
-            SDL_RenderDrawLine(renderer, x, y + size/3, x + size/3, y + size/2);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size/2, x + 2*size/3, y + size/2);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size/2, x + size, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + 2*size/3, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x, y + size);
-            break;
-        case 'T':
-            SDL_RenderDrawLine(renderer, x, y, x + size, y);
-            SDL_RenderDrawLine(renderer, x + size/2, y, x + size/2, y + size);
-            break;
-        case 'U':
-            SDL_RenderDrawLine(renderer, x, y, x, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x, y + 2*size/3, x + size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x + size, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + 2*size/3, x + size, y);
-            break;
-        case 'V':
-            SDL_RenderDrawLine(renderer, x, y, x + size/2, y + size);
-            SDL_RenderDrawLine(renderer, x + size/2, y + size, x + size, y);
-            break;
-        case 'W':
-            SDL_RenderDrawLine(renderer, x, y, x + size/4, y + size);
-            SDL_RenderDrawLine(renderer, x + size/4, y + size, x + size/2, y + size/2);
-            SDL_RenderDrawLine(renderer, x + size/2, y + size/2, x + 3*size/4, y + size);
-            SDL_RenderDrawLine(renderer, x + 3*size/4, y + size, x + size, y);
-            break;
-        case 'Y':
-            SDL_RenderDrawLine(renderer, x, y, x + size/2, y + size/2);
-            SDL_RenderDrawLine(renderer, x + size, y, x + size/2, y + size/2);
-            SDL_RenderDrawLine(renderer, x + size/2, y + size/2, x + size/2, y + size);
-            break;
-        case '!':
-            SDL_RenderDrawLine(renderer, x + size/2, y, x + size/2, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size/2, y + 4*size/5, x + size/2, y + size);
-            break;
-        case '.':
-            SDL_RenderDrawLine(renderer, x + size/2, y + 4*size/5, x + size/2, y + size);
-            break;
-        case ':':
-            SDL_RenderDrawLine(renderer, x + size/2, y + size/4, x + size/2, y + size/3);
-            SDL_RenderDrawLine(renderer, x + size/2, y + 2*size/3, x + size/2, y + 3*size/4);
-            break;
-        case ' ':
-            // Nothing for space
-            break;
-        case '0':
-            SDL_RenderDrawLine(renderer, x + size/3, y, x + 2*size/3, y);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + size, y + size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + size/3, x + size, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + 2*size/3, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x + size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size, x, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x, y + 2*size/3, x, y + size/3);
-            SDL_RenderDrawLine(renderer, x, y + size/3, x + size/3, y);
-            break;
-        case '1':
-            SDL_RenderDrawLine(renderer, x + size/3, y, x + size/2, y);
-            SDL_RenderDrawLine(renderer, x + size/2, y, x + size/2, y + size);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size, x + 2*size/3, y + size);
-            break;
-        case '2':
-            SDL_RenderDrawLine(renderer, x + size/4, y, x + 3*size/4, y);
-            SDL_RenderDrawLine(renderer, x + 3*size/4, y, x + size, y + size/4);
-            SDL_RenderDrawLine(renderer, x + size, y + size/4, x + 3*size/4, y + size/2);
-            SDL_RenderDrawLine(renderer, x + 3*size/4, y + size/2, x + size/4, y + size/2);
-            SDL_RenderDrawLine(renderer, x + size/4, y + size/2, x, y + 3*size/4);
-            SDL_RenderDrawLine(renderer, x, y + 3*size/4, x, y + size);
-            SDL_RenderDrawLine(renderer, x, y + size, x + size, y + size);
-            break;
-        case '3':
-            SDL_RenderDrawLine(renderer, x, y, x + 2*size/3, y);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + size, y + size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + size/3, x + 2*size/3, y + size/2);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size/2, x + size/2, y + size/2);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size/2, x + size, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + 2*size/3, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x, y + size);
-            break;
-        case '4':
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x, y + 2*size/3, x + size, y + 2*size/3);
-            break;
-        case '5':
-            SDL_RenderDrawLine(renderer, x, y, x + size, y);
-            SDL_RenderDrawLine(renderer, x, y, x, y + size/2);
-            SDL_RenderDrawLine(renderer, x, y + size/2, x + 2*size/3, y + size/2);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size/2, x + size, y + 3*size/4);
-            SDL_RenderDrawLine(renderer, x + size, y + 3*size/4, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x + size/3, y + size);
-            break;
-        case '6':
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + size/3, y);
-            SDL_RenderDrawLine(renderer, x + size/3, y, x, y + size/3);
-            SDL_RenderDrawLine(renderer, x, y + size/3, x, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x, y + 2*size/3, x + size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x + size, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + 2*size/3, x + size/2, y + size/2);
-            SDL_RenderDrawLine(renderer, x + size/2, y + size/2, x, y + size/2);
-            break;
-        case '7':
-            SDL_RenderDrawLine(renderer, x, y, x + size, y);
-            SDL_RenderDrawLine(renderer, x + size, y, x + size/3, y + size);
-            break;
-        case '8':
-            SDL_RenderDrawLine(renderer, x + size/3, y, x + 2*size/3, y);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + size, y + size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + size/3, x + 2*size/3, y + size/2);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size/2, x + size/3, y + size/2);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size/2, x, y + size/3);
-            SDL_RenderDrawLine(renderer, x, y + size/3, x + size/3, y);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size/2, x, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x, y + 2*size/3, x + size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x + size, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + 2*size/3, x + 2*size/3, y + size/2);
-            break;
-        case '9':
-            SDL_RenderDrawLine(renderer, x, y + 2*size/3, x + size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + size/3, y + size, x + 2*size/3, y + size);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y + size, x + size, y + 2*size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + 2*size/3, x + size, y + size/3);
-            SDL_RenderDrawLine(renderer, x + size, y + size/3, x + 2*size/3, y);
-            SDL_RenderDrawLine(renderer, x + 2*size/3, y, x + size/3, y);
-            SDL_RenderDrawLine(renderer, x + size/3, y, x, y + size/3);
-            SDL_RenderDrawLine(renderer, x, y + size/3, x + size/2, y + size/2);
-            SDL_RenderDrawLine(renderer, x + size/2, y + size/2, x + size, y + size/2);
-            break;
-        default:
-            // Default unknown character
-            SDL_RenderDrawLine(renderer, x, y, x + size, y + size);
-            SDL_RenderDrawLine(renderer, x, y + size, x + size, y);
-            break;
+// Parse a "WIDTHxHEIGHT" (or single "SIZE") map size argument; the upper
+// bound depends on --streamed and is checked once all options are read
+static bool parse_map_size(const char *text, int *width, int *height) {
+    int w = 0, h = 0;
+    char extra;
+    if (sscanf(text, "%dx%d%c", &w, &h, &extra) == 2) {
+        // Both dimensions given
+    } else if (sscanf(text, "%d%c", &w, &extra) == 1) {
+        h = w;
+    } else {
+        return false;
     }
-}
-
-// Draw a simple text string
-void draw_simple_text(SDL_Renderer* renderer, int x, int y, const char* text, int size) {
-    int spacing = size + size/3;
-    int cx = x;
-    
-    for (int i = 0; text[i] != '\0'; i++) {
-        draw_simple_char(renderer, cx, y, text[i], size);
-        cx += spacing;
+    if (w < MIN_MAP_SIZE || w > MAX_STREAMED_MAP_SIZE || h < MIN_MAP_SIZE || h > MAX_STREAMED_MAP_SIZE) {
+        return false;
     }
+    *width = w;
+    *height = h;
+    return true;
 }
 
 int main(int argc, char* argv[]) {
-    // Mark parameters as unused to suppress warnings
-    (void)argc;
-    (void)argv;
+    int map_width = DEFAULT_MAP_WIDTH;
+    int map_height = DEFAULT_MAP_HEIGHT;
+    bool streamed = false;
+    unsigned int seed = 0;
+    const char *level_path = NULL;
+    const char *save_path = NULL;
+    int candidates = 1;
+    int budget_ms = DEFAULT_GEN_BUDGET_MS;
+    bool vsync = false;
+    const char *profile_path = NULL;
+    const char *capture_target = NULL;
+    CaptureFormat capture_format = CAPTURE_QOI;
+    int capture_every = 1;
+
+    // Parse command line options
+    for (int i = 1; i < argc; i++) {
+        char extra;
+        if (strcmp(argv[i], "--map-size") == 0 && i + 1 < argc) {
+            if (!parse_map_size(argv[++i], &map_width, &map_height)) {
+                printf("Invalid map size '%s' (expected WIDTHxHEIGHT, each %d..%d, or up to %d with --streamed)\n",
+                       argv[i], MIN_MAP_SIZE, MAX_MAP_SIZE, MAX_STREAMED_MAP_SIZE);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--streamed") == 0) {
+            streamed = true;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%u%c", &seed, &extra) != 1 || seed == 0) {
+                printf("Invalid seed '%s' (expected a positive number)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--best-of") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d%c", &candidates, &extra) != 1 ||
+                candidates < 1 || candidates > MAPGEN_MAX_CANDIDATES) {
+                printf("Invalid candidate count '%s' (expected 1..%d)\n", argv[i], MAPGEN_MAX_CANDIDATES);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--gen-budget") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d%c", &budget_ms, &extra) != 1 || budget_ms < 0) {
+                printf("Invalid generation budget '%s' (expected milliseconds, 0 = no limit)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--level-file") == 0 && i + 1 < argc) {
+            level_path = argv[++i];
+        } else if (strcmp(argv[i], "--save-level") == 0 && i + 1 < argc) {
+            save_path = argv[++i];
+        } else if (strcmp(argv[i], "--vsync") == 0) {
+            vsync = true;
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_target = argv[++i];
+        } else if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc) {
+            if (!capture_parse_format(argv[++i], &capture_format)) {
+                printf("Invalid capture format '%s' (expected raw, qoi, png or y4m)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--capture-every") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d%c", &capture_every, &extra) != 1 || capture_every < 1) {
+                printf("Invalid capture interval '%s' (expected a positive number of frames)\n", argv[i]);
+                return 1;
+            }
+        } else {
+            printf("Usage: %s [--map-size WIDTHxHEIGHT] [--streamed] [--seed N] [--best-of N] "
+                   "[--gen-budget MS] [--level-file FILE] [--save-level FILE] [--vsync] [--profile FILE] "
+                   "[--capture TARGET] [--capture-format raw|qoi|png|y4m] [--capture-every N]\n", argv[0]);
+            return 1;
+        }
+    }
+    
+    if (!streamed && (map_width > MAX_MAP_SIZE || map_height > MAX_MAP_SIZE)) {
+        printf("Maps larger than %d tiles per side need --streamed\n", MAX_MAP_SIZE);
+        return 1;
+    }
+    
+    set_level_candidates(candidates, budget_ms);
+    
+    // A level file brings its own map size
+    if (level_path != NULL) {
+        if (streamed) {
+            printf("--level-file cannot be combined with --streamed\n");
+            return 1;
+        }
+        LevelFile file;
+        if (!level_file_open(level_path, &file)) {
+            return 1;
+        }
+        map_width = file.header->width;
+        map_height = file.header->height;
+        level_file_close(&file);
+    }
     
     printf("Dungeon Conquerors\n");
     
@@ -329,7 +179,7 @@ int main(int argc, char* argv[]) {
     printf("Game initialized successfully\n");
     
     // Initialize shared memory for game state
-    if (!init_shared_memory()) {
+    if (!init_shared_memory(map_width, map_height, streamed, seed, level_path)) {
         printf("Failed to initialize shared memory\n");
         game_cleanup();
         SDL_Quit();
@@ -357,6 +207,24 @@ int main(int argc, char* argv[]) {
     create_enemy_processes(5); // Create 5 enemy processes
     printf("Enemy processes created\n");
     
+    // Write the starting level, with its enemy spawn points, as a level file
+    if (save_path != NULL) {
+        lock_game_state();
+        save_level(game_state, save_path);
+        unlock_game_state();
+    }
+    
+    // Stream chunks of a streamed level in the background (after forking,
+    // so the enemy processes don't inherit the worker threads)
+    if (game_state->map.chunks != NULL && chunk_world_start_workers(game_state->map.chunks)) {
+        printf("Chunk streaming started\n");
+    }
+    
+    // Pre-generate the next level in the background so entering it is a swap
+    if (level_stage_start(game_state)) {
+        printf("Level pre-generation started\n");
+    }
+    
     // Initialize SDL in the main process
     SDL_Window* window = NULL;
     SDL_Renderer* renderer = NULL;
@@ -376,6 +244,7 @@ int main(int argc, char* argv[]) {
     
     if (window == NULL) {
         printf("Error creating window: %s\n", SDL_GetError());
+        level_stage_stop();
         cleanup_ipc_channels();
         cleanup_shared_memory();
         game_cleanup();
@@ -385,10 +254,12 @@ int main(int argc, char* argv[]) {
     
     printf("Window created successfully\n");
     
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    // With --vsync the present waits for the display's refresh instead of a timer
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
     if (renderer == NULL) {
         printf("Error creating renderer: %s\n", SDL_GetError());
         SDL_DestroyWindow(window);
+        level_stage_stop();
         cleanup_ipc_channels();
         cleanup_shared_memory();
         game_cleanup();
@@ -398,17 +269,22 @@ int main(int argc, char* argv[]) {
     
     printf("Renderer created successfully\n");
     
+    // Tables used by the render code
+    sine_lut_init();
+    
     // Game loop
     bool running = true;
     SDL_Event event;
     GameMessage message;
+    RenderSnapshot snapshot;
+    FrameClock frame_clock;
     
     printf("Starting game loop\n");
     
     // Show welcome message
     bool showing_welcome = true;
     int welcome_timer = 0;
-    const int WELCOME_DURATION = 180; // Show for about 3 seconds (60 FPS * 3)
+    const int WELCOME_DURATION = 3 * SIM_TICKS_PER_SECOND; // Show for 3 seconds (counted in ticks)
     
     // Pause enemies until welcome screen is dismissed
     lock_game_state();
@@ -416,12 +292,44 @@ int main(int argc, char* argv[]) {
     time_t welcome_start_time = game_state->current_time;
     unlock_game_state();
     
+    frame_clock_init(&frame_clock, FRAME_CLOCK_DEFAULT_FPS, vsync);
+    
+    // Shed visual effects when frames run over their budget
+    quality_init(1000000000ULL / FRAME_CLOCK_DEFAULT_FPS);
+    
+    // Per-frame phase times go to a CSV file with --profile
+    if (profile_path != NULL && profiler_open_csv(profile_path)) {
+        printf("Writing frame profile to %s\n", profile_path);
+    }
+    
+    // Record the session with --capture (the game runs on if it cannot start)
+    if (capture_target != NULL) {
+        capture_start(renderer, capture_target, capture_format, capture_every);
+    }
+    
     while (running && !terminate_flag) {
+        uint64_t frame_start = profile_begin();
+        uint64_t work_start = frame_clock_now_ns();
+        
         // Process events
+        uint64_t phase_start = profile_begin();
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
                 printf("Quit event received\n");
                 running = false;
+            } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3) {
+                // F3 shows or hides the frame profiler
+                profiler_toggle_overlay();
+            } else if (event.type == SDL_RENDER_TARGETS_RESET) {
+                // Render target contents were lost; redraw the tile layer
+                tile_layer_invalidate();
+            } else if (event.type == SDL_RENDER_DEVICE_RESET) {
+                // Textures were lost; the tile layer, UI gradients, sprite
+                // and glyph atlases are recreated next frame
+                tile_layer_destroy();
+                ui_cache_destroy();
+                sprite_atlas_destroy();
+                text_cache_destroy();
             } else if (showing_welcome && event.type == SDL_KEYDOWN) {
                 // Any key press skips the welcome message
                 showing_welcome = false;
@@ -445,8 +353,10 @@ int main(int argc, char* argv[]) {
                 broadcast_player_position(player_x, player_y);
             }
         }
+        profile_end(PROFILE_INPUT, phase_start);
         
         // Check for messages from enemy processes - only if not showing welcome screen
+        phase_start = profile_begin();
         if (!showing_welcome) {
             for (int i = 0; i < game_state->num_enemies; i++) {
                 if (receive_message_from_enemy(i, &message)) {
@@ -461,12 +371,45 @@ int main(int argc, char* argv[]) {
             }
         }
         
+        profile_end(PROFILE_IPC, phase_start);
+        
+        // Run the simulation ticks that are due: the chunk stream, the AI
+        // level-of-detail scheduler, the interception planner and the
+        // batched decisions for the enemies waiting on one
+        phase_start = profile_begin();
+        int ticks = frame_clock_begin(&frame_clock);
+        if (ticks > 0) {
+            lock_game_state();
+            for (int t = 0; t < ticks; t++) {
+                chunk_world_update(game_state);
+                ai_lod_update(game_state);
+                intercept_update(game_state);
+                enemy_ai_update(game_state);
+            }
+            unlock_game_state();
+        }
+        profile_end(PROFILE_SIMULATION, phase_start);
+        
+        // Copy what this frame shows out of the shared state; everything
+        // below draws from the copy without holding the lock
+        phase_start = profile_begin();
+        lock_game_state();
+        capture_render_snapshot(game_state, 0, &snapshot);
+        unlock_game_state();
+        profile_end(PROFILE_SNAPSHOT, phase_start);
+        
+        // Advance animations and particles by the same ticks, spawning
+        // effects for what the snapshot shows
+        phase_start = profile_begin();
+        for (int t = 0; t < ticks; t++) {
+            advance_animation(&snapshot, SIM_TICK_SECONDS);
+        }
+        profile_end(PROFILE_PARTICLES, phase_start);
+        
         // Render game
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
         SDL_RenderClear(renderer);
         
-        lock_game_state();
-        
         if (showing_welcome) {
             // Draw welcome message with modern styling
             SDL_SetRenderDrawColor(renderer, 20, 20, 30, 255);
@@ -476,14 +419,8 @@ int main(int argc, char* argv[]) {
             float pulse = (sinf(welcome_timer * 0.05f) * 0.2f + 0.8f);
             
             // Draw stylish background gradient
-            for (int y = 0; y < WINDOW_HEIGHT; y++) {
-                float progress = (float)y / WINDOW_HEIGHT;
-                SDL_SetRenderDrawColor(renderer, 
-                                      (Uint8)(20 + 10 * progress), 
-                                      (Uint8)(20 + 15 * progress), 
-                                      (Uint8)(40 + 20 * progress), 
-                                      255);
-                SDL_RenderDrawLine(renderer, 0, y, WINDOW_WIDTH, y);
+            if (quality_settings()->gradient_background) {
+                ui_draw_welcome_background(renderer);
             }
             
             // Draw decorative elements (stars)
@@ -581,19 +518,13 @@ int main(int argc, char* argv[]) {
             // Bottom-right corner
             SDL_RenderDrawLine(renderer, msg_bg.x + msg_bg.w, msg_bg.y + msg_bg.h, msg_bg.x + msg_bg.w - corner_size, msg_bg.y + msg_bg.h);
             SDL_RenderDrawLine(renderer, msg_bg.x + msg_bg.w, msg_bg.y + msg_bg.h, msg_bg.x + msg_bg.w, msg_bg.y + msg_bg.h - corner_size);
-            
-            // Increment timer and check if welcome should end
-            welcome_timer++;
-            if (welcome_timer >= WELCOME_DURATION) {
-                showing_welcome = false;
-            }
         } else {
-            // Regular game rendering
-            render_game(renderer, game_state, 0);
+            // Regular game rendering, interpolated between ticks
+            render_game(renderer, &snapshot, frame_clock_alpha(&frame_clock));
         }
         
         // Check if game is over
-        if (game_state->game_over) {
+        if (snapshot.game_over) {
             // Only print game over message once
             if (!game_over_message_printed) {
                 printf("Game over condition reached\n");
@@ -620,7 +551,7 @@ int main(int argc, char* argv[]) {
             SDL_RenderFillRect(renderer, &msg_bg);
             
             // Draw multiple borders for a glowing effect
-            if (game_state->winner_id == -2) {
+            if (snapshot.winner_id == -2) {
                 // Game Exited - blue glow
                 for (int i = 0; i < 3; i++) {
                     SDL_SetRenderDrawColor(renderer, 
@@ -647,19 +578,19 @@ int main(int argc, char* argv[]) {
                 
                 // Draw score
                 char score_text[32];
-                sprintf(score_text, "SCORE: %d", game_state->players[0].score);
+                sprintf(score_text, "SCORE: %d", snapshot.score);
                 draw_simple_text(renderer, WINDOW_WIDTH/2 - 70, WINDOW_HEIGHT/2, score_text, 15);
                 
                 // Console message - print only once
                 if (!game_over_message_printed) {
                     printf("\n*******************************\n");
                     printf("*   Game exited by player   *\n");
-                    printf("*   Final Score: %d   *\n", game_state->players[0].score);
+                    printf("*   Final Score: %d   *\n", snapshot.score);
                     printf("*******************************\n\n");
                     game_over_message_printed = true;
                 }
             }
-            else if (game_state->winner_id == 0) {
+            else if (snapshot.winner_id == 0) {
                 // Victory - green glow
                 for (int i = 0; i < 3; i++) {
                     SDL_SetRenderDrawColor(renderer, 
@@ -686,7 +617,7 @@ int main(int argc, char* argv[]) {
                 
                 // Draw score
                 char score_text[32];
-                sprintf(score_text, "SCORE: %d", game_state->players[0].score);
+                sprintf(score_text, "SCORE: %d", snapshot.score);
                 draw_simple_text(renderer, WINDOW_WIDTH/2 - 70, WINDOW_HEIGHT/2, score_text, 15);
                 
                 // Draw checkmark symbol - moved down to avoid overlapping with text
@@ -719,7 +650,7 @@ int main(int argc, char* argv[]) {
                 if (!game_over_message_printed) {
                     printf("\n*******************************\n");
                     printf("*   VICTORY! You escaped the dungeon!   *\n");
-                    printf("*   Final Score: %d   *\n", game_state->players[0].score);
+                    printf("*   Final Score: %d   *\n", snapshot.score);
                     printf("*******************************\n\n");
                     game_over_message_printed = true;
                 }
@@ -788,9 +719,6 @@ int main(int argc, char* argv[]) {
                 draw_simple_text(renderer, WINDOW_WIDTH/2 - 100, WINDOW_HEIGHT/2 + 50, "PRESS ANY KEY TO EXIT", 10);
             }
             
-            // Present the game over screen
-            SDL_RenderPresent(renderer);
-            
             // Wait for key press or timeout to exit
             static bool exit_wait_started = false;
             static Uint32 exit_start_time = 0;
@@ -814,18 +742,31 @@ int main(int argc, char* argv[]) {
             if (SDL_GetTicks() - exit_start_time > EXIT_TIMEOUT) {
                 running = false;
             }
-            
-            // Skip the rest of the loop
-            unlock_game_state();
-            continue;
         }
         
-        unlock_game_state();
+        // Queue the finished frame for recording; the back buffer is only
+        // defined until the present, and the profiler overlay is left out
+        phase_start = profile_begin();
+        uint64_t capture_ns = capture_frame(renderer);
+        profile_end(PROFILE_CAPTURE, phase_start);
         
+        // The profiler overlay goes over everything else
+        profiler_draw_overlay(renderer);
+        
+        phase_start = profile_begin();
+        uint64_t present_start = frame_clock_now_ns();
         SDL_RenderPresent(renderer);
+        profile_end(PROFILE_PRESENT, phase_start);
+        profile_end(PROFILE_FRAME, frame_start);
+        profiler_end_frame();
+        
+        // Report the frame's work to the quality governor; with vsync the
+        // present waits for the display, so it is left out. So is the capture
+        // readback, which would otherwise make recording lower the quality.
+        quality_record_frame((vsync ? present_start : frame_clock_now_ns()) - work_start - capture_ns);
         
-        // Cap frame rate to approximately 60 FPS
-        SDL_Delay(16);
+        // Sleep until the next frame is due
+        frame_clock_wait(&frame_clock);
         
         // Check if termination was requested
         if (terminate_flag) {
@@ -836,7 +777,7 @@ int main(int argc, char* argv[]) {
         
         // Update welcome timer if showing welcome screen
         if (showing_welcome) {
-            welcome_timer++;
+            welcome_timer += ticks;
             if (welcome_timer >= WELCOME_DURATION) {
                 showing_welcome = false;
                 // Resume normal game time tracking
@@ -849,6 +790,9 @@ int main(int argc, char* argv[]) {
     }
     
     printf("Game loop ended\n");
+    profiler_shutdown();
+    quality_print_stats();
+    capture_stop();
     
     // Send game over message to all enemy processes
     GameMessage game_over_msg;
@@ -906,6 +850,11 @@ int main(int argc, char* argv[]) {
     
     // Cleanup SDL resources first
     printf("Cleaning up SDL resources...\n");
+    tile_layer_destroy();
+    ui_cache_destroy();
+    sprite_atlas_destroy();
+    text_cache_destroy();
+    render_batch_free();
     if (renderer) {
         SDL_DestroyRenderer(renderer);
         renderer = NULL;
@@ -933,6 +882,10 @@ int main(int argc, char* argv[]) {
     // Clean up in the correct order to prevent segmentation faults
     // First clean up game resources
     printf("Cleaning up game resources...\n");
+    if (game_state->map.chunks != NULL) {
+        chunk_world_stop_workers(game_state->map.chunks);
+    }
+    level_stage_stop();
     game_cleanup();
     
     // Then clean up IPC channels 
@@ -0,0 +1,1372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../include/mapgen.h"
+#include "../include/freecells.h"
+
+// Sequential random stream for one generation run (no global state)
+typedef struct {
+    unsigned long long state;
+} MapGenRng;
+
+// splitmix64 finalizer, also used to hash tile coordinates for the noise stage
+static inline unsigned long long mix64(unsigned long long z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Next random value from the stream
+static inline unsigned int rng_next(MapGenRng *rng) {
+    rng->state += 0x9E3779B97F4A7C15ULL;
+    return (unsigned int)(mix64(rng->state) >> 32);
+}
+
+// Random integer in [0, n)
+static inline int rng_range(MapGenRng *rng, int n) {
+    return n > 0 ? (int)(rng_next(rng) % (unsigned int)n) : 0;
+}
+
+// Base value for every random stream of a (seed, level) pair
+static unsigned long long level_key(unsigned int seed, int level) {
+    return mix64(((unsigned long long)seed << 32) ^ (unsigned long long)(unsigned int)level);
+}
+
+// Milliseconds on the monotonic clock
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Generator settings used by the game for a level
+void mapgen_default_params(int level, MapGenParams *params) {
+    if (params == NULL) return;
+
+    params->wall_chance = 30 + (level - 1) * 5;  // 30% for level 1, 35% for level 2, etc.
+    if (params->wall_chance > 50) params->wall_chance = 50;
+    params->smoothing_passes = 3;
+    params->section_doors = 2;
+    params->treasure_divisor = 400;
+    params->extra_treasures = level - 1;
+    params->keys = level == 1 ? 5 : 7;
+    params->path_door_chance = 5;
+    params->threads = 0;
+    params->candidates = 1;
+    params->budget_ms = 0;
+}
+
+// Work split across threads: each band owns a contiguous range of rows
+typedef void (*BandFunc)(void *ctx, int row_begin, int row_end);
+
+typedef struct {
+    BandFunc func;
+    void *ctx;
+    int row_begin;
+    int row_end;
+} BandJob;
+
+// Thread entry point for one band
+static void *band_thread(void *arg) {
+    BandJob *job = (BandJob *)arg;
+    job->func(job->ctx, job->row_begin, job->row_end);
+    return NULL;
+}
+
+// Number of row bands to use for a map; small maps stay on the calling thread
+static int band_count(const MapGenParams *params, int height) {
+    int threads = params->threads;
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > MAPGEN_MAX_THREADS) threads = MAPGEN_MAX_THREADS;
+    if (threads > height / MAPGEN_MIN_BAND_ROWS) threads = height / MAPGEN_MIN_BAND_ROWS;
+    return threads < 1 ? 1 : threads;
+}
+
+// Run func over all rows split into bands and wait for every band to finish.
+// The calling thread takes the first band, and any band whose thread cannot
+// be started, so the work always completes.
+static void run_in_bands(const MapGenParams *params, int height, BandFunc func, void *ctx) {
+    int bands = band_count(params, height);
+    BandJob jobs[MAPGEN_MAX_THREADS];
+    pthread_t threads[MAPGEN_MAX_THREADS];
+    bool started[MAPGEN_MAX_THREADS] = {false};
+
+    for (int i = 0; i < bands; i++) {
+        jobs[i].func = func;
+        jobs[i].ctx = ctx;
+        jobs[i].row_begin = (int)((long)height * i / bands);
+        jobs[i].row_end = (int)((long)height * (i + 1) / bands);
+    }
+    for (int i = 1; i < bands; i++) {
+        started[i] = pthread_create(&threads[i], NULL, band_thread, &jobs[i]) == 0;
+    }
+
+    band_thread(&jobs[0]);
+    for (int i = 1; i < bands; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            band_thread(&jobs[i]);
+        }
+    }
+}
+
+// Wall masks shared by the noise and smoothing stages. Walls are packed one
+// bit per tile, 64 tiles per word; smoothing passes ping-pong between masks.
+typedef struct {
+    int width;
+    int height;
+    int words;                  // 64-bit words per row
+    unsigned long long key;     // Noise key of the (seed, level) pair
+    unsigned int wall_threshold; // Wall chance scaled to 16 bits
+    MapTile *tiles;
+    int stride;                 // Tiles per row of the output map
+    const uint64_t *src;        // Mask read by the current pass
+    uint64_t *dst;              // Mask written by the current pass
+    const uint64_t *interior;   // Per-word bits of the columns a pass may change
+} MaskJob;
+
+// Stage 1: solid border and random walls, written straight into the wall
+// mask. Each word of 64 tiles hashes its own index (16 bits of hash per
+// tile), so the result does not depend on the order or thread it runs on.
+static void noise_band(void *ctx, int row_begin, int row_end) {
+    const MaskJob *job = (const MaskJob *)ctx;
+    int width = job->width;
+    int words = job->words;
+
+    for (int y = row_begin; y < row_end; y++) {
+        uint64_t *bits = &job->dst[(size_t)y * words];
+        bool border_row = y == 0 || y == job->height - 1;
+
+        for (int w = 0; w < words; w++) {
+            uint64_t word = 0;
+            if (border_row) {
+                word = ~(uint64_t)0;
+            } else {
+                unsigned long long index = ((unsigned long long)y * words + w) << 4;
+                for (int k = 0; k < 16; k++) {
+                    unsigned long long h = mix64(job->key ^ (index + k));
+                    for (int lane = 0; lane < 4; lane++) {
+                        unsigned int sample = (unsigned int)(h >> (16 * lane)) & 0xFFFF;
+                        word |= (uint64_t)(sample < job->wall_threshold) << (k * 4 + lane);
+                    }
+                }
+                word &= job->interior[w];
+                if (w == 0) word |= 1;
+                if (w == (width - 1) >> 6) word |= (uint64_t)1 << ((width - 1) & 63);
+            }
+            bits[w] = word;
+        }
+
+        // Keep starting area clear (top-left corner)
+        if (y < 5 && !border_row) {
+            bits[0] &= ~(uint64_t)0x1E;
+        }
+        // Bits past the right edge stay clear so they never count as walls
+        if (width & 63) {
+            bits[words - 1] &= ((uint64_t)1 << (width & 63)) - 1;
+        }
+    }
+}
+
+// Majority of three bit planes (the carry of a full adder)
+static inline uint64_t majority(uint64_t a, uint64_t b, uint64_t c) {
+    return (a & b) | (a & c) | (b & c);
+}
+
+// One smoothing pass over a row. The 3x3 wall count of all 64 tiles of a
+// word is computed at once with bit-sliced adders: each row's left, center
+// and right planes are summed to two bits, then the three row sums are added
+// into a four-bit count (o + 2u + 4v + 8 * eight).
+static void smooth_row(const MaskJob *job, int y) {
+    int words = job->words;
+    const uint64_t *rows[3] = {
+        &job->src[(size_t)(y - 1) * words], &job->src[(size_t)y * words], &job->src[(size_t)(y + 1) * words]
+    };
+    uint64_t *out = &job->dst[(size_t)y * words];
+
+    for (int w = 0; w < words; w++) {
+        uint64_t sum0[3], sum1[3];
+        for (int r = 0; r < 3; r++) {
+            uint64_t c = rows[r][w];
+            uint64_t left = (c << 1) | (w > 0 ? rows[r][w - 1] >> 63 : 0);
+            uint64_t right = (c >> 1) | (w + 1 < words ? rows[r][w + 1] << 63 : 0);
+            sum0[r] = left ^ c ^ right;
+            sum1[r] = majority(left, c, right);
+        }
+
+        uint64_t o = sum0[0] ^ sum0[1] ^ sum0[2];
+        uint64_t carry = majority(sum0[0], sum0[1], sum0[2]);
+        uint64_t t = sum1[0] ^ sum1[1] ^ sum1[2];
+        uint64_t t_carry = majority(sum1[0], sum1[1], sum1[2]);
+        uint64_t u = t ^ carry;
+        uint64_t u_carry = t & carry;
+        uint64_t v = t_carry ^ u_carry;
+        uint64_t eight = t_carry & u_carry;
+
+        uint64_t at_least_5 = eight | (v & (u | o));
+        uint64_t at_most_2 = ~(eight | v | (u & o));
+        uint64_t center = rows[1][w];
+        uint64_t next = at_least_5 | (center & ~at_most_2);
+
+        out[w] = (next & job->interior[w]) | (center & ~job->interior[w]);
+    }
+}
+
+// Run one pass over a band of rows (the border rows are copied unchanged)
+static void smooth_band(void *ctx, int row_begin, int row_end) {
+    const MaskJob *job = (const MaskJob *)ctx;
+    for (int y = row_begin; y < row_end; y++) {
+        if (y == 0 || y == job->height - 1) {
+            memcpy(&job->dst[(size_t)y * job->words], &job->src[(size_t)y * job->words],
+                   sizeof(uint64_t) * job->words);
+        } else {
+            smooth_row(job, y);
+        }
+    }
+}
+
+// Unpack a band of the final wall mask into tiles. TILE_EMPTY is 0 and
+// TILE_WALL is 1, so each tile is just its mask bit.
+static void unpack_band(void *ctx, int row_begin, int row_end) {
+    const MaskJob *job = (const MaskJob *)ctx;
+    for (int y = row_begin; y < row_end; y++) {
+        MapTile *row = &job->tiles[(size_t)y * job->stride];
+        const uint64_t *bits = &job->src[(size_t)y * job->words];
+        for (int w = 0; w < job->words; w++) {
+            uint64_t word = bits[w];
+            int count = job->width - w * 64 < 64 ? job->width - w * 64 : 64;
+            MapTile *out = &row[w * 64];
+            for (int b = 0; b < count; b++) {
+                out[b] = (MapTile)((word >> b) & 1);
+            }
+        }
+    }
+}
+
+// Stage 2: cellular automaton smoothing (3x3 wall count, >= 5 becomes a wall,
+// <= 2 becomes floor, otherwise unchanged; the border never changes), then
+// unpack the mask into tiles. Each pass reads rows owned by neighboring
+// bands, so the bands rejoin between passes.
+static void stage_smoothing(MaskJob *job, uint64_t *masks, size_t mask_words, const MapGenParams *params) {
+    job->dst = masks;
+    for (int pass = 0; pass < params->smoothing_passes; pass++) {
+        job->src = masks + (pass & 1) * mask_words;
+        job->dst = masks + ((pass + 1) & 1) * mask_words;
+        run_in_bands(params, job->height, smooth_band, job);
+    }
+
+    job->src = job->dst;
+    run_in_bands(params, job->height, unpack_band, job);
+}
+
+// Stage 3: clear the start area, the paths out of it and the exit corner.
+// Everything else is connected by the connectivity stage with as little
+// carving as possible.
+static void stage_carving(GameMap *map) {
+    int width = map->width;
+    int height = map->height;
+
+    // Ensure the player's starting position is clear
+    for (int y = 1; y < 8; y++) {
+        for (int x = 1; x < 8; x++) {
+            MAP_TILE(map, x, y) = TILE_EMPTY;
+        }
+    }
+
+    // Paths to the right of and below the starting area
+    for (int i = 8; i < 15; i++) {
+        MAP_TILE(map, i, 4) = TILE_EMPTY;
+        MAP_TILE(map, i, 5) = TILE_EMPTY;
+        MAP_TILE(map, 4, i) = TILE_EMPTY;
+        MAP_TILE(map, 5, i) = TILE_EMPTY;
+    }
+
+    // Clear the exit corner
+    MAP_TILE(map, width - 2, height - 2) = TILE_EMPTY;
+    MAP_TILE(map, width - 2, height - 3) = TILE_EMPTY;
+    MAP_TILE(map, width - 3, height - 2) = TILE_EMPTY;
+    MAP_TILE(map, width - 3, height - 3) = TILE_EMPTY;
+}
+
+// A horizontal run of walkable tiles, the unit of the component labeler
+typedef struct {
+    int x0;
+    int x1;    // Inclusive
+} TileRun;
+
+// Growable list of tile indices (frontiers of the repair search)
+typedef struct {
+    int *items;
+    size_t count;
+    size_t capacity;
+} IndexList;
+
+// Root of a union-find set, halving the path on the way
+static int uf_find(int *parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// Merge two union-find sets; the lower index stays the root
+static void uf_union(int *parent, int a, int b) {
+    a = uf_find(parent, a);
+    b = uf_find(parent, b);
+    if (a < b) {
+        parent[b] = a;
+    } else if (b < a) {
+        parent[a] = b;
+    }
+}
+
+// Run of row y that covers column x, or -1
+static int run_at(const TileRun *runs, const int *row_start, int x, int y) {
+    for (int r = row_start[y]; r < row_start[y + 1]; r++) {
+        if (runs[r].x0 <= x && x <= runs[r].x1) return r;
+    }
+    return -1;
+}
+
+// Append to an index list
+static bool index_list_push(IndexList *list, int index) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 4096;
+        int *items = realloc(list->items, sizeof(int) * capacity);
+        if (items == NULL) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = index;
+    return true;
+}
+
+// Label the walkable components of the map with union-find over row runs
+// (4-connected: runs of adjacent rows that overlap are merged). The start
+// area becomes MAP_COMPONENT_MAIN, components of at least
+// MAPGEN_MIN_CAVE_TILES tiles (and the exit corner) get 2..*last_cave, and
+// smaller pockets follow, sharing MAP_COMPONENT_POCKET once the label range
+// runs out. Returns the number of components, or -1 if memory runs out.
+static int label_components(const GameMap *map, unsigned short *labels, int *last_cave) {
+    int width = map->width;
+    int height = map->height;
+    int stride = map->stride;
+
+    int *row_start = malloc(sizeof(int) * (height + 1));
+    size_t capacity = (size_t)height * 8;
+    TileRun *runs = malloc(sizeof(TileRun) * capacity);
+    if (row_start == NULL || runs == NULL) {
+        free(row_start);
+        free(runs);
+        return -1;
+    }
+
+    // Collect the runs of every row
+    int num_runs = 0;
+    for (int y = 0; y < height; y++) {
+        row_start[y] = num_runs;
+        const MapTile *row = &MAP_TILE(map, 0, y);
+        for (int x = 0; x < width; x++) {
+            if (row[x] == TILE_WALL) continue;
+
+            int x0 = x;
+            while (x + 1 < width && row[x + 1] != TILE_WALL) x++;
+            if ((size_t)num_runs == capacity) {
+                capacity *= 2;
+                TileRun *grown = realloc(runs, sizeof(TileRun) * capacity);
+                if (grown == NULL) {
+                    free(row_start);
+                    free(runs);
+                    return -1;
+                }
+                runs = grown;
+            }
+            runs[num_runs].x0 = x0;
+            runs[num_runs].x1 = x;
+            num_runs++;
+        }
+    }
+    row_start[height] = num_runs;
+
+    int *parent = malloc(sizeof(int) * (num_runs > 0 ? num_runs : 1));
+    int *size = calloc(num_runs > 0 ? num_runs : 1, sizeof(int));
+    if (parent == NULL || size == NULL) {
+        free(row_start);
+        free(runs);
+        free(parent);
+        free(size);
+        return -1;
+    }
+
+    // Merge overlapping runs of adjacent rows
+    for (int r = 0; r < num_runs; r++) {
+        parent[r] = r;
+    }
+    for (int y = 1; y < height; y++) {
+        int a = row_start[y - 1], b = row_start[y];
+        while (a < row_start[y] && b < row_start[y + 1]) {
+            if (runs[a].x0 <= runs[b].x1 && runs[b].x0 <= runs[a].x1) {
+                uf_union(parent, a, b);
+            }
+            if (runs[a].x1 < runs[b].x1) a++; else b++;
+        }
+    }
+    for (int r = 0; r < num_runs; r++) {
+        size[uf_find(parent, r)] += runs[r].x1 - runs[r].x0 + 1;
+    }
+
+    // Number the components: the start first, then caves, then pockets
+    int start_run = run_at(runs, row_start, 4, 4);
+    int exit_run = run_at(runs, row_start, width - 2, height - 2);
+    int start_root = start_run >= 0 ? uf_find(parent, start_run) : -1;
+    int exit_root = exit_run >= 0 ? uf_find(parent, exit_run) : -1;
+
+    // Sizes are replaced in place by the negated label of each root
+    int *id = size;
+    int next_id = MAP_COMPONENT_MAIN + 1;
+    int components = 0;
+    for (int r = 0; r < num_runs; r++) {
+        if (parent[r] != r) continue;
+        components++;
+        if (r != start_root && (r == exit_root || size[r] >= MAPGEN_MIN_CAVE_TILES)) {
+            id[r] = -(next_id < MAP_COMPONENT_POCKET ? next_id++ : MAP_COMPONENT_POCKET);
+        }
+    }
+    *last_cave = next_id - 1;
+    for (int r = 0; r < num_runs; r++) {
+        if (parent[r] == r && r != start_root && id[r] > 0) {
+            id[r] = -(next_id < MAP_COMPONENT_POCKET ? next_id++ : MAP_COMPONENT_POCKET);
+        }
+    }
+    if (start_root >= 0) id[start_root] = -MAP_COMPONENT_MAIN;
+
+    // Write the labels, walls included
+    for (int y = 0; y < height; y++) {
+        unsigned short *row = &labels[(size_t)y * stride];
+        memset(row, 0, sizeof(unsigned short) * width);
+        for (int r = row_start[y]; r < row_start[y + 1]; r++) {
+            unsigned short label = (unsigned short)-id[uf_find(parent, r)];
+            for (int x = runs[r].x0; x <= runs[r].x1; x++) {
+                row[x] = label;
+            }
+        }
+    }
+
+    free(row_start);
+    free(runs);
+    free(parent);
+    free(size);
+    return components;
+}
+
+// Give every tile of a sealed pocket the main label (it was opened up by a tunnel)
+static void absorb_pocket(const GameMap *map, unsigned short *labels, int index, IndexList *stack) {
+    unsigned short pocket = labels[index];
+    labels[index] = MAP_COMPONENT_MAIN;
+    stack->count = 0;
+    if (!index_list_push(stack, index)) return;
+
+    static const int step_x[4] = {1, -1, 0, 0};
+    static const int step_y[4] = {0, 0, 1, -1};
+    while (stack->count > 0) {
+        int i = stack->items[--stack->count];
+        int x = i % map->stride;
+        int y = i / map->stride;
+        for (int dir = 0; dir < 4; dir++) {
+            int n = (y + step_y[dir]) * map->stride + x + step_x[dir];
+            if (labels[n] == pocket && MAP_TILE(map, x + step_x[dir], y + step_y[dir]) != TILE_WALL) {
+                labels[n] = MAP_COMPONENT_MAIN;
+                if (!index_list_push(stack, n)) return;
+            }
+        }
+    }
+}
+
+// Stage 3b: connect every cave to the start with the fewest carved walls. A
+// 0-1 breadth-first search runs outward from the start component (walls cost
+// one, floor costs nothing); the first time it reaches a cave, the walls on
+// its path back are carved. Later paths stop at the first tile that is
+// already connected, so tunnels are shared. Small pockets stay sealed and
+// keep their own labels. Returns false if memory runs out.
+static bool stage_connectivity(MapGenRng *rng, GameMap *map, const MapGenParams *params,
+                               unsigned short *labels, MapGenStats *stats) {
+    int last_cave = MAP_COMPONENT_MAIN;
+    int components = label_components(map, labels, &last_cave);
+    if (components < 0) return false;
+
+    int width = map->width;
+    int height = map->height;
+    int stride = map->stride;
+    int caves_left = last_cave - MAP_COMPONENT_MAIN;
+    int carved = 0;
+
+    if (caves_left > 0) {
+        size_t cells = MAP_CELLS(map);
+        unsigned short *cost = malloc(sizeof(unsigned short) * cells);
+        unsigned char *from = malloc(cells);
+        bool *joined = calloc(last_cave + 1, sizeof(bool));
+        IndexList current = {NULL, 0, 0}, next = {NULL, 0, 0}, stack = {NULL, 0, 0}, opened = {NULL, 0, 0};
+        bool ok = cost != NULL && from != NULL && joined != NULL;
+
+        static const int step_x[4] = {1, -1, 0, 0};
+        static const int step_y[4] = {0, 0, 1, -1};
+        if (ok) {
+            memset(cost, 0xFF, sizeof(unsigned short) * cells);
+            for (int y = 1; y < height - 1 && ok; y++) {
+                for (int x = 1; x < width - 1 && ok; x++) {
+                    int i = y * stride + x;
+                    if (labels[i] == MAP_COMPONENT_MAIN) {
+                        cost[i] = 0;
+                        ok = index_list_push(&current, i);
+                    }
+                }
+            }
+        }
+
+        for (int level = 0; ok && current.count > 0 && caves_left > 0; level++) {
+            for (size_t k = 0; k < current.count && ok && caves_left > 0; k++) {
+                int i = current.items[k];
+                if (cost[i] != level) continue;
+
+                int label = labels[i];
+                if (label > MAP_COMPONENT_MAIN && label <= last_cave && !joined[label]) {
+                    // First tile of this cave: carve the path back to connected ground
+                    joined[label] = true;
+                    caves_left--;
+                    for (int p = i; cost[p] > 0 || labels[p] != MAP_COMPONENT_MAIN;) {
+                        int l = labels[p];
+                        if (l != label && (l == MAP_COMPONENT_MAIN || (l <= last_cave && joined[l]))) break;
+
+                        int x = p % stride, y = p / stride;
+                        if (MAP_TILE(map, x, y) == TILE_WALL) {
+                            MAP_TILE(map, x, y) = rng_range(rng, 100) < params->path_door_chance ? TILE_DOOR : TILE_EMPTY;
+                            labels[p] = MAP_COMPONENT_MAIN;
+                            carved++;
+                            // Pockets the tunnel brushes past are opened up too
+                            for (int dir = 0; dir < 4 && ok; dir++) {
+                                int n = p + step_y[dir] * stride + step_x[dir];
+                                if (labels[n] > last_cave) ok = index_list_push(&opened, n);
+                            }
+                        } else if (l > last_cave) {
+                            ok = index_list_push(&opened, p);
+                        }
+                        p -= step_y[from[p]] * stride + step_x[from[p]];
+                    }
+
+                    // Relabel opened pockets only now, so the walk above
+                    // does not mistake them for connected ground
+                    for (size_t o = 0; o < opened.count; o++) {
+                        if (labels[opened.items[o]] > last_cave) {
+                            absorb_pocket(map, labels, opened.items[o], &stack);
+                        }
+                    }
+                    opened.count = 0;
+                }
+
+                int x = i % stride, y = i / stride;
+                for (int dir = 0; dir < 4 && ok; dir++) {
+                    int nx = x + step_x[dir], ny = y + step_y[dir];
+                    if (nx <= 0 || ny <= 0 || nx >= width - 1 || ny >= height - 1) continue;
+
+                    int n = ny * stride + nx;
+                    bool wall = MAP_TILE(map, nx, ny) == TILE_WALL;
+                    int c = level + (wall ? 1 : 0);
+                    if (c < cost[n]) {
+                        cost[n] = (unsigned short)c;
+                        from[n] = (unsigned char)dir;
+                        ok = index_list_push(wall ? &next : &current, n);
+                    }
+                }
+            }
+
+            IndexList swap = current;
+            current = next;
+            next = swap;
+            next.count = 0;
+        }
+
+        // Every cave now hangs off the start component
+        for (size_t i = 0; ok && i < cells; i++) {
+            if (labels[i] > MAP_COMPONENT_MAIN && labels[i] <= last_cave) {
+                labels[i] = MAP_COMPONENT_MAIN;
+            }
+        }
+
+        free(cost);
+        free(from);
+        free(joined);
+        free(current.items);
+        free(next.items);
+        free(stack.items);
+        free(opened.items);
+        if (!ok) {
+            perror("mapgen connectivity search allocation failed");
+            return false;
+        }
+    }
+
+    if (stats != NULL) {
+        stats->components = components;
+        stats->tiles_carved = carved;
+    }
+    return true;
+}
+
+// Set a tile and keep the free-cell index in step
+static inline void place_tile(GameMap *map, FreeCellIndex *index, int x, int y, MapTile tile) {
+    MAP_TILE(map, x, y) = tile;
+    freecells_update(index, map, x, y);
+}
+
+// Stage 4: doors, the exit, keys and treasures. Every random site is drawn
+// from the free-cell index of reachable empty floor, so each item lands on
+// the first draw and nothing is placed twice on the same tile. map->components
+// must hold the final labels.
+static void stage_placement(MapGenRng *rng, GameMap *map, const MapGenParams *params,
+                            FreeCellIndex *index, int num_keys) {
+    int width = map->width;
+    int height = map->height;
+    unsigned int pick = rng_next(rng) | 1;
+    FreeCellFilter filter;
+    int x, y;
+
+    // A door at the end of each starting path, and the exit
+    place_tile(map, index, 14, 4, TILE_DOOR);
+    place_tile(map, index, 4, 14, TILE_DOOR);
+    place_tile(map, index, width - 2, height - 2, TILE_EXIT);
+
+    // Keys away from the starting corner; mostly solid maps fall back to
+    // anywhere reachable
+    freecells_filter_all(map, &filter);
+    filter.min_x = 20;
+    filter.min_y = 20;
+    filter.max_x = width - 6;
+    filter.max_y = height - 6;
+    for (int i = 0; i < num_keys; i++) {
+        if (freecells_sample(index, map, &filter, &pick, &x, &y) ||
+            freecells_sample(index, map, NULL, &pick, &x, &y)) {
+            place_tile(map, index, x, y, TILE_KEY);
+        }
+    }
+
+    // Doors that split the map into sections
+    filter.min_x = 15;
+    filter.min_y = 15;
+    filter.max_x = width - 11;
+    filter.max_y = height - 11;
+    for (int i = 0; i < params->section_doors; i++) {
+        if (freecells_sample(index, map, &filter, &pick, &x, &y)) {
+            place_tile(map, index, x, y, TILE_DOOR);
+        }
+    }
+
+    int divisor = params->treasure_divisor > 0 ? params->treasure_divisor : 400;
+    int num_treasures = width * height / divisor + params->extra_treasures;
+    for (int i = 0; i < num_treasures; i++) {
+        if (freecells_sample(index, map, NULL, &pick, &x, &y)) {
+            place_tile(map, index, x, y, TILE_TREASURE);
+        }
+    }
+}
+
+// Generate one level into a caller-provided map. map->tiles must hold
+// map->stride * height tiles with map->stride >= width; width and height are
+// stored in the map. Every cave is connected to the start; if
+// map->components is set, it receives the component label of every tile, and
+// map->free_cells, if set, indexes the free tiles of the new level. The output
+// depends only on the arguments: the same (seed, level, size, params) always
+// produces the same map. stats may be NULL.
+// Returns false if memory runs out.
+static bool generate_one(unsigned int seed, int level, int width, int height,
+                         const MapGenParams *params, GameMap *map, MapGenStats *stats) {
+    map->width = width;
+    map->height = height;
+
+    int num_keys = params->keys < 0 ? 0 : params->keys;
+    if (num_keys > MAPGEN_MAX_KEYS) num_keys = MAPGEN_MAX_KEYS;
+
+    unsigned long long key = level_key(seed, level);
+    MapGenRng rng = {key};
+
+    // Two wall masks for the noise and smoothing stages, plus the interior column mask
+    int words = (width + 63) / 64;
+    size_t mask_words = (size_t)words * height;
+    uint64_t *masks = malloc(sizeof(uint64_t) * (2 * mask_words + words));
+    if (masks == NULL) {
+        perror("mapgen wall mask allocation failed");
+        return false;
+    }
+
+    uint64_t *interior = masks + 2 * mask_words;
+    memset(interior, 0, sizeof(uint64_t) * words);
+    for (int x = 1; x < width - 1; x++) {
+        interior[x >> 6] |= (uint64_t)1 << (x & 63);
+    }
+
+    int wall_chance = params->wall_chance < 0 ? 0 : params->wall_chance > 100 ? 100 : params->wall_chance;
+    MaskJob job = {width, height, words, key, (unsigned int)(wall_chance * 65536 / 100),
+                   map->tiles, map->stride, NULL, masks, interior};
+
+    double t0 = stats ? now_ms() : 0;
+    run_in_bands(params, height, noise_band, &job);
+    double t1 = stats ? now_ms() : 0;
+    stage_smoothing(&job, masks, mask_words, params);
+    free(masks);
+    double t2 = stats ? now_ms() : 0;
+
+    // Component labels go to the map if it keeps them, else to scratch memory
+    unsigned short *labels = map->components;
+    if (labels == NULL) {
+        labels = malloc(sizeof(unsigned short) * MAP_CELLS(map));
+        if (labels == NULL) {
+            perror("mapgen component label allocation failed");
+            return false;
+        }
+    }
+    stage_carving(map);
+    bool connected = stage_connectivity(&rng, map, params, labels, stats);
+    double t3 = stats ? now_ms() : 0;
+    if (connected) {
+        // Placement samples from the map's own free-cell index if it keeps
+        // one (leaving it current), else from a scratch one
+        FreeCellIndex *index = map->free_cells ? map->free_cells : freecells_alloc(width, height);
+        if (index != NULL) {
+            GameMap view = *map;
+            view.components = labels;
+            freecells_rebuild(index, &view);
+            stage_placement(&rng, &view, params, index, num_keys);
+            if (index != map->free_cells) free(index);
+        } else {
+            connected = false;
+        }
+    }
+    double t4 = stats ? now_ms() : 0;
+    if (labels != map->components) {
+        free(labels);
+    }
+    if (!connected) {
+        return false;
+    }
+
+    if (stats != NULL) {
+        stats->noise_ms = t1 - t0;
+        stats->smoothing_ms = t2 - t1;
+        stats->carving_ms = t3 - t2;
+        stats->placement_ms = t4 - t3;
+    }
+    return true;
+}
+
+// Enemy spawn region r (0..3) of a map, the same regions create_enemy_processes
+// places enemies in (half-open bounds)
+static void spawn_region(int width, int height, int r, int *x0, int *y0, int *x1, int *y1) {
+    int span_x = width * 3 / 16;
+    int span_y = height * 3 / 16;
+    switch (r) {
+        case 0: *x0 = width - span_x - 5; *x1 = width - 5; *y0 = 5; *y1 = span_y; break;
+        case 1: *x0 = width - span_x - 5; *x1 = width - 5; *y0 = height - span_y; *y1 = height - 5; break;
+        case 2: *x0 = 5; *x1 = span_x; *y0 = height - span_y; *y1 = height - 5; break;
+        default: *x0 = width * 3 / 4; *x1 = width - 5; *y0 = height / 2 - 5; *y1 = height / 2 + 5; break;
+    }
+}
+
+// Score a generated level with cheap metrics: one breadth-first search from
+// the start (frontier lists and a visited bitmap, so it stays small on large
+// maps) and one scan of the tiles. quality may be NULL. Returns the score,
+// 0 if a key or the exit cannot be reached or memory runs out.
+double mapgen_score(const GameMap *map, MapGenQuality *quality) {
+    MapGenQuality q;
+    memset(&q, 0, sizeof(q));
+    int width = map->width;
+    int height = map->height;
+    size_t cells = MAP_CELLS(map);
+
+    // Keys, and floor tiles with a single way out
+    int key_x[MAPGEN_MAX_KEYS], key_y[MAPGEN_MAX_KEYS];
+    int num_keys = 0;
+    long floor_tiles = 0, dead_ends = 0;
+    for (int y = 1; y < height - 1; y++) {
+        for (int x = 1; x < width - 1; x++) {
+            MapTile tile = MAP_TILE(map, x, y);
+            if (tile == TILE_WALL) continue;
+            floor_tiles++;
+            int exits = (MAP_TILE(map, x - 1, y) != TILE_WALL) + (MAP_TILE(map, x + 1, y) != TILE_WALL) +
+                        (MAP_TILE(map, x, y - 1) != TILE_WALL) + (MAP_TILE(map, x, y + 1) != TILE_WALL);
+            if (exits == 1) dead_ends++;
+            if (tile == TILE_KEY && num_keys < MAPGEN_MAX_KEYS) {
+                key_x[num_keys] = x;
+                key_y[num_keys] = y;
+                num_keys++;
+            }
+        }
+    }
+
+    // Walking distances from the start, one frontier at a time
+    uint64_t *visited = calloc((cells + 63) / 64, sizeof(uint64_t));
+    IndexList current = {NULL, 0, 0}, next = {NULL, 0, 0};
+    bool ok = visited != NULL && index_list_push(&current, 2 * map->stride + 2);
+    if (ok) visited[(2 * map->stride + 2) >> 6] |= (uint64_t)1 << ((2 * map->stride + 2) & 63);
+
+    static const int step_x[4] = {1, -1, 0, 0};
+    static const int step_y[4] = {0, 0, 1, -1};
+    int exit_index = (height - 2) * map->stride + (width - 2);
+    long exit_distance = -1, key_distance_sum = 0;
+    int keys_reached = 0;
+    for (long distance = 0; ok && current.count > 0; distance++) {
+        next.count = 0;
+        for (size_t i = 0; i < current.count && ok; i++) {
+            int index = current.items[i];
+            if (index == exit_index) exit_distance = distance;
+            if (map->tiles[index] == TILE_KEY) {
+                key_distance_sum += distance;
+                keys_reached++;
+            }
+            int x = index % map->stride;
+            int y = index / map->stride;
+            for (int dir = 0; dir < 4; dir++) {
+                int nx = x + step_x[dir];
+                int ny = y + step_y[dir];
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+                int n = ny * map->stride + nx;
+                uint64_t bit = (uint64_t)1 << (n & 63);
+                if ((visited[n >> 6] & bit) || map->tiles[n] == TILE_WALL) continue;
+                visited[n >> 6] |= bit;
+                ok = index_list_push(&next, n);
+            }
+        }
+        IndexList swap = current;
+        current = next;
+        next = swap;
+    }
+    free(current.items);
+    free(next.items);
+
+    // Reachable floor in each enemy spawn region
+    int regions_ok = 0;
+    for (int r = 0; ok && r < 4; r++) {
+        int x0, y0, x1, y1, reachable = 0;
+        spawn_region(width, height, r, &x0, &y0, &x1, &y1);
+        for (int y = y0 < 0 ? 0 : y0; y < y1 && y < height && reachable < MAPGEN_MIN_CAVE_TILES; y++) {
+            for (int x = x0 < 0 ? 0 : x0; x < x1 && x < width; x++) {
+                size_t i = (size_t)y * map->stride + x;
+                if ((visited[i >> 6] >> (i & 63)) & 1) reachable++;
+            }
+        }
+        if (reachable >= MAPGEN_MIN_CAVE_TILES) regions_ok++;
+    }
+    free(visited);
+
+    if (ok && exit_distance >= 0 && keys_reached == num_keys) {
+        double span = (double)(width + height);
+        double walk = exit_distance + (num_keys > 0 ? (double)key_distance_sum / num_keys : 0.0);
+        q.path = walk / (1.5 * span) > 1.0 ? 1.0 : walk / (1.5 * span);
+
+        double interior = (double)(width - 2) * (height - 2);
+        double open_ratio = floor_tiles / interior;
+        q.open_area = 1.0 - fabs(open_ratio - 0.5) / 0.5;
+        if (q.open_area < 0) q.open_area = 0;
+
+        // More than one dead end per 20 floor tiles scores zero
+        double density = floor_tiles > 0 ? (double)dead_ends * 20.0 / floor_tiles : 1.0;
+        q.dead_ends = density > 1.0 ? 0.0 : 1.0 - density;
+
+        // Mean nearest-neighbour distance against that of evenly spread keys
+        if (num_keys > 1) {
+            double sum = 0;
+            for (int i = 0; i < num_keys; i++) {
+                double nearest = span * span;
+                for (int j = 0; j < num_keys; j++) {
+                    if (j == i) continue;
+                    double dx = key_x[i] - key_x[j], dy = key_y[i] - key_y[j];
+                    double d = dx * dx + dy * dy;
+                    if (d < nearest) nearest = d;
+                }
+                sum += sqrt(nearest);
+            }
+            double expected = 0.5 * sqrt(interior / num_keys);
+            q.key_spread = sum / num_keys / expected > 1.0 ? 1.0 : sum / num_keys / expected;
+        } else {
+            q.key_spread = 1.0;
+        }
+
+        q.spawn_spread = regions_ok / 4.0;
+        q.score = 0.35 * q.path + 0.2 * q.open_area + 0.15 * q.dead_ends +
+                  0.15 * q.key_spread + 0.15 * q.spawn_spread;
+    }
+
+    if (quality != NULL) *quality = q;
+    return q.score;
+}
+
+// Shared state of a best-of-N run
+typedef struct {
+    unsigned int seed;
+    int level;
+    int width;
+    int height;
+    MapGenParams params;        // Per-candidate params (one thread, one candidate)
+    int candidates;
+    int budget_ms;
+    double start_ms;
+    int next;                   // Next candidate to build
+    pthread_mutex_t mutex;
+} CandidateRun;
+
+// One candidate thread: its best level so far and a buffer to build into
+typedef struct {
+    CandidateRun *run;
+    GameMap best;
+    GameMap scratch;
+    int best_index;             // -1 until a candidate was kept
+    double best_score;
+    MapGenStats best_stats;
+    int built;
+} CandidateWorker;
+
+// Seed of candidate i; candidate 0 is the plain (seed, level) level
+static unsigned int candidate_seed(unsigned int seed, int i) {
+    return i == 0 ? seed : (unsigned int)mix64(((unsigned long long)seed << 32) | (unsigned int)i);
+}
+
+// Build candidates until none are left or the budget is spent (candidate 0
+// is always built, so there is a level whatever the budget)
+static void *candidate_thread(void *arg) {
+    CandidateWorker *worker = (CandidateWorker *)arg;
+    CandidateRun *run = worker->run;
+
+    for (;;) {
+        pthread_mutex_lock(&run->mutex);
+        int index = run->next;
+        bool over_budget = run->budget_ms > 0 && now_ms() - run->start_ms >= run->budget_ms;
+        if (index >= run->candidates || (index > 0 && over_budget)) {
+            pthread_mutex_unlock(&run->mutex);
+            break;
+        }
+        run->next++;
+        pthread_mutex_unlock(&run->mutex);
+
+        MapGenStats stats;
+        memset(&stats, 0, sizeof(stats));
+        if (!generate_one(candidate_seed(run->seed, index), run->level, run->width, run->height,
+                          &run->params, &worker->scratch, &stats)) {
+            continue;
+        }
+        worker->built++;
+
+        // Ties go to the lower index, so an unlimited run is deterministic
+        double score = mapgen_score(&worker->scratch, NULL);
+        if (worker->best_index < 0 || score > worker->best_score ||
+            (score == worker->best_score && index < worker->best_index)) {
+            GameMap swap = worker->best;
+            worker->best = worker->scratch;
+            worker->scratch = swap;
+            worker->best_index = index;
+            worker->best_score = score;
+            worker->best_stats = stats;
+        }
+    }
+    return NULL;
+}
+
+// Allocate a candidate map buffer (tiles and labels)
+static bool alloc_candidate(GameMap *map, int width, int height) {
+    memset(map, 0, sizeof(*map));
+    map->width = width;
+    map->height = height;
+    map->stride = MAP_STRIDE_FOR(width);
+    map->tiles = malloc(sizeof(MapTile) * MAP_CELLS(map));
+    map->components = malloc(sizeof(unsigned short) * MAP_CELLS(map));
+    return map->tiles != NULL && map->components != NULL;
+}
+
+// Best-of-N generation: build params->candidates levels from seeds derived
+// from (seed, level) on parallel threads, each single-threaded, and keep the
+// one mapgen_score rates best. Without a budget the result depends only on
+// the arguments; with one, slower machines may compare fewer candidates.
+static bool generate_best(unsigned int seed, int level, int width, int height,
+                          const MapGenParams *params, GameMap *map, MapGenStats *stats) {
+    CandidateRun run;
+    run.seed = seed;
+    run.level = level;
+    run.width = width;
+    run.height = height;
+    run.params = *params;
+    run.params.threads = 1;
+    run.params.candidates = 1;
+    run.candidates = params->candidates > MAPGEN_MAX_CANDIDATES ? MAPGEN_MAX_CANDIDATES : params->candidates;
+    run.budget_ms = params->budget_ms;
+    run.start_ms = now_ms();
+    run.next = 0;
+    pthread_mutex_init(&run.mutex, NULL);
+
+    // One thread per CPU (or params->threads), as many as the scratch budget allows
+    int threads = params->threads;
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    size_t buffer_bytes = (sizeof(MapTile) + sizeof(unsigned short)) * (size_t)MAP_STRIDE_FOR(width) * height;
+    size_t memory_limit = MAPGEN_CANDIDATE_MAX_BYTES / (2 * buffer_bytes);
+    if (threads > MAPGEN_MAX_THREADS) threads = MAPGEN_MAX_THREADS;
+    if (threads > run.candidates) threads = run.candidates;
+    if ((size_t)threads > memory_limit) threads = (int)memory_limit;
+    if (threads < 1) threads = 1;
+
+    CandidateWorker workers[MAPGEN_MAX_THREADS];
+    pthread_t ids[MAPGEN_MAX_THREADS];
+    bool started[MAPGEN_MAX_THREADS] = {false};
+    int ready = 0;
+    for (; ready < threads; ready++) {
+        CandidateWorker *worker = &workers[ready];
+        worker->run = &run;
+        worker->best_index = -1;
+        worker->best_score = 0;
+        worker->built = 0;
+        if (!alloc_candidate(&worker->best, width, height) || !alloc_candidate(&worker->scratch, width, height)) {
+            free(worker->best.tiles);
+            free(worker->best.components);
+            free(worker->scratch.tiles);
+            free(worker->scratch.components);
+            break;
+        }
+    }
+    if (ready == 0) {
+        perror("mapgen candidate allocation failed");
+        pthread_mutex_destroy(&run.mutex);
+        return false;
+    }
+
+    // The calling thread works too, and takes over any thread that fails to start
+    for (int i = 1; i < ready; i++) {
+        started[i] = pthread_create(&ids[i], NULL, candidate_thread, &workers[i]) == 0;
+    }
+    candidate_thread(&workers[0]);
+    for (int i = 1; i < ready; i++) {
+        if (started[i]) pthread_join(ids[i], NULL);
+    }
+    pthread_mutex_destroy(&run.mutex);
+
+    // Keep the best candidate of all threads
+    CandidateWorker *winner = NULL;
+    int built = 0;
+    for (int i = 0; i < ready; i++) {
+        built += workers[i].built;
+        if (workers[i].best_index < 0) continue;
+        if (winner == NULL || workers[i].best_score > winner->best_score ||
+            (workers[i].best_score == winner->best_score && workers[i].best_index < winner->best_index)) {
+            winner = &workers[i];
+        }
+    }
+
+    if (winner != NULL) {
+        map->width = width;
+        map->height = height;
+        for (int y = 0; y < height; y++) {
+            memcpy(&MAP_TILE(map, 0, y), &MAP_TILE(&winner->best, 0, y), sizeof(MapTile) * width);
+            if (map->components != NULL) {
+                memcpy(map->components + (size_t)y * map->stride,
+                       winner->best.components + (size_t)y * winner->best.stride,
+                       sizeof(unsigned short) * width);
+            }
+        }
+        if (map->free_cells != NULL) freecells_rebuild(map->free_cells, map);
+        if (stats != NULL) {
+            *stats = winner->best_stats;
+            stats->candidates = built;
+            stats->quality = winner->best_score;
+        }
+    }
+
+    for (int i = 0; i < ready; i++) {
+        free(workers[i].best.tiles);
+        free(workers[i].best.components);
+        free(workers[i].scratch.tiles);
+        free(workers[i].scratch.components);
+    }
+    return winner != NULL;
+}
+
+// Generate a level into a caller-provided map (see generate_one); with
+// params->candidates > 1, the best of that many candidates (see
+// generate_best). Returns false if the arguments are invalid or memory runs out.
+bool mapgen_generate(unsigned int seed, int level, int width, int height,
+                     const MapGenParams *params, GameMap *map, MapGenStats *stats) {
+    if (params == NULL || map == NULL || map->tiles == NULL) {
+        printf("Error: mapgen_generate called without params or map\n");
+        return false;
+    }
+    if (width < MAPGEN_MIN_SIZE || height < MAPGEN_MIN_SIZE || map->stride < width) {
+        printf("Error: map size %dx%d (stride %d) is not valid (minimum %d)\n",
+               width, height, map->stride, MAPGEN_MIN_SIZE);
+        return false;
+    }
+
+    if (params->candidates > 1) {
+        return generate_best(seed, level, width, height, params, map, stats);
+    }
+    if (!generate_one(seed, level, width, height, params, map, stats)) {
+        return false;
+    }
+    if (stats != NULL) {
+        stats->candidates = 1;
+        stats->quality = mapgen_score(map, NULL);
+    }
+    return true;
+}
+
+// Streamed levels: instead of one map, every MAPGEN_CHUNK_SIZE square chunk is
+// generated on its own from its position. Every rule below is a function of
+// world coordinates, so neighbouring chunks agree on the tiles they share no
+// matter in which order (or in which process) they are generated.
+
+// Random stream tags of the streamed layout
+#define STREAM_ROW_TAG      0x524F57ULL
+#define STREAM_COLUMN_TAG   0x434F4CULL
+#define STREAM_DOOR_TAG     0x444F4FULL
+#define STREAM_TREASURE_TAG 0x545245ULL
+#define STREAM_KEY_TAG      0x4B4559ULL
+
+// Most smoothing passes a chunk can take (each needs one tile of apron)
+#define STREAM_MAX_PASSES 8
+#define STREAM_GRID (MAPGEN_CHUNK_SIZE + 2 * STREAM_MAX_PASSES)
+
+// Seed a tile as wall or floor, as the noise stage does for whole maps
+static inline MapTile streamed_noise(unsigned long long key, unsigned int threshold,
+                                     int width, int height, int x, int y) {
+    if (x <= 0 || y <= 0 || x >= width - 1 || y >= height - 1) return TILE_WALL;
+    if (x < 5 && y < 5) return TILE_EMPTY;  // Keep starting area clear
+    unsigned long long h = mix64(key ^ ((unsigned long long)y * (unsigned int)width + (unsigned int)x));
+    return (unsigned int)(h & 0xFFFF) < threshold ? TILE_WALL : TILE_EMPTY;
+}
+
+// First row (or column) of the two-tile corridor crossing a chunk row (or
+// column), or -1 if the chunk is too thin for one. The first chunk row and
+// column run through the starting area; corridors span the whole level, so
+// every chunk is reachable from the start.
+static int streamed_corridor(unsigned long long key, unsigned long long tag, int chunk, int size) {
+    if (chunk == 0) return 4;
+    int origin = chunk * MAPGEN_CHUNK_SIZE;
+    int extent = size - 1 - origin;
+    if (extent > MAPGEN_CHUNK_SIZE) extent = MAPGEN_CHUNK_SIZE;
+    if (extent < 6) return -1;
+    unsigned long long h = mix64(key ^ (tag << 40) ^ (unsigned long long)chunk);
+    return origin + 2 + (int)(h % (unsigned long long)(extent - 4));
+}
+
+// Column where the path from the exit meets the corridor network
+static int streamed_exit_path_start(unsigned long long key, int width) {
+    for (int chunk = (width - 3) / MAPGEN_CHUNK_SIZE; chunk > 0; chunk--) {
+        int column = streamed_corridor(key, STREAM_COLUMN_TAG, chunk, width);
+        if (column >= 0 && column <= width - 3) return column;
+    }
+    return 4;
+}
+
+// Pick the key sites of a streamed level: distinct corridor tiles away from
+// the starting corner. Returns the number of sites written.
+int mapgen_chunk_key_sites(unsigned int seed, int level, int width, int height,
+                           int keys, int *site_x, int *site_y) {
+    if (site_x == NULL || site_y == NULL || width < MAPGEN_MIN_SIZE || height < MAPGEN_MIN_SIZE) {
+        return 0;
+    }
+    if (keys < 0) keys = 0;
+    if (keys > MAPGEN_MAX_KEYS) keys = MAPGEN_MAX_KEYS;
+
+    unsigned long long key = level_key(seed, level);
+    MapGenRng rng = {key ^ (STREAM_KEY_TAG << 40)};
+    int chunks_y = (height + MAPGEN_CHUNK_SIZE - 1) / MAPGEN_CHUNK_SIZE;
+
+    for (int i = 0; i < keys; i++) {
+        int x = 20 + i;
+        int y = 4;
+        for (int attempt = 0; attempt < 1000; attempt++) {
+            int row = streamed_corridor(key, STREAM_ROW_TAG, rng_range(&rng, chunks_y), height);
+            int candidate_x = 20 + rng_range(&rng, width - 25);
+            int candidate_y = row + rng_range(&rng, 2);
+            bool taken = row < 0;
+            for (int j = 0; j < i && !taken; j++) {
+                taken = site_x[j] == candidate_x && site_y[j] == candidate_y;
+            }
+            if (!taken) {
+                x = candidate_x;
+                y = candidate_y;
+                break;
+            }
+        }
+        site_x[i] = x;
+        site_y[i] = y;
+    }
+    return keys;
+}
+
+// Generate one chunk of a streamed level into tiles (MAPGEN_CHUNK_SIZE rows of
+// MAPGEN_CHUNK_SIZE tiles; tiles past the level edge are walls). The chunk
+// depends only on the arguments, so it can be regenerated whenever it has
+// been dropped. The smoothing passes run on the chunk plus an apron of one
+// tile per pass, which is exactly what the center needs to come out the same
+// as on a whole map. Open tiles the chunk's corridors cannot reach within the
+// chunk are walled in, so every open tile of the level is reachable from the
+// start. Returns false if the arguments are invalid.
+bool mapgen_generate_chunk(unsigned int seed, int level, int width, int height,
+                           const MapGenParams *params, const int *key_x, const int *key_y,
+                           int num_keys, int chunk_x, int chunk_y, MapTile *tiles) {
+    if (params == NULL || tiles == NULL || width < MAPGEN_MIN_SIZE || height < MAPGEN_MIN_SIZE ||
+        chunk_x < 0 || chunk_y < 0 || chunk_x * MAPGEN_CHUNK_SIZE >= width ||
+        chunk_y * MAPGEN_CHUNK_SIZE >= height) {
+        printf("Error: chunk (%d,%d) is outside a %dx%d level\n", chunk_x, chunk_y, width, height);
+        return false;
+    }
+
+    unsigned long long key = level_key(seed, level);
+    int wall_chance = params->wall_chance < 0 ? 0 : params->wall_chance > 100 ? 100 : params->wall_chance;
+    unsigned int threshold = (unsigned int)(wall_chance * 65536 / 100);
+    int passes = params->smoothing_passes < 0 ? 0 : params->smoothing_passes;
+    if (passes > STREAM_MAX_PASSES) passes = STREAM_MAX_PASSES;
+
+    // Stage 1 and 2: noise over the chunk and its apron, then smoothing. Each
+    // pass leaves one more ring of the apron stale, never the chunk itself.
+    static __thread MapTile grid[2][STREAM_GRID * STREAM_GRID];
+    int side = MAPGEN_CHUNK_SIZE + 2 * passes;
+    int origin_x = chunk_x * MAPGEN_CHUNK_SIZE - passes;
+    int origin_y = chunk_y * MAPGEN_CHUNK_SIZE - passes;
+
+    for (int gy = 0; gy < side; gy++) {
+        for (int gx = 0; gx < side; gx++) {
+            grid[0][gy * side + gx] = streamed_noise(key, threshold, width, height, origin_x + gx, origin_y + gy);
+        }
+    }
+
+    for (int pass = 0; pass < passes; pass++) {
+        const MapTile *src = grid[pass & 1];
+        MapTile *dst = grid[(pass + 1) & 1];
+        memcpy(dst, src, sizeof(MapTile) * side * side);
+        for (int gy = 1; gy < side - 1; gy++) {
+            int y = origin_y + gy;
+            if (y <= 0 || y >= height - 1) continue;
+            for (int gx = 1; gx < side - 1; gx++) {
+                int x = origin_x + gx;
+                if (x <= 0 || x >= width - 1) continue;
+
+                const MapTile *center = &src[gy * side + gx];
+                int walls = center[-side - 1] + center[-side] + center[-side + 1] +
+                            center[-1] + center[0] + center[1] +
+                            center[side - 1] + center[side] + center[side + 1];
+                if (walls >= 5) {
+                    dst[gy * side + gx] = TILE_WALL;
+                } else if (walls <= 2) {
+                    dst[gy * side + gx] = TILE_EMPTY;
+                }
+            }
+        }
+    }
+    const MapTile *smoothed = grid[passes & 1];
+
+    // Stage 3 and 4: corridors, the start area, the exit path, doors and treasures
+    int row = streamed_corridor(key, STREAM_ROW_TAG, chunk_y, height);
+    int column = streamed_corridor(key, STREAM_COLUMN_TAG, chunk_x, width);
+    int exit_path_x = streamed_exit_path_start(key, width);
+    int divisor = params->treasure_divisor > 0 ? params->treasure_divisor : 400;
+
+    for (int ty = 0; ty < MAPGEN_CHUNK_SIZE; ty++) {
+        int y = chunk_y * MAPGEN_CHUNK_SIZE + ty;
+        for (int tx = 0; tx < MAPGEN_CHUNK_SIZE; tx++) {
+            int x = chunk_x * MAPGEN_CHUNK_SIZE + tx;
+            MapTile *out = &tiles[ty * MAPGEN_CHUNK_SIZE + tx];
+            if (x <= 0 || y <= 0 || x >= width - 1 || y >= height - 1) {
+                *out = TILE_WALL;
+                continue;
+            }
+
+            MapTile tile = smoothed[(ty + passes) * side + tx + passes];
+            bool corridor = (row >= 0 && (y == row || y == row + 1)) ||
+                            (column >= 0 && (x == column || x == column + 1));
+            bool start = x < 8 && y < 8;
+            bool exit_path = y >= height - 3 && x >= exit_path_x;
+            unsigned long long h = mix64(key ^ ((unsigned long long)y * (unsigned int)width + (unsigned int)x) ^
+                                         (STREAM_DOOR_TAG << 40));
+
+            if (start || exit_path) {
+                tile = TILE_EMPTY;
+            } else if (corridor) {
+                tile = (int)(h % 100) < params->path_door_chance ? TILE_DOOR : TILE_EMPTY;
+            } else if (tile == TILE_EMPTY &&
+                       mix64(h ^ (STREAM_TREASURE_TAG << 40)) % (unsigned long long)divisor == 0) {
+                tile = TILE_TREASURE;
+            }
+            *out = tile;
+        }
+    }
+
+    int chunk_x0 = chunk_x * MAPGEN_CHUNK_SIZE;
+    int chunk_y0 = chunk_y * MAPGEN_CHUNK_SIZE;
+
+    // Stage 5: seal pockets. Streamed levels carry no component labels, so
+    // every open tile must be reachable: flood the chunk from its corridors,
+    // start area and exit path (which join the level-wide corridor network)
+    // and wall in whatever the flood misses. The flood never leaves the
+    // chunk, so the result still depends only on the chunk's position.
+    static __thread unsigned char reached[MAPGEN_CHUNK_SIZE * MAPGEN_CHUNK_SIZE];
+    static __thread unsigned short stack[MAPGEN_CHUNK_SIZE * MAPGEN_CHUNK_SIZE];
+    int count = 0;
+    memset(reached, 0, sizeof(reached));
+    for (int ty = 0; ty < MAPGEN_CHUNK_SIZE; ty++) {
+        int y = chunk_y0 + ty;
+        for (int tx = 0; tx < MAPGEN_CHUNK_SIZE; tx++) {
+            int x = chunk_x0 + tx;
+            int i = ty * MAPGEN_CHUNK_SIZE + tx;
+            bool corridor = (row >= 0 && (y == row || y == row + 1)) ||
+                            (column >= 0 && (x == column || x == column + 1));
+            bool start = x < 8 && y < 8;
+            bool exit_path = y >= height - 3 && x >= exit_path_x;
+            if (tiles[i] != TILE_WALL && (corridor || start || exit_path)) {
+                reached[i] = 1;
+                stack[count++] = (unsigned short)i;
+            }
+        }
+    }
+    while (count > 0) {
+        int i = stack[--count];
+        int tx = i % MAPGEN_CHUNK_SIZE;
+        int ty = i / MAPGEN_CHUNK_SIZE;
+        int neighbors[4] = {tx > 0 ? i - 1 : -1, tx < MAPGEN_CHUNK_SIZE - 1 ? i + 1 : -1,
+                            ty > 0 ? i - MAPGEN_CHUNK_SIZE : -1,
+                            ty < MAPGEN_CHUNK_SIZE - 1 ? i + MAPGEN_CHUNK_SIZE : -1};
+        for (int dir = 0; dir < 4; dir++) {
+            int n = neighbors[dir];
+            if (n >= 0 && !reached[n] && tiles[n] != TILE_WALL) {
+                reached[n] = 1;
+                stack[count++] = (unsigned short)n;
+            }
+        }
+    }
+    for (int i = 0; i < MAPGEN_CHUNK_SIZE * MAPGEN_CHUNK_SIZE; i++) {
+        if (!reached[i]) tiles[i] = TILE_WALL;
+    }
+
+    // A door at the end of each starting path, the exit and the keys
+    if (chunk_x == 0 && chunk_y == 0) {
+        tiles[4 * MAPGEN_CHUNK_SIZE + 14] = TILE_DOOR;
+        tiles[14 * MAPGEN_CHUNK_SIZE + 4] = TILE_DOOR;
+    }
+    if ((width - 2) / MAPGEN_CHUNK_SIZE == chunk_x && (height - 2) / MAPGEN_CHUNK_SIZE == chunk_y) {
+        tiles[(height - 2 - chunk_y0) * MAPGEN_CHUNK_SIZE + (width - 2 - chunk_x0)] = TILE_EXIT;
+    }
+    for (int i = 0; i < num_keys && key_x != NULL && key_y != NULL; i++) {
+        int tx = key_x[i] - chunk_x0;
+        int ty = key_y[i] - chunk_y0;
+        if (tx >= 0 && tx < MAPGEN_CHUNK_SIZE && ty >= 0 && ty < MAPGEN_CHUNK_SIZE) {
+            tiles[ty * MAPGEN_CHUNK_SIZE + tx] = TILE_KEY;
+        }
+    }
+    return true;
+}
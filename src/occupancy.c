@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <string.h>
+#include "../include/occupancy.h"
+
+// Check whether an entity id matches a kind filter
+static bool entity_matches(int entity_id, int kinds) {
+    if (entity_id < MAX_PLAYERS) {
+        return (kinds & OCCUPANCY_PLAYERS) != 0;
+    }
+    return (kinds & OCCUPANCY_ENEMIES) != 0;
+}
+
+// Keep query results in ascending entity id order so callers draw and
+// resolve collisions in the same order as a plain array walk would
+static void sort_entity_ids(int *ids, int count) {
+    for (int i = 1; i < count; i++) {
+        int id = ids[i];
+        int j = i - 1;
+        while (j >= 0 && ids[j] > id) {
+            ids[j + 1] = ids[j];
+            j--;
+        }
+        ids[j + 1] = id;
+    }
+}
+
+// Reset the grid so that no entity is linked anywhere
+void occupancy_clear(GameState *state) {
+    if (state == NULL) return;
+
+    OccupancyGrid *grid = &state->occupancy;
+    memset(grid->head, 0, sizeof(grid->head));
+    memset(grid->next, 0, sizeof(grid->next));
+    memset(grid->cell_x, 0, sizeof(grid->cell_x));
+    memset(grid->cell_y, 0, sizeof(grid->cell_y));
+    memset(grid->linked, 0, sizeof(grid->linked));
+}
+
+// Bucket a tile hashes to
+static inline int tile_bucket(int x, int y) {
+    unsigned int hash = (unsigned int)x * 0x9E3779B1u ^ (unsigned int)y * 0x85EBCA77u;
+    return (int)((hash >> 16) & (OCCUPANCY_BUCKETS - 1));
+}
+
+// Whether an entity in a bucket list actually stands on the tile
+static inline bool entity_on(const GameState *state, int entity_id, int x, int y) {
+    return state->occupancy.cell_x[entity_id] == x && state->occupancy.cell_y[entity_id] == y;
+}
+
+// Unlink an entity from the tile it is currently standing on
+void occupancy_remove(GameState *state, int entity_id) {
+    if (state == NULL || entity_id < 0 || entity_id >= MAX_ENTITIES) return;
+
+    OccupancyGrid *grid = &state->occupancy;
+    if (!grid->linked[entity_id]) return;
+
+    short *link = &grid->head[tile_bucket(grid->cell_x[entity_id], grid->cell_y[entity_id])];
+    while (*link != 0) {
+        if (*link - 1 == entity_id) {
+            *link = grid->next[entity_id];
+            break;
+        }
+        link = &grid->next[*link - 1];
+    }
+
+    grid->next[entity_id] = 0;
+    grid->linked[entity_id] = false;
+}
+
+// Move an entity to a new tile (links it if it was not in the grid yet)
+void occupancy_move(GameState *state, int entity_id, int x, int y) {
+    if (state == NULL || entity_id < 0 || entity_id >= MAX_ENTITIES) return;
+    if (x < 0 || x >= state->map.width || y < 0 || y >= state->map.height) {
+        fprintf(stderr, "Warning: entity %d moved off the occupancy grid (%d,%d)\n", entity_id, x, y);
+        return;
+    }
+
+    OccupancyGrid *grid = &state->occupancy;
+    if (grid->linked[entity_id] && grid->cell_x[entity_id] == x && grid->cell_y[entity_id] == y) {
+        return;
+    }
+
+    occupancy_remove(state, entity_id);
+
+    short *head = &grid->head[tile_bucket(x, y)];
+    grid->next[entity_id] = *head;
+    *head = (short)(entity_id + 1);
+    grid->cell_x[entity_id] = (short)x;
+    grid->cell_y[entity_id] = (short)y;
+    grid->linked[entity_id] = true;
+}
+
+// Check whether any enemy stands on a tile
+bool occupancy_has_enemy(const GameState *state, int x, int y) {
+    if (state == NULL || x < 0 || x >= state->map.width || y < 0 || y >= state->map.height) return false;
+
+    for (int link = state->occupancy.head[tile_bucket(x, y)]; link != 0; link = state->occupancy.next[link - 1]) {
+        if (link - 1 >= MAX_PLAYERS && entity_on(state, link - 1, x, y)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Collect the entities standing on a single tile
+int occupancy_entities_at(const GameState *state, int x, int y, int kinds, int *out, int max_out) {
+    return occupancy_query_rect(state, x, y, 1, 1, kinds, out, max_out);
+}
+
+// Collect the entities inside a tile rectangle (e.g. the visible viewport).
+// Small rectangles are looked up tile by tile in the hash buckets; larger
+// ones (more tiles than there are entities) walk the linked entities instead,
+// so a query never costs more than a scan of MAX_ENTITIES.
+int occupancy_query_rect(const GameState *state, int x, int y, int w, int h, int kinds, int *out, int max_out) {
+    if (state == NULL || out == NULL || max_out <= 0) return 0;
+
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + w > state->map.width ? state->map.width : x + w;
+    int y1 = y + h > state->map.height ? state->map.height : y + h;
+    if (x1 <= x0 || y1 <= y0) return 0;
+
+    int count = 0;
+    if ((long)(x1 - x0) * (y1 - y0) > MAX_ENTITIES) {
+        const OccupancyGrid *grid = &state->occupancy;
+        for (int id = 0; id < MAX_ENTITIES && count < max_out; id++) {
+            if (grid->linked[id] && entity_matches(id, kinds) &&
+                grid->cell_x[id] >= x0 && grid->cell_x[id] < x1 &&
+                grid->cell_y[id] >= y0 && grid->cell_y[id] < y1) {
+                out[count++] = id;
+            }
+        }
+        return count;
+    }
+
+    for (int ty = y0; ty < y1; ty++) {
+        for (int tx = x0; tx < x1; tx++) {
+            for (int link = state->occupancy.head[tile_bucket(tx, ty)]; link != 0; link = state->occupancy.next[link - 1]) {
+                if (entity_matches(link - 1, kinds) && entity_on(state, link - 1, tx, ty) && count < max_out) {
+                    out[count++] = link - 1;
+                }
+            }
+        }
+    }
+
+    sort_entity_ids(out, count);
+    return count;
+}
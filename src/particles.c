@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/particles.h"
+
+// Four float lanes, mapped by GCC onto SSE on x86-64 and NEON on ARM
+typedef float v4sf __attribute__((vector_size(16)));
+typedef int v4si __attribute__((vector_size(16)));
+
+#define SPLATF(v) ((v4sf){(v), (v), (v), (v)})
+
+static inline v4sf load4(const float *p) {
+    v4sf v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void store4(float *p, v4sf v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+// Allocate room for capacity particles (rounded up to whole lanes)
+bool particles_init(ParticleSystem *ps, int capacity) {
+    memset(ps, 0, sizeof(*ps));
+    capacity = (capacity + PARTICLE_LANES - 1) / PARTICLE_LANES * PARTICLE_LANES;
+
+    ps->x = calloc(capacity, sizeof(float));
+    ps->y = calloc(capacity, sizeof(float));
+    ps->prev_x = calloc(capacity, sizeof(float));
+    ps->prev_y = calloc(capacity, sizeof(float));
+    ps->vx = calloc(capacity, sizeof(float));
+    ps->vy = calloc(capacity, sizeof(float));
+    ps->life = calloc(capacity, sizeof(float));
+    ps->max_life = calloc(capacity, sizeof(float));
+    ps->color = calloc(capacity, sizeof(SDL_Color));
+    ps->size = calloc(capacity, sizeof(unsigned char));
+
+    if (!ps->x || !ps->y || !ps->prev_x || !ps->prev_y || !ps->vx || !ps->vy ||
+        !ps->life || !ps->max_life || !ps->color || !ps->size) {
+        perror("Failed to allocate particles");
+        particles_free(ps);
+        return false;
+    }
+    ps->capacity = capacity;
+    return true;
+}
+
+// Free the particle arrays
+void particles_free(ParticleSystem *ps) {
+    free(ps->x);
+    free(ps->y);
+    free(ps->prev_x);
+    free(ps->prev_y);
+    free(ps->vx);
+    free(ps->vy);
+    free(ps->life);
+    free(ps->max_life);
+    free(ps->color);
+    free(ps->size);
+    memset(ps, 0, sizeof(*ps));
+}
+
+// Add a particle at (x, y) after the live ones; false if the system is full
+bool particles_spawn(ParticleSystem *ps, float x, float y, SDL_Color color, ParticleKind kind) {
+    if (ps->count >= ps->capacity) return false;
+
+    int i = ps->count++;
+    ps->x[i] = x;
+    ps->y[i] = y;
+    ps->prev_x[i] = x;
+    ps->prev_y[i] = y;
+    ps->color[i] = color;
+
+    switch (kind) {
+        case PARTICLE_EXPLOSION:
+            ps->vx[i] = (rand() % 100 - 50) / 25.0f;
+            ps->vy[i] = (rand() % 100 - 50) / 25.0f;
+            ps->size[i] = (unsigned char)(3 + (rand() % 3));
+            ps->max_life[i] = 0.5f + (rand() % 100) / 200.0f;
+            break;
+        case PARTICLE_TRAIL:
+            ps->vx[i] = (rand() % 60 - 30) / 100.0f;
+            ps->vy[i] = (rand() % 60 - 30) / 100.0f - 0.2f; // Upward bias
+            ps->size[i] = (unsigned char)(2 + (rand() % 2));
+            ps->max_life[i] = 0.3f + (rand() % 100) / 500.0f;
+            break;
+        case PARTICLE_SPARKLE:
+            ps->vx[i] = 0;
+            ps->vy[i] = 0;
+            ps->size[i] = (unsigned char)(1 + (rand() % 2));
+            ps->max_life[i] = 0.2f + (rand() % 100) / 500.0f;
+            break;
+    }
+    ps->life[i] = ps->max_life[i];
+    return true;
+}
+
+// Replace every dead particle with the last live one
+static void remove_dead(ParticleSystem *ps) {
+    int i = 0;
+    while (i < ps->count) {
+        if (ps->life[i] > 0) {
+            i++;
+            continue;
+        }
+        int last = --ps->count;
+        ps->x[i] = ps->x[last];
+        ps->y[i] = ps->y[last];
+        ps->prev_x[i] = ps->prev_x[last];
+        ps->prev_y[i] = ps->prev_y[last];
+        ps->vx[i] = ps->vx[last];
+        ps->vy[i] = ps->vy[last];
+        ps->life[i] = ps->life[last];
+        ps->max_life[i] = ps->max_life[last];
+        ps->color[i] = ps->color[last];
+        ps->size[i] = ps->size[last];
+    }
+}
+
+// Advance one particle by a tick
+static inline bool update_one(ParticleSystem *ps, int i, float dt) {
+    ps->life[i] -= dt;
+    ps->prev_x[i] = ps->x[i];
+    ps->prev_y[i] = ps->y[i];
+    ps->x[i] += ps->vx[i];
+    ps->y[i] += ps->vy[i];
+    ps->vy[i] += PARTICLE_GRAVITY;
+    return ps->life[i] <= 0;
+}
+
+// Advance every particle by one tick of dt seconds: move by its velocity,
+// apply gravity and age it, then drop the ones that died. Four particles
+// are integrated per step.
+void particles_update(ParticleSystem *ps, float dt) {
+    int n = ps->count;
+    v4si died = {0, 0, 0, 0};
+    int i = 0;
+    for (; i + PARTICLE_LANES <= n; i += PARTICLE_LANES) {
+        v4sf life = load4(&ps->life[i]) - SPLATF(dt);
+        v4sf x = load4(&ps->x[i]);
+        v4sf y = load4(&ps->y[i]);
+        v4sf vy = load4(&ps->vy[i]);
+        store4(&ps->life[i], life);
+        store4(&ps->prev_x[i], x);
+        store4(&ps->prev_y[i], y);
+        store4(&ps->x[i], x + load4(&ps->vx[i]));
+        store4(&ps->y[i], y + vy);
+        store4(&ps->vy[i], vy + SPLATF(PARTICLE_GRAVITY));
+        died |= life <= SPLATF(0.0f);
+    }
+
+    bool any_died = died[0] | died[1] | died[2] | died[3];
+    for (; i < n; i++) {
+        any_died |= update_one(ps, i, dt);
+    }
+    if (any_died) {
+        remove_dead(ps);
+    }
+}
+
+// Reference version of particles_update, one particle at a time
+void particles_update_scalar(ParticleSystem *ps, float dt) {
+    bool any_died = false;
+    for (int i = 0; i < ps->count; i++) {
+        any_died |= update_one(ps, i, dt);
+    }
+    if (any_died) {
+        remove_dead(ps);
+    }
+}
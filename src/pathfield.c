@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/pathfield.h"
+#include "../include/chunk_world.h"
+
+// Check whether an entity can stand on a tile
+bool pathfield_is_walkable(const GameMap *map, int x, int y) {
+    if (x < 0 || x >= map->width || y < 0 || y >= map->height) {
+        return false;
+    }
+    // Unloaded chunks of a streamed level count as walls, so searches stay
+    // within the resident part of the level
+    return map_peek_tile(map, x, y) != TILE_WALL;
+}
+
+// Mark every tile of a distance field as unreached
+void pathfield_clear(const GameMap *map, unsigned short *distance) {
+    size_t cells = MAP_CELLS(map);
+    for (size_t i = 0; i < cells; i++) {
+        distance[i] = PATHFIELD_UNREACHED;
+    }
+}
+
+// Build a 4-connected path distance field from a start tile with a breadth-first
+// search. distance must hold MAP_CELLS(map) entries in map layout; tiles
+// farther than max_distance (or behind walls) are left at PATHFIELD_UNREACHED.
+// Returns the number of tiles reached, or -1 on failure.
+int pathfield_build(const GameMap *map, int start_x, int start_y, int max_distance, unsigned short *distance) {
+    if (map == NULL || distance == NULL) {
+        return -1;
+    }
+
+    pathfield_clear(map, distance);
+    if (!pathfield_is_walkable(map, start_x, start_y)) {
+        return 0;
+    }
+
+    int source = start_y * map->stride + start_x;
+    return pathfield_search(map, &source, 1, max_distance, distance);
+}
+
+// Build a distance field to the nearest of several source tiles (map layout
+// indices, all at distance 0). Unwalkable sources are skipped.
+// Returns the number of tiles reached, or -1 on failure.
+int pathfield_build_multi(const GameMap *map, const int *sources, int num_sources, int max_distance, unsigned short *distance) {
+    if (map == NULL || distance == NULL) {
+        return -1;
+    }
+
+    pathfield_clear(map, distance);
+    return pathfield_search(map, sources, num_sources, max_distance, distance);
+}
+
+// Run the breadth-first search without clearing the field first; every tile
+// the search can reach must already be PATHFIELD_UNREACHED. Returns the number of tiles reached, or -1 on failure.
+int pathfield_search(const GameMap *map, const int *sources, int num_sources, int max_distance, unsigned short *distance) {
+    if (map == NULL || distance == NULL || (sources == NULL && num_sources > 0)) {
+        return -1;
+    }
+    if (num_sources <= 0) {
+        return 0;
+    }
+    if (max_distance < 0 || max_distance >= PATHFIELD_UNREACHED) {
+        max_distance = PATHFIELD_UNREACHED - 1;
+    }
+
+    // A bounded search reaches at most the diamond of radius max_distance around each source
+    size_t capacity = MAP_CELLS(map);
+    size_t diamond = 2 * (size_t)max_distance * (max_distance + 1) + 1;
+    if (diamond * num_sources < capacity) {
+        capacity = diamond * num_sources;
+    }
+
+    int *queue = malloc(sizeof(int) * capacity);
+    if (queue == NULL) {
+        perror("pathfield queue allocation failed");
+        return -1;
+    }
+
+    static const int step_x[4] = {1, -1, 0, 0};
+    static const int step_y[4] = {0, 0, 1, -1};
+    int stride = map->stride;
+
+    int head = 0;
+    int tail = 0;
+    for (int s = 0; s < num_sources; s++) {
+        int index = sources[s];
+        if (index < 0 || (size_t)index >= MAP_CELLS(map)) continue;
+        if (!pathfield_is_walkable(map, index % stride, index / stride)) continue;
+        if (distance[index] == 0) continue;
+
+        distance[index] = 0;
+        queue[tail++] = index;
+    }
+
+    while (head < tail) {
+        int index = queue[head++];
+        int d = distance[index];
+        if (d >= max_distance) continue;
+
+        int x = index % stride;
+        int y = index / stride;
+        for (int dir = 0; dir < 4; dir++) {
+            int nx = x + step_x[dir];
+            int ny = y + step_y[dir];
+            int next = ny * stride + nx;
+            if (pathfield_is_walkable(map, nx, ny) && distance[next] == PATHFIELD_UNREACHED) {
+                distance[next] = (unsigned short)(d + 1);
+                queue[tail++] = next;
+            }
+        }
+    }
+
+    free(queue);
+    return tail;
+}
+
+// Build the distance field from (cx, cy) out to radius steps into a window
+// field of PATHFIELD_WINDOW_CELLS(radius) entries, row-major from
+// (cx - radius, cy - radius). Its size depends only on the radius, not on the
+// map. Returns the number of tiles reached, or -1 on failure.
+int pathfield_search_window(const GameMap *map, int cx, int cy, int radius, unsigned short *distance) {
+    if (map == NULL || distance == NULL || radius < 0 || radius >= PATHFIELD_UNREACHED) {
+        return -1;
+    }
+
+    int side = PATHFIELD_WINDOW_SIDE(radius);
+    int cells = side * side;
+    for (int i = 0; i < cells; i++) {
+        distance[i] = PATHFIELD_UNREACHED;
+    }
+    if (!pathfield_is_walkable(map, cx, cy)) {
+        return 0;
+    }
+
+    // A search bounded to radius steps reaches at most the diamond of that radius
+    int capacity = 2 * radius * (radius + 1) + 1;
+    int *queue = malloc(sizeof(int) * capacity);
+    if (queue == NULL) {
+        perror("pathfield queue allocation failed");
+        return -1;
+    }
+
+    static const int step_x[4] = {1, -1, 0, 0};
+    static const int step_y[4] = {0, 0, 1, -1};
+    int left = cx - radius;
+    int top = cy - radius;
+
+    int head = 0;
+    int tail = 0;
+    int start = radius * side + radius;
+    distance[start] = 0;
+    queue[tail++] = start;
+
+    while (head < tail) {
+        int index = queue[head++];
+        int d = distance[index];
+        if (d >= radius) continue;
+
+        int wx = index % side;
+        int wy = index / side;
+        for (int dir = 0; dir < 4; dir++) {
+            int nx = wx + step_x[dir];
+            int ny = wy + step_y[dir];
+            int next = ny * side + nx;
+            if (distance[next] == PATHFIELD_UNREACHED && pathfield_is_walkable(map, left + nx, top + ny)) {
+                distance[next] = (unsigned short)(d + 1);
+                queue[tail++] = next;
+            }
+        }
+    }
+
+    free(queue);
+    return tail;
+}
+
+// Distance to (x, y) in a window field centred on (cx, cy); tiles outside
+// the window are unreached
+unsigned short pathfield_window_distance(const unsigned short *distance, int cx, int cy, int radius, int x, int y) {
+    int wx = x - cx + radius;
+    int wy = y - cy + radius;
+    int side = PATHFIELD_WINDOW_SIDE(radius);
+    if (wx < 0 || wx >= side || wy < 0 || wy >= side) {
+        return PATHFIELD_UNREACHED;
+    }
+    return distance[wy * side + wx];
+}
+
+// Connected component of a tile (MAP_COMPONENT_*). Maps without labels
+// (streamed levels) report every walkable tile as part of the main component.
+unsigned short pathfield_component(const GameMap *map, int x, int y) {
+    if (!pathfield_is_walkable(map, x, y)) {
+        return MAP_COMPONENT_NONE;
+    }
+    if (map->components == NULL) {
+        return MAP_COMPONENT_MAIN;
+    }
+    return map->components[(size_t)y * map->stride + x];
+}
+
+// Whether one tile can be reached from another, answered from the component
+// labels without a search. Tiles in overflowing pockets never count as connected.
+bool pathfield_connected(const GameMap *map, int from_x, int from_y, int to_x, int to_y) {
+    unsigned short from = pathfield_component(map, from_x, from_y);
+    return from != MAP_COMPONENT_NONE && from != MAP_COMPONENT_POCKET &&
+           from == pathfield_component(map, to_x, to_y);
+}
+
+// Finish a relabel without memory: sweep the map, moving tiles still labelled
+// old that touch the new label over to it, until a sweep changes nothing.
+// Different components never touch, so only the component being relabelled
+// is reached, even when old is the shared MAP_COMPONENT_POCKET label.
+static void relabel_by_sweeps(GameMap *map, unsigned short old, unsigned short label) {
+    static const int step_x[4] = {1, -1, 0, 0};
+    static const int step_y[4] = {0, 0, 1, -1};
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int y = 1; y < map->height - 1; y++) {
+            for (int x = 1; x < map->width - 1; x++) {
+                if (map->components[(size_t)y * map->stride + x] != old || !pathfield_is_walkable(map, x, y)) continue;
+                for (int dir = 0; dir < 4; dir++) {
+                    if (pathfield_component(map, x + step_x[dir], y + step_y[dir]) == label) {
+                        map->components[(size_t)y * map->stride + x] = label;
+                        freecells_update(map->free_cells, map, x, y);
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Give every tile of a component a new label (flood fill). If the stack
+// cannot grow, the rest of the component is relabelled by sweeps, so the
+// labels and the free cell index never disagree.
+static void relabel_component(GameMap *map, int x, int y, unsigned short label) {
+    unsigned short old = map->components[(size_t)y * map->stride + x];
+    if (old == label) return;
+
+    map->components[(size_t)y * map->stride + x] = label;
+    freecells_update(map->free_cells, map, x, y);
+
+    size_t capacity = 256, count = 0;
+    int *stack = malloc(sizeof(int) * capacity);
+    if (stack == NULL) {
+        perror("pathfield relabel allocation failed");
+        relabel_by_sweeps(map, old, label);
+        return;
+    }
+
+    static const int step_x[4] = {1, -1, 0, 0};
+    static const int step_y[4] = {0, 0, 1, -1};
+    bool out_of_memory = false;
+    stack[count++] = y * map->stride + x;
+    while (count > 0 && !out_of_memory) {
+        int index = stack[--count];
+        int cx = index % map->stride;
+        int cy = index / map->stride;
+        for (int dir = 0; dir < 4; dir++) {
+            int nx = cx + step_x[dir];
+            int ny = cy + step_y[dir];
+            if (pathfield_component(map, nx, ny) != old) continue;
+
+            if (count == capacity) {
+                int *grown = realloc(stack, sizeof(int) * capacity * 2);
+                if (grown == NULL) {
+                    perror("pathfield relabel allocation failed");
+                    out_of_memory = true;
+                    break;
+                }
+                stack = grown;
+                capacity *= 2;
+            }
+            map->components[(size_t)ny * map->stride + nx] = label;
+            freecells_update(map->free_cells, map, nx, ny);
+            stack[count++] = ny * map->stride + nx;
+        }
+    }
+    free(stack);
+    if (out_of_memory) {
+        relabel_by_sweeps(map, old, label);
+    }
+}
+
+// Turn a wall into floor and keep the component labels right: the tile
+// joins the neighbouring component (the main one if it touches it), and any
+// other components it touches are merged into that one
+void pathfield_open_tile(GameMap *map, int x, int y) {
+    if (x <= 0 || y <= 0 || x >= map->width - 1 || y >= map->height - 1) return;
+    if (map_get_tile(map, x, y) != TILE_WALL) return;
+
+    map_set_tile(map, x, y, TILE_EMPTY);
+    if (map->components == NULL) return;
+
+    static const int step_x[4] = {1, -1, 0, 0};
+    static const int step_y[4] = {0, 0, 1, -1};
+    unsigned short label = MAP_COMPONENT_POCKET;
+    for (int dir = 0; dir < 4; dir++) {
+        unsigned short neighbour = pathfield_component(map, x + step_x[dir], y + step_y[dir]);
+        if (neighbour != MAP_COMPONENT_NONE && neighbour < label) {
+            label = neighbour;
+        }
+    }
+
+    map->components[(size_t)y * map->stride + x] = label;
+    freecells_update(map->free_cells, map, x, y);
+    for (int dir = 0; dir < 4; dir++) {
+        int nx = x + step_x[dir];
+        int ny = y + step_y[dir];
+        unsigned short neighbour = pathfield_component(map, nx, ny);
+        if (neighbour != MAP_COMPONENT_NONE && neighbour != label) {
+            relabel_component(map, nx, ny, label);
+        }
+    }
+}
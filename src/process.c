@@ -7,10 +7,20 @@
 #include <signal.h>
 #include <sys/select.h>
 #include <sys/time.h>
+#include <time.h>
 #include <SDL2/SDL.h>
 #include "../include/process.h"
 #include "../include/game.h"
 #include "../include/shared_memory.h"
+#include "../include/occupancy.h"
+#include "../include/ai_lod.h"
+#include "../include/enemy_kernel.h"
+#include "../include/intercept.h"
+#include "../include/chunk_world.h"
+#include "../include/pathfield.h"
+#include "../include/freecells.h"
+#include "../include/frame_clock.h"
+#include "../include/quality.h"
 
 // Array to store player process IDs
 pid_t player_pids[MAX_PROCESSES];
@@ -53,16 +63,15 @@ void create_player_processes(int count) {
         game_state->players[i].type = ENTITY_PLAYER;
         game_state->players[i].keys = 0;
         game_state->num_players = count;
+        occupancy_move(game_state, ENTITY_ID_PLAYER(i), game_state->players[i].x, game_state->players[i].y);
         unlock_game_state();
         
         // Ensure starting area is clear
         lock_game_state();
         for (int y = 1; y < 6; y++) {
             for (int x = 1; x < 6; x++) {
-                if (game_state->map.tiles[y][x] == TILE_WALL) {
-                    // Clear any walls near the start
-                    game_state->map.tiles[y][x] = TILE_EMPTY;
-                }
+                // Clear any walls near the start
+                pathfield_open_tile(&game_state->map, x, y);
             }
         }
         unlock_game_state();
@@ -85,82 +94,115 @@ void create_enemy_processes(int count) {
         // Initialize enemy data in game state
         lock_game_state();
         // Position enemies in different parts of the map far from player
-        game_state->enemies[i].id = i;
-        
-        // Define valid spawn locations based on corner regions, far from player's start position (2,2)
+        // Define valid spawn locations based on corner regions, far from player's start position (2,2).
+        // Regions scale with the map (on the default 80x80 map they span 15 tiles).
+        int map_width = game_state->map.width;
+        int map_height = game_state->map.height;
+        int span_x = map_width * 3 / 16;
+        int span_y = map_height * 3 / 16;
         struct {
             int min_x, max_x;
             int min_y, max_y;
         } spawnRegions[4] = {
-            {MAP_WIDTH - 20, MAP_WIDTH - 5, 5, 15},                  // Top right
-            {MAP_WIDTH - 20, MAP_WIDTH - 5, MAP_HEIGHT - 15, MAP_HEIGHT - 5}, // Bottom right
-            {5, 15, MAP_HEIGHT - 15, MAP_HEIGHT - 5},                // Bottom left
-            {MAP_WIDTH/2 + 20, MAP_WIDTH - 5, MAP_HEIGHT/2 - 5, MAP_HEIGHT/2 + 5}  // Middle right
+            {map_width - span_x - 5, map_width - 5, 5, span_y},                            // Top right
+            {map_width - span_x - 5, map_width - 5, map_height - span_y, map_height - 5},  // Bottom right
+            {5, span_x, map_height - span_y, map_height - 5},                              // Bottom left
+            {map_width * 3 / 4, map_width - 5, map_height / 2 - 5, map_height / 2 + 5}     // Middle right
         };
         
         // Select a spawn region for this enemy
         int regionIndex = i % 4;
         
-        // Find a valid empty tile within the region
+        // Find a valid empty tile within the region that the player can reach
         int x = 0, y = 0;
         bool valid_position = false;
-        int attempts = 0;
-        const int MAX_ATTEMPTS = 50;
-        
-        while (!valid_position && attempts < MAX_ATTEMPTS) {
-            x = spawnRegions[regionIndex].min_x + 
-                rand() % (spawnRegions[regionIndex].max_x - spawnRegions[regionIndex].min_x);
-            y = spawnRegions[regionIndex].min_y + 
-                rand() % (spawnRegions[regionIndex].max_y - spawnRegions[regionIndex].min_y);
+        GameMap *map = &game_state->map;
+        
+        if (i < game_state->num_spawns) {
+            // Spawn point given by the level file
+            x = game_state->spawn_x[i];
+            y = game_state->spawn_y[i];
+            valid_position = x > 0 && y > 0 && x < map_width - 1 && y < map_height - 1 &&
+                             map_get_tile(map, x, y) != TILE_WALL;
+        } else if (map->free_cells != NULL) {
+            // Drawn from the free-cell index: reachable floor in the region,
+            // not right next to the player
+            FreeCellFilter filter = {
+                spawnRegions[regionIndex].min_x, spawnRegions[regionIndex].min_y,
+                spawnRegions[regionIndex].max_x - 1, spawnRegions[regionIndex].max_y - 1,
+                game_state->players[0].x, game_state->players[0].y, ENEMY_SPAWN_MIN_DISTANCE
+            };
+            unsigned int pick = (unsigned int)rand() | 1u;
+            valid_position = freecells_sample(map->free_cells, map, &filter, &pick, &x, &y);
+        } else {
+            int attempts = 0;
+            const int MAX_ATTEMPTS = 50;
             
-            // Check if the position is an empty tile
-            if (game_state->map.tiles[y][x] == TILE_EMPTY) {
-                // Clear any walls in adjacent tiles to ensure enemies can move
-                for (int dy = -1; dy <= 1; dy++) {
-                    for (int dx = -1; dx <= 1; dx++) {
-                        int nx = x + dx;
-                        int ny = y + dy;
-                        if (nx > 0 && nx < MAP_WIDTH-1 && ny > 0 && ny < MAP_HEIGHT-1) {
-                            if (game_state->map.tiles[ny][nx] == TILE_WALL) {
-                                game_state->map.tiles[ny][nx] = TILE_EMPTY;
-                            }
-                        }
-                    }
+            while (!valid_position && attempts < MAX_ATTEMPTS) {
+                x = spawnRegions[regionIndex].min_x + 
+                    rand() % (spawnRegions[regionIndex].max_x - spawnRegions[regionIndex].min_x);
+                y = spawnRegions[regionIndex].min_y + 
+                    rand() % (spawnRegions[regionIndex].max_y - spawnRegions[regionIndex].min_y);
+                
+                // Streamed levels (the only ones without a free-cell index)
+                // wall in their sealed pockets, so any empty tile is one the
+                // player can reach
+                valid_position = map_get_tile(map, x, y) == TILE_EMPTY;
+                attempts++;
+            }
+        }
+        
+        if (valid_position) {
+            // Clear any walls in adjacent tiles to ensure enemies can move
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    pathfield_open_tile(map, x + dx, y + dy);
                 }
-                valid_position = true;
             }
-            attempts++;
         }
         
         // If no valid position found, use fallback positions
         if (!valid_position) {
             switch (i) {
-                case 0: x = MAP_WIDTH - 10; y = MAP_HEIGHT - 10; break;
-                case 1: x = MAP_WIDTH - 15; y = 15; break;
-                case 2: x = MAP_WIDTH - 12; y = MAP_HEIGHT - 12; break;
-                case 3: x = MAP_WIDTH - 20; y = MAP_HEIGHT / 2; break;
-                case 4: x = 15; y = MAP_HEIGHT - 15; break;
-                default: x = MAP_WIDTH - 8; y = MAP_HEIGHT - 8; break;
+                case 0: x = map_width - 10; y = map_height - 10; break;
+                case 1: x = map_width - 15; y = 15; break;
+                case 2: x = map_width - 12; y = map_height - 12; break;
+                case 3: x = map_width - 20; y = map_height / 2; break;
+                case 4: x = 15; y = map_height - 15; break;
+                default: x = map_width - 8; y = map_height - 8; break;
             }
             // Ensure the fallback position is walkable
-            game_state->map.tiles[y][x] = TILE_EMPTY;
+            pathfield_open_tile(&game_state->map, x, y);
         }
         
         // Set enemy position and type
-        game_state->enemies[i].x = x;
-        game_state->enemies[i].y = y;
+        EnemyStore *enemies = &game_state->enemies;
+        enemies->x[i] = x;
+        enemies->y[i] = y;
+        occupancy_move(game_state, ENTITY_ID_ENEMY(i), x, y);
         
         // Assign enemy type
         switch (i % 5) {
-            case 0: game_state->enemies[i].type = ENTITY_ENEMY_CHASE; break;
-            case 1: game_state->enemies[i].type = ENTITY_ENEMY_RANDOM; break;
-            case 2: game_state->enemies[i].type = ENTITY_ENEMY_GUARD; break;
-            case 3: game_state->enemies[i].type = ENTITY_ENEMY_CHASE; break;
-            case 4: game_state->enemies[i].type = ENTITY_ENEMY_SMART; break;
+            case 0: enemies->type[i] = ENTITY_ENEMY_CHASE; break;
+            case 1: enemies->type[i] = ENTITY_ENEMY_RANDOM; break;
+            case 2: enemies->type[i] = ENTITY_ENEMY_GUARD; break;
+            case 3: enemies->type[i] = ENTITY_ENEMY_CHASE; break;
+            case 4: enemies->type[i] = ENTITY_ENEMY_SMART; break;
+        }
+        if (i < game_state->num_spawns && game_state->spawn_type[i] >= ENTITY_ENEMY_CHASE &&
+            game_state->spawn_type[i] <= ENTITY_ENEMY_SMART) {
+            enemies->type[i] = game_state->spawn_type[i];
         }
         
-        game_state->enemies[i].health = 100;
-        game_state->enemies[i].is_active = true;
+        enemies->range[i] = (short)enemy_detection_range((EntityType)enemies->type[i], game_state->current_level);
+        enemies->cooldown[i] = 0;
+        enemies->phase[i] = 0;
+        enemies->rng[i] = (unsigned int)rand() | 1u; // xorshift state must be non-zero
+        enemies->step_x[i] = 0;
+        enemies->step_y[i] = 0;
+        enemies->wants_decision[i] = false;
+        enemies->decided[i] = false;
+        enemies->active[i] = true;
         game_state->num_enemies = count;
         unlock_game_state();
         
@@ -178,7 +220,7 @@ void create_enemy_processes(int count) {
             close(enemy_to_main_pipe[i][0]); // Close read end of enemy-to-main pipe
             
             // Run enemy process
-            enemy_process_main(i, game_state->enemies[i].type);
+            enemy_process_main(i, (EntityType)game_state->enemies.type[i]);
             
             // Clean up and exit
             close(main_to_enemy_pipe[i][0]);
@@ -321,6 +363,13 @@ void broadcast_player_position(int x, int y) {
     }
 }
 
+// Microseconds elapsed since a monotonic timestamp
+static long elapsed_microseconds(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000000L + (now.tv_nsec - since->tv_nsec) / 1000L;
+}
+
 // Main function for enemy process
 void enemy_process_main(int enemy_id, EntityType enemy_type) {
     printf("Enemy %d process started (type: %d)\n", enemy_id, enemy_type);
@@ -356,210 +405,96 @@ void enemy_process_main(int enemy_id, EntityType enemy_type) {
         
         // Don't move every cycle - only every few cycles based on enemy type
         move_counter++;
-        int move_frequency;
-        
-        switch (enemy_type) {
-            case ENTITY_ENEMY_CHASE:
-                move_frequency = 8; 
-                break;
-            case ENTITY_ENEMY_RANDOM:
-                move_frequency = 10;
-                break;
-            case ENTITY_ENEMY_GUARD:
-                move_frequency = 12;
-                break;
-            case ENTITY_ENEMY_SMART:
-                move_frequency = 7;
-                break;
-            default:
-                move_frequency = 10;
-        }
+        int move_frequency = enemy_move_frequency(enemy_type);
         
         // Increase move frequency at the beginning to slow down enemies
         if (!can_track_player) {
             move_frequency *= 2;
         }
         
-        if (move_counter >= move_frequency) {
+        // Stretch the cadence of far-away and off-screen enemies, and ask the
+        // scheduler for a share of the window's AI budget once it is time to
+        // move. If the budget is spent the counter stays primed for next cycle.
+        lock_game_state();
+        AiLodTier lod_tier = ai_lod_tier(game_state, enemy_id);
+        move_frequency *= ai_lod_frequency_scale(lod_tier);
+        unsigned int budget_window = 0;
+        bool granted = move_counter >= move_frequency && ai_lod_try_acquire(game_state, enemy_id, &budget_window);
+        unlock_game_state();
+        
+        if (granted) {
             move_counter = 0;
             
-            // Determine next move based on enemy type
-            int dx = 0, dy = 0;
+            // All enemies now have some ability to track the player
+            // (dormant enemies skip tracking and just wander cheaply)
+            bool tracking = player_x >= 0 && player_y >= 0 && lod_tier != AI_LOD_DORMANT;
             
+            // Smart enemies take the step the interception planner assigned
+            // them; everyone else (or a smart enemy without a current plan)
+            // asks the main process, which decides all pending requests in
+            // one batched kernel pass on its next tick (see enemy_ai.h)
+            // The clock starts once the lock is held, so time spent waiting
+            // for it is not charged to the AI budget
             lock_game_state();
-            int enemy_x = game_state->enemies[enemy_id].x;
-            int enemy_y = game_state->enemies[enemy_id].y;
-            bool is_active = game_state->enemies[enemy_id].is_active;
-            unlock_game_state();
-            
-            if (!is_active) {
-                running = false;
-                break;
-            }
-            
-            // All enemies now have some ability to track the player
-            if (player_x >= 0 && player_y >= 0) {
-                // Calculate distance to player
-                int dx_to_player = player_x - enemy_x;
-                int dy_to_player = player_y - enemy_y;
-                int dist_squared = dx_to_player*dx_to_player + dy_to_player*dy_to_player;
-                
-                switch (enemy_type) {
-                    case ENTITY_ENEMY_CHASE:
-                        // Always chase player if position is known
-                        // Smart chase - prioritize the larger distance dimension
-                        if (abs(dx_to_player) > abs(dy_to_player)) {
-                            dx = (dx_to_player > 0) ? 1 : -1;
-                        } else {
-                            dy = (dy_to_player > 0) ? 1 : -1;
-                        }
-                        break;
-                        
-                    case ENTITY_ENEMY_RANDOM:
-                        // Now follows player if close enough (aggressive random)
-                        if (dist_squared < 100) { // Within range of ~10 tiles
-                            // Simple chase for random when close
-                            if (rand() % 2 == 0) {
-                                dx = (dx_to_player > 0) ? 1 : -1;
-                            } else {
-                                dy = (dy_to_player > 0) ? 1 : -1;
-                            }
-                        } else {
-                            // Random movement if player is far
-                            int dir = rand() % 4;
-                            if (dir == 0) dx = 1;
-                            else if (dir == 1) dx = -1;
-                            else if (dir == 2) dy = 1;
-                            else dy = -1;
-                        }
-                        break;
-                        
-                    case ENTITY_ENEMY_GUARD:
-                        // Now actively guards area but moves toward player if detected
-                        if (dist_squared < 64) { // Within range of ~8 tiles
-                            // Chase player if detected in guarded area
-                            if (move_counter % 2 == 0) {
-                                dx = (dx_to_player > 0) ? 1 : -1;
-                            } else {
-                                dy = (dy_to_player > 0) ? 1 : -1;
-                            }
-                        } else {
-                            // Guard behavior - patrol in a small area
-                            if (move_counter % 2 == 0) {
-                                // Move horizontally in a pattern
-                                if ((move_counter / 2) % 2 == 0) dx = 1;
-                                else dx = -1;
-                            } else {
-                                // Move vertically in a pattern
-                                if ((move_counter / 2) % 2 == 0) dy = 1;
-                                else dy = -1;
-                            }
-                        }
-                        break;
-                        
-                    case ENTITY_ENEMY_SMART:
-                        // Smart enemy tries to predict and intercept player's path
-                        // First, determine if player is moving primarily horizontally or vertically
-                        // We'll use the last known positions to estimate this
-                        static int last_player_x = -1;
-                        static int last_player_y = -1;
-                        
-                        if (last_player_x != -1 && last_player_y != -1) {
-                            int player_dx = player_x - last_player_x;
-                            int player_dy = player_y - last_player_y;
-                            
-                            // Try to intercept player by predicting where they're going
-                            if (abs(player_dx) > abs(player_dy) && player_dx != 0) {
-                                // Player moving horizontally
-                                // Move to intercept a few tiles ahead in x direction
-                                int intercept_x = player_x + player_dx * 3;
-                                int dx_to_intercept = intercept_x - enemy_x;
-                                
-                                if (dx_to_intercept != 0) {
-                                    dx = (dx_to_intercept > 0) ? 1 : -1;
-                                } else {
-                                    // Already at intercept x, move in y direction toward player
-                                    dy = (dy_to_player > 0) ? 1 : -1;
-                                }
-                            } else if (player_dy != 0) {
-                                // Player moving vertically
-                                // Move to intercept a few tiles ahead in y direction
-                                int intercept_y = player_y + player_dy * 3;
-                                int dy_to_intercept = intercept_y - enemy_y;
-                                
-                                if (dy_to_intercept != 0) {
-                                    dy = (dy_to_intercept > 0) ? 1 : -1;
-                                } else {
-                                    // Already at intercept y, move in x direction toward player
-                                    dx = (dx_to_player > 0) ? 1 : -1;
-                                }
-                            } else {
-                                // Player not moving or first time seeing player
-                                // Use standard chase logic but faster
-                                if (rand() % 3 == 0) {
-                                    // Sometimes move diagonally for smarter movement
-                                    dx = (dx_to_player > 0) ? 1 : -1;
-                                    dy = (dy_to_player > 0) ? 1 : -1;
-                                } else {
-                                    // Prioritize larger distance axis
-                                    if (abs(dx_to_player) > abs(dy_to_player)) {
-                                        dx = (dx_to_player > 0) ? 1 : -1;
-                                    } else {
-                                        dy = (dy_to_player > 0) ? 1 : -1;
-                                    }
-                                }
-                            }
-                        } else {
-                            // First time seeing player, use standard chase
-                            if (abs(dx_to_player) > abs(dy_to_player)) {
-                                dx = (dx_to_player > 0) ? 1 : -1;
-                            } else {
-                                dy = (dy_to_player > 0) ? 1 : -1;
-                            }
-                        }
-                        
-                        // Update last known player position
-                        last_player_x = player_x;
-                        last_player_y = player_y;
-                        break;
-                        
-                    default:
-                        // Default chase behavior for unknown types
-                        if (enemy_x < player_x) dx = 1;
-                        else if (enemy_x > player_x) dx = -1;
-                        else if (enemy_y < player_y) dy = 1;
-                        else if (enemy_y > player_y) dy = -1;
-                        break;
-                }
+            struct timespec decision_start;
+            clock_gettime(CLOCK_MONOTONIC, &decision_start);
+            int dx = 0, dy = 0;
+            int enemy_x = game_state->enemies.x[enemy_id];
+            int enemy_y = game_state->enemies.y[enemy_id];
+            if (enemy_type == ENTITY_ENEMY_SMART && tracking &&
+                intercept_lookup(game_state, enemy_id, enemy_x, enemy_y, &dx, &dy)) {
+                game_state->enemies.step_x[enemy_id] = (signed char)dx;
+                game_state->enemies.step_y[enemy_id] = (signed char)dy;
+                game_state->enemies.decided[enemy_id] = true;
             } else {
-                // No player position known, use random movement for all types
-                int dir = rand() % 4;
-                if (dir == 0) dx = 1;
-                else if (dir == 1) dx = -1;
-                else if (dir == 2) dy = 1;
-                else dy = -1;
+                game_state->enemies.tracking[enemy_id] = tracking;
+                game_state->enemies.wants_decision[enemy_id] = true;
             }
             
+            // Charge the request against the AI budget window it was granted
+            // in; the main process charges its batched pass separately
+            ai_lod_charge(game_state, budget_window, elapsed_microseconds(&decision_start));
+            unlock_game_state();
+        }
+        
+        // Take a decided step, if there is one waiting
+        lock_game_state();
+        bool is_active = game_state->enemies.active[enemy_id];
+        bool has_step = is_active && game_state->enemies.decided[enemy_id];
+        game_state->enemies.decided[enemy_id] = false;
+        int enemy_x = game_state->enemies.x[enemy_id];
+        int enemy_y = game_state->enemies.y[enemy_id];
+        int new_x = enemy_x + game_state->enemies.step_x[enemy_id];
+        int new_y = enemy_y + game_state->enemies.step_y[enemy_id];
+        unlock_game_state();
+        
+        if (!is_active) {
+            running = false;
+            break;
+        }
+        
+        if (has_step) {
             // Check if the move is valid
             lock_game_state();
-            int new_x = enemy_x + dx;
-            int new_y = enemy_y + dy;
             
             // Boundary check
             if (new_x > 0 && new_x < game_state->map.width - 1 && 
                 new_y > 0 && new_y < game_state->map.height - 1) {
                 
                 // Check if the tile is walkable
-                if (game_state->map.tiles[new_y][new_x] != TILE_WALL) {
+                if (map_get_tile(&game_state->map, new_x, new_y) != TILE_WALL) {
                     // Update enemy position
-                    game_state->enemies[enemy_id].x = new_x;
-                    game_state->enemies[enemy_id].y = new_y;
+                    game_state->enemies.x[enemy_id] = new_x;
+                    game_state->enemies.y[enemy_id] = new_y;
+                    occupancy_move(game_state, ENTITY_ID_ENEMY(enemy_id), new_x, new_y);
                     
-                    // Check for collision with player
-                    for (int i = 0; i < game_state->num_players; i++) {
-                        if (game_state->players[i].is_active &&
-                            game_state->players[i].x == new_x &&
-                            game_state->players[i].y == new_y) {
+                    // Check for collision with any player standing on the new tile
+                    int hit_players[MAX_PLAYERS];
+                    int num_hit = occupancy_entities_at(game_state, new_x, new_y, OCCUPANCY_PLAYERS,
+                                                        hit_players, MAX_PLAYERS);
+                    for (int h = 0; h < num_hit; h++) {
+                        int i = hit_players[h];
+                        if (game_state->players[i].is_active) {
                             
                             // Hit player - send message to main process
                             game_state->player_hit = true;
@@ -645,6 +580,7 @@ void check_player_enemy_collision(GameState *state) {
         if (state->players[0].health <= 0) {
             state->players[0].health = 0;
             state->players[0].is_active = false;
+            occupancy_remove(state, ENTITY_ID_PLAYER(0));
             state->game_over = true;
             state->winner_id = -1; // No winner, player lost
         }
@@ -696,8 +632,14 @@ void player_process_main(int player_id) {
     // Player game loop
     bool running = true;
     SDL_Event event;
+    RenderSnapshot snapshot;
+    FrameClock frame_clock;
+    frame_clock_init(&frame_clock, FRAME_CLOCK_DEFAULT_FPS, false);
+    quality_init(frame_clock.frame_ns);
     
     while (running) {
+        uint64_t work_start = frame_clock_now_ns();
+        
         // Process events
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
@@ -708,22 +650,31 @@ void player_process_main(int player_id) {
             }
         }
         
+        // Copy this player's view out of the shared state, then draw it
+        // without holding the lock
+        lock_game_state();
+        capture_render_snapshot(game_state, player_id, &snapshot);
+        unlock_game_state();
+        
+        // Advance animations and particles by the ticks that are due
+        int ticks = frame_clock_begin(&frame_clock);
+        for (int t = 0; t < ticks; t++) {
+            advance_animation(&snapshot, SIM_TICK_SECONDS);
+        }
+        
         // Render game
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
         SDL_RenderClear(renderer);
-        
-        lock_game_state();
-        render_game(renderer, game_state, player_id);
+        render_game(renderer, &snapshot, frame_clock_alpha(&frame_clock));
         
         // Check if game is over
-        if (game_state->game_over) {
+        if (snapshot.game_over) {
             running = false;
         }
         
-        unlock_game_state();
-        
         SDL_RenderPresent(renderer);
-        SDL_Delay(16); // ~60 FPS
+        quality_record_frame(frame_clock_now_ns() - work_start);
+        frame_clock_wait(&frame_clock);
     }
     
     // Cleanup
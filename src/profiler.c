@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/profiler.h"
+#include "../include/text.h"
+#include "../include/quality.h"
+
+// Overlay and CSV column names of each phase
+static const char *phase_labels[PROFILE_PHASE_COUNT] = {
+    "INPUT", "IPC", "SIMULATION", "SNAPSHOT", "TILES",
+    "PARTICLES", "ENTITIES", "UI", "CAPTURE", "PRESENT", "FRAME"
+};
+static const char *phase_columns[PROFILE_PHASE_COUNT] = {
+    "input_us", "ipc_us", "simulation_us", "snapshot_us", "tiles_us",
+    "particles_us", "entities_us", "ui_us", "capture_us", "present_us", "frame_us"
+};
+
+// Profiler state (main process only)
+bool profiler_enabled = false;
+static bool overlay_visible = false;
+static FILE *csv_file = NULL;
+static unsigned long frame_number = 0;
+static uint64_t current_ns[PROFILE_PHASE_COUNT];                 // Phases of the frame in progress
+static float window_ms[PROFILE_PHASE_COUNT][PROFILER_WINDOW];    // Ring of the last frames
+static int window_count = 0;
+static int window_next = 0;
+static int frames_since_refresh = 0;
+static bool overlay_ready = false;
+static char overlay_lines[PROFILE_PHASE_COUNT][48];
+
+// Profile while either output wants the figures
+static void update_enabled(void) {
+    profiler_enabled = overlay_visible || csv_file != NULL;
+}
+
+// Add time to a phase of the current frame
+void profiler_record(ProfilePhase phase, uint64_t ns) {
+    current_ns[phase] += ns;
+}
+
+static int compare_floats(const void *a, const void *b) {
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Recompute the overlay text from the rolling window
+static void refresh_overlay(void) {
+    float sorted[PROFILER_WINDOW];
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        double total = 0.0;
+        for (int i = 0; i < window_count; i++) {
+            sorted[i] = window_ms[p][i];
+            total += sorted[i];
+        }
+        qsort(sorted, (size_t)window_count, sizeof(float), compare_floats);
+        snprintf(overlay_lines[p], sizeof(overlay_lines[p]), "%-10s %6.2f %6.2f %6.2f %6.2f",
+                 phase_labels[p], total / window_count,
+                 sorted[(int)(0.95f * (window_count - 1) + 0.5f)],
+                 sorted[(int)(0.99f * (window_count - 1) + 0.5f)],
+                 sorted[window_count - 1]);
+    }
+    overlay_ready = true;
+    frames_since_refresh = 0;
+}
+
+// Close the current frame: add it to the window and the CSV file
+void profiler_end_frame(void) {
+    if (!profiler_enabled) return;
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        window_ms[p][window_next] = (float)(current_ns[p] / 1e6);
+    }
+    window_next = (window_next + 1) % PROFILER_WINDOW;
+    if (window_count < PROFILER_WINDOW) window_count++;
+
+    if (csv_file != NULL) {
+        fprintf(csv_file, "%lu", frame_number);
+        for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+            fprintf(csv_file, ",%.1f", current_ns[p] / 1e3);
+        }
+        fprintf(csv_file, ",%d\n", (int)quality_level());
+    }
+
+    memset(current_ns, 0, sizeof(current_ns));
+    frame_number++;
+
+    // The figures change twice a second rather than every frame, which
+    // keeps them readable and lets the text cache reuse their layout
+    frames_since_refresh++;
+    if (overlay_visible && (!overlay_ready || frames_since_refresh >= PROFILER_REFRESH_FRAMES)) {
+        refresh_overlay();
+    }
+}
+
+// Show or hide the overlay; figures start over when profiling starts
+void profiler_toggle_overlay(void) {
+    if (!profiler_enabled) {
+        window_count = 0;
+        window_next = 0;
+        memset(current_ns, 0, sizeof(current_ns));
+    }
+    overlay_visible = !overlay_visible;
+    overlay_ready = false;
+    update_enabled();
+}
+
+// Write every frame's phase times (microseconds) to a CSV file
+bool profiler_open_csv(const char *path) {
+    csv_file = fopen(path, "w");
+    if (csv_file == NULL) {
+        perror("Failed to open profile file");
+        return false;
+    }
+    fputs("frame", csv_file);
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        fprintf(csv_file, ",%s", phase_columns[p]);
+    }
+    fputs(",quality\n", csv_file);
+    update_enabled();
+    return true;
+}
+
+// Draw the statistics panel in the top-left corner (milliseconds), with the
+// render quality level and the seconds spent at each level below it
+void profiler_draw_overlay(SDL_Renderer *renderer) {
+    if (!overlay_visible) return;
+
+    int rows = overlay_ready ? PROFILE_PHASE_COUNT : 0;
+    SDL_SetRenderDrawColor(renderer, 10, 10, 16, 255);
+    SDL_Rect panel = {8, 32, 396, 20 + (rows + 3) * 14};
+    SDL_RenderFillRect(renderer, &panel);
+    SDL_SetRenderDrawColor(renderer, 100, 100, 120, 255);
+    SDL_RenderDrawRect(renderer, &panel);
+
+    SDL_Color header = {255, 255, 100, 255};
+    SDL_Color body = {180, 220, 255, 255};
+    char title[48];
+    snprintf(title, sizeof(title), "%-10s %6s %6s %6s %6s", "PHASE", "AVG", "P95", "P99", "MAX");
+    draw_text(renderer, 16, 42, title, 8, header);
+    for (int p = 0; p < rows; p++) {
+        draw_text(renderer, 16, 42 + (p + 1) * 14, overlay_lines[p], 8, p == PROFILE_FRAME ? header : body);
+    }
+
+    // Whole seconds, so the lines change rarely enough for the text cache.
+    // Upper case only: draw_text has no lower case glyphs (nor J, X or Z).
+    QualityStats stats;
+    quality_get_stats(&stats);
+    char line[48];
+    snprintf(line, sizeof(line), "%-10s %-7s CHG %u", "QUALITY", quality_level_name(stats.level), stats.changes);
+    draw_text(renderer, 16, 42 + (rows + 1) * 14, line, 8, header);
+    snprintf(line, sizeof(line), "H %.0f  M %.0f  L %.0f  MIN %.0f", stats.seconds_at[QUALITY_HIGH],
+             stats.seconds_at[QUALITY_MEDIUM], stats.seconds_at[QUALITY_LOW], stats.seconds_at[QUALITY_MINIMAL]);
+    draw_text(renderer, 16, 42 + (rows + 2) * 14, line, 8, body);
+}
+
+// Close the CSV file
+void profiler_shutdown(void) {
+    if (csv_file != NULL) {
+        fclose(csv_file);
+        csv_file = NULL;
+    }
+    overlay_visible = false;
+    update_enabled();
+}
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <string.h>
+#include "../include/quality.h"
+#include "../include/frame_clock.h"
+
+// Effects of each level, from everything down to the bare minimum
+static const QualitySettings level_settings[QUALITY_LEVEL_COUNT] = {
+    [QUALITY_HIGH]    = {1, true,  true,  true,  true,  true},
+    [QUALITY_MEDIUM]  = {2, false, true,  true,  true,  true},
+    [QUALITY_LOW]     = {4, false, false, false, false, true},
+    [QUALITY_MINIMAL] = {0, false, false, false, false, false},
+};
+
+static const char *level_names[QUALITY_LEVEL_COUNT] = {"HIGH", "MEDIUM", "LOW", "MINIMAL"};
+
+// Governor state (one per rendering process). Until quality_init is called
+// the level stays at QUALITY_HIGH.
+static QualityLevel current_level = QUALITY_HIGH;
+static uint64_t budget_ns = 0;
+static float average_ns = 0.0f;
+static int frames_over = 0;          // Consecutive frames above the degrade threshold
+static int frames_under = 0;         // Consecutive frames below the recover threshold
+static unsigned int level_changes = 0;
+static uint64_t last_frame_ns = 0;
+static uint64_t ns_at_level[QUALITY_LEVEL_COUNT];
+
+// Start governing frames against a budget (the frame interval)
+void quality_init(uint64_t frame_budget_ns) {
+    current_level = QUALITY_HIGH;
+    budget_ns = frame_budget_ns;
+    average_ns = 0.0f;
+    frames_over = 0;
+    frames_under = 0;
+    level_changes = 0;
+    last_frame_ns = frame_clock_now_ns();
+    memset(ns_at_level, 0, sizeof(ns_at_level));
+}
+
+// Move to another level and start both counts over
+static void change_level(QualityLevel level) {
+    printf("Render quality %s -> %s (%.2f ms of %.2f ms)\n", level_names[current_level],
+           level_names[level], average_ns / 1e6, budget_ns / 1e6);
+    current_level = level;
+    frames_over = 0;
+    frames_under = 0;
+    level_changes++;
+}
+
+// Account for a finished frame that took work_ns before its sleep
+void quality_record_frame(uint64_t work_ns) {
+    if (budget_ns == 0) return;
+
+    uint64_t now = frame_clock_now_ns();
+    ns_at_level[current_level] += now - last_frame_ns;
+    last_frame_ns = now;
+
+    if (average_ns == 0.0f) {
+        average_ns = (float)work_ns;
+    } else {
+        average_ns += ((float)work_ns - average_ns) * QUALITY_SMOOTHING;
+    }
+
+    if (average_ns > budget_ns * QUALITY_DEGRADE_SHARE) {
+        frames_over++;
+        frames_under = 0;
+    } else if (average_ns < budget_ns * QUALITY_RECOVER_SHARE) {
+        frames_under++;
+        frames_over = 0;
+    } else {
+        // Inside the band: hold the current level
+        frames_over = 0;
+        frames_under = 0;
+    }
+
+    if (frames_over >= QUALITY_DEGRADE_FRAMES && current_level < QUALITY_MINIMAL) {
+        change_level(current_level + 1);
+    } else if (frames_under >= QUALITY_RECOVER_FRAMES && current_level > QUALITY_HIGH) {
+        change_level(current_level - 1);
+    }
+}
+
+// Current level
+QualityLevel quality_level(void) {
+    return current_level;
+}
+
+// Effects the current level draws
+const QualitySettings *quality_settings(void) {
+    return &level_settings[current_level];
+}
+
+// Display name of a level
+const char *quality_level_name(QualityLevel level) {
+    return level_names[level];
+}
+
+// Copy out the current level and the time spent at each one
+void quality_get_stats(QualityStats *stats) {
+    stats->level = current_level;
+    stats->average_ms = average_ns / 1e6f;
+    stats->budget_ms = budget_ns / 1e6f;
+    stats->changes = level_changes;
+    for (int i = 0; i < QUALITY_LEVEL_COUNT; i++) {
+        stats->seconds_at[i] = ns_at_level[i] / 1e9;
+    }
+}
+
+// Print the time spent at each level
+void quality_print_stats(void) {
+    QualityStats stats;
+    quality_get_stats(&stats);
+    printf("Render quality: %s now, %u changes;", level_names[stats.level], stats.changes);
+    for (int i = 0; i < QUALITY_LEVEL_COUNT; i++) {
+        printf(" %s %.1fs", level_names[i], stats.seconds_at[i]);
+    }
+    printf("\n");
+}
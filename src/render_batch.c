@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "../include/render_batch.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Most rectangles passed to one SDL_RenderFillRects call
+#define RECT_RUN_MAX 256
+
+typedef enum {
+    SHAPE_RECT,              // x, y, w, h
+    SHAPE_LINE,              // x1, y1, x2, y2 (end points included)
+    SHAPE_TRIANGLE,          // x0, y0, x1, y1, x2, y2
+    SHAPE_CIRCLE             // cx, cy, radius
+} ShapeType;
+
+// A primitive waiting for the next flush
+typedef struct {
+    ShapeType type;
+    SDL_Color color;
+    int segments;            // Circle only
+    float v[6];
+} Shape;
+
+// Batch state (main process only)
+static Shape *shapes = NULL;
+static int num_shapes = 0;
+static int shape_capacity = 0;
+static SDL_Vertex *vertices = NULL;
+static int vertex_capacity = 0;
+static int *indices = NULL;
+static int index_capacity = 0;
+
+// Append a shape, growing the list as needed; NULL if out of memory
+static Shape *add_shape(ShapeType type, SDL_Color color) {
+    if (num_shapes == shape_capacity) {
+        int capacity = shape_capacity ? shape_capacity * 2 : 1024;
+        Shape *grown = realloc(shapes, (size_t)capacity * sizeof(Shape));
+        if (grown == NULL) {
+            perror("Failed to grow render batch");
+            return NULL;
+        }
+        shapes = grown;
+        shape_capacity = capacity;
+    }
+    Shape *s = &shapes[num_shapes++];
+    s->type = type;
+    s->color = color;
+    s->segments = 0;
+    return s;
+}
+
+// Queue a filled rectangle (same pixels as SDL_RenderFillRect)
+void render_batch_rect(int x, int y, int w, int h, SDL_Color color) {
+    if (w <= 0 || h <= 0) return;
+    Shape *s = add_shape(SHAPE_RECT, color);
+    if (s == NULL) return;
+    s->v[0] = x; s->v[1] = y; s->v[2] = w; s->v[3] = h;
+}
+
+// Queue a one pixel wide line; horizontal and vertical lines become rectangles
+void render_batch_line(int x1, int y1, int x2, int y2, SDL_Color color) {
+    if (x1 == x2 || y1 == y2) {
+        int x = x1 < x2 ? x1 : x2;
+        int y = y1 < y2 ? y1 : y2;
+        render_batch_rect(x, y, abs(x2 - x1) + 1, abs(y2 - y1) + 1, color);
+        return;
+    }
+    Shape *s = add_shape(SHAPE_LINE, color);
+    if (s == NULL) return;
+    s->v[0] = x1; s->v[1] = y1; s->v[2] = x2; s->v[3] = y2;
+}
+
+// Queue a filled triangle
+void render_batch_triangle(float x0, float y0, float x1, float y1, float x2, float y2, SDL_Color color) {
+    Shape *s = add_shape(SHAPE_TRIANGLE, color);
+    if (s == NULL) return;
+    s->v[0] = x0; s->v[1] = y0; s->v[2] = x1; s->v[3] = y1; s->v[4] = x2; s->v[5] = y2;
+}
+
+// Queue a filled circle approximated by a fan of segments triangles
+void render_batch_circle(float cx, float cy, float radius, int segments, SDL_Color color) {
+    if (segments < 3) segments = 3;
+    Shape *s = add_shape(SHAPE_CIRCLE, color);
+    if (s == NULL) return;
+    s->v[0] = cx; s->v[1] = cy; s->v[2] = radius;
+    s->segments = segments;
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+static bool geometry_failed = false;
+
+// Make room for the vertices and indices of every queued shape
+static bool reserve_geometry(void) {
+    int needed_vertices = 0;
+    int needed_indices = 0;
+    for (int i = 0; i < num_shapes; i++) {
+        if (shapes[i].type == SHAPE_CIRCLE) {
+            needed_vertices += shapes[i].segments + 1;
+            needed_indices += shapes[i].segments * 3;
+        } else if (shapes[i].type == SHAPE_TRIANGLE) {
+            needed_vertices += 3;
+            needed_indices += 3;
+        } else {
+            needed_vertices += 4;
+            needed_indices += 6;
+        }
+    }
+
+    if (needed_vertices > vertex_capacity) {
+        SDL_Vertex *grown = realloc(vertices, (size_t)needed_vertices * sizeof(SDL_Vertex));
+        if (grown == NULL) return false;
+        vertices = grown;
+        vertex_capacity = needed_vertices;
+    }
+    if (needed_indices > index_capacity) {
+        int *grown = realloc(indices, (size_t)needed_indices * sizeof(int));
+        if (grown == NULL) return false;
+        indices = grown;
+        index_capacity = needed_indices;
+    }
+    return true;
+}
+
+// Submit every queued shape as one triangle list
+static bool flush_geometry(SDL_Renderer *renderer) {
+    if (!reserve_geometry()) {
+        perror("Failed to allocate render batch vertices");
+        return false;
+    }
+
+    int nv = 0;
+    int ni = 0;
+    for (int i = 0; i < num_shapes; i++) {
+        const Shape *s = &shapes[i];
+        SDL_Vertex vertex = {{0, 0}, s->color, {0, 0}};
+        int first = nv;
+
+        switch (s->type) {
+            case SHAPE_RECT:
+                vertex.position = (SDL_FPoint){s->v[0], s->v[1]};
+                vertices[nv++] = vertex;
+                vertex.position = (SDL_FPoint){s->v[0] + s->v[2], s->v[1]};
+                vertices[nv++] = vertex;
+                vertex.position = (SDL_FPoint){s->v[0] + s->v[2], s->v[1] + s->v[3]};
+                vertices[nv++] = vertex;
+                vertex.position = (SDL_FPoint){s->v[0], s->v[1] + s->v[3]};
+                vertices[nv++] = vertex;
+                break;
+            case SHAPE_LINE: {
+                // A one pixel wide quad through the centres of the end pixels,
+                // extended by half a pixel at each end
+                float x1 = s->v[0] + 0.5f, y1 = s->v[1] + 0.5f;
+                float x2 = s->v[2] + 0.5f, y2 = s->v[3] + 0.5f;
+                float dx = x2 - x1, dy = y2 - y1;
+                float length = sqrtf(dx * dx + dy * dy);
+                dx = dx / length * 0.5f;
+                dy = dy / length * 0.5f;
+                vertex.position = (SDL_FPoint){x1 - dx - dy, y1 - dy + dx};
+                vertices[nv++] = vertex;
+                vertex.position = (SDL_FPoint){x2 + dx - dy, y2 + dy + dx};
+                vertices[nv++] = vertex;
+                vertex.position = (SDL_FPoint){x2 + dx + dy, y2 + dy - dx};
+                vertices[nv++] = vertex;
+                vertex.position = (SDL_FPoint){x1 - dx + dy, y1 - dy - dx};
+                vertices[nv++] = vertex;
+                break;
+            }
+            case SHAPE_TRIANGLE:
+                for (int k = 0; k < 3; k++) {
+                    vertex.position = (SDL_FPoint){s->v[k * 2], s->v[k * 2 + 1]};
+                    vertices[nv++] = vertex;
+                    indices[ni++] = first + k;
+                }
+                continue;
+            case SHAPE_CIRCLE:
+                vertex.position = (SDL_FPoint){s->v[0], s->v[1]};
+                vertices[nv++] = vertex;
+                for (int k = 0; k < s->segments; k++) {
+                    float angle = k * 2.0f * (float)M_PI / s->segments;
+                    vertex.position = (SDL_FPoint){s->v[0] + s->v[2] * cosf(angle),
+                                                   s->v[1] + s->v[2] * sinf(angle)};
+                    vertices[nv++] = vertex;
+                    indices[ni++] = first;
+                    indices[ni++] = first + 1 + k;
+                    indices[ni++] = first + 1 + (k + 1) % s->segments;
+                }
+                continue;
+        }
+
+        // Two triangles per quad
+        indices[ni++] = first;
+        indices[ni++] = first + 1;
+        indices[ni++] = first + 2;
+        indices[ni++] = first;
+        indices[ni++] = first + 2;
+        indices[ni++] = first + 3;
+    }
+
+    if (SDL_RenderGeometry(renderer, NULL, vertices, nv, indices, ni) < 0) {
+        printf("SDL_RenderGeometry failed, drawing shapes directly: %s\n", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+#endif
+
+// Scanline fill of a triangle
+static void fill_triangle(SDL_Renderer *renderer, const float *v) {
+    float min_y = fminf(v[1], fminf(v[3], v[5]));
+    float max_y = fmaxf(v[1], fmaxf(v[3], v[5]));
+    for (int y = (int)ceilf(min_y); y <= (int)floorf(max_y); y++) {
+        float x_start = INFINITY;
+        float x_end = -INFINITY;
+        for (int e = 0; e < 3; e++) {
+            float ax = v[e * 2], ay = v[e * 2 + 1];
+            float bx = v[(e * 2 + 2) % 6], by = v[(e * 2 + 3) % 6];
+            if ((y < ay && y < by) || (y > ay && y > by)) continue;
+            float x = ay == by ? ax : ax + (y - ay) * (bx - ax) / (by - ay);
+            if (ay == by) {
+                x_start = fminf(x_start, fminf(ax, bx));
+                x_end = fmaxf(x_end, fmaxf(ax, bx));
+            } else {
+                x_start = fminf(x_start, x);
+                x_end = fmaxf(x_end, x);
+            }
+        }
+        if (x_start <= x_end) {
+            SDL_RenderDrawLine(renderer, (int)x_start, y, (int)x_end, y);
+        }
+    }
+}
+
+// Draw the queued shapes one by one, joining runs of same-coloured
+// rectangles into SDL_RenderFillRects calls
+static void flush_direct(SDL_Renderer *renderer) {
+    SDL_Rect run[RECT_RUN_MAX];
+    int run_length = 0;
+
+    for (int i = 0; i < num_shapes; i++) {
+        const Shape *s = &shapes[i];
+        SDL_Color c = s->color;
+
+        if (s->type == SHAPE_RECT) {
+            run[run_length++] = (SDL_Rect){(int)s->v[0], (int)s->v[1], (int)s->v[2], (int)s->v[3]};
+            const Shape *next = i + 1 < num_shapes ? &shapes[i + 1] : NULL;
+            bool same = next != NULL && next->type == SHAPE_RECT &&
+                        next->color.r == c.r && next->color.g == c.g &&
+                        next->color.b == c.b && next->color.a == c.a;
+            if (!same || run_length == RECT_RUN_MAX) {
+                SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+                SDL_RenderFillRects(renderer, run, run_length);
+                run_length = 0;
+            }
+            continue;
+        }
+
+        SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+        if (s->type == SHAPE_LINE) {
+            SDL_RenderDrawLine(renderer, (int)s->v[0], (int)s->v[1], (int)s->v[2], (int)s->v[3]);
+        } else if (s->type == SHAPE_TRIANGLE) {
+            fill_triangle(renderer, s->v);
+        } else {
+            // Spokes from the centre, as the circles were drawn before
+            for (int k = 0; k < s->segments; k++) {
+                float angle = k * 2.0f * (float)M_PI / s->segments;
+                SDL_RenderDrawLine(renderer, (int)s->v[0], (int)s->v[1],
+                                   (int)(s->v[0] + s->v[2] * cosf(angle)),
+                                   (int)(s->v[1] + s->v[2] * sinf(angle)));
+            }
+        }
+    }
+}
+
+// Draw everything queued since the last flush and empty the batch
+void render_batch_flush(SDL_Renderer *renderer) {
+    if (num_shapes == 0) return;
+
+    bool drawn = false;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (!geometry_failed) {
+        drawn = flush_geometry(renderer);
+        geometry_failed = !drawn;
+    }
+#endif
+    if (!drawn) {
+        flush_direct(renderer);
+    }
+    num_shapes = 0;
+}
+
+// Free the batch buffers
+void render_batch_free(void) {
+    free(shapes);
+    free(vertices);
+    free(indices);
+    shapes = NULL;
+    vertices = NULL;
+    indices = NULL;
+    num_shapes = shape_capacity = vertex_capacity = index_capacity = 0;
+}
@@ -9,14 +9,89 @@
 #include <errno.h>
 #include "../include/shared_memory.h"
 #include "../include/game.h"
+#include "../include/ai_lod.h"
+#include "../include/intercept.h"
+#include "../include/enemy_ai.h"
+#include "../include/chunk_world.h"
+#include "../include/freecells.h"
 
 // Shared memory and semaphore handles
 int shm_id = -1;
 sem_t* sem_id = NULL;
 GameState* game_state = NULL;
 
-// Initialize shared memory for game state
-bool init_shared_memory(void) {
+// Round a size up to a multiple of SHM_REGION_ALIGN
+static size_t align_region(size_t size) {
+    return (size + SHM_REGION_ALIGN - 1) & ~(size_t)(SHM_REGION_ALIGN - 1);
+}
+
+// Size of one set of map buffers: tiles, component labels and free-cell index
+static size_t map_buffers_size(int map_width, int map_height) {
+    size_t cells = (size_t)MAP_STRIDE_FOR(map_width) * map_height;
+    return align_region(sizeof(MapTile) * cells) +
+           align_region(sizeof(unsigned short) * cells) +
+           align_region(freecells_size(map_width, map_height));
+}
+
+// Size of the shared segment for a map: the GameState header followed by
+// two sets of map buffers (live and staging), or by the chunk store of a
+// streamed level. Everything else in the header has a fixed size, so a
+// streamed level's segment grows only with its chunk count, never per tile.
+size_t shared_segment_size(int map_width, int map_height, bool streamed) {
+    size_t tiles = streamed ? align_region(chunk_world_size(map_width, map_height))
+                            : map_buffers_size(map_width, map_height) * 2;
+    return align_region(sizeof(GameState)) + tiles;
+}
+
+// Point a map at a set of map buffers starting at region; returns the end
+static char *bind_map_buffers(GameMap *map, char *region, int map_width, int map_height) {
+    size_t cells = (size_t)MAP_STRIDE_FOR(map_width) * map_height;
+    map->width = map_width;
+    map->height = map_height;
+    map->stride = MAP_STRIDE_FOR(map_width);
+    map->chunks = NULL;
+    map->tiles = (MapTile *)region;
+    region += align_region(sizeof(MapTile) * cells);
+    map->components = (unsigned short *)region;
+    region += align_region(sizeof(unsigned short) * cells);
+    map->free_cells = freecells_place(region, map_width, map_height);
+    return region + align_region(freecells_size(map_width, map_height));
+}
+
+// Point the per-tile arrays of a freshly attached segment at their regions
+static void bind_tile_regions(GameState *state, int map_width, int map_height, bool streamed) {
+    char *region = (char *)state + align_region(sizeof(GameState));
+
+    if (streamed) {
+        state->map.width = map_width;
+        state->map.height = map_height;
+        state->map.stride = MAP_STRIDE_FOR(map_width);
+        state->map.tiles = NULL;
+        state->map.components = NULL;
+        state->map.free_cells = NULL;
+        state->map.chunks = chunk_world_place(region, map_width, map_height);
+        region += align_region(chunk_world_size(map_width, map_height));
+    } else {
+        region = bind_map_buffers(&state->map, region, map_width, map_height);
+        bind_map_buffers(&state->staged_map, region, map_width, map_height);
+    }
+}
+
+// Initialize shared memory for game state with a map of the given size
+// (MIN_MAP_SIZE..MAX_MAP_SIZE tiles on each side, or up to
+// MAX_STREAMED_MAP_SIZE when streamed). Streamed maps keep only a bounded
+// pool of chunks resident instead of every tile. The first level is
+// generated from seed (0 = from the clock), or loaded from level_path if set.
+// Child processes are forked after this, so the segment is attached at the
+// same address in all of them and the pointers into it stay valid.
+bool init_shared_memory(int map_width, int map_height, bool streamed, unsigned int seed, const char *level_path) {
+    int max_size = streamed ? MAX_STREAMED_MAP_SIZE : MAX_MAP_SIZE;
+    if (map_width < MIN_MAP_SIZE || map_width > max_size ||
+        map_height < MIN_MAP_SIZE || map_height > max_size) {
+        printf("Error: map size %dx%d is outside %d..%d\n", map_width, map_height, MIN_MAP_SIZE, max_size);
+        return false;
+    }
+    
     // Generate a key using ftok
     key_t key = ftok(SHM_PATH, SHM_ID);
     if (key == -1) {
@@ -25,7 +100,16 @@ bool init_shared_memory(void) {
     }
     
     // Create shared memory segment
-    shm_id = shmget(key, sizeof(GameState), IPC_CREAT | 0666);
+    size_t segment_size = shared_segment_size(map_width, map_height, streamed);
+    shm_id = shmget(key, segment_size, IPC_CREAT | 0666);
+    if (shm_id == -1 && errno == EINVAL) {
+        // A segment left over from an earlier run is too small; replace it
+        int stale_id = shmget(key, 0, 0666);
+        if (stale_id != -1) {
+            shmctl(stale_id, IPC_RMID, NULL);
+        }
+        shm_id = shmget(key, segment_size, IPC_CREAT | 0666);
+    }
     if (shm_id == -1) {
         perror("shmget failed");
         return false;
@@ -39,9 +123,8 @@ bool init_shared_memory(void) {
     }
 
     // Initialize game state in shared memory
-    memset(game_state, 0, sizeof(GameState));
-    game_state->map.width = MAP_WIDTH;
-    game_state->map.height = MAP_HEIGHT;
+    memset(game_state, 0, segment_size);
+    bind_tile_regions(game_state, map_width, map_height, streamed);
     game_state->game_over = false;
     
     // Initialize timer
@@ -52,177 +135,22 @@ bool init_shared_memory(void) {
     game_state->keys_collected = 0;
     game_state->current_level = 1;  // Start at level 1
     game_state->level_complete = false;
-    
-    // Initialize map with walls around the edges
-    for (int y = 0; y < MAP_HEIGHT; y++) {
-        for (int x = 0; x < MAP_WIDTH; x++) {
-            if (x == 0 || y == 0 || x == MAP_WIDTH-1 || y == MAP_HEIGHT-1) {
-                game_state->map.tiles[y][x] = TILE_WALL;
-            } else {
-                game_state->map.tiles[y][x] = TILE_EMPTY;
-            }
-        }
-    }
-    
-    // Create a more complex maze using a cellular automaton approach
-    // First, randomly place walls
-    for (int y = 1; y < MAP_HEIGHT-1; y++) {
-        for (int x = 1; x < MAP_WIDTH-1; x++) {
-            // Keep starting area clear (top-left corner)
-            if (x < 5 && y < 5) continue;
-            
-            // 30% chance of a wall
-            if (rand() % 100 < 30) {
-                game_state->map.tiles[y][x] = TILE_WALL;
-            }
-        }
-    }
-    
-    // Smooth the maze using a cellular automaton approach
-    for (int iteration = 0; iteration < 3; iteration++) {
-        // Create a temporary copy of the map
-        TileType temp_map[MAP_HEIGHT][MAP_WIDTH];
-        memcpy(temp_map, game_state->map.tiles, sizeof(temp_map));
-        
-        for (int y = 1; y < MAP_HEIGHT-1; y++) {
-            for (int x = 1; x < MAP_WIDTH-1; x++) {
-                // Count walls in 3x3 neighborhood
-                int wall_count = 0;
-                for (int dy = -1; dy <= 1; dy++) {
-                    for (int dx = -1; dx <= 1; dx++) {
-                        if (game_state->map.tiles[y+dy][x+dx] == TILE_WALL) {
-                            wall_count++;
-                        }
-                    }
-                }
-                
-                // Apply cellular automaton rules
-                if (wall_count >= 5) {
-                    temp_map[y][x] = TILE_WALL;
-                } else if (wall_count <= 2) {
-                    temp_map[y][x] = TILE_EMPTY;
-                }
-                // Otherwise, keep the current state
-            }
-        }
-        
-        // Update the map with the smoothed version
-        memcpy(game_state->map.tiles, temp_map, sizeof(temp_map));
-    }
-    
-    // Ensure the player's starting position is clear
-    for (int y = 1; y < 8; y++) {
-        for (int x = 1; x < 8; x++) {
-            game_state->map.tiles[y][x] = TILE_EMPTY;
-        }
-    }
-    
-    // Also create clear paths outward from the starting area in four directions
-    // Path to the right
-    for (int x = 8; x < 15; x++) {
-        game_state->map.tiles[4][x] = TILE_EMPTY;
-        game_state->map.tiles[5][x] = TILE_EMPTY;
-    }
-    
-    // Path downward
-    for (int y = 8; y < 15; y++) {
-        game_state->map.tiles[y][4] = TILE_EMPTY;
-        game_state->map.tiles[y][5] = TILE_EMPTY;
-    }
-    
-    // Place a door at the end of each starting path
-    game_state->map.tiles[4][14] = TILE_DOOR;
-    game_state->map.tiles[14][4] = TILE_DOOR;
-    
-    // Add keys in different areas of the map (far from start)
-    for (int i = 0; i < game_state->keys_required; i++) {
-        int x, y;
-        do {
-            // Place keys farther from the starting point
-            x = 20 + rand() % (MAP_WIDTH - 25);
-            y = 20 + rand() % (MAP_HEIGHT - 25);
-        } while (game_state->map.tiles[y][x] != TILE_EMPTY);
-        
-        game_state->map.tiles[y][x] = TILE_KEY;
-        
-        // Create a path from this key to either the starting area or the map center
-        int path_x = x;
-        int path_y = y;
-        int target_x, target_y;
-        
-        // Alternate between creating paths to start and center to create connections
-        if (i % 2 == 0) {
-            // Path to starting area
-            target_x = 3;
-            target_y = 3;
-        } else {
-            // Path to center of map
-            target_x = MAP_WIDTH / 2;
-            target_y = MAP_HEIGHT / 2;
-        }
-        
-        // Create path from key to target
-        while ((abs(path_x - target_x) > 3) || (abs(path_y - target_y) > 3)) {
-            // Choose direction based on which axis has greater distance
-            if (abs(path_x - target_x) > abs(path_y - target_y)) {
-                // Move horizontally
-                path_x += (path_x < target_x) ? 1 : -1;
-            } else {
-                // Move vertically
-                path_y += (path_y < target_y) ? 1 : -1;
-            }
-            
-            // Clear current tile if it's a wall
-            if (game_state->map.tiles[path_y][path_x] == TILE_WALL) {
-                game_state->map.tiles[path_y][path_x] = TILE_EMPTY;
-            }
-            
-            // Occasionally place a door (5% chance instead of 10%)
-            if (rand() % 100 < 5 && game_state->map.tiles[path_y][path_x] == TILE_EMPTY) {
-                game_state->map.tiles[path_y][path_x] = TILE_DOOR;
-            }
-        }
-    }
-    
-    // Add treasures - reduced quantity for balance
-    for (int i = 0; i < MAP_WIDTH * MAP_HEIGHT / 100; i++) { // Reduced from /50 to /100
-        int x = rand() % (MAP_WIDTH - 2) + 1;
-        int y = rand() % (MAP_HEIGHT - 2) + 1;
-        if (game_state->map.tiles[y][x] == TILE_EMPTY) {
-            game_state->map.tiles[y][x] = TILE_TREASURE;
-        }
-    }
-    
-    // Add exit in the far corner - initially inaccessible until keys are collected
-    game_state->map.tiles[MAP_HEIGHT-2][MAP_WIDTH-2] = TILE_EMPTY; // Clear any walls near exit
-    game_state->map.tiles[MAP_HEIGHT-3][MAP_WIDTH-2] = TILE_EMPTY;
-    game_state->map.tiles[MAP_HEIGHT-2][MAP_WIDTH-3] = TILE_EMPTY;
-    game_state->map.tiles[MAP_HEIGHT-3][MAP_WIDTH-3] = TILE_EMPTY;
-    game_state->map.tiles[MAP_HEIGHT-2][MAP_WIDTH-2] = TILE_EXIT;
-    
-    // Create a path from exit toward the center of the map
-    int path_x = MAP_WIDTH - 2;
-    int path_y = MAP_HEIGHT - 2;
-    int target_x = MAP_WIDTH / 2;
-    int target_y = MAP_HEIGHT / 2;
-    
-    // Clear a path from exit toward center (using simple pathfinding)
-    while (path_x > target_x || path_y > target_y) {
-        // Move toward center, one step at a time
-        if (path_x > target_x) {
-            path_x--;
-            game_state->map.tiles[path_y][path_x] = TILE_EMPTY;
-        }
-        if (path_y > target_y) {
-            path_y--;
-            game_state->map.tiles[path_y][path_x] = TILE_EMPTY;
+    ai_lod_init(game_state, AI_LOD_DEFAULT_BUDGET_US);
+    intercept_init(game_state);
+    enemy_ai_init(game_state);
+    
+    // Generate the first level; every level is derived from this seed
+    game_state->seed = seed != 0 ? seed : (unsigned int)time(NULL);
+    if (level_path != NULL) {
+        if (!load_level(game_state, level_path)) {
+            shmdt(game_state);
+            shmctl(shm_id, IPC_RMID, NULL);
+            game_state = NULL;
+            shm_id = -1;
+            return false;
         }
-        
-        // Also clear adjacent tiles to make the path wider and more visible
-        if (path_x + 1 < MAP_WIDTH) 
-            game_state->map.tiles[path_y][path_x + 1] = TILE_EMPTY;
-        if (path_y + 1 < MAP_HEIGHT) 
-            game_state->map.tiles[path_y + 1][path_x] = TILE_EMPTY;
+    } else {
+        generate_level(game_state, 1);
     }
     
     // Create POSIX semaphore for synchronization
@@ -0,0 +1,16 @@
+#include <math.h>
+#include "../include/sine_lut.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// sin of each 1/SINE_LUT_SIZE of a turn
+float sine_lut[SINE_LUT_SIZE];
+
+// Fill the sine table
+void sine_lut_init(void) {
+    for (int i = 0; i < SINE_LUT_SIZE; i++) {
+        sine_lut[i] = (float)sin(i * 2.0 * M_PI / SINE_LUT_SIZE);
+    }
+}
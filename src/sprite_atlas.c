@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/sprite_atlas.h"
+#include "../include/render_batch.h"
+#include "../include/game.h"
+
+// Samples per pixel along each axis when rasterizing (antialiasing)
+#define ATLAS_SUPERSAMPLE 4
+
+// Most parts in one sprite
+#define SPRITE_MAX_PARTS 3
+
+// Filled shapes a sprite is made of, in cell coordinates (pixel edges at
+// integers, so the centre of the top-left pixel is (0.5, 0.5))
+typedef enum {
+    PART_RECT,               // x, y, w, h
+    PART_TRIANGLE,           // x0, y0, x1, y1, x2, y2
+    PART_CIRCLE              // cx, cy, radius
+} PartType;
+
+typedef struct {
+    PartType type;
+    SDL_Color color;
+    float v[6];
+} SpritePart;
+
+typedef struct {
+    int num_parts;
+    SpritePart parts[SPRITE_MAX_PARTS];
+} SpriteShape;
+
+#define WHITE {255, 255, 255, 255}
+#define T TILE_SIZE
+
+// The shapes, matching what the render code used to draw
+static const SpriteShape sprite_shapes[SPRITE_COUNT] = {
+    [SPRITE_PLAYER_BODY] = {1, {{PART_CIRCLE, WHITE, {T/2 + 0.5f, T/2 + 0.5f, T/3 + 0.5f}}}},
+    [SPRITE_PLAYER_CORE] = {1, {{PART_CIRCLE, WHITE, {T/2 + 0.5f, T/2 + 0.5f, T/6 + 0.5f}}}},
+    [SPRITE_KEY] = {3, {
+        {PART_CIRCLE, WHITE, {T/2 + 0.5f, T/2 + 0.5f, T/3 + 0.5f}},
+        {PART_RECT, WHITE, {T/2, T/2 + T/6, 1, T/3 + 1}},                   // Stem
+        {PART_RECT, WHITE, {T/2 - 2, T/2 + T/2 - 1, 5, 1}}                  // Bit
+    }},
+    [SPRITE_TREASURE] = {3, {
+        {PART_RECT, {150, 100, 50, 255}, {2, T/2, T - 4, T/2 - 2}},         // Chest base
+        {PART_RECT, {200, 150, 50, 255}, {2, 2, T - 4, T/2 - 2}},           // Chest top
+        {PART_RECT, {220, 180, 40, 255}, {T/2 - 2, T/2 - 2, 4, 4}}          // Lock
+    }},
+    [SPRITE_ENEMY_BODY] = {1, {{PART_TRIANGLE, WHITE,
+        {T/2 + 0.5f, T/4, T/4, T*3/4 + 1, T*3/4 + 1, T*3/4 + 1}}}},
+    [SPRITE_EYES_CHASE] = {1, {{PART_RECT, WHITE, {T*3/8, T*3/8, T/4, T/4}}}},
+    [SPRITE_EYES_RANDOM] = {2, {
+        {PART_RECT, WHITE, {T*5/16, T*3/8, T/8, T/8}},
+        {PART_RECT, WHITE, {T*9/16, T*3/8, T/8, T/8}}
+    }},
+    [SPRITE_EYES_GUARD] = {1, {{PART_RECT, WHITE, {T*3/8, T*3/8, T/4, T/8}}}},
+    [SPRITE_EYES_SMART] = {2, {
+        {PART_RECT, WHITE, {T*3/8, T*3/8, T/4, T/4}},
+        {PART_RECT, {255, 0, 0, 255}, {T/2 - T/16, T/2 - T/16, T/8, T/8}}  // Red pupil
+    }},
+};
+
+// A sprite waiting for the next flush
+typedef struct {
+    SpriteId id;
+    int x;
+    int y;
+    SDL_Color tint;
+} QueuedSprite;
+
+// Atlas state (main process only)
+static SDL_Texture *atlas = NULL;
+static SDL_Renderer *atlas_renderer = NULL;
+static bool atlas_failed = false;
+static QueuedSprite *queue = NULL;
+static int queue_length = 0;
+static int queue_capacity = 0;
+static SDL_Vertex *vertices = NULL;
+static int *indices = NULL;
+static int geometry_capacity = 0;        // Sprites the vertex arrays hold
+
+// Drop the atlas texture; it is rebuilt on next use
+static void destroy_texture(void) {
+    if (atlas != NULL) {
+        SDL_DestroyTexture(atlas);
+        atlas = NULL;
+    }
+    atlas_renderer = NULL;
+    atlas_failed = false;
+}
+
+// Whether the point (x, y) lies inside a part
+static bool part_contains(const SpritePart *p, float x, float y) {
+    const float *v = p->v;
+    switch (p->type) {
+        case PART_RECT:
+            return x >= v[0] && x < v[0] + v[2] && y >= v[1] && y < v[1] + v[3];
+        case PART_CIRCLE:
+            return (x - v[0]) * (x - v[0]) + (y - v[1]) * (y - v[1]) <= v[2] * v[2];
+        case PART_TRIANGLE: {
+            float d0 = (v[2] - v[0]) * (y - v[1]) - (v[3] - v[1]) * (x - v[0]);
+            float d1 = (v[4] - v[2]) * (y - v[3]) - (v[5] - v[3]) * (x - v[2]);
+            float d2 = (v[0] - v[4]) * (y - v[5]) - (v[1] - v[5]) * (x - v[4]);
+            return (d0 >= 0 && d1 >= 0 && d2 >= 0) || (d0 <= 0 && d1 <= 0 && d2 <= 0);
+        }
+    }
+    return false;
+}
+
+// Rasterize a sprite into its cell of the atlas pixels (RGBA8888, straight
+// alpha), compositing its parts in order with supersampled coverage
+static void rasterize_sprite(const SpriteShape *shape, Uint32 *pixels, int pitch) {
+    const int samples = ATLAS_SUPERSAMPLE * ATLAS_SUPERSAMPLE;
+
+    for (int py = 0; py < TILE_SIZE; py++) {
+        for (int px = 0; px < TILE_SIZE; px++) {
+            // Premultiplied colour and alpha, composited part over part
+            float r = 0, g = 0, b = 0, a = 0;
+            for (int k = 0; k < shape->num_parts; k++) {
+                const SpritePart *part = &shape->parts[k];
+                int inside = 0;
+                for (int sy = 0; sy < ATLAS_SUPERSAMPLE; sy++) {
+                    for (int sx = 0; sx < ATLAS_SUPERSAMPLE; sx++) {
+                        float x = px + (sx + 0.5f) / ATLAS_SUPERSAMPLE;
+                        float y = py + (sy + 0.5f) / ATLAS_SUPERSAMPLE;
+                        inside += part_contains(part, x, y);
+                    }
+                }
+                float coverage = (float)inside / samples * part->color.a / 255.0f;
+                r = part->color.r * coverage + r * (1.0f - coverage);
+                g = part->color.g * coverage + g * (1.0f - coverage);
+                b = part->color.b * coverage + b * (1.0f - coverage);
+                a = coverage + a * (1.0f - coverage);
+            }
+
+            Uint32 pixel = 0;
+            if (a > 0) {
+                pixel = (Uint32)(r / a + 0.5f) << 24 | (Uint32)(g / a + 0.5f) << 16 |
+                        (Uint32)(b / a + 0.5f) << 8 | (Uint32)(a * 255.0f + 0.5f);
+            }
+            pixels[py * pitch + px] = pixel;
+        }
+    }
+}
+
+// Rasterize every sprite and upload the atlas texture
+static bool build_atlas(SDL_Renderer *renderer) {
+    int width = SPRITE_COUNT * TILE_SIZE;
+    Uint32 *pixels = malloc((size_t)width * TILE_SIZE * sizeof(Uint32));
+    if (pixels == NULL) {
+        perror("Failed to allocate sprite atlas");
+        return false;
+    }
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        rasterize_sprite(&sprite_shapes[i], pixels + i * TILE_SIZE, width);
+    }
+
+    atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, width, TILE_SIZE);
+    if (atlas == NULL) {
+        printf("Failed to create sprite atlas, drawing sprites as shapes: %s\n", SDL_GetError());
+        free(pixels);
+        return false;
+    }
+    SDL_UpdateTexture(atlas, NULL, pixels, width * (int)sizeof(Uint32));
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+    free(pixels);
+
+    atlas_renderer = renderer;
+    return true;
+}
+
+// Queue a sprite with its cell's top-left corner at (x, y), its colours
+// multiplied by tint
+void sprite_atlas_draw(SpriteId id, int x, int y, SDL_Color tint) {
+    if ((unsigned)id >= SPRITE_COUNT) return;
+
+    if (queue_length == queue_capacity) {
+        int capacity = queue_capacity ? queue_capacity * 2 : 256;
+        QueuedSprite *grown = realloc(queue, (size_t)capacity * sizeof(QueuedSprite));
+        if (grown == NULL) {
+            perror("Failed to grow sprite queue");
+            return;
+        }
+        queue = grown;
+        queue_capacity = capacity;
+    }
+    queue[queue_length++] = (QueuedSprite){id, x, y, tint};
+}
+
+// Without an atlas: queue the sprites' shapes on the render batch and draw it
+static void flush_shapes(SDL_Renderer *renderer) {
+    for (int i = 0; i < queue_length; i++) {
+        const QueuedSprite *q = &queue[i];
+        const SpriteShape *shape = &sprite_shapes[q->id];
+        for (int k = 0; k < shape->num_parts; k++) {
+            const SpritePart *p = &shape->parts[k];
+            SDL_Color c = {
+                (Uint8)(p->color.r * q->tint.r / 255), (Uint8)(p->color.g * q->tint.g / 255),
+                (Uint8)(p->color.b * q->tint.b / 255), (Uint8)(p->color.a * q->tint.a / 255)
+            };
+            const float *v = p->v;
+            if (p->type == PART_RECT) {
+                render_batch_rect(q->x + (int)v[0], q->y + (int)v[1], (int)v[2], (int)v[3], c);
+            } else if (p->type == PART_CIRCLE) {
+                render_batch_circle(q->x + v[0], q->y + v[1], v[2], 32, c);
+            } else {
+                render_batch_triangle(q->x + v[0], q->y + v[1], q->x + v[2], q->y + v[3],
+                                      q->x + v[4], q->y + v[5], c);
+            }
+        }
+    }
+    render_batch_flush(renderer);
+}
+
+// Draw every queued sprite and empty the queue. Without an atlas texture the
+// sprites are drawn as shapes through the render batch, which is flushed.
+void sprite_atlas_flush(SDL_Renderer *renderer) {
+    if (queue_length == 0) return;
+
+    if (atlas_renderer != renderer && atlas != NULL) {
+        destroy_texture();
+    }
+    if (atlas == NULL && !atlas_failed) {
+        atlas_failed = !build_atlas(renderer);
+    }
+    if (atlas == NULL) {
+        flush_shapes(renderer);
+        queue_length = 0;
+        return;
+    }
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (queue_length > geometry_capacity) {
+        SDL_Vertex *grown_vertices = realloc(vertices, (size_t)queue_length * 4 * sizeof(SDL_Vertex));
+        if (grown_vertices != NULL) vertices = grown_vertices;
+        int *grown_indices = realloc(indices, (size_t)queue_length * 6 * sizeof(int));
+        if (grown_indices != NULL) indices = grown_indices;
+        if (grown_vertices == NULL || grown_indices == NULL) {
+            perror("Failed to allocate sprite vertices");
+            queue_length = 0;
+            return;
+        }
+        geometry_capacity = queue_length;
+    }
+
+    const float cell_u = 1.0f / SPRITE_COUNT;
+    for (int i = 0; i < queue_length; i++) {
+        const QueuedSprite *q = &queue[i];
+        float x0 = q->x, y0 = q->y;
+        float x1 = q->x + TILE_SIZE, y1 = q->y + TILE_SIZE;
+        float u0 = q->id * cell_u, u1 = (q->id + 1) * cell_u;
+        SDL_Vertex *v = &vertices[i * 4];
+        v[0] = (SDL_Vertex){{x0, y0}, q->tint, {u0, 0}};
+        v[1] = (SDL_Vertex){{x1, y0}, q->tint, {u1, 0}};
+        v[2] = (SDL_Vertex){{x1, y1}, q->tint, {u1, 1}};
+        v[3] = (SDL_Vertex){{x0, y1}, q->tint, {u0, 1}};
+        int *index = &indices[i * 6];
+        index[0] = i * 4; index[1] = i * 4 + 1; index[2] = i * 4 + 2;
+        index[3] = i * 4; index[4] = i * 4 + 2; index[5] = i * 4 + 3;
+    }
+    if (SDL_RenderGeometry(renderer, atlas, vertices, queue_length * 4, indices, queue_length * 6) < 0) {
+        printf("Failed to draw sprites: %s\n", SDL_GetError());
+    }
+#else
+    // One copy per sprite, tinted through the texture modulation
+    for (int i = 0; i < queue_length; i++) {
+        const QueuedSprite *q = &queue[i];
+        SDL_Rect src = {q->id * TILE_SIZE, 0, TILE_SIZE, TILE_SIZE};
+        SDL_Rect dest = {q->x, q->y, TILE_SIZE, TILE_SIZE};
+        SDL_SetTextureColorMod(atlas, q->tint.r, q->tint.g, q->tint.b);
+        SDL_SetTextureAlphaMod(atlas, q->tint.a);
+        SDL_RenderCopy(renderer, atlas, &src, &dest);
+    }
+#endif
+    queue_length = 0;
+}
+
+// Free the atlas and queues (at exit, or after SDL_RENDER_DEVICE_RESET; the
+// atlas is rebuilt on next use)
+void sprite_atlas_destroy(void) {
+    destroy_texture();
+    free(queue);
+    free(vertices);
+    free(indices);
+    queue = NULL;
+    vertices = NULL;
+    indices = NULL;
+    queue_length = queue_capacity = geometry_capacity = 0;
+}
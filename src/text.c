@@ -0,0 +1,538 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../include/text.h"
+
+// Glyphs in an atlas: the printable ASCII characters, then the glyph used
+// for every other character
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define GLYPH_UNKNOWN (GLYPH_LAST - GLYPH_FIRST + 1)
+#define GLYPH_COUNT (GLYPH_UNKNOWN + 1)
+#define GLYPH_ATLAS_COLUMNS 16
+#define GLYPH_MAX_LINES 16
+
+// A line of a glyph, end points included
+typedef struct {
+    int x1, y1, x2, y2;
+} GlyphLine;
+
+// A size of glyphs rasterized into a texture (main process only)
+typedef struct {
+    int size;                // 0 if the slot is free
+    int cell;                // Cell width and height in the texture
+    SDL_Texture *texture;
+    SDL_Renderer *renderer;
+} GlyphAtlas;
+
+// Laid out quads of a string, relative to its origin
+typedef struct {
+    bool used;
+    char text[TEXT_CACHE_MAX_LENGTH + 1];
+    int size;
+    SDL_Color color;
+    int num_vertices;
+    SDL_Vertex vertices[TEXT_CACHE_MAX_LENGTH * 4];
+} TextCacheEntry;
+
+static GlyphAtlas atlases[TEXT_MAX_ATLASES];
+static int next_atlas = 0;           // Slot replaced when all are in use
+static TextCacheEntry text_cache[TEXT_CACHE_ENTRIES];
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+static SDL_Vertex placed[TEXT_CACHE_MAX_LENGTH * 4];  // Cached quads moved into place
+static int quad_indices[TEXT_CACHE_MAX_LENGTH * 6];
+static bool quad_indices_ready = false;
+#endif
+
+// Lines of a character spanning size x size pixels from (0, 0); returns the
+// number of lines
+static int glyph_lines(char c, int size, GlyphLine *out) {
+    int x = 0;
+    int y = 0;
+    int n = 0;
+#define LINE(ax, ay, bx, by) (out[n++] = (GlyphLine){(ax), (ay), (bx), (by)})
+
+    switch(c) {
+        case 'A':
+            LINE(x, y + size, x + size/2, y);
+            LINE(x + size/2, y, x + size, y + size);
+            LINE(x + size/4, y + size/2, x + 3*size/4, y + size/2);
+            break;
+        case 'B':
+            LINE(x, y, x, y + size);
+            LINE(x, y, x + 2*size/3, y);
+            LINE(x + 2*size/3, y, x + size, y + size/4);
+            LINE(x + size, y + size/4, x + 2*size/3, y + size/2);
+            LINE(x, y + size/2, x + 2*size/3, y + size/2);
+            LINE(x + 2*size/3, y + size/2, x + size, y + 3*size/4);
+            LINE(x + size, y + 3*size/4, x + 2*size/3, y + size);
+            LINE(x, y + size, x + 2*size/3, y + size);
+            break;
+        case 'C':
+            LINE(x + size, y, x + size/3, y);
+            LINE(x + size/3, y, x, y + size/3);
+            LINE(x, y + size/3, x, y + 2*size/3);
+            LINE(x, y + 2*size/3, x + size/3, y + size);
+            LINE(x + size/3, y + size, x + size, y + size);
+            break;
+        case 'D':
+            LINE(x, y, x, y + size);
+            LINE(x, y, x + 2*size/3, y);
+            LINE(x + 2*size/3, y, x + size, y + size/3);
+            LINE(x + size, y + size/3, x + size, y + 2*size/3);
+            LINE(x + size, y + 2*size/3, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x, y + size);
+            break;
+        case 'E':
+            LINE(x, y, x, y + size);
+            LINE(x, y, x + size, y);
+            LINE(x, y + size/2, x + 2*size/3, y + size/2);
+            LINE(x, y + size, x + size, y + size);
+            break;
+        case 'F':
+            LINE(x, y, x, y + size);
+            LINE(x, y, x + size, y);
+            LINE(x, y + size/2, x + 2*size/3, y + size/2);
+            break;
+        case 'G':
+            LINE(x + size, y, x + size/3, y);
+            LINE(x + size/3, y, x, y + size/3);
+            LINE(x, y + size/3, x, y + 2*size/3);
+            LINE(x, y + 2*size/3, x + size/3, y + size);
+            LINE(x + size/3, y + size, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x + size, y + 2*size/3);
+            LINE(x + size, y + 2*size/3, x + size, y + size/2);
+            LINE(x + size, y + size/2, x + 2*size/3, y + size/2);
+            break;
+        case 'H':
+            LINE(x, y, x, y + size);
+            LINE(x + size, y, x + size, y + size);
+            LINE(x, y + size/2, x + size, y + size/2);
+            break;
+        case 'I':
+            LINE(x, y, x + size, y);
+            LINE(x + size/2, y, x + size/2, y + size);
+            LINE(x, y + size, x + size, y + size);
+            break;
+        case 'K':
+            LINE(x, y, x, y + size);
+            LINE(x, y + size/2, x + size, y);
+            LINE(x, y + size/2, x + size, y + size);
+            break;
+        case 'L':
+            LINE(x, y, x, y + size);
+            LINE(x, y + size, x + size, y + size);
+            break;
+        case 'M':
+            LINE(x, y, x, y + size);
+            LINE(x, y, x + size/2, y + size/2);
+            LINE(x + size/2, y + size/2, x + size, y);
+            LINE(x + size, y, x + size, y + size);
+            break;
+        case 'N':
+            LINE(x, y, x, y + size);
+            LINE(x, y, x + size, y + size);
+            LINE(x + size, y, x + size, y + size);
+            break;
+        case 'O':
+            LINE(x + size/3, y, x + 2*size/3, y);
+            LINE(x + 2*size/3, y, x + size, y + size/3);
+            LINE(x + size, y + size/3, x + size, y + 2*size/3);
+            LINE(x + size, y + 2*size/3, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x + size/3, y + size);
+            LINE(x + size/3, y + size, x, y + 2*size/3);
+            LINE(x, y + 2*size/3, x, y + size/3);
+            LINE(x, y + size/3, x + size/3, y);
+            break;
+        case 'P':
+            LINE(x, y, x, y + size);
+            LINE(x, y, x + 2*size/3, y);
+            LINE(x + 2*size/3, y, x + size, y + size/4);
+            LINE(x + size, y + size/4, x + 2*size/3, y + size/2);
+            LINE(x + 2*size/3, y + size/2, x, y + size/2);
+            break;
+        case 'Q':
+            LINE(x + size/3, y, x + 2*size/3, y);
+            LINE(x + 2*size/3, y, x + size, y + size/3);
+            LINE(x + size, y + size/3, x + size, y + 2*size/3);
+            LINE(x + size, y + 2*size/3, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x + size/3, y + size);
+            LINE(x + size/3, y + size, x, y + 2*size/3);
+            LINE(x, y + 2*size/3, x, y + size/3);
+            LINE(x, y + size/3, x + size/3, y);
+            LINE(x + size/2, y + 2*size/3, x + size, y + size);
+            break;
+        case 'R':
+            LINE(x, y, x, y + size);
+            LINE(x, y, x + 2*size/3, y);
+            LINE(x + 2*size/3, y, x + size, y + size/4);
+            LINE(x + size, y + size/4, x + 2*size/3, y + size/2);
+            LINE(x + 2*size/3, y + size/2, x, y + size/2);
+            LINE(x + size/2, y + size/2, x + size, y + size);
+            break;
+        case 'S':
+            LINE(x + size, y, x + size/3, y);
+            LINE(x + size/3, y, x, y + size/3);
+            LINE(x, y + size/3, x + size/3, y + size/2);
+            LINE(x + size/3, y + size/2, x + 2*size/3, y + size/2);
+            LINE(x + 2*size/3, y + size/2, x + size, y + 2*size/3);
+            LINE(x + size, y + 2*size/3, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x, y + size);
+            break;
+        case 'T':
+            LINE(x, y, x + size, y);
+            LINE(x + size/2, y, x + size/2, y + size);
+            break;
+        case 'U':
+            LINE(x, y, x, y + 2*size/3);
+            LINE(x, y + 2*size/3, x + size/3, y + size);
+            LINE(x + size/3, y + size, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x + size, y + 2*size/3);
+            LINE(x + size, y + 2*size/3, x + size, y);
+            break;
+        case 'V':
+            LINE(x, y, x + size/2, y + size);
+            LINE(x + size/2, y + size, x + size, y);
+            break;
+        case 'W':
+            LINE(x, y, x + size/4, y + size);
+            LINE(x + size/4, y + size, x + size/2, y + size/2);
+            LINE(x + size/2, y + size/2, x + 3*size/4, y + size);
+            LINE(x + 3*size/4, y + size, x + size, y);
+            break;
+        case 'Y':
+            LINE(x, y, x + size/2, y + size/2);
+            LINE(x + size, y, x + size/2, y + size/2);
+            LINE(x + size/2, y + size/2, x + size/2, y + size);
+            break;
+        case '!':
+            LINE(x + size/2, y, x + size/2, y + 2*size/3);
+            LINE(x + size/2, y + 4*size/5, x + size/2, y + size);
+            break;
+        case '.':
+            LINE(x + size/2, y + 4*size/5, x + size/2, y + size);
+            break;
+        case ':':
+            LINE(x + size/2, y + size/4, x + size/2, y + size/3);
+            LINE(x + size/2, y + 2*size/3, x + size/2, y + 3*size/4);
+            break;
+        case ' ':
+            // Nothing for space
+            break;
+        case '0':
+            LINE(x + size/3, y, x + 2*size/3, y);
+            LINE(x + 2*size/3, y, x + size, y + size/3);
+            LINE(x + size, y + size/3, x + size, y + 2*size/3);
+            LINE(x + size, y + 2*size/3, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x + size/3, y + size);
+            LINE(x + size/3, y + size, x, y + 2*size/3);
+            LINE(x, y + 2*size/3, x, y + size/3);
+            LINE(x, y + size/3, x + size/3, y);
+            break;
+        case '1':
+            LINE(x + size/3, y, x + size/2, y);
+            LINE(x + size/2, y, x + size/2, y + size);
+            LINE(x + size/3, y + size, x + 2*size/3, y + size);
+            break;
+        case '2':
+            LINE(x + size/4, y, x + 3*size/4, y);
+            LINE(x + 3*size/4, y, x + size, y + size/4);
+            LINE(x + size, y + size/4, x + 3*size/4, y + size/2);
+            LINE(x + 3*size/4, y + size/2, x + size/4, y + size/2);
+            LINE(x + size/4, y + size/2, x, y + 3*size/4);
+            LINE(x, y + 3*size/4, x, y + size);
+            LINE(x, y + size, x + size, y + size);
+            break;
+        case '3':
+            LINE(x, y, x + 2*size/3, y);
+            LINE(x + 2*size/3, y, x + size, y + size/3);
+            LINE(x + size, y + size/3, x + 2*size/3, y + size/2);
+            LINE(x + 2*size/3, y + size/2, x + size/2, y + size/2);
+            LINE(x + 2*size/3, y + size/2, x + size, y + 2*size/3);
+            LINE(x + size, y + 2*size/3, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x, y + size);
+            break;
+        case '4':
+            LINE(x + 2*size/3, y, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y, x, y + 2*size/3);
+            LINE(x, y + 2*size/3, x + size, y + 2*size/3);
+            break;
+        case '5':
+            LINE(x, y, x + size, y);
+            LINE(x, y, x, y + size/2);
+            LINE(x, y + size/2, x + 2*size/3, y + size/2);
+            LINE(x + 2*size/3, y + size/2, x + size, y + 3*size/4);
+            LINE(x + size, y + 3*size/4, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x + size/3, y + size);
+            break;
+        case '6':
+            LINE(x + 2*size/3, y, x + size/3, y);
+            LINE(x + size/3, y, x, y + size/3);
+            LINE(x, y + size/3, x, y + 2*size/3);
+            LINE(x, y + 2*size/3, x + size/3, y + size);
+            LINE(x + size/3, y + size, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x + size, y + 2*size/3);
+            LINE(x + size, y + 2*size/3, x + size/2, y + size/2);
+            LINE(x + size/2, y + size/2, x, y + size/2);
+            break;
+        case '7':
+            LINE(x, y, x + size, y);
+            LINE(x + size, y, x + size/3, y + size);
+            break;
+        case '8':
+            LINE(x + size/3, y, x + 2*size/3, y);
+            LINE(x + 2*size/3, y, x + size, y + size/3);
+            LINE(x + size, y + size/3, x + 2*size/3, y + size/2);
+            LINE(x + 2*size/3, y + size/2, x + size/3, y + size/2);
+            LINE(x + size/3, y + size/2, x, y + size/3);
+            LINE(x, y + size/3, x + size/3, y);
+            LINE(x + size/3, y + size/2, x, y + 2*size/3);
+            LINE(x, y + 2*size/3, x + size/3, y + size);
+            LINE(x + size/3, y + size, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x + size, y + 2*size/3);
+            LINE(x + size, y + 2*size/3, x + 2*size/3, y + size/2);
+            break;
+        case '9':
+            LINE(x, y + 2*size/3, x + size/3, y + size);
+            LINE(x + size/3, y + size, x + 2*size/3, y + size);
+            LINE(x + 2*size/3, y + size, x + size, y + 2*size/3);
+            LINE(x + size, y + 2*size/3, x + size, y + size/3);
+            LINE(x + size, y + size/3, x + 2*size/3, y);
+            LINE(x + 2*size/3, y, x + size/3, y);
+            LINE(x + size/3, y, x, y + size/3);
+            LINE(x, y + size/3, x + size/2, y + size/2);
+            LINE(x + size/2, y + size/2, x + size, y + size/2);
+            break;
+        default:
+            // Default unknown character
+            LINE(x, y, x + size, y + size);
+            LINE(x, y + size, x + size, y);
+            break;
+    }
+#undef LINE
+    return n;
+}
+
+// Atlas cell of a character
+static int glyph_index(char c) {
+    unsigned char u = (unsigned char)c;
+    return (u >= GLYPH_FIRST && u <= GLYPH_LAST) ? u - GLYPH_FIRST : GLYPH_UNKNOWN;
+}
+
+// Set the pixels of a line (Bresenham) in a white-on-transparent image
+static void plot_line(Uint32 *pixels, int pitch, int ox, int oy, const GlyphLine *l) {
+    int x = l->x1, y = l->y1;
+    int dx = abs(l->x2 - l->x1), sx = l->x1 < l->x2 ? 1 : -1;
+    int dy = -abs(l->y2 - l->y1), sy = l->y1 < l->y2 ? 1 : -1;
+    int err = dx + dy;
+    for (;;) {
+        pixels[(oy + y) * pitch + ox + x] = 0xFFFFFFFFu;
+        if (x == l->x2 && y == l->y2) break;
+        int e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x += sx; }
+        if (e2 <= dx) { err += dx; y += sy; }
+    }
+}
+
+// Rasterize the glyphs of a size into an atlas texture
+static bool build_atlas(GlyphAtlas *atlas, SDL_Renderer *renderer, int size) {
+    int cell = size + 2;     // Glyphs span size + 1 pixels; one pixel of gap
+    int width = GLYPH_ATLAS_COLUMNS * cell;
+    int height = (GLYPH_COUNT + GLYPH_ATLAS_COLUMNS - 1) / GLYPH_ATLAS_COLUMNS * cell;
+    Uint32 *pixels = calloc((size_t)width * height, sizeof(Uint32));
+    if (pixels == NULL) {
+        perror("Failed to allocate glyph atlas");
+        return false;
+    }
+
+    GlyphLine lines[GLYPH_MAX_LINES];
+    for (int g = 0; g < GLYPH_COUNT; g++) {
+        char c = g == GLYPH_UNKNOWN ? 127 : (char)(g + GLYPH_FIRST);
+        int ox = g % GLYPH_ATLAS_COLUMNS * cell;
+        int oy = g / GLYPH_ATLAS_COLUMNS * cell;
+        int n = glyph_lines(c, size, lines);
+        for (int i = 0; i < n; i++) {
+            plot_line(pixels, width, ox, oy, &lines[i]);
+        }
+    }
+
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                             SDL_TEXTUREACCESS_STATIC, width, height);
+    if (texture == NULL) {
+        printf("Failed to create glyph atlas: %s\n", SDL_GetError());
+        free(pixels);
+        return false;
+    }
+    SDL_UpdateTexture(texture, NULL, pixels, width * (int)sizeof(Uint32));
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    free(pixels);
+
+    atlas->size = size;
+    atlas->cell = cell;
+    atlas->texture = texture;
+    atlas->renderer = renderer;
+    return true;
+}
+
+// Atlas of a glyph size, built on first use; NULL if it cannot be created
+static GlyphAtlas *get_atlas(SDL_Renderer *renderer, int size) {
+    if (size <= 0 || size > 512) return NULL;
+
+    GlyphAtlas *slot = NULL;
+    for (int i = 0; i < TEXT_MAX_ATLASES; i++) {
+        if (atlases[i].size == size) {
+            if (atlases[i].renderer == renderer) return &atlases[i];
+            slot = &atlases[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        for (int i = 0; i < TEXT_MAX_ATLASES && slot == NULL; i++) {
+            if (atlases[i].size == 0) slot = &atlases[i];
+        }
+    }
+    if (slot == NULL) {
+        slot = &atlases[next_atlas];
+        next_atlas = (next_atlas + 1) % TEXT_MAX_ATLASES;
+    }
+
+    if (slot->texture != NULL) {
+        SDL_DestroyTexture(slot->texture);
+    }
+    memset(slot, 0, sizeof(GlyphAtlas));
+    return build_atlas(slot, renderer, size) ? slot : NULL;
+}
+
+// Hash of a cache key
+static unsigned int text_hash(const char *text, int size, SDL_Color color) {
+    unsigned int h = 2166136261u;
+    for (const char *p = text; *p; p++) {
+        h = (h ^ (unsigned char)*p) * 16777619u;
+    }
+    h = (h ^ (unsigned int)size) * 16777619u;
+    h = (h ^ ((unsigned int)color.r << 24 | (unsigned int)color.g << 16 |
+              (unsigned int)color.b << 8 | color.a)) * 16777619u;
+    return h;
+}
+
+// Lay out the quads of a string (one per visible character, positions
+// relative to the string's origin)
+static void layout_text(TextCacheEntry *entry, const GlyphAtlas *atlas, const char *text,
+                        int size, SDL_Color color) {
+    int spacing = size + size/3;
+    float atlas_width = (float)(GLYPH_ATLAS_COLUMNS * atlas->cell);
+    float atlas_height = (float)((GLYPH_COUNT + GLYPH_ATLAS_COLUMNS - 1) / GLYPH_ATLAS_COLUMNS * atlas->cell);
+    float extent = (float)(size + 1);
+    GlyphLine lines[GLYPH_MAX_LINES];
+
+    entry->num_vertices = 0;
+    for (int i = 0; text[i] != '\0' && i < TEXT_CACHE_MAX_LENGTH; i++) {
+        if (glyph_lines(text[i], size, lines) == 0) continue;
+
+        int g = glyph_index(text[i]);
+        float u0 = g % GLYPH_ATLAS_COLUMNS * atlas->cell / atlas_width;
+        float v0 = g / GLYPH_ATLAS_COLUMNS * atlas->cell / atlas_height;
+        float u1 = u0 + extent / atlas_width;
+        float v1 = v0 + extent / atlas_height;
+        float x0 = (float)(i * spacing);
+        float x1 = x0 + extent;
+
+        SDL_Vertex *v = &entry->vertices[entry->num_vertices];
+        v[0] = (SDL_Vertex){{x0, 0}, color, {u0, v0}};
+        v[1] = (SDL_Vertex){{x1, 0}, color, {u1, v0}};
+        v[2] = (SDL_Vertex){{x1, extent}, color, {u1, v1}};
+        v[3] = (SDL_Vertex){{x0, extent}, color, {u0, v1}};
+        entry->num_vertices += 4;
+    }
+
+    strncpy(entry->text, text, TEXT_CACHE_MAX_LENGTH);
+    entry->text[TEXT_CACHE_MAX_LENGTH] = '\0';
+    entry->size = size;
+    entry->color = color;
+    entry->used = true;
+}
+
+// Draw text as lines, one call per line
+static void draw_text_lines(SDL_Renderer* renderer, int x, int y, const char* text, int size, SDL_Color color) {
+    int spacing = size + size/3;
+    GlyphLine lines[GLYPH_MAX_LINES];
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    for (int i = 0; text[i] != '\0'; i++) {
+        int n = glyph_lines(text[i], size, lines);
+        int cx = x + i * spacing;
+        for (int k = 0; k < n; k++) {
+            SDL_RenderDrawLine(renderer, cx + lines[k].x1, y + lines[k].y1, cx + lines[k].x2, y + lines[k].y2);
+        }
+    }
+}
+
+// Draw a string with its top-left corner at (x, y), characters size pixels
+// tall, in the given colour
+void draw_text(SDL_Renderer* renderer, int x, int y, const char* text, int size, SDL_Color color) {
+    if (text == NULL || text[0] == '\0') return;
+
+    GlyphAtlas *atlas = get_atlas(renderer, size);
+    if (atlas == NULL || strlen(text) > TEXT_CACHE_MAX_LENGTH) {
+        draw_text_lines(renderer, x, y, text, size, color);
+        return;
+    }
+
+    // Reuse the cached layout if this string was drawn recently
+    TextCacheEntry *entry = &text_cache[text_hash(text, size, color) % TEXT_CACHE_ENTRIES];
+    if (!entry->used || entry->size != size || strcmp(entry->text, text) != 0 ||
+        memcmp(&entry->color, &color, sizeof(SDL_Color)) != 0) {
+        layout_text(entry, atlas, text, size, color);
+    }
+    if (entry->num_vertices == 0) return;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (!quad_indices_ready) {
+        for (int q = 0; q < TEXT_CACHE_MAX_LENGTH; q++) {
+            int *index = &quad_indices[q * 6];
+            index[0] = q * 4; index[1] = q * 4 + 1; index[2] = q * 4 + 2;
+            index[3] = q * 4; index[4] = q * 4 + 2; index[5] = q * 4 + 3;
+        }
+        quad_indices_ready = true;
+    }
+    for (int i = 0; i < entry->num_vertices; i++) {
+        placed[i] = entry->vertices[i];
+        placed[i].position.x += x;
+        placed[i].position.y += y;
+    }
+    SDL_RenderGeometry(renderer, atlas->texture, placed, entry->num_vertices,
+                       quad_indices, entry->num_vertices / 4 * 6);
+#else
+    // One copy per character, tinted through the texture modulation
+    SDL_SetTextureColorMod(atlas->texture, color.r, color.g, color.b);
+    SDL_SetTextureAlphaMod(atlas->texture, color.a);
+    int spacing = size + size/3;
+    for (int i = 0; text[i] != '\0'; i++) {
+        int g = glyph_index(text[i]);
+        SDL_Rect src = {g % GLYPH_ATLAS_COLUMNS * atlas->cell, g / GLYPH_ATLAS_COLUMNS * atlas->cell, size + 1, size + 1};
+        SDL_Rect dest = {x + i * spacing, y, size + 1, size + 1};
+        SDL_RenderCopy(renderer, atlas->texture, &src, &dest);
+    }
+#endif
+}
+
+// Draw a simple text string (always white, as it has always been)
+void draw_simple_text(SDL_Renderer* renderer, int x, int y, const char* text, int size) {
+    SDL_Color white = {255, 255, 255, 255};
+    draw_text(renderer, x, y, text, size, white);
+}
+
+// Free the glyph atlases and forget cached layouts (at exit, or after
+// SDL_RENDER_DEVICE_RESET; atlases are rebuilt on next use)
+void text_cache_destroy(void) {
+    for (int i = 0; i < TEXT_MAX_ATLASES; i++) {
+        if (atlases[i].texture != NULL) {
+            SDL_DestroyTexture(atlases[i].texture);
+        }
+    }
+    memset(atlases, 0, sizeof(atlases));
+    next_atlas = 0;
+    for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+        text_cache[i].used = false;
+    }
+}
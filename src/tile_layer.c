@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/tile_layer.h"
+#include "../include/render_batch.h"
+
+// Tile colours (game.c)
+extern SDL_Color tile_colors[6];
+
+// What a texture cell currently shows
+#define CELL_UNKNOWN -2      // Never drawn, or the texture was lost
+#define CELL_OUTSIDE -1      // Position outside the map (transparent)
+
+typedef struct {
+    int map_x;
+    int map_y;
+    int tile;
+} LayerCell;
+
+// Layer state (main process only)
+static SDL_Texture *layer_texture = NULL;
+static SDL_Renderer *layer_renderer = NULL;
+static LayerCell *layer_cells = NULL;
+static int layer_columns = 0;
+static int layer_rows = 0;
+static bool layer_unsupported = false;
+
+// Keys, treasures and the exit change every frame; they are drawn on top
+bool tile_layer_is_animated(TileType tile) {
+    return tile == TILE_KEY || tile == TILE_TREASURE || tile == TILE_EXIT;
+}
+
+// Queue the static look of a tile with its top-left corner at (x, y) on the
+// render batch. Doors keep the frame brightness that used to be the middle
+// of their pulse.
+void tile_layer_draw_tile(TileType tile, int map_y, int x, int y) {
+    // The exit is covered by its animated fill; show floor until then
+    render_batch_rect(x, y, TILE_SIZE, TILE_SIZE, tile_colors[tile == TILE_EXIT ? TILE_EMPTY : tile]);
+
+    if (tile == TILE_WALL) {
+        // Brick lines, alternating direction by row
+        SDL_Color brick = {40, 42, 54, 255};
+        if (map_y % 2 == 0) {
+            render_batch_rect(x, y + TILE_SIZE/2, TILE_SIZE, 1, brick);
+        } else {
+            render_batch_rect(x + TILE_SIZE/2, y, 1, TILE_SIZE, brick);
+        }
+    } else if (tile == TILE_DOOR) {
+        // Door frame, handle and panel line
+        SDL_Color frame = {120, 64, 32, 255};
+        render_batch_rect(x + 2, y + 2, TILE_SIZE - 4, 1, frame);
+        render_batch_rect(x + 2, y + TILE_SIZE - 3, TILE_SIZE - 4, 1, frame);
+        render_batch_rect(x + 2, y + 3, 1, TILE_SIZE - 6, frame);
+        render_batch_rect(x + TILE_SIZE - 3, y + 3, 1, TILE_SIZE - 6, frame);
+        render_batch_rect(x + TILE_SIZE * 3/4 - 2, y + TILE_SIZE/2 - 2, 4, 4, frame);
+        render_batch_line(x + TILE_SIZE/2, y + 4, x + TILE_SIZE/2, y + TILE_SIZE - 4, frame);
+    }
+}
+
+// Non-negative remainder
+static int wrap(int value, int size) {
+    int r = value % size;
+    return r < 0 ? r + size : r;
+}
+
+// Create the texture and cell table for a columns x rows viewport
+static bool create_layer(SDL_Renderer *renderer, int columns, int rows) {
+    tile_layer_destroy();
+
+    if (!SDL_RenderTargetSupported(renderer)) {
+        printf("Render targets not supported; drawing tiles directly\n");
+        layer_unsupported = true;
+        return false;
+    }
+
+    layer_cells = malloc((size_t)columns * rows * sizeof(LayerCell));
+    if (layer_cells == NULL) {
+        perror("Failed to allocate tile layer");
+        return false;
+    }
+
+    layer_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                      columns * TILE_SIZE, rows * TILE_SIZE);
+    if (layer_texture == NULL) {
+        printf("Failed to create tile layer texture: %s\n", SDL_GetError());
+        free(layer_cells);
+        layer_cells = NULL;
+        layer_unsupported = true;
+        return false;
+    }
+    SDL_SetTextureBlendMode(layer_texture, SDL_BLENDMODE_BLEND);
+
+    layer_renderer = renderer;
+    layer_columns = columns;
+    layer_rows = rows;
+    tile_layer_invalidate();
+    return true;
+}
+
+// Bring the cells under the snapshot's viewport up to date, show the layer
+// and list the visible animated tiles (screen positions relative to the
+// viewport). Returns the number of animated tiles, or -1 if the layer is
+// unavailable and the caller should draw the tiles itself.
+int tile_layer_render(SDL_Renderer *renderer, const RenderSnapshot *snapshot,
+                      AnimatedTile *animated, int max_animated) {
+    int start_x = snapshot->start_x;
+    int start_y = snapshot->start_y;
+    int columns = snapshot->columns;
+    int rows = snapshot->rows;
+    if (layer_unsupported || columns <= 0 || rows <= 0) {
+        return -1;
+    }
+    if (layer_texture == NULL || layer_renderer != renderer ||
+        layer_columns != columns || layer_rows != rows) {
+        if (!create_layer(renderer, columns, rows)) {
+            return -1;
+        }
+    }
+
+    int num_animated = 0;
+    bool drawing = false;
+
+    for (int y = 0; y < rows; y++) {
+        int map_y = start_y + y;
+        int cell_y = wrap(map_y, rows);
+        for (int x = 0; x < columns; x++) {
+            int map_x = start_x + x;
+            int cell_x = wrap(map_x, columns);
+
+            int tile = snapshot->tiles[y * columns + x];
+            if (tile == SNAPSHOT_TILE_OUTSIDE) {
+                tile = CELL_OUTSIDE;
+            } else if (tile_layer_is_animated((TileType)tile) && num_animated < max_animated) {
+                AnimatedTile *a = &animated[num_animated++];
+                a->map_x = map_x;
+                a->map_y = map_y;
+                a->screen_x = x * TILE_SIZE;
+                a->screen_y = y * TILE_SIZE;
+                a->tile = (TileType)tile;
+            }
+
+            LayerCell *cell = &layer_cells[cell_y * columns + cell_x];
+            if (cell->tile == tile && cell->map_x == map_x && cell->map_y == map_y) {
+                continue;
+            }
+
+            // Redraw only the cells whose tile changed or scrolled in
+            drawing = true;
+            int px = cell_x * TILE_SIZE;
+            int py = cell_y * TILE_SIZE;
+            if (tile == CELL_OUTSIDE) {
+                SDL_Color clear = {0, 0, 0, 0};
+                render_batch_rect(px, py, TILE_SIZE, TILE_SIZE, clear);
+            } else {
+                tile_layer_draw_tile((TileType)tile, map_y, px, py);
+            }
+            cell->map_x = map_x;
+            cell->map_y = map_y;
+            cell->tile = tile;
+        }
+    }
+
+    // Draw the changed cells into the texture in one batch, replacing what
+    // was there (cells outside the map become transparent)
+    if (drawing) {
+        SDL_BlendMode mode;
+        SDL_GetRenderDrawBlendMode(renderer, &mode);
+        SDL_SetRenderTarget(renderer, layer_texture);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        render_batch_flush(renderer);
+        SDL_SetRenderDrawBlendMode(renderer, mode);
+        SDL_SetRenderTarget(renderer, NULL);
+    }
+
+    // The viewport starts at cell (cx, cy) and wraps around the texture, so
+    // it is shown as up to four pieces (one when it is aligned)
+    int cx = wrap(start_x, columns);
+    int cy = wrap(start_y, rows);
+    int widths[2] = {columns - cx, cx};
+    int heights[2] = {rows - cy, cy};
+    int dest_y = 0;
+    for (int j = 0; j < 2; j++) {
+        if (heights[j] == 0) continue;
+        int src_y = j == 0 ? cy : 0;
+        int dest_x = 0;
+        for (int i = 0; i < 2; i++) {
+            if (widths[i] == 0) continue;
+            int src_x = i == 0 ? cx : 0;
+            SDL_Rect src = {src_x * TILE_SIZE, src_y * TILE_SIZE, widths[i] * TILE_SIZE, heights[j] * TILE_SIZE};
+            SDL_Rect dest = {dest_x, dest_y, src.w, src.h};
+            SDL_RenderCopy(renderer, layer_texture, &src, &dest);
+            dest_x += src.w;
+        }
+        dest_y += heights[j] * TILE_SIZE;
+    }
+
+    return num_animated;
+}
+
+// Forget the texture contents (after SDL_RENDER_TARGETS_RESET); every cell
+// is redrawn on the next frame
+void tile_layer_invalidate(void) {
+    if (layer_cells == NULL) return;
+
+    for (int i = 0; i < layer_columns * layer_rows; i++) {
+        layer_cells[i].map_x = 0;
+        layer_cells[i].map_y = 0;
+        layer_cells[i].tile = CELL_UNKNOWN;
+    }
+}
+
+// Free the texture and cell table (also after SDL_RENDER_DEVICE_RESET, when
+// the texture itself is gone; it is recreated on the next frame)
+void tile_layer_destroy(void) {
+    if (layer_texture != NULL) {
+        SDL_DestroyTexture(layer_texture);
+        layer_texture = NULL;
+    }
+    free(layer_cells);
+    layer_cells = NULL;
+    layer_renderer = NULL;
+    layer_columns = 0;
+    layer_rows = 0;
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/ui_cache.h"
+
+// Colour of each pixel of a gradient; key is the gradient's input
+typedef void (*GradientFill)(SDL_Color *colors, int length, int key);
+
+// A cached gradient (main process only)
+typedef struct {
+    GradientFill fill;
+    int length;              // Pixels along the gradient
+    bool vertical;           // Colour changes with y (one pixel wide texture)
+    bool built;
+    int key;                 // Input the colours were computed for
+    SDL_Renderer *renderer;
+    SDL_Texture *texture;    // NULL if textures are unavailable
+    SDL_Color colors[UI_GRADIENT_MAX_LENGTH];
+} Gradient;
+
+// Dark blue-grey game background, top to bottom
+static void fill_background(SDL_Color *colors, int length, int key) {
+    (void)key;
+    for (int y = 0; y < length; y++) {
+        int gradient = 20 + (y * 10 / WINDOW_HEIGHT);
+        colors[y] = (SDL_Color){gradient/2, gradient/2, gradient, 255};
+    }
+}
+
+// Welcome screen background, top to bottom
+static void fill_welcome(SDL_Color *colors, int length, int key) {
+    (void)key;
+    for (int y = 0; y < length; y++) {
+        float progress = (float)y / WINDOW_HEIGHT;
+        colors[y] = (SDL_Color){(Uint8)(20 + 10 * progress), (Uint8)(20 + 15 * progress),
+                                (Uint8)(40 + 20 * progress), 255};
+    }
+}
+
+// HUD bar along the bottom of the window, top to bottom
+static void fill_hud(SDL_Color *colors, int length, int key) {
+    (void)key;
+    for (int y = 0; y < length; y++) {
+        float fade = (float)y / 40.0f;
+        colors[y] = (SDL_Color){(Uint8)(20 + fade * 20), (Uint8)(20 + fade * 20),
+                                (Uint8)(30 + fade * 20), (Uint8)(200 + fade * 55)};
+    }
+}
+
+// Timer box at the top of the window, top to bottom
+static void fill_timer(SDL_Color *colors, int length, int key) {
+    (void)key;
+    for (int y = 0; y < length; y++) {
+        float fade = (float)y / 25.0f;
+        colors[y] = (SDL_Color){(Uint8)(20 + fade * 20), (Uint8)(20 + fade * 20),
+                                (Uint8)(30 + fade * 20), (Uint8)(200 - fade * 100)};
+    }
+}
+
+// Score bar, orange to gold from left to right
+static void fill_score(SDL_Color *colors, int length, int key) {
+    (void)key;
+    for (int x = 0; x < length; x++) {
+        float progress = (float)x / (WINDOW_WIDTH/3 - 25);
+        colors[x] = (SDL_Color){(Uint8)(255 * (1.0f - progress)),
+                                (Uint8)(215 * progress + 180 * (1.0f - progress)),
+                                (Uint8)(0 * progress + 40 * (1.0f - progress)), 255};
+    }
+}
+
+// Health bar, redder as health (the key) drops
+static void fill_health(SDL_Color *colors, int length, int key) {
+    float health_percent = key / 100.0f;
+    for (int x = 0; x < length; x++) {
+        float progress = (float)x / (WINDOW_WIDTH/3 - 30);
+        colors[x] = (SDL_Color){(Uint8)(255 * (1.0f - progress * health_percent)),
+                                (Uint8)(80 * (1.0f - health_percent) + 220 * health_percent * progress),
+                                (Uint8)(80 * (1.0f - health_percent)), 255};
+    }
+}
+
+static Gradient background = {.fill = fill_background, .length = WINDOW_HEIGHT, .vertical = true};
+static Gradient welcome = {.fill = fill_welcome, .length = WINDOW_HEIGHT, .vertical = true};
+static Gradient hud = {.fill = fill_hud, .length = 40, .vertical = true};
+static Gradient timer = {.fill = fill_timer, .length = 25, .vertical = true};
+static Gradient score_bar = {.fill = fill_score, .length = WINDOW_WIDTH/3 - 25, .vertical = false};
+static Gradient health_bar = {.fill = fill_health, .length = WINDOW_WIDTH/3 - 30, .vertical = false};
+
+static Gradient *gradients[] = {&background, &welcome, &hud, &timer, &score_bar, &health_bar};
+#define NUM_GRADIENTS ((int)(sizeof(gradients) / sizeof(gradients[0])))
+
+// Compute the colours for key and upload them to the gradient's texture,
+// creating it on first use
+static void build_gradient(SDL_Renderer *renderer, Gradient *g, int key) {
+    g->fill(g->colors, g->length, key);
+    g->key = key;
+    g->built = true;
+
+    if (g->texture == NULL || g->renderer != renderer) {
+        if (g->texture != NULL) {
+            SDL_DestroyTexture(g->texture);
+        }
+        g->renderer = renderer;
+        g->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC,
+                                       g->vertical ? 1 : g->length, g->vertical ? g->length : 1);
+        if (g->texture == NULL) {
+            printf("Failed to create gradient texture: %s\n", SDL_GetError());
+            return;
+        }
+        // Replace what is underneath, as the line drawing did
+        SDL_SetTextureBlendMode(g->texture, SDL_BLENDMODE_NONE);
+    }
+
+    Uint32 pixels[UI_GRADIENT_MAX_LENGTH];
+    for (int i = 0; i < g->length; i++) {
+        SDL_Color c = g->colors[i];
+        pixels[i] = (Uint32)c.r << 24 | (Uint32)c.g << 16 | (Uint32)c.b << 8 | c.a;
+    }
+    SDL_UpdateTexture(g->texture, NULL, pixels, g->vertical ? (int)sizeof(Uint32) : g->length * (int)sizeof(Uint32));
+}
+
+// Fill dest with the first count pixels of the gradient, stretched across
+// the other axis
+static void draw_gradient(SDL_Renderer *renderer, Gradient *g, int key, int count, SDL_Rect dest) {
+    if (count > g->length) count = g->length;
+    if (count <= 0) return;
+
+    if (!g->built || g->key != key || g->renderer != renderer) {
+        build_gradient(renderer, g, key);
+    }
+
+    if (g->texture != NULL) {
+        SDL_Rect src = {0, 0, g->vertical ? 1 : count, g->vertical ? count : 1};
+        if (g->vertical) dest.h = count; else dest.w = count;
+        SDL_RenderCopy(renderer, g->texture, &src, &dest);
+        return;
+    }
+
+    // No texture: one line per pixel
+    for (int i = 0; i < count; i++) {
+        SDL_Color c = g->colors[i];
+        SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+        if (g->vertical) {
+            SDL_RenderDrawLine(renderer, dest.x, dest.y + i, dest.x + dest.w - 1, dest.y + i);
+        } else {
+            SDL_RenderDrawLine(renderer, dest.x + i, dest.y, dest.x + i, dest.y + dest.h - 1);
+        }
+    }
+}
+
+// Game background behind the map
+void ui_draw_background(SDL_Renderer *renderer) {
+    SDL_Rect dest = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
+    draw_gradient(renderer, &background, 0, WINDOW_HEIGHT, dest);
+}
+
+// Welcome screen background
+void ui_draw_welcome_background(SDL_Renderer *renderer) {
+    SDL_Rect dest = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
+    draw_gradient(renderer, &welcome, 0, WINDOW_HEIGHT, dest);
+}
+
+// Background of the HUD bar
+void ui_draw_hud_background(SDL_Renderer *renderer) {
+    SDL_Rect dest = {0, WINDOW_HEIGHT - 40, WINDOW_WIDTH, 40};
+    draw_gradient(renderer, &hud, 0, 40, dest);
+}
+
+// Background of the timer box
+void ui_draw_timer_background(SDL_Renderer *renderer) {
+    SDL_Rect dest = {WINDOW_WIDTH/2 - 60, 0, 121, 25};
+    draw_gradient(renderer, &timer, 0, 25, dest);
+}
+
+// Score bar filled to width pixels, top-left corner at (x, y)
+void ui_draw_score_bar(SDL_Renderer *renderer, int x, int y, int width) {
+    SDL_Rect dest = {x, y, width, 14};
+    draw_gradient(renderer, &score_bar, 0, width, dest);
+}
+
+// Health bar filled in proportion to health, top-left corner at (x, y)
+void ui_draw_health_bar(SDL_Renderer *renderer, int x, int y, int health) {
+    int width = (WINDOW_WIDTH/3 - 30) * health / 100;
+    SDL_Rect dest = {x, y, width, 14};
+    draw_gradient(renderer, &health_bar, health, width, dest);
+}
+
+// Free the gradient textures (at exit, or after SDL_RENDER_DEVICE_RESET; they
+// are rebuilt on next use)
+void ui_cache_destroy(void) {
+    for (int i = 0; i < NUM_GRADIENTS; i++) {
+        if (gradients[i]->texture != NULL) {
+            SDL_DestroyTexture(gradients[i]->texture);
+            gradients[i]->texture = NULL;
+        }
+        gradients[i]->renderer = NULL;
+        gradients[i]->built = false;
+    }
+}